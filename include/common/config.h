@@ -38,6 +38,19 @@ inline FailoverStrategy parse_failover_strategy(const std::string& s) {
     return FailoverStrategy::kRoundRobin;
 }
 
+// Hot-standby replication role
+enum class ReplicationRole {
+    kNone,
+    kPrimary,     // Streams subscription changes to a standby
+    kStandby      // Applies the primary's stream into its own workers
+};
+
+inline ReplicationRole parse_replication_role(const std::string& s) {
+    if (s == "primary")  return ReplicationRole::kPrimary;
+    if (s == "standby")  return ReplicationRole::kStandby;
+    return ReplicationRole::kNone;
+}
+
 struct Config {
     // General
     std::string service_id     = "sip-proc-01";
@@ -53,9 +66,38 @@ struct Config {
     size_t num_workers                   = 0;
     size_t max_incoming_queue_per_worker = 50000;
     size_t max_dialogs_per_worker        = 2000000;
+    size_t dispatcher_max_workers        = 64;     // Upper bound for online resize
+    size_t dispatcher_ring_vnodes        = 128;    // Hash ring points per worker
+    Seconds dispatcher_rebalance_interval      = Seconds(10);   // 0 = never migrate dialogs
+    size_t  dispatcher_rebalance_threshold_pct = 25;
+    size_t  dispatcher_rebalance_max_moves     = 1000;
+    size_t  dispatcher_feed_batch              = 1024;  // Feed events per worker cycle, 0 = all
+    size_t  dispatcher_feed_guard_batch        = 64;    // Same, while SIP transactions wait
+
+    // Overload control: pressure is each signal over its limit (0 = ignored)
+    bool      overload_enabled             = true;
+    Millisecs overload_sample_interval     = Millisecs(250);
+    size_t    overload_queue_fill_pct      = 80;     // Worker lane fill at full pressure
+    Millisecs overload_queue_wait_p99      = Millisecs(200);
+    size_t    overload_notify_backlog      = 20000;  // NOTIFYs awaiting a response
+    size_t    overload_elevated_pct        = 50;     // Pressure that starts coalescing
+    size_t    overload_shed_pct            = 75;     // Pressure that starts shedding
+    uint32_t  overload_retry_after_sec     = 30;
+    uint32_t  overload_refresh_expires_sec = 3600;   // 0 = never lengthen
+
+    // SUBSCRIBE Expires negotiation (max 0 = unlimited)
+    uint32_t    expires_blf_min_sec      = 60;
+    uint32_t    expires_blf_max_sec      = 3600;
+    uint32_t    expires_blf_default_sec  = 3600;
+    uint32_t    expires_mwi_min_sec      = 60;
+    uint32_t    expires_mwi_max_sec      = 7200;
+    uint32_t    expires_mwi_default_sec  = 3600;
+    std::string expires_tenant_overrides;             // "tenant:BLF:min:max,..."
+    Seconds     expires_checkpoint       = Seconds(300);  // Refresh persist lag (at most Expires/2), 0 = every refresh
 
     // Tenant
     size_t max_subscriptions_per_tenant  = 5000;
+    size_t max_interned_symbols          = 16777216;   // Tenant ids + monitored URIs; never freed
 
     // Reaper
     Seconds blf_subscription_ttl         = Seconds(3600);
@@ -69,12 +111,35 @@ struct Config {
     Seconds  presence_reconnect_max_interval = Seconds(60);
     Seconds  presence_read_timeout           = Seconds(30);
     size_t   presence_recv_buffer_size       = 65536;
+    std::string presence_io_backend          = "poll";   // poll | io_uring (falls back to poll)
+    size_t   presence_uring_buffers          = 16;       // Provided buffers of recv_buffer_size
     Seconds  presence_heartbeat_interval     = Seconds(15);
     int      presence_heartbeat_miss_threshold = 3;
     size_t   presence_max_pending_events     = 100000;
+    size_t   presence_watcher_prefilter      = 4194304;  // Bloom counters before BLF lookups; 0 = off
     FailoverStrategy presence_failover_strategy = FailoverStrategy::kRoundRobin;
     Seconds  presence_health_check_interval  = Seconds(30);
     Seconds  presence_server_cooldown        = Seconds(120);
+    bool     presence_publish_interest       = false;    // Servers are presence distributors
+    size_t   presence_interest_bits_per_uri  = 10;       // ~1% false positives
+    Seconds  presence_interest_interval      = Seconds(5);    // For removals; new URIs publish at once
+
+    // Presence distributor: forwards each call-state event only to the
+    // nodes whose published interest covers it
+    bool        distributor_enabled          = false;    // Embedded in this processor
+    std::string distributor_bind_address     = "0.0.0.0";
+    uint16_t    distributor_listen_port      = 9100;
+    size_t      distributor_max_node_backlog = 16 * 1024 * 1024;   // Bytes queued per node
+
+    // Hot-standby replication of subscription state
+    ReplicationRole replication_role                     = ReplicationRole::kNone;
+    std::string     replication_bind_address             = "0.0.0.0";     // Primary
+    uint16_t        replication_listen_port              = 9200;          // Primary
+    std::string     replication_primary_host             = "127.0.0.1";   // Standby
+    uint16_t        replication_primary_port             = 9200;          // Standby
+    Seconds         replication_heartbeat_interval       = Seconds(1);
+    int             replication_heartbeat_miss_threshold = 3;
+    size_t          replication_max_backlog              = 64 * 1024 * 1024;   // Bytes queued before resync
 
     // MongoDB
     std::string mongo_uri                    = "mongodb://localhost:27017";
@@ -91,11 +156,26 @@ struct Config {
     size_t      mongo_batch_size             = 500;
     bool        mongo_enable_persistence     = true;
 
+    // Local snapshot + journal (warm restart without MongoDB)
+    bool        snapshot_enabled                = false;
+    std::string snapshot_directory              = "/var/lib/sip_processor";
+    Seconds     snapshot_interval               = Seconds(300);
+    Millisecs   snapshot_journal_flush_interval = Millisecs(200);
+    bool        snapshot_fsync                  = false;
+    size_t      snapshot_load_threads           = 0;      // 0 = num_workers
+    bool        snapshot_reconcile_with_mongo   = true;
+
+    // Full-state NOTIFYs owed to recovered dialogs, paced per worker
+    Seconds     recovery_notify_window          = Seconds(60);   // 0 = send on re-attach
+    int         recovery_notify_min_rate        = 20;            // Per worker per second
+
     // Slow event logging thresholds
     Millisecs slow_event_warn_threshold      = Millisecs(50);
     Millisecs slow_event_error_threshold     = Millisecs(200);
     Millisecs slow_event_critical_threshold  = Millisecs(1000);
     bool      slow_event_log_stack_trace     = false;
+    size_t    slow_event_top_n               = 32;     // Slowest events kept for /stats/slow
+    Seconds   slow_event_top_window          = Seconds(60);
 
     // HTTP server
     bool        http_enabled            = true;
@@ -104,6 +184,20 @@ struct Config {
     Seconds     http_read_timeout       = Seconds(30);
     Seconds     http_write_timeout      = Seconds(30);
     size_t      http_max_connections    = 100;
+    size_t      http_handler_threads    = 2;
+    size_t      http_max_request_bytes  = 1024 * 1024;
+    bool        http_mwi_feed_enabled   = false;  // POST /mwi mailbox updates; unauthenticated
+
+    // Thread placement: CPU lists like "0-3,8" or "node1"; empty = unpinned
+    bool        affinity_enabled        = false;
+    std::string affinity_workers;
+    std::string affinity_sip;
+    std::string affinity_presence;
+    std::string affinity_router;
+    std::string affinity_persistence;
+    std::string affinity_http;
+    std::string affinity_logging;
+    std::string affinity_maintenance;
 
     // Logging
     std::string log_directory           = "/var/log/sip_processor";
@@ -111,6 +205,10 @@ struct Config {
     std::string log_console_level_str   = "warn";
     size_t      log_max_file_size_mb    = 50;
     int         log_max_rotated_files   = 10;
+    bool        log_async               = true;
+    size_t      log_thread_buffer_kb    = 256;       // Per logging thread ring
+    Millisecs   log_flush_interval      = Millisecs(10);
+    std::string log_overflow_policy     = "count";   // drop | count
 
     // Parse from INI-style config file
     static Config load_from_file(const std::string& path);
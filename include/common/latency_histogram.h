@@ -0,0 +1,162 @@
+
+// =============================================================================
+// FILE: include/common/latency_histogram.h
+// =============================================================================
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include "common/types.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sip_processor {
+
+// Pipeline stages with a latency histogram
+enum class LatencyStage : uint8_t {
+    kSipCallbackToDispatch = 0,  // Sofia callback entry -> dispatcher enqueue
+    kQueueWait,                  // Dispatcher enqueue -> worker dequeue
+    kQueueWaitSip,               // Same, SIP transactions only
+    kQueueWaitFeed,              // Same, presence and MWI feed events only
+    kProcessEvent,               // DialogWorker::process_event duration
+    kPresenceToRouter,           // Presence feed receive -> router pickup
+    kPresenceRoute,              // Router lookup + fan-out per call-state event
+    kPresenceToNotify,           // Presence feed receive -> NOTIFY sent
+    kMongoFlush,                 // SubscriptionStore batch flush duration
+    kCount
+};
+
+inline const char* latency_stage_name(LatencyStage s) {
+    switch (s) {
+        case LatencyStage::kSipCallbackToDispatch: return "sip_callback_to_dispatch";
+        case LatencyStage::kQueueWait:             return "queue_wait";
+        case LatencyStage::kQueueWaitSip:          return "queue_wait_sip";
+        case LatencyStage::kQueueWaitFeed:         return "queue_wait_feed";
+        case LatencyStage::kProcessEvent:          return "process_event";
+        case LatencyStage::kPresenceToRouter:      return "presence_to_router";
+        case LatencyStage::kPresenceRoute:         return "presence_route";
+        case LatencyStage::kPresenceToNotify:      return "presence_to_notify";
+        case LatencyStage::kMongoFlush:            return "mongo_flush";
+        default:                                   return "unknown";
+    }
+}
+
+constexpr size_t kNumLatencyStages = static_cast<size_t>(LatencyStage::kCount);
+
+// HDR-style log-linear histogram of nanosecond values: 2^kSubBits linear
+// sub-buckets per power of two (relative error < 3.2%), values clamped to
+// ~137 s (2^37 ns). Single writer; readers may copy it concurrently
+// (relaxed atomics, so a snapshot can be off by the increments in flight).
+class LatencyHistogram {
+public:
+    static constexpr int    kSubBits  = 5;
+    static constexpr int    kMaxShift = 31;
+    static constexpr size_t kBuckets  = static_cast<size_t>(kMaxShift + 2) << kSubBits;
+    static constexpr uint64_t kMaxValue = (uint64_t{2} << (kMaxShift + kSubBits)) - 1;
+
+    static size_t bucket_index(uint64_t v) {
+        if (v > kMaxValue) v = kMaxValue;
+        if (v < (uint64_t{1} << kSubBits)) return static_cast<size_t>(v);
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - kSubBits;
+        return (static_cast<size_t>(shift + 1) << kSubBits) |
+               static_cast<size_t>((v >> shift) & ((uint64_t{1} << kSubBits) - 1));
+    }
+    // Highest value that maps to bucket `idx`
+    static uint64_t bucket_upper(size_t idx) {
+        if (idx < (size_t{1} << kSubBits)) return idx;
+        int shift = static_cast<int>(idx >> kSubBits) - 1;
+        uint64_t sub = idx & ((size_t{1} << kSubBits) - 1);
+        return (((uint64_t{1} << kSubBits) + sub + 1) << shift) - 1;
+    }
+
+    // Owning thread only: plain load + store, no locked instructions
+    void record(uint64_t ns) {
+        bump(counts_[bucket_index(ns)], 1);
+        bump(count_, 1);
+        bump(sum_, ns);
+        if (ns > max_.load(std::memory_order_relaxed)) max_.store(ns, std::memory_order_relaxed);
+    }
+
+    // Merged, non-atomic view used for percentiles and exposition
+    struct Snapshot {
+        std::array<uint64_t, kBuckets> counts{};
+        uint64_t count = 0;
+        uint64_t sum   = 0;
+        uint64_t max   = 0;
+
+        void add(const Snapshot& o);
+        uint64_t percentile(double p) const;   // p in [0, 100]
+        double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+    };
+    void add_to(Snapshot& out) const;
+
+private:
+    static void bump(std::atomic<uint64_t>& a, uint64_t n) {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// Process-wide per-thread stage histograms. record() touches only the
+// calling thread's set (registered on first use); summaries merge all
+// live threads plus the totals of threads that have exited.
+class LatencyRecorder {
+public:
+    static LatencyRecorder& instance();
+
+    void record(LatencyStage stage, uint64_t ns);
+    void record(LatencyStage stage, TimePoint from, TimePoint to) {
+        if (from.time_since_epoch().count() == 0 || to < from) return;
+        record(stage, static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count()));
+    }
+
+    LatencyHistogram::Snapshot snapshot(LatencyStage stage) const;
+
+    // Tags the calling thread's histograms with a dispatcher worker index
+    void set_thread_worker(int worker);
+
+    struct WorkerSnapshot {
+        int worker = -1;   // -1: non-worker threads and threads that exited
+        LatencyHistogram::Snapshot snap;
+    };
+    // Counts since start (reset() does not apply), one entry per worker in
+    // index order after the -1 entry; empty groups are omitted. `out` is
+    // reused, so repeated calls do not allocate once it has grown.
+    void snapshot_by_worker(LatencyStage stage, std::vector<WorkerSnapshot>& out) const;
+
+    // Rebases every stage to zero. Writers are lock-free, so this records a
+    // baseline that later snapshots subtract. Used by tests and benchmarks.
+    void reset();
+
+    LatencyRecorder(const LatencyRecorder&) = delete;
+    LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+private:
+    LatencyRecorder();
+
+    struct ThreadSet {
+        std::array<LatencyHistogram, kNumLatencyStages> stages;
+        std::atomic<int> worker{-1};
+    };
+    struct ThreadHandle;
+    ThreadSet* thread_set();
+    void retire(const std::shared_ptr<ThreadSet>& set);
+    LatencyHistogram::Snapshot raw_snapshot_locked(LatencyStage stage) const;
+
+    mutable std::mutex mu_;
+    std::vector<std::shared_ptr<ThreadSet>> threads_;
+    std::array<LatencyHistogram::Snapshot, kNumLatencyStages> retired_{};
+    std::array<LatencyHistogram::Snapshot, kNumLatencyStages> baseline_{};
+};
+
+} // namespace sip_processor
+#endif // LATENCY_HISTOGRAM_H
@@ -4,15 +4,24 @@
 #ifndef COMMON_LOGGER_H
 #define COMMON_LOGGER_H
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <atomic>
 #include <cstdarg>
 #include <cstdio>
 #include <chrono>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
 #include <pthread.h>
+#include <sys/uio.h>
 
 namespace sip_processor {
 
@@ -47,6 +56,168 @@ inline LogLevel parse_log_level(const std::string& s) {
     return LogLevel::kInfo;
 }
 
+// What a producer does when its per-thread ring is full. Neither policy
+// ever blocks the logging thread.
+enum class LogOverflowPolicy {
+    kDrop,    // Discard the message; only the logger stats record it
+    kCount    // Discard, and the writer emits a "N messages dropped" line
+};
+
+inline LogOverflowPolicy parse_log_overflow_policy(const std::string& s) {
+    return s == "drop" ? LogOverflowPolicy::kDrop : LogOverflowPolicy::kCount;
+}
+
+// Asynchronous pipeline settings. Each logging thread formats into its own
+// lock-free ring; one writer thread drains all rings and batches writev()
+// calls per sink, so file I/O and rotation never run on a worker.
+struct AsyncLogConfig {
+    bool              enabled             = true;
+    size_t            thread_buffer_bytes = 256 * 1024;  // Per-thread ring (rounded to 2^n)
+    std::chrono::milliseconds flush_interval{10};        // Max writer sleep
+    LogOverflowPolicy overflow            = LogOverflowPolicy::kCount;
+};
+
+// Per call-site descriptor emitted by the LOG_* macros as a constexpr
+// static. Deferred records reference it by address, so the format string,
+// file and line are never copied on the hot path.
+struct LogSite {
+    LogLevel    level;
+    const char* file;   // Basename only
+    int         line;
+    const char* fmt;
+    uint64_t    bounded_strings;   // See log_bounded_string_args()
+};
+
+constexpr const char* log_basename(const char* path) {
+    const char* base = path;
+    for (const char* p = path; *p; ++p) {
+        if (*p == '/') base = p + 1;
+    }
+    return base;
+}
+
+// Bit i is set when argument i is the string of a "%.*s", whose precision
+// is argument i - 1: that string need not be NUL-terminated, so only
+// `precision` bytes of it may be read.  Arguments past the 64th are not
+// tracked.
+constexpr uint64_t log_bounded_string_args(const char* fmt) {
+    auto digits = [](const char*& p) { while (*p >= '0' && *p <= '9') ++p; };
+    uint64_t mask = 0;
+    unsigned arg = 0;
+    for (const char* p = fmt; *p; ++p) {
+        if (*p != '%') continue;
+        if (*++p == '\0') break;
+        if (*p == '%') continue;
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') ++p;
+        if (*p == '*') { ++arg; ++p; } else digits(p);
+        bool star_precision = false;
+        if (*p == '.') {
+            ++p;
+            if (*p == '*') { ++arg; ++p; star_precision = true; } else digits(p);
+        }
+        while (*p == 'h' || *p == 'l' || *p == 'L' || *p == 'z' || *p == 'j' || *p == 't' || *p == 'q') ++p;
+        if (*p == '\0') break;
+        if (*p == 's' && star_precision && arg < 64) mask |= uint64_t{1} << arg;
+        ++arg;
+    }
+    return mask;
+}
+
+// Never called; lets the compiler keep checking LOG_* format strings
+// against their arguments now that the macros no longer call a printf-like
+// function.
+inline void log_format_check(const char*, ...) __attribute__((format(printf, 1, 2)));
+inline void log_format_check(const char*, ...) {}
+
+namespace log_detail {
+
+// Binary encoding of one deferred argument: a tag byte then the value.
+// Strings are copied (callers' buffers do not outlive the call) and stored
+// NUL-terminated so the writer can hand them straight to snprintf.
+enum ArgTag : uint8_t { kArgSigned, kArgUnsigned, kArgDouble, kArgString, kArgPointer };
+
+template <typename> struct dependent_false : std::false_type {};
+
+class ArgWriter {
+public:
+    // bounded_strings as in LogSite
+    ArgWriter(char* buf, size_t cap, uint64_t bounded_strings = 0)
+        : begin_(buf), pos_(buf), end_(buf + cap), bounded_strings_(bounded_strings) {}
+
+    template <typename T>
+    void put_raw(const T& v) {
+        if (pos_ + sizeof(T) > end_) { pos_ = end_; return; }
+        memcpy(pos_, &v, sizeof(T));
+        pos_ += sizeof(T);
+    }
+
+    void put_string(const char* s, size_t len) {
+        // Tag + 4-byte length + NUL; truncate to what is left
+        if (pos_ + 6 > end_) { pos_ = end_; return; }
+        len = std::min(len, static_cast<size_t>(end_ - pos_) - 6);
+        *pos_++ = static_cast<char>(kArgString);
+        uint32_t n = static_cast<uint32_t>(len);
+        memcpy(pos_, &n, sizeof(n));
+        memcpy(pos_ + sizeof(n), s, len);
+        pos_[sizeof(n) + len] = '\0';
+        pos_ += sizeof(n) + len + 1;
+    }
+
+    template <typename T>
+    void put(const T& v) {
+        using D = std::decay_t<T>;
+        // A "%.*s" string is read no further than its precision, as printf
+        // would; a negative precision means none
+        bool bounded = arg_ < 64 && (bounded_strings_ >> arg_ & 1) && precision_ >= 0;
+        size_t limit = bounded ? static_cast<size_t>(precision_) : SIZE_MAX;
+        ++arg_;
+        precision_ = -1;
+        if constexpr (std::is_array_v<T>) {
+            put_string(v, strnlen(v, std::min(limit, std::extent_v<T>)));
+        } else if constexpr (std::is_same_v<D, std::string> || std::is_same_v<D, std::string_view>) {
+            put_string(v.data(), std::min(limit, v.size()));
+        } else if constexpr (std::is_same_v<D, const char*> || std::is_same_v<D, char*>) {
+            const char* s = v ? v : "(null)";
+            put_string(s, bounded ? strnlen(s, limit) : strlen(s));
+        } else if constexpr (std::is_enum_v<D>) {
+            put_tagged(kArgSigned, static_cast<int64_t>(v));
+        } else if constexpr (std::is_floating_point_v<D>) {
+            put_tagged(kArgDouble, static_cast<double>(v));
+        } else if constexpr (std::is_integral_v<D> && std::is_signed_v<D>) {
+            precision_ = static_cast<int64_t>(v);
+            put_tagged(kArgSigned, static_cast<int64_t>(v));
+        } else if constexpr (std::is_integral_v<D>) {
+            precision_ = static_cast<int64_t>(std::min<uint64_t>(v, INT64_MAX));
+            put_tagged(kArgUnsigned, static_cast<uint64_t>(v));
+        } else if constexpr (std::is_pointer_v<D>) {
+            put_tagged(kArgPointer, reinterpret_cast<uintptr_t>(v));
+        } else {
+            static_assert(dependent_false<D>::value, "unsupported LOG_* argument type");
+        }
+    }
+
+    size_t size() const { return static_cast<size_t>(pos_ - begin_); }
+
+private:
+    template <typename V>
+    void put_tagged(ArgTag tag, V v) {
+        if (pos_ + 1 + sizeof(V) > end_) { pos_ = end_; return; }
+        *pos_++ = static_cast<char>(tag);
+        put_raw(v);
+    }
+
+    char* begin_;
+    char* pos_;
+    char* end_;
+    uint64_t bounded_strings_;
+    unsigned arg_ = 0;
+    int64_t  precision_ = -1;   // Previous argument, if an integer
+};
+
+int64_t now_ms();
+
+} // namespace log_detail
+
 struct LogSinkConfig {
     std::string file_path;
     size_t max_file_size_bytes = 50 * 1024 * 1024;  // 50 MB
@@ -60,8 +231,14 @@ public:
     explicit LogSink(const LogSinkConfig& config);
     ~LogSink();
 
+    // Synchronous single-message write (used when async is disabled)
     void write(LogLevel level, const char* formatted_msg, size_t len);
-    void flush();
+
+    // Batched path used by the async writer: stage() queues a message that
+    // must stay valid until the following commit(), which issues writev()
+    // and rotates if the file is over its size limit. Returns rotations.
+    void stage(LogLevel level, const char* msg, size_t len);
+    size_t commit(uint64_t& writev_calls, uint64_t& bytes);
 
     LogSink(const LogSink&) = delete;
     LogSink& operator=(const LogSink&) = delete;
@@ -71,11 +248,14 @@ private:
     std::string rotated_path(int index) const;
     bool needs_rotation() const;
     void rotate();
+    size_t write_all(int fd, std::vector<struct iovec>& iov, uint64_t& writev_calls);
 
     LogSinkConfig config_;
     std::mutex mu_;
-    FILE* fp_ = nullptr;
+    int fd_ = -1;
     size_t current_size_ = 0;
+    std::vector<struct iovec> pending_;
+    std::vector<struct iovec> pending_stderr_;
 };
 
 class Logger {
@@ -85,11 +265,36 @@ public:
     void set_level(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
     LogLevel level() const { return level_.load(std::memory_order_relaxed); }
 
+    // The LOG_* macros test this before evaluating any argument: one
+    // relaxed load, no instance() guard.
+    static bool enabled(LogLevel level) {
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+
+    struct Stats {
+        std::atomic<uint64_t> dropped{0};       // Ring full (overflow policy applied)
+        std::atomic<uint64_t> written{0};       // Drained by the writer
+        std::atomic<uint64_t> writev_calls{0};
+        std::atomic<uint64_t> bytes_written{0};
+        std::atomic<uint64_t> rotations{0};
+        std::atomic<uint64_t> thread_buffers{0};
+    };
+
+    // (Re)configures the file sinks. With async.enabled the writer thread
+    // is (re)started; rings of existing threads are drained first.
     void configure(const std::string& log_dir,
                    const std::string& base_name,
                    LogLevel console_level,
                    size_t max_file_size_bytes,
-                   int max_rotated_files);
+                   int max_rotated_files,
+                   const AsyncLogConfig& async = AsyncLogConfig{});
+
+    // Drains every ring, stops the writer, closes the sinks and reverts to
+    // the stderr fallback. Called at process exit.
+    void shutdown();
+
+    bool async() const { return mode_.load(std::memory_order_acquire) == Mode::kAsync; }
+    const Stats& stats() const { return stats_; }
 
     void add_sink(std::unique_ptr<LogSink> sink);
 
@@ -99,6 +304,25 @@ public:
     void log_slow(const char* file, int line, const char* fmt, ...)
         __attribute__((format(printf, 4, 5)));
 
+    // Deferred path behind the LOG_* macros: captures the call site, a
+    // timestamp and the raw arguments; the writer thread does the printf
+    // formatting. Without the async writer the record is rendered inline.
+    template <typename... Args>
+    void log_deferred(const LogSite& site, const Args&... args) {
+        char buf[kMaxMessage];
+        log_detail::ArgWriter w(buf, sizeof(buf), site.bounded_strings);
+        w.put_raw(&site);
+        w.put_raw(log_detail::now_ms());
+        (w.put(args), ...);
+        submit_deferred(site, buf, w.size());
+    }
+
+    // Renders a deferred record (as built by log_deferred) into a text line
+    static size_t render_deferred(char* out, size_t cap, const char* rec, size_t len,
+                                  unsigned long tid);
+
+    // In async mode blocks (bounded) until everything logged before the
+    // call has been written.
     void flush_all();
 
     Logger(const Logger&) = delete;
@@ -108,31 +332,91 @@ private:
     Logger();
     ~Logger();
 
+    enum class Mode { kStderr, kSync, kAsync };
+
+    // Single-producer (owning thread) / single-consumer (writer) byte ring
+    // of length-prefixed records. Indices are monotonic; the producer never
+    // overwrites bytes the writer has not released.
+    struct ThreadBuffer {
+        explicit ThreadBuffer(size_t capacity);
+        bool push(LogLevel level, uint16_t flags, const char* msg, size_t len);
+
+        alignas(64) std::atomic<size_t> head{0};   // Producer
+        size_t tail_cache = 0;
+        alignas(64) std::atomic<size_t> tail{0};   // Writer
+        alignas(64) std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> retired{false};          // Owning thread exited
+        unsigned long tid = 0;
+        std::unique_ptr<char[]> data;
+        size_t mask = 0;
+    };
+    struct ThreadBufferHandle;
+
+    static constexpr uint16_t kRecordSlow     = 1;
+    static constexpr uint16_t kRecordDeferred = 2;
+    static constexpr size_t   kMaxMessage     = 4096;
+    static constexpr size_t   kRenderBlock    = 256 * 1024;
+
     size_t format_message(char* buf, size_t buf_size,
                           LogLevel level, const char* file, int line,
                           const char* fmt, va_list args);
+    void dispatch(LogLevel level, uint16_t flags, const char* buf, size_t len);
+    void submit_deferred(const LogSite& site, const char* rec, size_t len);
+    char* render_space();
+    ThreadBuffer* thread_buffer();
+    void start_writer_locked();
+    void stop_writer_locked();
+    void writer_loop();
+    bool drain_once();
 
-    std::atomic<LogLevel> level_;
-    std::mutex configure_mu_;
+    static inline std::atomic<LogLevel> level_{LogLevel::kInfo};
+    std::atomic<Mode> mode_{Mode::kStderr};
+    // Held shared by synchronous writes, so the sink list cannot change
+    // under them
+    std::shared_mutex configure_mu_;
     std::vector<std::unique_ptr<LogSink>> sinks_;
     std::unique_ptr<LogSink> slow_event_sink_;
-    bool stderr_fallback_ = true;
-    bool configured_ = false;
+    AsyncLogConfig async_config_;
+    std::atomic<size_t> thread_buffer_bytes_{AsyncLogConfig{}.thread_buffer_bytes};
+    Stats stats_;
+
+    std::mutex buffers_mu_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+    std::atomic<uint64_t> buffers_gen_{0};
+
+    // Writer thread state
+    std::vector<std::shared_ptr<ThreadBuffer>> writer_buffers_;
+    uint64_t writer_gen_ = ~uint64_t{0};
+    std::vector<std::unique_ptr<char[]>> render_blocks_;   // Deferred lines until commit
+    size_t render_block_ = 0;
+    size_t render_pos_ = 0;
+    std::thread writer_;
+    std::mutex wake_mu_;
+    std::condition_variable wake_cv_;
+    std::condition_variable flushed_cv_;
+    std::atomic<bool> writer_stop_{false};
+    uint64_t flush_requested_ = 0;   // Guarded by wake_mu_
+    uint64_t flush_completed_ = 0;
 };
 
-// Logging macros
-#define LOG_TRACE(fmt, ...) \
-    sip_processor::Logger::instance().log(sip_processor::LogLevel::kTrace, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define LOG_DEBUG(fmt, ...) \
-    sip_processor::Logger::instance().log(sip_processor::LogLevel::kDebug, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define LOG_INFO(fmt, ...) \
-    sip_processor::Logger::instance().log(sip_processor::LogLevel::kInfo, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define LOG_WARN(fmt, ...) \
-    sip_processor::Logger::instance().log(sip_processor::LogLevel::kWarn, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define LOG_ERROR(fmt, ...) \
-    sip_processor::Logger::instance().log(sip_processor::LogLevel::kError, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define LOG_FATAL(fmt, ...) \
-    sip_processor::Logger::instance().log(sip_processor::LogLevel::kFatal, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+// Logging macros. Arguments are not evaluated when the level is disabled.
+#define SIP_LOG_AT(lvl, fmt, ...)                                                        \
+    do {                                                                                 \
+        if (sip_processor::Logger::enabled(lvl)) {                                       \
+            static constexpr sip_processor::LogSite sip_log_site_{                       \
+                lvl, sip_processor::log_basename(__FILE__), __LINE__, fmt,               \
+                sip_processor::log_bounded_string_args(fmt)};                            \
+            if (false) sip_processor::log_format_check(fmt, ##__VA_ARGS__);              \
+            sip_processor::Logger::instance().log_deferred(sip_log_site_, ##__VA_ARGS__); \
+        }                                                                                \
+    } while (0)
+
+#define LOG_TRACE(fmt, ...) SIP_LOG_AT(sip_processor::LogLevel::kTrace, fmt, ##__VA_ARGS__)
+#define LOG_DEBUG(fmt, ...) SIP_LOG_AT(sip_processor::LogLevel::kDebug, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...)  SIP_LOG_AT(sip_processor::LogLevel::kInfo,  fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...)  SIP_LOG_AT(sip_processor::LogLevel::kWarn,  fmt, ##__VA_ARGS__)
+#define LOG_ERROR(fmt, ...) SIP_LOG_AT(sip_processor::LogLevel::kError, fmt, ##__VA_ARGS__)
+#define LOG_FATAL(fmt, ...) SIP_LOG_AT(sip_processor::LogLevel::kFatal, fmt, ##__VA_ARGS__)
 #define LOG_SLOW(fmt, ...) \
     sip_processor::Logger::instance().log_slow(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
 
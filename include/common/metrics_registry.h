@@ -0,0 +1,122 @@
+
+// =============================================================================
+// FILE: include/common/metrics_registry.h
+// =============================================================================
+#ifndef METRICS_REGISTRY_H
+#define METRICS_REGISTRY_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sip_processor {
+
+enum class MetricType : uint8_t { kCounter, kGauge, kHistogram };
+
+// Appends OpenMetrics text to a caller-owned buffer. Numbers are formatted
+// on the stack, so once the buffer has grown to a scrape's size rendering
+// does not allocate.
+class MetricsWriter {
+public:
+    explicit MetricsWriter(std::string& out) : out_(out) {}
+
+    void family(const char* name, MetricType type, const char* help);
+
+    // <name><suffix>{<labels>} <value>; labels is pre-rendered or empty
+    void sample(const char* name, const char* suffix, std::string_view labels, uint64_t value);
+    void sample(const char* name, const char* suffix, std::string_view labels, int64_t value);
+    void sample(const char* name, const char* suffix, std::string_view labels, double value);
+
+    // Histogram bucket: <name>_bucket{<labels>,le="<le>"} <cumulative>
+    void bucket(const char* name, std::string_view labels, const char* le, uint64_t cumulative);
+
+    // Appends key="value" (comma-separated from earlier labels) with
+    // OpenMetrics escaping of backslash, quote and newline
+    static void add_label(std::string& labels, std::string_view key, std::string_view value);
+
+private:
+    void begin(const char* name, const char* suffix, std::string_view labels);
+    std::string& out_;
+};
+
+// One stats-struct field exposed as a counter or gauge; components keep a
+// static table of these and pass it to MetricsRegistry::add_fields()
+template <typename Stats>
+struct MetricField {
+    const char* name;
+    MetricType  type;
+    const char* help;
+    std::atomic<uint64_t> Stats::* field;
+};
+
+// Process-wide metric catalogue. Components register their stats atomics
+// once (typically in the constructor) and unregister by owner before the
+// atomics go away; a scrape then reads each registered value in place.
+//
+// Names and help strings must be string literals. Counter families are
+// named without the _total suffix; it is added on exposition.
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    // Emits every sample of one family; called with the registry lock held
+    using Collector = std::function<void(MetricsWriter&, const char* name)>;
+
+    void add_counter(const void* owner, const char* name, const char* help,
+                     const std::atomic<uint64_t>& value, std::string labels = {});
+    void add_gauge(const void* owner, const char* name, const char* help,
+                   const std::atomic<uint64_t>& value, std::string labels = {});
+    void add_gauge(const void* owner, const char* name, const char* help,
+                   const std::atomic<int64_t>& value, std::string labels = {});
+    void add_collector(const void* owner, const char* name, MetricType type,
+                       const char* help, Collector collector);
+
+    template <typename Stats, size_t N>
+    void add_fields(const void* owner, const Stats& stats, const MetricField<Stats> (&fields)[N],
+                    const std::string& labels = {}) {
+        for (const auto& f : fields) {
+            if (f.type == MetricType::kCounter) add_counter(owner, f.name, f.help, stats.*f.field, labels);
+            else                                add_gauge(owner, f.name, f.help, stats.*f.field, labels);
+        }
+    }
+
+    // Removes every series and collector registered by `owner`
+    void unregister(const void* owner);
+
+    // Replaces `out` with the OpenMetrics exposition, ending in "# EOF"
+    void render(std::string& out) const;
+
+    size_t series_count() const;
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+private:
+    MetricsRegistry() = default;
+
+    struct Series {
+        const void* owner;
+        std::string labels;
+        const std::atomic<uint64_t>* unsigned_value = nullptr;
+        const std::atomic<int64_t>*  signed_value   = nullptr;
+    };
+    struct Family {
+        const char* name;
+        const char* help;
+        MetricType  type;
+        std::vector<Series> series;
+        std::vector<std::pair<const void*, Collector>> collectors;
+    };
+
+    Family& family_locked(const char* name, MetricType type, const char* help);
+
+    mutable std::mutex mu_;
+    std::vector<Family> families_;
+};
+
+} // namespace sip_processor
+#endif // METRICS_REGISTRY_H
@@ -8,17 +8,26 @@
 #include "common/types.h"
 #include "common/config.h"
 #include "common/logger.h"
+#include <array>
 #include <atomic>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace sip_processor {
 
-// Logs warnings when event processing exceeds configured thresholds.
+// Logs warnings when event processing exceeds configured thresholds and
+// keeps the N slowest recent events with their stage breakdown.
 // Usage:
-//   SlowEventLogger::Timer timer(slow_logger, "SUBSCRIBE", dialog_id);
+//   SlowEventLogger::Timer timer(slow_logger, "SUBSCRIBE BLF", dialog_id);
+//   timer.add_stage("queue_wait", enqueued_at, dequeued_at);
 //   ... process event ...
 //   timer.finish(); // or let destructor call it
 //
+// Operation and stage names must be string literals (or other static
+// storage); nothing is copied unless the event is captured or logged.
+//
 // Auto-logs at appropriate level based on elapsed time:
 //   > warn_threshold:     LOG_WARN
 //   > error_threshold:    LOG_ERROR
@@ -37,53 +46,106 @@ public:
     };
     Thresholds thresholds() const;
 
+    static constexpr size_t kMaxStages   = 4;
+    static constexpr size_t kMaxDialogId = 96;
+    static constexpr size_t kMaxContext  = 64;
+
+    struct Stage {
+        const char* name = nullptr;
+        uint64_t    ns   = 0;
+    };
+
+    // One captured slow event; strings are truncated copies
+    struct Sample {
+        const char* operation = "";
+        uint64_t    total_ns  = 0;
+        int64_t     wall_ms   = 0;   // When it finished
+        char        dialog_id[kMaxDialogId] = {};
+        char        context[kMaxContext]    = {};
+        uint8_t     num_stages = 0;
+        std::array<Stage, kMaxStages> stages{};
+    };
+
     // RAII timer for automatic logging
     class Timer {
     public:
+        // dialog_id and extra_context must outlive the timer
         Timer(SlowEventLogger& logger,
               const char* operation,
-              const std::string& dialog_id,
-              const std::string& extra_context = "");
+              std::string_view dialog_id,
+              std::string_view extra_context = {});
         ~Timer();
 
+        // Attach a stage duration to this event; extra stages are ignored
+        void add_stage(const char* name, Nanosecs d) {
+            if (num_stages_ < kMaxStages && d.count() >= 0) {
+                stages_[num_stages_++] = {name, static_cast<uint64_t>(d.count())};
+            }
+        }
+        void add_stage(const char* name, TimePoint from, TimePoint to) {
+            if (from.time_since_epoch().count() != 0) add_stage(name, to - from);
+        }
+
         // Explicit finish (prevents double-log in destructor)
         void finish();
 
-        Millisecs elapsed() const {
-            return std::chrono::duration_cast<Millisecs>(Clock::now() - start_);
+        TimePoint started_at() const { return start_; }
+
+        // Running time, or the final duration once finished
+        Nanosecs elapsed() const {
+            return finished_ ? elapsed_ : std::chrono::duration_cast<Nanosecs>(Clock::now() - start_);
         }
 
     private:
+        friend class SlowEventLogger;
         SlowEventLogger& logger_;
         const char* operation_;
-        std::string dialog_id_;
-        std::string extra_context_;
+        std::string_view dialog_id_;
+        std::string_view extra_context_;
         TimePoint start_;
+        Nanosecs elapsed_{0};
+        std::array<Stage, kMaxStages> stages_{};
+        uint8_t num_stages_ = 0;
         bool finished_ = false;
     };
 
+    // Slowest events of the current and previous window, slowest first
+    std::vector<Sample> slowest(size_t limit) const;
+    size_t top_n() const { return top_n_; }
+    Seconds window() const { return window_; }
+
     // Stats
     struct Stats {
         std::atomic<uint64_t> warn_count{0};
         std::atomic<uint64_t> error_count{0};
         std::atomic<uint64_t> critical_count{0};
-        std::atomic<uint64_t> max_duration_ms{0};
+        std::atomic<uint64_t> max_duration_us{0};
+        std::atomic<uint64_t> samples_captured{0};
     };
     const Stats& stats() const { return stats_; }
 
 private:
     friend class Timer;
-    void check_and_log(const char* operation,
-                       const std::string& dialog_id,
-                       const std::string& extra_context,
-                       Millisecs elapsed);
-
-    std::atomic<int64_t> warn_ms_;
-    std::atomic<int64_t> error_ms_;
-    std::atomic<int64_t> critical_ms_;
+    void on_finish(const Timer& timer, TimePoint now);
+    void capture(const Timer& timer, uint64_t ns, TimePoint now);
+    void rotate_locked(TimePoint now);
+
+    std::atomic<int64_t> warn_ns_;
+    std::atomic<int64_t> error_ns_;
+    std::atomic<int64_t> critical_ns_;
     bool log_stack_trace_;
     Stats stats_;
+
+    // Top-N of the current window as a min-heap on total_ns. Events faster
+    // than admit_floor_ns_ skip the lock entirely.
+    const size_t top_n_;
+    const Seconds window_;
+    mutable std::mutex top_mu_;
+    std::vector<Sample> current_;
+    std::vector<Sample> previous_;
+    std::atomic<uint64_t> admit_floor_ns_{0};
+    std::atomic<int64_t> window_end_ns_{0};   // steady clock, since epoch
 };
 
 } // namespace sip_processor
-#endif // SLOW_EVENT_LOGGER_H
\ No newline at end of file
+#endif // SLOW_EVENT_LOGGER_H
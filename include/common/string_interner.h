@@ -0,0 +1,153 @@
+
+// =============================================================================
+// FILE: include/common/string_interner.h
+// =============================================================================
+#ifndef STRING_INTERNER_H
+#define STRING_INTERNER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sip_processor {
+
+// Process-wide pool of immutable strings (tenant ids, monitored URIs) that
+// hands out stable 32-bit ids. Interned text lives in append-only arena
+// blocks and is never freed, so only intern values from bounded sets —
+// never per-dialog data such as dialog ids or Call-IDs.
+//
+// id -> text is a lock-free array lookup; text -> id takes a shared lock on
+// one of kNumShards hash shards (exclusive only on first insert).
+class StringInterner {
+public:
+    static constexpr size_t kMaxSymbols = size_t{1} << 28;   // Id space, "" included
+
+    static StringInterner& instance();
+
+    // Returns the id for `s`, inserting it if absent. "" is always id 0.
+    // Once capacity() symbols exist, new text is refused: the result is 0
+    // (the empty string) and rejected() counts it.
+    uint32_t intern(std::string_view s);
+    // Looks up `s` without inserting; false if it was never interned.
+    bool find(std::string_view s, uint32_t& id) const;
+
+    std::string_view view(uint32_t id) const {
+        const Entry& e = entry(id);
+        return {e.data, e.len};
+    }
+    const char* c_str(uint32_t id) const { return entry(id).data; }
+
+    size_t size() const { return count_.load(std::memory_order_relaxed); }
+    size_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+    // Clamped to [1, kMaxSymbols]; lowering it below size() only stops growth
+    void set_capacity(size_t n);
+    size_t capacity() const { return capacity_.load(std::memory_order_relaxed); }
+    uint64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+private:
+    StringInterner();
+
+    struct Entry {
+        const char* data = "";
+        uint32_t    len  = 0;
+    };
+    static constexpr size_t kPageBits  = 12;
+    static constexpr size_t kPageSize  = size_t{1} << kPageBits;
+    static constexpr size_t kMaxPages  = kMaxSymbols >> kPageBits;
+    static constexpr size_t kNumShards = 32;
+    static constexpr size_t kArenaBlock = 64 * 1024;
+
+    const Entry& entry(uint32_t id) const {
+        return pages_[id >> kPageBits].load(std::memory_order_acquire)[id & (kPageSize - 1)];
+    }
+    uint32_t allocate_locked(std::string_view s);
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mu;
+        std::unordered_map<std::string_view, uint32_t> ids;   // Views into the arena
+    };
+    std::array<Shard, kNumShards> shards_;
+
+    std::unique_ptr<std::atomic<Entry*>[]> pages_;
+    std::mutex alloc_mu_;
+    std::vector<std::unique_ptr<Entry[]>> page_storage_;
+    std::vector<std::unique_ptr<char[]>> arena_;
+    char*    arena_pos_  = nullptr;
+    size_t   arena_left_ = 0;
+    uint32_t next_id_    = 1;
+
+    std::atomic<size_t> count_{1};
+    std::atomic<size_t> bytes_{0};
+    std::atomic<size_t> capacity_{kMaxSymbols};
+    std::atomic<uint64_t> rejected_{0};
+};
+
+// Handle to an interned string: 4 bytes, copied by value, compared and
+// hashed by id. Construction from text interns it, so it is explicit:
+// untrusted input (SIP headers, feed XML, HTTP queries) goes through find()
+// and is interned only once a subscription carrying it has been admitted.
+// A full interner yields the empty Symbol for text it has not seen.
+class Symbol {
+public:
+    Symbol() = default;
+    explicit Symbol(std::string_view s) : id_(StringInterner::instance().intern(s)) {}
+    explicit Symbol(const std::string& s) : Symbol(std::string_view(s)) {}
+    explicit Symbol(const char* s) : Symbol(std::string_view(s ? s : "")) {}
+
+    // Resolves `s` only if it is already interned (no insert); lookups with
+    // untrusted input should use this rather than the constructor.
+    static bool find(std::string_view s, Symbol& out) {
+        return StringInterner::instance().find(s, out.id_);
+    }
+
+    uint32_t         id() const    { return id_; }
+    bool             empty() const { return id_ == 0; }
+    std::string_view view() const  { return StringInterner::instance().view(id_); }
+    const char*      c_str() const { return StringInterner::instance().c_str(id_); }
+    std::string      str() const   { return std::string(view()); }
+    size_t           size() const  { return view().size(); }
+
+    friend bool operator==(Symbol a, Symbol b) { return a.id_ == b.id_; }
+    friend bool operator!=(Symbol a, Symbol b) { return a.id_ != b.id_; }
+    // Orders by id, not text: stable within a process, cheap for map keys
+    friend bool operator<(Symbol a, Symbol b)  { return a.id_ < b.id_; }
+
+    // Text comparisons do not intern the other operand
+    friend bool operator==(Symbol a, std::string_view b)   { return a.view() == b; }
+    friend bool operator==(Symbol a, const std::string& b) { return a.view() == b; }
+    friend bool operator==(Symbol a, const char* b)        { return a.view() == b; }
+    friend bool operator==(std::string_view a, Symbol b)   { return b == a; }
+    friend bool operator==(const std::string& a, Symbol b) { return b == a; }
+    friend bool operator==(const char* a, Symbol b)        { return b == a; }
+    friend bool operator!=(Symbol a, std::string_view b)   { return !(a == b); }
+    friend bool operator!=(Symbol a, const std::string& b) { return !(a == b); }
+    friend bool operator!=(Symbol a, const char* b)        { return !(a == b); }
+
+    friend std::ostream& operator<<(std::ostream& os, Symbol s) { return os << s.view(); }
+private:
+    uint32_t id_ = 0;
+};
+
+} // namespace sip_processor
+
+namespace std {
+template <>
+struct hash<sip_processor::Symbol> {
+    size_t operator()(sip_processor::Symbol s) const noexcept { return s.id(); }
+};
+} // namespace std
+
+#endif // STRING_INTERNER_H
@@ -0,0 +1,68 @@
+
+// =============================================================================
+// FILE: include/common/thread_affinity.h
+// =============================================================================
+#ifndef THREAD_AFFINITY_H
+#define THREAD_AFFINITY_H
+
+#include "common/config.h"
+#include <array>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sip_processor {
+
+// Long-lived thread roles, each with its own CPU list in [affinity]
+enum class ThreadRole : uint8_t {
+    kWorker = 0,     // DialogWorker (one CPU each, round-robin over the list)
+    kSip,            // Sofia event loop
+    kPresence,       // Presence TCP reader
+    kRouter,         // Presence event router
+    kPersistence,    // MongoDB sync, snapshot writer, recovery reconcile
+    kHttp,           // HTTP event loop and handler pool
+    kLogging,        // Async log writer
+    kMaintenance,    // Stale subscription reaper
+    kCount
+};
+
+const char* thread_role_name(ThreadRole role);
+
+// Parses "0-3,8,10-11" or "nodeN" (that NUMA node's CPUs from sysfs).
+// Returns false on a malformed list; an empty spec yields an empty list.
+bool parse_cpu_list(const std::string& spec, std::vector<int>& out);
+
+// Names and pins the calling thread by role.  Configured once from main
+// before any component starts; every role thread calls place() first thing.
+// Memory the thread touches first afterwards (the worker's dialog table,
+// buffers) is then allocated on the node it runs on.
+class ThreadPlacement {
+public:
+    static ThreadPlacement& instance();
+
+    // Loads the per-role CPU lists.  False if any list is malformed; that
+    // role is left unpinned.
+    bool configure(const Config& config);
+
+    // Sets the thread name (truncated to 15 chars) and, when enabled and the
+    // role has CPUs, the affinity.  Returns true if the thread was pinned.
+    bool place(ThreadRole role, size_t index, const char* name);
+
+    // CPU worker `index` is pinned to, or -1 if workers are unpinned
+    int worker_cpu(size_t index) const;
+    bool enabled() const;
+    // "role=cpus ..." for the startup log
+    std::string describe() const;
+
+    static void set_thread_name(const char* name);
+
+private:
+    ThreadPlacement() = default;
+
+    mutable std::mutex mu_;
+    bool enabled_ = false;
+    std::array<std::vector<int>, static_cast<size_t>(ThreadRole::kCount)> cpus_;
+};
+
+} // namespace sip_processor
+#endif // THREAD_AFFINITY_H
@@ -9,6 +9,7 @@
 #include <string>
 #include <memory>
 #include <functional>
+#include "common/string_interner.h"
 
 namespace sip_processor {
 
@@ -16,14 +17,16 @@ using Clock     = std::chrono::steady_clock;
 using TimePoint = Clock::time_point;
 using Duration  = Clock::duration;
 using Millisecs = std::chrono::milliseconds;
+using Microsecs = std::chrono::microseconds;
+using Nanosecs  = std::chrono::nanoseconds;
 using Seconds   = std::chrono::seconds;
 using EventId   = uint64_t;
-using TenantId  = std::string;
+using TenantId  = Symbol;   // Interned; see common/string_interner.h
 
 enum class Result {
     kOk, kError, kTimeout, kNotFound, kAlreadyExists,
     kCapacityExceeded, kInvalidArgument, kShuttingDown,
-    kConnectionLost, kParseError, kPersistenceError
+    kConnectionLost, kParseError, kPersistenceError, kOverloaded
 };
 
 inline const char* result_to_string(Result r) {
@@ -39,10 +42,17 @@ inline const char* result_to_string(Result r) {
         case Result::kConnectionLost:   return "ConnectionLost";
         case Result::kParseError:       return "ParseError";
         case Result::kPersistenceError: return "PersistenceError";
+        case Result::kOverloaded:       return "Overloaded";
         default:                        return "Unknown";
     }
 }
 
+// Wall-clock milliseconds since the epoch (for timestamps that outlive the process)
+inline int64_t wall_clock_ms() {
+    return std::chrono::duration_cast<Millisecs>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
 // Scoped timer for measuring operation durations
 class ScopedTimer {
 public:
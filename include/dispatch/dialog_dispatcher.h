@@ -7,15 +7,24 @@
 #include "common/types.h"
 #include "common/config.h"
 #include "dispatch/dialog_worker.h"
+#include "dispatch/dialog_routing_table.h"
+#include "dispatch/hash_ring.h"
 #include "sip/sip_event.h"
+#include <atomic>
 #include <vector>
 #include <memory>
+#include <mutex>
 
 namespace sip_processor {
 class SlowEventLogger;
 class SubscriptionStore;
 class SipStackManager;
+class OverloadController;
 
+// Workers live in fixed slots [0, dispatcher.max_workers).  Slots
+// [0, active_workers()) are on the hash ring and take new dialogs; slots
+// [active_workers(), num_workers()) are draining after a shrink and stop
+// once their last dialog has been handed off.
 class DialogDispatcher {
 public:
     DialogDispatcher(const Config& config,
@@ -25,9 +34,41 @@ public:
     ~DialogDispatcher();
     Result start();
     void stop();
+    // Routes to the dialog's owner.  A new dialog from the SIP stack is placed
+    // on its ring home, or the least-loaded worker if the home is overloaded;
+    // feed events for unknown dialogs get kNotFound.
     Result dispatch(std::unique_ptr<SipEvent> event);
-    size_t worker_index_for(const std::string& dialog_id) const;
-    size_t num_workers() const { return workers_.size(); }
+    // Fan-out path: groups events by worker and enqueues each group under
+    // one lock with one wakeup. Returns how many were accepted; events with
+    // no valid dialog or owner count as unroutable.
+    size_t dispatch_batch(std::vector<std::unique_ptr<SipEvent>> events);
+    // Owner of the dialog, placing it first if it has none
+    size_t place(const std::string& dialog_id);
+    // Re-routes an event that reached a worker after its dialog was handed off
+    Result forward(std::unique_ptr<SipEvent> event);
+    // Hands idle dialogs from the busiest to the least-loaded worker when the
+    // spread exceeds dispatcher.rebalance_threshold_pct.  Returns how many
+    // dialogs were requested to move.
+    size_t rebalance();
+
+    // Changes the number of ring workers without a restart.  Growing starts
+    // new workers and moves to them only the dialogs whose ring home changed;
+    // shrinking takes the tail workers off the ring and drains them.
+    Result resize(size_t num_workers);
+    // Stops drained workers and re-requests handoff from the rest; called
+    // once a second from the main loop
+    void finish_resize();
+
+    // Set before start(); workers and the SIP callback consult it per event
+    void set_overload_controller(OverloadController* overload) { overload_ = overload; }
+    OverloadController* overload() const { return overload_; }
+
+    DialogRoutingTable& routing() { return routing_; }
+    const DialogRoutingTable& routing() const { return routing_; }
+    // Running workers, draining ones included
+    size_t num_workers() const { return live_.load(std::memory_order_acquire); }
+    size_t active_workers() const { return active_.load(std::memory_order_acquire); }
+    size_t max_workers() const { return workers_.size(); }
     DialogWorker& worker(size_t idx) { return *workers_[idx]; }
     const DialogWorker& worker(size_t idx) const { return *workers_[idx]; }
 
@@ -36,15 +77,53 @@ public:
         uint64_t total_events_dropped = 0, total_presence_triggers = 0;
         uint64_t total_dialogs_active = 0, total_dialogs_reaped = 0;
         uint64_t max_queue_depth = 0, total_slow_events = 0;
+        uint64_t recovery_notify_owed = 0, recovery_notify_queued = 0;
+        uint64_t recovery_notify_sent = 0;
+        uint64_t total_events_unroutable = 0;
     };
     AggregateStats aggregate_stats() const;
 
+    // Spread of owned dialogs and queue depth across ring workers
+    struct Balance {
+        int64_t dialogs_max = 0, dialogs_min = 0;
+        double  dialogs_mean = 0;
+        uint64_t queue_depth_max = 0;
+        double  queue_depth_mean = 0;
+        size_t  busiest = 0, idlest = 0;
+        // Busiest worker's dialogs over the mean; 1.0 is perfectly even
+        double imbalance() const { return dialogs_mean > 0 ? dialogs_max / dialogs_mean : 1.0; }
+    };
+    Balance balance() const;
+
     DialogDispatcher(const DialogDispatcher&) = delete;
     DialogDispatcher& operator=(const DialogDispatcher&) = delete;
 private:
+    size_t choose_worker(const std::string& dialog_id) const;
+    size_t least_loaded_worker() const;
+    int64_t load_of(size_t idx) const;
+    void create_worker(size_t idx);
+    std::shared_ptr<const HashRing> ring() const { return std::atomic_load(&ring_); }
+    bool resize_current(uint64_t gen) const { return resize_generation_.load(std::memory_order_acquire) == gen; }
+
     Config config_;
+    std::shared_ptr<SlowEventLogger> slow_logger_;
+    std::shared_ptr<SubscriptionStore> sub_store_;
+    SipStackManager* stack_mgr_;
+    OverloadController* overload_ = nullptr;
+
+    DialogRoutingTable routing_;
+    // Sized to max_workers up front so slots never move; a slot is filled
+    // before live_ is raised past it
     std::vector<std::unique_ptr<DialogWorker>> workers_;
+    std::atomic<size_t> active_{0};
+    std::atomic<size_t> live_{0};
+    std::shared_ptr<const HashRing> ring_;
+    std::mutex resize_mu_;
+    // Bumped by every resize; handoffs requested under an older ring no-op
+    std::atomic<uint64_t> resize_generation_{0};
     bool started_ = false;
+    // Feed and in-dialog events whose dialog has no owner (or no valid id)
+    std::atomic<uint64_t> events_unroutable_{0};
 };
 } // namespace sip_processor
 #endif
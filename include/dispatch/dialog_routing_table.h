@@ -0,0 +1,138 @@
+
+// =============================================================================
+// FILE: include/dispatch/dialog_routing_table.h
+// =============================================================================
+#ifndef DIALOG_ROUTING_TABLE_H
+#define DIALOG_ROUTING_TABLE_H
+
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sip_processor {
+
+// Sticky dialog -> worker placement.  A dialog is placed once, when its first
+// event is dispatched, and every later event goes to the same worker until the
+// owner hands it off.  The table also keeps how many dialogs each worker owns
+// so the dispatcher can place new dialogs on the least-loaded one.
+class DialogRoutingTable {
+public:
+    static constexpr uint32_t kNoWorker = UINT32_MAX;
+    static constexpr size_t kNumShards = 64;
+
+    explicit DialogRoutingTable(size_t num_workers);
+
+    // Owner of the dialog, or kNoWorker
+    uint32_t find(const std::string& dialog_id) const;
+
+    // Owner of the dialog; places it on choose() first if it has none.  choose
+    // runs under the shard lock and must not touch the table.
+    template <typename Choose>
+    uint32_t find_or_place(const std::string& dialog_id, Choose&& choose);
+
+    // Records the owner, replacing any previous one
+    void bind(const std::string& dialog_id, uint32_t worker);
+
+    // Removes the entry if the dialog is still owned by worker
+    void release(const std::string& dialog_id, uint32_t worker);
+
+    // Hands the dialog from one worker to another.  Never waits for the
+    // shard: the caller holds the source worker's ingress lock, which a Guard
+    // holder may be waiting on to enqueue, so a held shard gives kBusy.
+    enum class Move { kMoved, kNotOwner, kBusy };
+    Move move(const std::string& dialog_id, uint32_t from, uint32_t to);
+
+    // Holds the shard locks of a set of dialogs, taken in shard order so two
+    // guards cannot deadlock.  No owner in the set changes while it is held,
+    // so looking up an owner and enqueueing to it is one step for move().
+    // Only the guard's own calls may touch the set's dialogs meanwhile.
+    class Guard {
+    public:
+        // Every shard: no dispatch is between lookup and enqueue meanwhile
+        explicit Guard(DialogRoutingTable& table);
+        Guard(DialogRoutingTable& table, const std::string& dialog_id);
+        Guard(DialogRoutingTable& table, const std::vector<const std::string*>& dialog_ids);
+        ~Guard();
+
+        uint32_t find(const std::string& dialog_id) const;
+        template <typename Choose>
+        uint32_t find_or_place(const std::string& dialog_id, Choose&& choose);
+        void release(const std::string& dialog_id, uint32_t worker);
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        DialogRoutingTable& table_;
+        std::bitset<kNumShards> held_;
+    };
+
+    int64_t owned(uint32_t worker) const {
+        return worker < num_workers_ ? owned_[worker].n.load(std::memory_order_relaxed) : 0;
+    }
+    const std::atomic<int64_t>& owned_ref(uint32_t worker) const { return owned_[worker].n; }
+    size_t num_workers() const { return num_workers_; }
+    size_t size() const;
+
+    DialogRoutingTable(const DialogRoutingTable&) = delete;
+    DialogRoutingTable& operator=(const DialogRoutingTable&) = delete;
+
+private:
+    struct alignas(64) Shard {
+        mutable std::mutex mu;
+        std::unordered_map<std::string, uint32_t> owners;
+    };
+    struct alignas(64) Counter {
+        std::atomic<int64_t> n{0};
+    };
+
+    static size_t shard_index(const std::string& dialog_id) {
+        return std::hash<std::string>{}(dialog_id) % kNumShards;
+    }
+    Shard& shard_for(const std::string& dialog_id) { return shards_[shard_index(dialog_id)]; }
+    const Shard& shard_for(const std::string& dialog_id) const { return shards_[shard_index(dialog_id)]; }
+
+    // Callers hold the shard's lock
+    static uint32_t find_locked(const Shard& sh, const std::string& dialog_id);
+    template <typename Choose>
+    uint32_t find_or_place_locked(Shard& sh, const std::string& dialog_id, Choose&& choose);
+    void release_locked(Shard& sh, const std::string& dialog_id, uint32_t worker);
+    void count(uint32_t worker, int64_t delta) {
+        if (worker < num_workers_) owned_[worker].n.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    size_t num_workers_;
+    std::unique_ptr<Counter[]> owned_;
+    std::array<Shard, kNumShards> shards_;
+};
+
+template <typename Choose>
+uint32_t DialogRoutingTable::find_or_place_locked(Shard& sh, const std::string& dialog_id, Choose&& choose) {
+    auto it = sh.owners.find(dialog_id);
+    if (it != sh.owners.end()) return it->second;
+    uint32_t worker = static_cast<uint32_t>(choose());
+    sh.owners.emplace(dialog_id, worker);
+    count(worker, 1);
+    return worker;
+}
+
+template <typename Choose>
+uint32_t DialogRoutingTable::find_or_place(const std::string& dialog_id, Choose&& choose) {
+    auto& sh = shard_for(dialog_id);
+    std::lock_guard<std::mutex> lk(sh.mu);
+    return find_or_place_locked(sh, dialog_id, std::forward<Choose>(choose));
+}
+
+template <typename Choose>
+uint32_t DialogRoutingTable::Guard::find_or_place(const std::string& dialog_id, Choose&& choose) {
+    return table_.find_or_place_locked(table_.shard_for(dialog_id), dialog_id, std::forward<Choose>(choose));
+}
+
+} // namespace sip_processor
+#endif // DIALOG_ROUTING_TABLE_H
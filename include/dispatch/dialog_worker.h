@@ -9,13 +9,18 @@
 #include "common/config.h"
 #include "sip/sip_event.h"
 #include "subscription/subscription_state.h"
+#include "subscription/expires_policy.h"
+#include "dispatch/recovery_notify_scheduler.h"
+#include <array>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <deque>
 #include <queue>
 #include <unordered_map>
 #include <vector>
 #include <atomic>
+#include <functional>
 #include <memory>
 
 namespace sip_processor {
@@ -25,19 +30,42 @@ class MwiProcessor;
 class SlowEventLogger;
 class SubscriptionStore;
 class SipStackManager;
+class DialogDispatcher;
+class DialogRoutingTable;
 
 struct WorkerStats {
     std::atomic<uint64_t> events_received{0};
     std::atomic<uint64_t> events_processed{0};
     std::atomic<uint64_t> events_dropped{0};
     std::atomic<uint64_t> presence_triggers_processed{0};
+    std::atomic<uint64_t> mwi_triggers_processed{0};
     std::atomic<uint64_t> dialogs_active{0};
     std::atomic<uint64_t> dialogs_reaped{0};
     std::atomic<uint64_t> queue_depth{0};
+    std::atomic<uint64_t> transaction_queue_depth{0};
+    std::atomic<uint64_t> feed_queue_depth{0};
+    std::atomic<uint64_t> feed_throttled_cycles{0};
     std::atomic<uint64_t> slow_events{0};
     std::atomic<uint64_t> notify_sent{0};
     std::atomic<uint64_t> notify_errors{0};
     std::atomic<uint64_t> subscribe_responses_sent{0};
+    std::atomic<uint64_t> reconciled_applied{0};
+    std::atomic<uint64_t> reconciled_skipped{0};
+    std::atomic<uint64_t> migrations_in{0};
+    std::atomic<uint64_t> migrations_out{0};
+    std::atomic<uint64_t> events_forwarded{0};
+    std::atomic<uint64_t> presence_coalesced{0};
+    std::atomic<uint64_t> subscribes_too_brief{0};
+    std::atomic<uint64_t> refresh_fast_path{0};
+    std::atomic<uint64_t> refresh_checkpoints{0};
+    std::atomic<uint64_t> replicated_applied{0};
+    std::atomic<uint64_t> replicated_removed{0};
+    std::atomic<uint64_t> replicated_skipped{0};
+    std::atomic<uint64_t> recovery_notify_owed{0};
+    std::atomic<uint64_t> recovery_notify_queued{0};
+    std::atomic<uint64_t> recovery_notify_sent{0};
+    std::atomic<uint64_t> recovery_notify_superseded{0};
+    std::atomic<uint64_t> recovery_notify_rate{0};   // Paced NOTIFYs/s; 0 = unpaced
 };
 
 class DialogWorker {
@@ -45,16 +73,21 @@ public:
     DialogWorker(size_t worker_index, const Config& config,
                  std::shared_ptr<SlowEventLogger> slow_logger,
                  std::shared_ptr<SubscriptionStore> sub_store,
-                 SipStackManager* stack_mgr = nullptr);
+                 SipStackManager* stack_mgr = nullptr,
+                 DialogDispatcher* dispatcher = nullptr);
     ~DialogWorker();
 
     Result start();
     void stop();
+    // Events from the SIP stack go to the transaction lane, presence and MWI
+    // feed events to the feed lane; each lane holds max_incoming_queue_per_worker.
     Result enqueue(std::unique_ptr<SipEvent> event);
+    // Enqueues as many as fit under one lock; returns how many were taken
+    size_t enqueue_batch(std::vector<std::unique_ptr<SipEvent>>& events);
 
     struct StaleInfo {
         std::string dialog_id;
-        std::string tenant_id;
+        TenantId    tenant_id;
         SubscriptionType type;
         SubLifecycle lifecycle;
         TimePoint last_activity;
@@ -68,6 +101,34 @@ public:
     // Load recovered subscriptions from MongoDB into this worker
     Result load_recovered_subscription(SubscriptionRecord record);
 
+    // Apply records fetched from MongoDB after a snapshot-based start.  Runs
+    // on the worker thread; a record replaces local state only if its
+    // updated_at is newer and the dialog has not been re-established since.
+    Result reconcile_subscriptions(std::vector<SubscriptionRecord> records);
+
+    // Changes streamed from the replication primary, applied in order on the
+    // worker thread.  An upsert replaces the local copy outright (the stream
+    // is ordered per dialog) unless the phone's dialog is live on this node.
+    // kSyncEnd closes a full resync: every replica not refreshed by that
+    // generation is dropped.
+    struct ReplicatedChange {
+        enum Kind : uint8_t { kUpsert, kErase, kSyncEnd };
+        Kind kind = kUpsert;
+        uint64_t generation = 0;
+        SubscriptionRecord record;       // Only dialog_id for kErase
+    };
+    Result apply_replicated(std::vector<ReplicatedChange> changes);
+
+    // Asks the worker to hand up to max_dialogs idle dialogs to target.  Runs
+    // on the worker thread at the end of a cycle; a dialog moves only while
+    // neither its own queue nor the worker's ingress holds an event.
+    void migrate_to(DialogWorker& target, size_t max_dialogs);
+    // Same, with the target chosen per dialog; kNoWorker (or this worker)
+    // keeps the dialog.  Used by resize to move only ring-affected dialogs.
+    using MigrationTarget = std::function<uint32_t(const std::string& dialog_id)>;
+    void migrate_where(MigrationTarget target_for, size_t max_dialogs);
+    bool has_pending_migrations() const;
+
     const WorkerStats& stats() const { return stats_; }
     size_t worker_index() const { return worker_index_; }
 
@@ -80,24 +141,67 @@ private:
         SubscriptionRecord record;
         std::queue<std::unique_ptr<SipEvent>> event_queue;
         nua_handle_t* nua_handle = nullptr;  // Sofia handle for this dialog
+        uint64_t replica_generation = 0;     // Sync that last wrote it; 0 = not replicated
+        bool full_state_owed = false;        // Recovered; the phone has had no NOTIFY from us
+        bool full_state_queued = false;      // Waiting in recovery_notify_
     };
+    using DialogMap = std::unordered_map<std::string, DialogContext>;
+
+    // Ingress lanes, drained in this order
+    enum Lane : size_t { kTransactionLane = 0, kFeedLane, kNumLanes };
+    static Lane lane_of(const SipEvent& ev) {
+        return ev.source == SipEventSource::kSipStack ? kTransactionLane : kFeedLane;
+    }
+    bool lanes_empty_locked() const { return lanes_[kTransactionLane].empty() && lanes_[kFeedLane].empty(); }
+    void publish_queue_depth_locked();
 
     void run();
     void process_dialog_queues();
+    // Queues the event on its dialog, creating the dialog for a new SUBSCRIBE.
+    // Null if the event was forwarded to another worker or dropped.
+    DialogMap::value_type* route_to_dialog(std::unique_ptr<SipEvent> event);
+    // Processes the dialog's queue up to and including its next SIP transaction
+    void serve_transaction(DialogMap::value_type& entry);
     void process_event(const std::string& dialog_id, DialogContext& ctx,
                        std::unique_ptr<SipEvent> event);
     void process_presence_trigger(const std::string& dialog_id,
                                    DialogContext& ctx, const SipEvent& event);
-    void handle_new_subscription(const std::string& dialog_id, const SipEvent& event);
+    void process_mwi_trigger(const std::string& dialog_id,
+                             DialogContext& ctx, const SipEvent& event);
+    // Negotiates Expires (written back into the event) and creates the dialog
+    void handle_new_subscription(const std::string& dialog_id, SipEvent& event);
+    // Re-SUBSCRIBE on an active dialog: answers with the negotiated Expires
+    // and stores the record only once the stored expiry lags by
+    // expires.checkpoint_sec
+    void refresh_subscription(DialogContext& ctx, SipEvent& event);
+    // The callback refs the handle of every incoming SUBSCRIBE; a dialog
+    // keeps exactly one
+    void take_subscribe_handle(DialogContext& ctx, SipEvent& event);
     void cleanup_terminated_dialogs();
-    void index_blf_subscription(const std::string& dialog_id, const SubscriptionRecord& rec);
-    void deindex_blf_subscription(const std::string& dialog_id, const SubscriptionRecord& rec);
-    void persist_record(const SubscriptionRecord& record, bool immediate = false);
+    void index_subscription(const std::string& dialog_id, const SubscriptionRecord& rec);
+    void deindex_subscription(const std::string& dialog_id, const SubscriptionRecord& rec);
+    void register_in_registry(const SubscriptionRecord& rec);
+    void persist_record(SubscriptionRecord& record, bool immediate = false);
+    DialogContext& adopt_recovered(SubscriptionRecord record);
+    void apply_reconciled(SubscriptionRecord record);
+    void apply_replicated_change(ReplicatedChange& change);
+    // Removes a replica that has no live dialog here
+    void drop_replica(DialogMap::iterator it);
+    void adopt_migrated();
+    void migrate_out();
+    // Recovered dialogs owe one full-state NOTIFY once a handle re-attaches
+    void mark_full_state_owed(DialogContext& ctx);
+    // Sizes recovery_notify_'s rate to the current debt
+    void pace_owed_notifies();
+    void settle_full_state(DialogContext& ctx);
+    void queue_full_state(DialogContext& ctx);
+    void send_owed_notifies();
 
     // SIP response/NOTIFY sending
     void send_subscribe_response(DialogContext& ctx, const SipEvent& event,
                                  int status, const char* phrase);
-    void send_sip_notify(DialogContext& ctx, const std::string& content_type,
+    // False if the NOTIFY could not be handed to the stack
+    bool send_sip_notify(DialogContext& ctx, const std::string& content_type,
                          const std::string& body, const char* sub_state);
     void send_initial_notify(DialogContext& ctx);
     void handle_notify_response(const std::string& dialog_id, DialogContext& ctx,
@@ -109,6 +213,8 @@ private:
     std::shared_ptr<SlowEventLogger> slow_logger_;
     std::shared_ptr<SubscriptionStore> sub_store_;
     SipStackManager* stack_mgr_;
+    DialogDispatcher* dispatcher_;
+    DialogRoutingTable* routing_;
 
     std::thread thread_;
     std::atomic<bool> running_{false};
@@ -116,18 +222,43 @@ private:
 
     mutable std::mutex incoming_mu_;
     std::condition_variable incoming_cv_;
-    std::queue<std::unique_ptr<SipEvent>> incoming_queue_;
+    std::array<std::queue<std::unique_ptr<SipEvent>>, kNumLanes> lanes_;
 
     mutable std::mutex terminate_mu_;
     std::vector<std::string> pending_terminates_;
 
-    std::unordered_map<std::string, DialogContext> dialogs_;
+    mutable std::mutex reconcile_mu_;
+    std::vector<SubscriptionRecord> pending_reconciles_;
+    std::vector<ReplicatedChange> pending_replicated_;
+    std::atomic<bool> replicated_waiting_{false};   // Wakes the loop for pending_replicated_
+
+    // Outgoing handoff requests and dialogs handed to this worker.  A source
+    // repoints the routing table and then appends to migrated_in_, both under
+    // this worker's migrate_mu_; the loop adopts under that lock after taking
+    // its lanes, so the first event routed here always finds its context.
+    struct MigrationRequest {
+        MigrationTarget target_for;
+        size_t max_dialogs;
+    };
+    mutable std::mutex migrate_mu_;
+    bool accepting_migrations_ = false;   // False once stop() begins
+    std::vector<MigrationRequest> pending_migrations_;
+    std::deque<DialogContext> migrated_in_;
+    std::atomic<bool> migrations_waiting_{false};   // Wakes the loop for migrated_in_
+
+    DialogMap dialogs_;
+    // Registry tenant counters, cached so the limit check takes no lock
+    std::unordered_map<TenantId, const std::atomic<int64_t>*> tenant_counts_;
 
     std::unique_ptr<BlfProcessor> blf_processor_;
     std::unique_ptr<MwiProcessor> mwi_processor_;
+    ExpiresPolicy expires_policy_;
+    RecoveryNotifyScheduler recovery_notify_;
+    bool owed_added_ = false;   // Debt grew since the last pace_owed_notifies()
     WorkerStats stats_;
     uint64_t process_cycle_ = 0;
     static constexpr uint64_t kCleanupInterval = 1000;
+    static constexpr size_t kInitialDialogReserve = 4096;
 };
 
 } // namespace sip_processor
@@ -0,0 +1,38 @@
+
+// =============================================================================
+// FILE: include/dispatch/hash_ring.h
+// =============================================================================
+#ifndef HASH_RING_H
+#define HASH_RING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace sip_processor {
+
+// Consistent-hash ring over workers [0, num_workers).  Each worker owns
+// `vnodes` points; a key belongs to the first point at or after its hash.
+// Adding worker N takes roughly 1/(N+1) of the keys, all of them from the
+// existing workers, and removing it gives back exactly those.  Immutable:
+// a resize builds a new ring.
+class HashRing {
+public:
+    HashRing(size_t num_workers, size_t vnodes);
+
+    uint32_t owner(std::string_view key) const { return owner_of_hash(key_hash(key)); }
+    uint32_t owner_of_hash(uint64_t hash) const;
+    size_t num_workers() const { return num_workers_; }
+
+    // Stable across processes, unlike std::hash
+    static uint64_t key_hash(std::string_view key);
+
+private:
+    size_t num_workers_;
+    std::vector<std::pair<uint64_t, uint32_t>> points_;   // Sorted by hash
+};
+
+} // namespace sip_processor
+#endif // HASH_RING_H
@@ -0,0 +1,100 @@
+
+// =============================================================================
+// FILE: include/dispatch/overload_controller.h
+// =============================================================================
+#ifndef OVERLOAD_CONTROLLER_H
+#define OVERLOAD_CONTROLLER_H
+#include "common/types.h"
+#include "common/config.h"
+#include "common/latency_histogram.h"
+#include "subscription/subscription_type.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace sip_processor {
+class DialogDispatcher;
+class SipStackManager;
+
+// Each level keeps the responses of the levels below it
+enum class OverloadLevel : uint8_t {
+    kNormal = 0,
+    kElevated,     // Coalesce queued presence triggers, lengthen refresh Expires
+    kShedding,     // 503 a share of new SUBSCRIBEs that grows with pressure
+    kCritical,     // 503 every new SUBSCRIBE
+};
+const char* overload_level_name(OverloadLevel level);
+
+// Samples worker lane fill, queue-wait p99 and the SIP stack's NOTIFY
+// backlog, and maps the worst of them to a level.  Pressure is a signal
+// over its overload.* limit, so 1.0 means a limit is reached.  The level
+// rises as soon as pressure crosses a threshold and falls one step per
+// sample once pressure is 10 points below the current level's threshold.
+// Refreshes and in-dialog requests are never shed.
+class OverloadController {
+public:
+    struct Signals {
+        double   queue_fill = 0;          // Fullest worker lane, 0..1
+        uint64_t queue_wait_p99_us = 0;   // Over the last sample interval
+        int64_t  notify_backlog = 0;
+    };
+    struct Stats {
+        std::atomic<uint64_t> level{0};
+        std::atomic<uint64_t> pressure_pct{0};
+        std::atomic<uint64_t> shed_permille{0};
+        std::atomic<uint64_t> queue_fill_pct{0};
+        std::atomic<uint64_t> queue_wait_p99_us{0};
+        std::atomic<uint64_t> notify_backlog{0};
+        std::atomic<uint64_t> level_changes{0};
+        std::atomic<uint64_t> subscribes_shed{0};
+        std::atomic<uint64_t> refreshes_extended{0};
+    };
+
+    OverloadController(const Config& config, DialogDispatcher& dispatcher,
+                       SipStackManager* stack = nullptr);
+    ~OverloadController();
+    Result start();
+    void stop();
+
+    OverloadLevel level() const {
+        return static_cast<OverloadLevel>(stats_.level.load(std::memory_order_relaxed));
+    }
+    bool coalesce_presence() const { return level() >= OverloadLevel::kElevated; }
+    // False if a new SUBSCRIBE should be answered 503; counts the shed
+    bool admit_new_subscription();
+    // Spread over [retry_after_sec, 2 * retry_after_sec) so shed phones do
+    // not all come back in the same second
+    uint32_t retry_after_sec();
+    // Expires to grant in a refresh 200 OK.  While elevated this is
+    // overload.refresh_expires_sec, capped at the reaper TTL for the type.
+    uint32_t refresh_expires(uint32_t requested, SubscriptionType type);
+
+    // One sampling step; public so tests can drive the controller directly
+    Signals sample();
+    void update(const Signals& signals);
+    double pressure(const Signals& signals) const;
+
+    const Stats& stats() const { return stats_; }
+
+    OverloadController(const OverloadController&) = delete;
+    OverloadController& operator=(const OverloadController&) = delete;
+private:
+    void run();
+    double threshold(OverloadLevel level) const;
+
+    Config config_;
+    DialogDispatcher& dispatcher_;
+    SipStackManager* stack_;
+    LatencyHistogram::Snapshot last_wait_;   // Sampling thread only
+    std::atomic<uint64_t> admission_seq_{0};
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stop_requested_{false};
+    std::mutex mu_;
+    std::condition_variable cv_;
+    Stats stats_;
+};
+} // namespace sip_processor
+#endif
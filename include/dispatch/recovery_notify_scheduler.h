@@ -0,0 +1,77 @@
+
+// =============================================================================
+// FILE: include/dispatch/recovery_notify_scheduler.h
+// =============================================================================
+#ifndef RECOVERY_NOTIFY_SCHEDULER_H
+#define RECOVERY_NOTIFY_SCHEDULER_H
+
+#include "common/types.h"
+#include <cstddef>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace sip_processor {
+
+// Paces the full-state NOTIFYs owed to recovered subscriptions.  After a
+// restart every recovered dialog owes its phone one full-state NOTIFY once
+// the phone's refresh re-attaches the dialog; without pacing, the phones
+// that retried during the outage all come back at once and their NOTIFYs
+// (and the MongoDB writes behind them) arrive together at the SBCs.
+//
+// One per worker, used only on the worker thread.  Dialogs are sent
+// nearest expiry first, at most `rate` per second after a `burst`; a
+// rate of 0 sends everything as soon as it is scheduled.
+class RecoveryNotifyScheduler {
+public:
+    void configure(double rate_per_sec, double burst);
+    // Changes the pace of a running scheduler: tokens already earned are
+    // kept (up to the new burst), so a re-pace grants no extra burst
+    void set_rate(double rate_per_sec, double burst);
+    double rate() const { return rate_; }
+
+    void schedule(std::string dialog_id, TimePoint expires_at);
+    size_t queued() const { return heap_.size(); }
+
+    // Calls send(dialog_id) for queued dialogs while tokens last.  send
+    // returns false for a dialog that no longer needs the NOTIFY (gone,
+    // superseded by a live one); that costs no token.  Returns how many
+    // were sent.
+    template <typename Send>
+    size_t drain(TimePoint now, Send&& send) {
+        refill(now);
+        size_t sent = 0;
+        while (!heap_.empty() && (rate_ <= 0 || tokens_ >= 1.0)) {
+            std::string did = std::move(const_cast<Entry&>(heap_.top()).dialog_id);
+            heap_.pop();
+            if (!send(did)) continue;
+            ++sent;
+            if (rate_ > 0) tokens_ -= 1.0;
+        }
+        return sent;
+    }
+
+private:
+    void refill(TimePoint now);
+
+    struct Entry {
+        TimePoint   expires_at;
+        std::string dialog_id;
+        // No expiry sorts last
+        bool operator>(const Entry& o) const {
+            bool none = expires_at == TimePoint{}, o_none = o.expires_at == TimePoint{};
+            if (none != o_none) return none;
+            return expires_at > o.expires_at;
+        }
+    };
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap_;
+
+    double rate_ = 0;
+    double burst_ = 1;
+    double tokens_ = 0;
+    TimePoint last_refill_{};
+};
+
+} // namespace sip_processor
+#endif // RECOVERY_NOTIFY_SCHEDULER_H
@@ -0,0 +1,82 @@
+
+// =============================================================================
+// FILE: include/dispatch/subscription_recovery.h
+// =============================================================================
+#ifndef SUBSCRIPTION_RECOVERY_H
+#define SUBSCRIPTION_RECOVERY_H
+#include "common/types.h"
+#include "common/config.h"
+#include "subscription/subscription_state.h"
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <vector>
+namespace sip_processor {
+class DialogDispatcher;
+class SubscriptionStore;
+class LocalSnapshotStore;
+class SubscriptionChangeListener;
+
+// Restores subscriptions into the workers on startup.
+//
+//   1. recover() — before dispatcher.start().  Loads the local snapshot +
+//      journal if one exists, otherwise falls back to a full MongoDB load.
+//      Records are partitioned by worker and loaded on one thread per worker.
+//   2. start_reconcile() — after dispatcher.start().  When the snapshot was
+//      used, reads MongoDB in the background and hands every record to its
+//      worker, which keeps whichever copy has the newer updated_at.
+class SubscriptionRecovery {
+public:
+    enum class Source { kNone, kSnapshot, kMongo };
+
+    SubscriptionRecovery(const Config& config, DialogDispatcher& dispatcher,
+                         std::shared_ptr<SubscriptionStore> sub_store,
+                         std::shared_ptr<LocalSnapshotStore> snapshot);
+    ~SubscriptionRecovery();
+
+    Result recover();
+    // Recovered records are offered to these listeners before they are
+    // loaded; the replication primary needs them to sync a standby
+    void add_replay_listener(std::shared_ptr<SubscriptionChangeListener> listener);
+    void start_reconcile();
+    void stop();
+
+    // Load `records` into the dispatcher's workers, one thread per worker
+    static void load_into_workers(DialogDispatcher& dispatcher,
+                                  std::vector<SubscriptionRecord> records);
+
+    struct RecoveryStats {
+        std::atomic<int>      source{0};          // Source enum value
+        std::atomic<uint64_t> records_loaded{0};
+        std::atomic<uint64_t> load_ms{0};
+        std::atomic<uint64_t> reconcile_fetched{0};
+        std::atomic<uint64_t> reconcile_ms{0};
+        std::atomic<bool>     reconcile_done{false};
+    };
+    const RecoveryStats& stats() const { return stats_; }
+    Source source() const { return static_cast<Source>(stats_.source.load()); }
+
+    SubscriptionRecovery(const SubscriptionRecovery&) = delete;
+    SubscriptionRecovery& operator=(const SubscriptionRecovery&) = delete;
+private:
+    void reconcile_thread_func();
+
+    Config config_;
+    DialogDispatcher& dispatcher_;
+    std::shared_ptr<SubscriptionStore> sub_store_;
+    std::shared_ptr<LocalSnapshotStore> snapshot_;
+    std::vector<std::shared_ptr<SubscriptionChangeListener>> replay_listeners_;
+    std::thread reconcile_thread_;
+    std::atomic<bool> stop_requested_{false};
+    RecoveryStats stats_;
+};
+
+inline const char* recovery_source_to_string(SubscriptionRecovery::Source s) {
+    switch (s) {
+        case SubscriptionRecovery::Source::kSnapshot: return "snapshot";
+        case SubscriptionRecovery::Source::kMongo:    return "mongodb";
+        default:                                      return "none";
+    }
+}
+} // namespace sip_processor
+#endif
@@ -23,6 +23,7 @@ class SipStackManager;
 //   - At least one worker thread alive
 //   - MongoDB connected (if persistence enabled)
 //   - Presence feed connected (degraded if not)
+//   - Overload controller not shedding (degraded if it is)
 class HealthHandler {
 public:
     struct Dependencies {
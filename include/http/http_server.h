@@ -13,6 +13,9 @@
 #include <atomic>
 #include <functional>
 #include <unordered_map>
+#include <condition_variable>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -24,16 +27,27 @@ namespace sip_processor {
 //   GET  /health          → Health check (200 OK / 503 Unhealthy)
 //   GET  /ready           → Readiness check
 //   GET  /stats           → Full system statistics JSON
-//   GET  /stats/workers   → Per-worker stats
+//   GET  /stats/workers   → Per-worker stats and dialog balance
 //   GET  /stats/presence  → Presence connection stats
 //   GET  /stats/mongo     → MongoDB stats
-//   GET  /subscriptions                      → All subscriptions summary
-//   GET  /subscriptions?tenant=<id>          → Subscriptions for tenant
+//   GET  /stats/latency   → Per-stage latency percentiles
+//   GET  /stats/slow      → Slowest recent events with stage breakdown
+//   GET  /metrics         → OpenMetrics exposition (Prometheus scrape)
+//   GET  /subscriptions                      → Subscriptions, paged + streamed
+//   GET  /subscriptions?tenant=&type=&lifecycle=&worker=&uri_prefix=&limit=&cursor=
 //   GET  /subscriptions/<dialog_id>          → Single subscription detail
 //   GET  /config          → Current configuration (redacted)
+//   POST /mwi?account=    → Mailbox update, fanned out (http.mwi_feed_enabled)
+//   POST /workers?count=  → Resize the dialog worker pool online
 //
-// Implementation: Single-threaded select-based HTTP/1.1 server.
-// For production, consider replacing with a library (cpp-httplib, crow, etc.)
+// Implementation: one epoll event loop owns every socket. Connections are
+// non-blocking and kept alive (HTTP/1.1 semantics); requests are parsed
+// incrementally as bytes arrive, bodies included. Handlers run on a small
+// thread pool, except routes registered Dispatch::kInline (health probes),
+// which run on the loop so an expensive admin call never delays them.
+// Chunked responses are produced one chunk at a time on the pool, each
+// after the previous chunk has been written. HTTP/1.0 clients get the same
+// chunks unframed, and the connection closes to end the body.
 class HttpServer {
 public:
     explicit HttpServer(const Config& config);
@@ -43,6 +57,7 @@ public:
     struct Request {
         std::string method;
         std::string path;
+        std::string version;      // e.g. "HTTP/1.1"
         std::string query_string;
         std::unordered_map<std::string, std::string> query_params;
         std::unordered_map<std::string, std::string> headers;
@@ -54,22 +69,41 @@ public:
         std::string content_type = "application/json";
         std::string body;
         std::unordered_map<std::string, std::string> headers;
+
+        // When set, the response is sent with chunked transfer encoding
+        // (close-delimited to HTTP/1.0 clients) and `body` is ignored: the
+        // producer is called repeatedly to fill the next chunk and returns
+        // false once the response is complete.
+        std::function<bool(std::string& chunk)> stream;
     };
 
     using Handler = std::function<Response(const Request&)>;
 
-    // Register a route handler
-    void route(const std::string& method, const std::string& path, Handler handler);
+    // kInline handlers run on the event loop and must be cheap and
+    // non-blocking; kPool handlers run on the handler threads
+    enum class Dispatch { kPool, kInline };
+
+    // Register a route handler. A path also serves requests below it
+    // (/subscriptions matches /subscriptions/<id>) unless a longer route
+    // matches; lookup costs one hash probe per path segment.
+    void route(const std::string& method, const std::string& path, Handler handler,
+               Dispatch dispatch = Dispatch::kPool);
 
     Result start();
     void stop();
     bool is_running() const { return running_.load(std::memory_order_acquire); }
 
+    // Bound port; differs from the configured one when that is 0
+    uint16_t port() const { return bound_port_; }
+
     struct ServerStats {
         std::atomic<uint64_t> requests_total{0};
         std::atomic<uint64_t> requests_ok{0};
         std::atomic<uint64_t> requests_error{0};
         std::atomic<uint64_t> active_connections{0};
+        std::atomic<uint64_t> connections_accepted{0};
+        std::atomic<uint64_t> connections_rejected{0};   // Over max_connections
+        std::atomic<uint64_t> keepalive_reuses{0};       // Requests after the first on a connection
     };
     const ServerStats& stats() const { return stats_; }
 
@@ -77,21 +111,79 @@ public:
     HttpServer& operator=(const HttpServer&) = delete;
 
 private:
-    void server_thread_func();
-    void handle_client(int client_fd);
+    struct Route {
+        Handler  handler;
+        Dispatch dispatch;
+    };
+    struct Connection;
+
+    // Work for the handler pool: run a route, or produce the next chunk
+    // of a streamed response. Results come back as a Completion.
+    struct Job {
+        int         fd;
+        uint64_t    conn_id;
+        const Route* route = nullptr;
+        Request     request;
+        bool        keep_alive = false;
+        bool        chunked = true;     // Else a streamed body is close-delimited
+        std::shared_ptr<Response> stream;
+    };
+    struct Completion {
+        int         fd;
+        uint64_t    conn_id;
+        std::string data;                   // Bytes to write
+        std::shared_ptr<Response> stream;   // Set while a chunked response continues
+        bool        close = false;
+    };
+
+    void event_loop();
+    void accept_connections();
+    void on_readable(Connection& c);
+    void on_writable(Connection& c);
+    void process_input(Connection& c);
+    void start_response(Connection& c, Response resp, bool keep_alive);
+    void drain_completions();
+    void sweep_idle(TimePoint now);
+    void close_connection(int fd);
+    void set_writable_interest(Connection& c, bool want);
+
+    void handler_thread_func();
+    void submit(Job job);
+    void complete(Completion done);
+    Response run_handler(const Route& route, const Request& req);
+    static std::string chunk_frame(const std::string& chunk, bool last);
+
+    const Route* find_route(const std::string& method, const std::string& path) const;
     Request parse_request(const std::string& raw);
-    std::string serialize_response(const Response& resp);
+    // `chunked` false: a streamed response gets no Transfer-Encoding header
+    std::string serialize_response(const Response& resp, bool keep_alive, bool chunked);
     std::unordered_map<std::string, std::string> parse_query_string(const std::string& qs);
 
     Config config_;
     int server_fd_ = -1;
-    std::thread server_thread_;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;                 // eventfd: completions ready or stop
+    uint16_t bound_port_ = 0;
+    std::thread loop_thread_;
+    std::vector<std::thread> handler_threads_;
     std::atomic<bool> running_{false};
     std::atomic<bool> stop_requested_{false};
 
-    // Route table: "METHOD:path" → handler
-    std::mutex routes_mu_;
-    std::unordered_map<std::string, Handler> routes_;
+    // Route table: "METHOD path" → route. Nodes are never erased, so a
+    // Route* stays valid for the server's lifetime.
+    mutable std::mutex routes_mu_;
+    std::unordered_map<std::string, Route> routes_;
+
+    // Owned by the event loop thread
+    std::unordered_map<int, std::unique_ptr<Connection>> conns_;
+    uint64_t next_conn_id_ = 1;
+
+    std::mutex jobs_mu_;
+    std::condition_variable jobs_cv_;
+    std::deque<Job> jobs_;
+
+    std::mutex done_mu_;
+    std::vector<Completion> done_;
 
     ServerStats stats_;
 };
@@ -0,0 +1,48 @@
+
+// =============================================================================
+// FILE: include/http/mwi_handler.h
+// =============================================================================
+#ifndef MWI_HANDLER_H
+#define MWI_HANDLER_H
+
+#include "http/http_server.h"
+#include <atomic>
+
+namespace sip_processor {
+
+class DialogDispatcher;
+
+// Mailbox update ingestion for voicemail platforms.
+//
+//   POST /mwi?account=<uri>[&tenant=<id>]
+//   Content-Type: application/simple-message-summary
+//
+// The body is validated once, looked up in MwiSubscriptionIndex and handed
+// to every watching dialog as one shared buffer through a batched dispatch;
+// each worker NOTIFYs only if the dialog's counts changed. Without
+// ?account= the body's Message-Account is used. Unauthenticated, so main
+// registers it only when http.mwi_feed_enabled is set.
+class MwiHandler {
+public:
+    struct Dependencies {
+        DialogDispatcher* dispatcher = nullptr;
+    };
+
+    struct FeedStats {
+        std::atomic<uint64_t> updates_received{0};
+        std::atomic<uint64_t> updates_invalid{0};
+        std::atomic<uint64_t> watchers_not_found{0};
+        std::atomic<uint64_t> triggers_dispatched{0};
+        std::atomic<uint64_t> triggers_dropped{0};   // Worker queue full or dialog gone
+    };
+    static const FeedStats& stats();
+
+    static void register_routes(HttpServer& server, const Dependencies& deps);
+
+private:
+    static HttpServer::Response handle_update(const HttpServer::Request& req,
+                                               const Dependencies& deps);
+};
+
+} // namespace sip_processor
+#endif
@@ -19,6 +19,8 @@ class MongoClient;
 class SubscriptionStore;
 class SlowEventLogger;
 class SipStackManager;
+class LocalSnapshotStore;
+class SubscriptionRecovery;
 struct Config;
 
 // Registers stats, subscription, and config endpoints on the HTTP server.
@@ -35,6 +37,8 @@ public:
         MongoClient*             mongo            = nullptr;
         SubscriptionStore*       sub_store        = nullptr;
         SlowEventLogger*         slow_logger      = nullptr;
+        LocalSnapshotStore*      snapshot_store   = nullptr;
+        SubscriptionRecovery*    recovery         = nullptr;
     };
 
     static void register_routes(HttpServer& server, const Dependencies& deps);
@@ -46,6 +50,12 @@ private:
                                                       const Dependencies& deps);
     static HttpServer::Response handle_stats_presence(const HttpServer::Request& req,
                                                        const Dependencies& deps);
+    static HttpServer::Response handle_stats_latency(const HttpServer::Request& req,
+                                                      const Dependencies& deps);
+    static HttpServer::Response handle_stats_slow(const HttpServer::Request& req,
+                                                   const Dependencies& deps);
+    static HttpServer::Response handle_metrics(const HttpServer::Request& req,
+                                                const Dependencies& deps);
     static HttpServer::Response handle_subscriptions(const HttpServer::Request& req,
                                                       const Dependencies& deps);
     static HttpServer::Response handle_config(const HttpServer::Request& req,
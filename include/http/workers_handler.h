@@ -0,0 +1,36 @@
+
+// =============================================================================
+// FILE: include/http/workers_handler.h
+// =============================================================================
+#ifndef WORKERS_HANDLER_H
+#define WORKERS_HANDLER_H
+
+#include "http/http_server.h"
+
+namespace sip_processor {
+
+class DialogDispatcher;
+
+// Online worker pool resize.
+//
+//   POST /workers?count=<n>
+//
+// Growing starts workers and hands them the dialogs the hash ring now maps
+// to them; shrinking takes the tail workers off the ring and drains them in
+// the background.  GET /stats/workers shows the draining workers until they
+// stop.
+class WorkersHandler {
+public:
+    struct Dependencies {
+        DialogDispatcher* dispatcher = nullptr;
+    };
+
+    static void register_routes(HttpServer& server, const Dependencies& deps);
+
+private:
+    static HttpServer::Response handle_resize(const HttpServer::Request& req,
+                                               const Dependencies& deps);
+};
+
+} // namespace sip_processor
+#endif
@@ -0,0 +1,121 @@
+
+// =============================================================================
+// FILE: include/persistence/local_snapshot_store.h
+// =============================================================================
+#ifndef LOCAL_SNAPSHOT_STORE_H
+#define LOCAL_SNAPSHOT_STORE_H
+
+#include "common/types.h"
+#include "common/config.h"
+#include "persistence/subscription_store.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace sip_processor {
+
+// Node-local copy of the subscription state for fast warm restarts.
+//
+// Two files live in snapshot.directory:
+//   <service_id>.snapshot  — every live SubscriptionRecord, written atomically
+//                             (tmp + rename) and memory-mapped on load
+//   <service_id>.journal   — append-only log of upserts/deletes since the
+//                             last snapshot
+//
+// Both use the same framing after a 32-byte header:
+//   u32 payload_len, u32 checksum, payload (u8 op + SubscriptionCodec record
+//   or dialog_id)
+// A torn or corrupted frame ends the file; anything after it is ignored.
+//
+// Write path: SubscriptionStore forwards every change here (on the worker
+// thread).  The change is encoded into an in-memory buffer; a background
+// thread appends the buffer to the journal every journal_flush_interval and
+// folds the journal into a new snapshot every snapshot.interval.  Compaction
+// streams the old snapshot and copies unchanged frames verbatim, so it never
+// decodes or holds the whole state in memory.
+//
+// Read path: load() maps the snapshot, decodes its frames across N threads,
+// then overlays the journal.  Records that are terminated or already expired
+// are dropped.
+class LocalSnapshotStore : public SubscriptionChangeListener {
+public:
+    explicit LocalSnapshotStore(const Config& config);
+    ~LocalSnapshotStore() override;
+
+    // Fold any leftover journal into the snapshot, open a fresh journal and
+    // start the background writer.
+    Result start();
+    void stop();
+
+    void on_upsert(const SubscriptionRecord& record) override;
+    void on_delete(const std::string& dialog_id) override;
+
+    // Load the latest state of every live subscription.  Safe to call before
+    // start(); snapshot frames are decoded on `num_threads` threads.
+    Result load(std::vector<SubscriptionRecord>& out, size_t num_threads) const;
+
+    // Flush the journal and write a new snapshot that includes it
+    Result compact();
+
+    bool is_enabled() const { return enabled_; }
+    const std::string& snapshot_path() const { return snapshot_path_; }
+    const std::string& journal_path() const { return journal_path_; }
+
+    struct SnapshotStats {
+        std::atomic<uint64_t> journal_appends{0};
+        std::atomic<uint64_t> journal_bytes{0};
+        std::atomic<uint64_t> journal_flushes{0};
+        std::atomic<uint64_t> snapshots_written{0};
+        std::atomic<uint64_t> snapshot_records{0};
+        std::atomic<uint64_t> last_snapshot_ms{0};
+        std::atomic<uint64_t> records_loaded{0};
+        std::atomic<uint64_t> corrupt_frames{0};
+        std::atomic<uint64_t> errors{0};
+    };
+    const SnapshotStats& stats() const { return stats_; }
+
+    LocalSnapshotStore(const LocalSnapshotStore&) = delete;
+    LocalSnapshotStore& operator=(const LocalSnapshotStore&) = delete;
+
+private:
+    enum : uint8_t { kOpUpsert = 1, kOpDelete = 2 };
+
+    // Latest journal payload per dialog (op byte + body)
+    using JournalMap = std::unordered_map<std::string, std::string>;
+
+    void writer_thread_func();
+    void append_frame(uint8_t op, const std::string& body);
+    Result flush_journal_locked();
+    Result open_journal_locked();
+    void close_journal_locked();
+    bool read_journal(const std::string& path, JournalMap& latest) const;
+    Result write_snapshot_locked(const JournalMap& latest);
+
+    Config config_;
+    bool enabled_;
+    std::string snapshot_path_;
+    std::string journal_path_;
+    std::string compacting_path_;
+
+    std::thread writer_thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stop_requested_{false};
+
+    // Encoded frames waiting for the writer thread
+    std::mutex buffer_mu_;
+    std::condition_variable buffer_cv_;
+    std::string pending_;
+
+    // Serializes journal writes and compaction
+    std::mutex file_mu_;
+    int journal_fd_ = -1;
+
+    mutable SnapshotStats stats_;
+};
+
+} // namespace sip_processor
+#endif // LOCAL_SNAPSHOT_STORE_H
@@ -0,0 +1,63 @@
+
+// =============================================================================
+// FILE: include/persistence/subscription_codec.h
+// =============================================================================
+#ifndef SUBSCRIPTION_CODEC_H
+#define SUBSCRIPTION_CODEC_H
+
+#include "subscription/subscription_state.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace sip_processor {
+
+// Compact binary encoding of a SubscriptionRecord, used by the local snapshot
+// and journal files.
+//
+// Layout (all integers little-endian):
+//   u8  format version
+//   str dialog_id           (first, so it can be peeked without a full decode)
+//   u8  type, u8 lifecycle
+//   u32 cseq, u32 notify_cseq, u32 blf_notify_version
+//   i32 mwi_new_messages, i32 mwi_old_messages
+//   i64 expires_at          (wall-clock ms, 0 = no expiry)
+//   i64 updated_at_ms
+//   str tenant_id, blf_*, mwi_*, SIP dialog headers
+// where "str" is a u32 length followed by the raw bytes.
+//
+// Only persistent state is encoded; runtime fields (is_processing, dirty,
+// events_processed, last_activity) are reset on decode.  expires_at is
+// converted to wall-clock time on encode and back to steady_clock on decode
+// so it survives a reboot.
+class SubscriptionCodec {
+public:
+    static constexpr uint8_t kFormatVersion = 1;
+
+    // Append the encoding of `record` to `out`
+    static void encode(const SubscriptionRecord& record, std::string& out);
+
+    // Decode one record. Returns false on truncated or malformed input.
+    static bool decode(const char* data, size_t len, SubscriptionRecord& out);
+
+    // Fixed-position fields readable without a full decode (no allocation)
+    struct Summary {
+        std::string_view dialog_id;
+        SubLifecycle     lifecycle = SubLifecycle::kPending;
+        int64_t          expires_wall_ms = 0;
+
+        bool is_live(int64_t now_wall_ms) const {
+            return lifecycle != SubLifecycle::kTerminated &&
+                   lifecycle != SubLifecycle::kTerminating &&
+                   (expires_wall_ms == 0 || expires_wall_ms > now_wall_ms);
+        }
+    };
+    static bool peek(const char* data, size_t len, Summary& out);
+
+    // FNV-1a over a frame payload — detects torn or corrupted journal tails
+    static uint32_t checksum(const char* data, size_t len);
+};
+
+} // namespace sip_processor
+#endif // SUBSCRIPTION_CODEC_H
@@ -0,0 +1,162 @@
+
+// =============================================================================
+// FILE: include/persistence/subscription_replication.h
+// =============================================================================
+#ifndef SUBSCRIPTION_REPLICATION_H
+#define SUBSCRIPTION_REPLICATION_H
+
+#include "common/types.h"
+#include "common/config.h"
+#include "dispatch/dialog_worker.h"
+#include "persistence/subscription_store.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace sip_processor {
+
+class DialogDispatcher;
+
+// Hot-standby replication of subscription state.
+//
+// The primary (replication.role = primary) runs a ReplicationSender: a
+// SubscriptionChangeListener that keeps the latest encoded record of every
+// live dialog and streams each change to the standby connected on
+// replication.listen_port.  A standby that connects (or falls more than
+// replication.max_backlog behind) first gets the whole table, then deltas.
+//
+// The standby (replication.role = standby) runs a ReplicationReceiver that
+// connects to replication.primary_host:primary_port and applies the stream
+// into its own workers with DialogWorker::apply_replicated.  BLF/MWI
+// indexes, registry and routing are maintained as for recovered
+// subscriptions, so when the phones' traffic moves to the standby it
+// already holds each dialog's lifecycle, notify CSeq, BLF version and last
+// state: nothing is loaded from MongoDB and no full-state NOTIFY is owed.
+//
+// Stream framing is the local journal's: u32 payload_len, u32 checksum,
+// payload (u8 op + SubscriptionCodec record or dialog_id).  A full sync is
+// bracketed by kOpSyncBegin/kOpSyncEnd; the standby drops every replica the
+// sync did not mention.  The primary sends kOpHeartbeat every
+// replication.heartbeat_interval.
+namespace replication {
+enum Op : uint8_t { kOpUpsert = 1, kOpDelete = 2, kOpSyncBegin = 3, kOpSyncEnd = 4, kOpHeartbeat = 5 };
+constexpr size_t kFrameHeaderSize = 8;
+constexpr size_t kMaxFrameSize    = 16 * 1024 * 1024;
+
+// Append one frame carrying `op` and `body` to `out`
+void append_frame(std::string& out, uint8_t op, const char* body, size_t len);
+}  // namespace replication
+
+class ReplicationSender : public SubscriptionChangeListener {
+public:
+    explicit ReplicationSender(const Config& config);
+    ~ReplicationSender() override;
+
+    Result start();
+    void stop();
+    // Bound port; differs from replication.listen_port when that is 0
+    uint16_t port() const { return port_; }
+
+    void on_upsert(const SubscriptionRecord& record) override;
+    void on_delete(const std::string& dialog_id) override;
+
+    struct SenderStats {
+        std::atomic<uint64_t> changes_sent{0};
+        std::atomic<uint64_t> bytes_sent{0};
+        std::atomic<uint64_t> full_syncs{0};
+        std::atomic<uint64_t> backlog_overflows{0};   // Standby fell behind, resynced
+        std::atomic<uint64_t> records_tracked{0};
+        std::atomic<uint64_t> standby_connected{0};
+    };
+    const SenderStats& stats() const { return stats_; }
+
+    ReplicationSender(const ReplicationSender&) = delete;
+    ReplicationSender& operator=(const ReplicationSender&) = delete;
+
+private:
+    void io_thread_func();
+    void accept_standby();
+    void queue_full_sync_locked();
+    // False once the standby is gone
+    bool flush_standby();
+    void drop_standby();
+    void wake();
+
+    Config config_;
+    int listen_fd_ = -1;
+    int wake_fd_ = -1;
+    int standby_fd_ = -1;                 // IO thread only
+    uint16_t port_ = 0;
+
+    std::thread io_thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stop_requested_{false};
+
+    // Latest upsert frame body per live dialog, and frames not yet handed
+    // to the IO thread; workers write both under mu_
+    std::mutex mu_;
+    std::unordered_map<std::string, std::string> table_;
+    std::string outbox_;
+    bool standby_attached_ = false;
+    bool resync_needed_ = false;
+
+    std::string sending_;                 // IO thread only
+    SenderStats stats_;
+};
+
+class ReplicationReceiver {
+public:
+    ReplicationReceiver(const Config& config, DialogDispatcher& dispatcher);
+    ~ReplicationReceiver();
+
+    Result start();
+    void stop();
+    bool is_connected() const { return stats_.primary_connected.load(std::memory_order_acquire) != 0; }
+
+    struct ReceiverStats {
+        std::atomic<uint64_t> records_received{0};
+        std::atomic<uint64_t> deletes_received{0};
+        std::atomic<uint64_t> full_syncs{0};
+        std::atomic<uint64_t> bytes_received{0};
+        std::atomic<uint64_t> corrupt_frames{0};
+        std::atomic<uint64_t> primary_lost{0};
+        std::atomic<uint64_t> primary_connected{0};
+    };
+    const ReceiverStats& stats() const { return stats_; }
+
+    ReplicationReceiver(const ReplicationReceiver&) = delete;
+    ReplicationReceiver& operator=(const ReplicationReceiver&) = delete;
+
+private:
+    void receiver_thread_func();
+    int connect_primary();
+    // Reads until the connection ends; false on a corrupt stream
+    bool stream(int fd);
+    // Parses whole frames off the front of inbox_; false on a corrupt frame
+    bool consume_frames();
+    void flush_batches();
+    // Sleeps up to `d` unless stop() is called
+    void pause(Clock::duration d);
+
+    Config config_;
+    DialogDispatcher& dispatcher_;
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stop_requested_{false};
+    std::mutex stop_mu_;
+    std::condition_variable stop_cv_;
+
+    // Receiver thread only
+    std::string inbox_;
+    uint64_t generation_ = 0;             // New for every kOpSyncBegin
+    std::vector<std::vector<DialogWorker::ReplicatedChange>> batches_;   // Per worker
+    ReceiverStats stats_;
+};
+
+} // namespace sip_processor
+#endif // SUBSCRIPTION_REPLICATION_H
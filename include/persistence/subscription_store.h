@@ -20,6 +20,17 @@ namespace sip_processor {
 
 class MongoClient;
 
+// Observer for subscription changes passing through the store.  Listeners see
+// every upsert and delete — whether or not MongoDB persistence is enabled — on
+// the thread that issued the change (usually a DialogWorker), so they must be
+// cheap and thread-safe.
+class SubscriptionChangeListener {
+public:
+    virtual ~SubscriptionChangeListener() = default;
+    virtual void on_upsert(const SubscriptionRecord& record) = 0;
+    virtual void on_delete(const std::string& dialog_id) = 0;
+};
+
 // Persists minimal subscription state to MongoDB for cross-service redundancy.
 //
 // What is stored (minimal — just enough to resume on another service):
@@ -50,6 +61,9 @@ public:
     Result start();
     void stop();
 
+    // Register a change listener. Must be called before the workers start.
+    void add_change_listener(std::shared_ptr<SubscriptionChangeListener> listener);
+
     // Queue a record for persistence (async, batched)
     void queue_upsert(const SubscriptionRecord& record);
 
@@ -89,6 +103,10 @@ private:
     void sync_thread_func();
     void flush_pending();
 
+    // MongoDB writes without listener notification (used by flush_pending)
+    Result write_record(const SubscriptionRecord& record);
+    Result remove_record(const std::string& dialog_id);
+
     // Serialize/deserialize subscription records
     // (Implemented using libbson / MongoPool — actual implementation in .cpp)
     void serialize_record(const SubscriptionRecord& record, /* bson doc */ void* doc);
@@ -113,6 +131,8 @@ private:
     std::condition_variable queue_cv_;
     std::queue<PendingOp> pending_ops_;
 
+    std::vector<std::shared_ptr<SubscriptionChangeListener>> listeners_;
+
     StoreStats stats_;
 };
 
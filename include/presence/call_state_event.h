@@ -38,7 +38,7 @@ struct CallStateEvent {
     std::string callee_uri;
     CallState   state       = CallState::kUnknown;
     std::string direction;
-    std::string tenant_id;
+    std::string tenant_id;      // Feed text; never interned (see Symbol::find)
     std::string timestamp_str;
     TimePoint   received_at = Clock::now();
     bool        is_valid    = false;
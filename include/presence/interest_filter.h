@@ -0,0 +1,58 @@
+
+// =============================================================================
+// FILE: include/presence/interest_filter.h
+// =============================================================================
+#ifndef INTEREST_FILTER_H
+#define INTEREST_FILTER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sip_processor {
+
+// Bloom filter over the normalized URIs a node's BLF watchers monitor.  A
+// node publishes it to the presence distributor, which forwards a
+// call-state event only to nodes whose filter may hold its caller or
+// callee.  False positives cost a wasted parse on the node; there are no
+// false negatives.  Hashing is FNV-1a, so filters built by one binary are
+// read correctly by another.
+class InterestFilter {
+public:
+    // Double hashing: probe i tests bit (h1 + i * h2) mod bits
+    struct Hashes {
+        uint64_t h1 = 0;
+        uint64_t h2 = 0;
+    };
+    static Hashes hash(std::string_view normalized_uri);
+
+    InterestFilter() = default;
+    // bits is rounded up to a power of two (at least 64)
+    InterestFilter(size_t bits, unsigned hashes);
+    // Sized for bits_per_uri bits per URI, with the optimal probe count
+    static InterestFilter for_uris(const std::vector<std::string>& normalized_uris, size_t bits_per_uri);
+
+    void add(std::string_view normalized_uri) { add(hash(normalized_uri)); }
+    void add(const Hashes& h);
+    bool may_contain(std::string_view normalized_uri) const { return may_contain(hash(normalized_uri)); }
+    bool may_contain(const Hashes& h) const;
+
+    size_t   bits() const    { return words_.size() * 64; }
+    unsigned hashes() const  { return hashes_; }
+    bool     empty() const   { return words_.empty(); }
+    // Share of bits set; the false positive rate is about this ^ hashes()
+    double   fill_ratio() const;
+
+    // <Interest bits="N" hashes="K">hex words</Interest>, one line
+    std::string to_message() const;
+    // Parses one message as written by to_message()
+    static bool parse_message(std::string_view message, InterestFilter& out);
+
+private:
+    std::vector<uint64_t> words_;
+    unsigned hashes_ = 0;
+};
+
+} // namespace sip_processor
+#endif // INTEREST_FILTER_H
@@ -0,0 +1,51 @@
+// =============================================================================
+// FILE: include/presence/interest_publisher.h
+// =============================================================================
+#ifndef INTEREST_PUBLISHER_H
+#define INTEREST_PUBLISHER_H
+
+#include "common/config.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace sip_processor {
+
+// Republishes this node's BLF interest to the presence distributor when the
+// set of monitored URIs has changed.  A URI gaining its first watcher wakes
+// it at once: until the distributor holds that URI it drops the URI's
+// call-state events, and a lamp that misses a call's first state stays
+// wrong for the whole call.  Removals only make the published filter wider
+// than needed, so they wait for the interval.
+class InterestPublisher {
+public:
+    // Receives each InterestFilter message; PresenceTcpClient::publish_interest
+    using PublishFn = std::function<void(std::string message)>;
+
+    InterestPublisher(const Config& config, PublishFn publish);
+    ~InterestPublisher();
+
+    // No-op unless presence.publish_interest is set
+    void start();
+    void stop();
+
+    InterestPublisher(const InterestPublisher&) = delete;
+    InterestPublisher& operator=(const InterestPublisher&) = delete;
+
+private:
+    void wake();
+    void run();
+
+    Config config_;
+    PublishFn publish_;
+    std::thread thread_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool woken_ = false;
+    bool stop_ = false;
+};
+
+} // namespace sip_processor
+#endif // INTEREST_PUBLISHER_H
@@ -0,0 +1,87 @@
+
+// =============================================================================
+// FILE: include/presence/presence_distributor.h
+// =============================================================================
+#ifndef PRESENCE_DISTRIBUTOR_H
+#define PRESENCE_DISTRIBUTOR_H
+
+#include "common/types.h"
+#include "common/config.h"
+#include "presence/call_state_event.h"
+#include "presence/interest_filter.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sip_processor {
+
+// Fans the presence feed out to processor nodes by interest.  Nodes connect
+// as if to a presence server and publish an InterestFilter of the URIs
+// their BLF watchers monitor; each call-state event goes only to nodes
+// whose filter may hold its caller or callee, so a node parses roughly its
+// share of the feed instead of all of it.  A node that has not published
+// a filter yet gets everything.
+//
+// Runs embedded in a processor (fed by its own PresenceTcpClient) or as
+// the presence_distributor sidecar.  Sends its own heartbeats.
+class PresenceDistributor {
+public:
+    explicit PresenceDistributor(const Config& config);
+    ~PresenceDistributor();
+
+    Result start();
+    void stop();
+    // Bound port; differs from distributor.listen_port when that is 0
+    uint16_t port() const { return port_; }
+
+    void on_call_state_event(const CallStateEvent& event);
+
+    struct DistributorStats {
+        std::atomic<uint64_t> events_received{0};
+        std::atomic<uint64_t> events_forwarded{0};    // Per node
+        std::atomic<uint64_t> events_unwanted{0};     // No node interested
+        std::atomic<uint64_t> events_dropped{0};      // Node backlog full
+        std::atomic<uint64_t> interest_updates{0};
+        std::atomic<uint64_t> nodes_connected{0};
+    };
+    const DistributorStats& stats() const { return stats_; }
+
+    PresenceDistributor(const PresenceDistributor&) = delete;
+    PresenceDistributor& operator=(const PresenceDistributor&) = delete;
+
+private:
+    struct Node {
+        int fd = -1;
+        std::string peer;
+        std::string inbox;               // Partial interest messages
+        std::string outbox;              // Not yet written
+        std::shared_ptr<const InterestFilter> interest;   // Null: everything
+    };
+
+    void io_thread_func();
+    void accept_nodes();
+    // False once the node is gone
+    bool read_node(Node& node);
+    bool flush_node(Node& node);
+    void queue_heartbeats();
+    void wake();
+
+    Config config_;
+    int listen_fd_ = -1;
+    int wake_fd_ = -1;
+    uint16_t port_ = 0;
+
+    std::thread io_thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stop_requested_{false};
+
+    std::mutex nodes_mu_;
+    std::vector<std::unique_ptr<Node>> nodes_;
+    DistributorStats stats_;
+};
+
+} // namespace sip_processor
+#endif // PRESENCE_DISTRIBUTOR_H
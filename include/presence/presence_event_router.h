@@ -38,6 +38,8 @@ public:
         std::atomic<uint64_t> events_dropped{0};
         std::atomic<uint64_t> notifications_generated{0};
         std::atomic<uint64_t> watchers_not_found{0};
+        std::atomic<uint64_t> prefilter_rejected{0};   // Of watchers_not_found, no lookup needed
+        std::atomic<uint64_t> tenant_scoped_events{0};
         std::atomic<uint64_t> queue_depth{0};
     };
     const RouterStats& stats() const { return stats_; }
@@ -51,7 +53,7 @@ private:
     std::string build_dialog_info_xml(const CallStateEvent& event,
                                        const std::string& monitored_uri) const;
     std::unique_ptr<SipEvent> create_notify_trigger(
-        const std::string& dialog_id, const std::string& tenant_id,
+        const std::string& dialog_id, TenantId tenant_id,
         const CallStateEvent& event, const std::string& monitored_uri);
 
     Config config_;
@@ -21,6 +21,7 @@ namespace sip_processor {
 
 class PresenceXmlParser;
 class PresenceFailoverManager;
+class UringReceiver;
 
 class PresenceTcpClient {
 public:
@@ -45,6 +46,10 @@ public:
     // Currently connected server info
     std::string connected_server() const;
 
+    // Sends an InterestFilter message to the server (a presence
+    // distributor) now and again after every reconnect
+    void publish_interest(std::string message);
+
     struct ClientStats {
         std::atomic<uint64_t> events_received{0};
         std::atomic<uint64_t> events_delivered{0};
@@ -55,6 +60,8 @@ public:
         std::atomic<uint64_t> failover_count{0};
         std::atomic<uint64_t> heartbeat_timeouts{0};
         std::atomic<uint64_t> parse_errors{0};
+        std::atomic<uint64_t> read_syscalls{0};     // poll/recv or io_uring_enter
+        std::atomic<uint64_t> interest_published{0};
     };
     const ClientStats& stats() const { return stats_; }
 
@@ -65,7 +72,15 @@ private:
     void reader_thread_func();
     Result connect_to_server(const PresenceServerEndpoint& ep);
     void close_socket();
+    void send_interest_locked();
     void read_loop();
+    // False if the kernel turned out to lack multishot recv; the caller
+    // continues on the poll path
+    bool uring_read_loop();
+    void handle_received(const char* data, size_t len);
+    // Until the heartbeat deadline, so an idle io_uring wait wakes only to
+    // declare the timeout
+    Millisecs heartbeat_wait();
     void reconnect_with_backoff();
     void check_heartbeat_timeout();
     void set_connection_state(ConnectionState state, const std::string& detail = "");
@@ -96,6 +111,10 @@ private:
     StateCallback state_callback_;
     ClientStats stats_;
     std::vector<char> recv_buffer_;
+    std::unique_ptr<UringReceiver> uring_;   // presence.io_backend = io_uring
+
+    std::mutex send_mu_;                     // Writes and closes of socket_fd_
+    std::string interest_message_;
 };
 
 } // namespace sip_processor
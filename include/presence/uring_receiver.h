@@ -0,0 +1,75 @@
+
+// =============================================================================
+// FILE: include/presence/uring_receiver.h
+// =============================================================================
+#ifndef URING_RECEIVER_H
+#define URING_RECEIVER_H
+
+#include "common/types.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace sip_processor {
+
+// io_uring receive path for one TCP socket at a time.  A multishot recv
+// picks buffers from a provided buffer ring, so a single io_uring_enter
+// returns every chunk that arrived since the last one, and each chunk is
+// handed to the caller in place before its buffer goes back on the ring.
+// The wait timeout rides on the same io_uring_enter, so an idle feed costs
+// one syscall per timeout rather than one per second.
+//
+// Talks to the kernel through the raw syscalls.  create() returns null when
+// the build or the kernel lacks io_uring or extended wait arguments.  A
+// kernel that refuses to register a provided buffer ring (before 5.19) gets
+// IORING_OP_PROVIDE_BUFFERS instead, returning buffers by SQE with the next
+// wait.  A kernel without multishot recv (6.0) is found on the first wait,
+// which then reports kUnsupported.
+// Single-threaded: one reader thread owns the receiver.
+class UringReceiver {
+public:
+    enum class Wait { kData, kTimeout, kClosed, kError, kUnsupported };
+    using DataFn = std::function<void(const char* data, size_t len)>;
+
+    // buffer_count is rounded up to a power of two (at most 32768)
+    static std::unique_ptr<UringReceiver> create(size_t buffer_size, size_t buffer_count);
+    ~UringReceiver();
+
+    // Starts the multishot recv on a connected socket
+    bool arm(int fd);
+    // Waits up to `timeout` and passes each received chunk to on_data.
+    // kClosed once the peer closes or the socket is shut down.
+    Wait wait(Millisecs timeout, const DataFn& on_data);
+    // Cancels the recv and reclaims its buffers; call before closing the socket
+    void disarm();
+
+    uint64_t syscalls() const { return syscalls_; }
+    bool ring_mapped() const { return ring_mapped_; }
+
+    UringReceiver(const UringReceiver&) = delete;
+    UringReceiver& operator=(const UringReceiver&) = delete;
+
+private:
+    struct Ring;
+    UringReceiver(std::unique_ptr<Ring> ring, size_t buffer_size, size_t buffer_count, bool ring_mapped);
+    bool submit_recv();
+    bool submit_cancel();
+    Wait drain(const DataFn& on_data);
+    void recycle(uint16_t bid);
+    // Queues an IORING_OP_PROVIDE_BUFFERS for buffers [bid, bid + count)
+    void provide(uint16_t bid, size_t count);
+
+    std::unique_ptr<Ring> ring_;
+    size_t buffer_size_;
+    size_t buffer_count_;
+    std::vector<char> buffers_;
+    int fd_ = -1;
+    bool armed_ = false;        // A recv is outstanding in the kernel
+    bool ring_mapped_ = true;   // Buffers return through the ring, not by SQE
+    bool starved_ = false;      // Last recv ended with ENOBUFS
+    uint64_t syscalls_ = 0;
+};
+
+} // namespace sip_processor
+#endif // URING_RECEIVER_H
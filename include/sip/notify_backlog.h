@@ -0,0 +1,63 @@
+// =============================================================================
+// FILE: include/sip/notify_backlog.h
+// =============================================================================
+#ifndef NOTIFY_BACKLOG_H
+#define NOTIFY_BACKLOG_H
+
+#include "common/types.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace sip_processor {
+
+// Counts NOTIFYs that have no final response yet: the overload controller's
+// send backlog.  Fixed size and allocation-free.  A send bumps the bucket
+// of its second and its handle's slot, both relaxed atomics.  A response,
+// or the release of its handle, takes NOTIFYs back out of the oldest
+// buckets: responses come back roughly in send order, and the total is
+// what matters.  Buckets older than the response timeout are dropped whole,
+// since those responses were lost with their transactions.
+//
+// Handles sharing a slot (a hash collision) are forgotten together, and a
+// response that arrives after its NOTIFY expired takes a newer one out.
+// Either only under-counts, and only until those NOTIFYs would expire.
+class NotifyBacklog {
+public:
+    static constexpr size_t kBuckets     = 128;           // Seconds; more than any timeout
+    static constexpr size_t kHandleSlots = size_t(1) << 14;
+
+    explicit NotifyBacklog(Seconds timeout, TimePoint now = Clock::now());
+
+    void on_sent(const void* handle, TimePoint now = Clock::now());
+    // A final response for one of the handle's NOTIFYs; ignored if none
+    // are counted for it
+    void on_response(const void* handle);
+    // The handle is being destroyed: responses still owed on it never come
+    void forget(const void* handle);
+    // Drops NOTIFYs sent more than the timeout before `now` and returns how
+    // many.  Called by one thread (Sofia's), about once a second.
+    int64_t expire(TimePoint now = Clock::now());
+    void clear();
+
+    int64_t outstanding() const { return std::max<int64_t>(0, total_.load(std::memory_order_relaxed)); }
+
+    NotifyBacklog(const NotifyBacklog&) = delete;
+    NotifyBacklog& operator=(const NotifyBacklog&) = delete;
+
+private:
+    static int64_t second_of(TimePoint t);
+    std::atomic<int32_t>& slot(const void* handle);
+    void take_oldest(int64_t n);
+
+    const int64_t timeout_sec_;
+    std::atomic<int64_t> total_{0};
+    std::atomic<int64_t> expired_through_{0};   // Newest second dropped
+    std::array<std::atomic<int64_t>, kBuckets> buckets_{};
+    std::array<std::atomic<int32_t>, kHandleSlots> slots_{};
+};
+
+} // namespace sip_processor
+#endif // NOTIFY_BACKLOG_H
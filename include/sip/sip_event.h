@@ -31,12 +31,12 @@ inline const char* event_category_to_string(SipEventCategory c) {
     }
 }
 
-enum class SipEventSource { kSipStack, kPresenceFeed };
+enum class SipEventSource { kSipStack, kPresenceFeed, kMwiFeed };
 
 struct SipEvent {
     EventId id = 0;
     std::string dialog_id;
-    std::string tenant_id;
+    std::string tenant_id;      // As received; interned once the subscription is admitted
 
     nua_event_t       nua_event   = nua_i_error;
     SipDirection      direction   = SipDirection::kIncoming;
@@ -56,6 +56,7 @@ struct SipEvent {
     std::string body;
     uint32_t    cseq     = 0;
     uint32_t    expires  = 0;
+    bool        has_expires = false;   // Expires header present
     std::string contact_uri;
 
     std::string subscription_state;
@@ -68,23 +69,38 @@ struct SipEvent {
     std::string presence_state;
     std::string presence_direction;
 
+    // MWI feed: message-summary body shared by every watcher of the mailbox
+    std::shared_ptr<const std::string> shared_body;
+
+    // For presence triggers: when the feed delivered the call-state event
     TimePoint   created_at  = Clock::now();
     TimePoint   enqueued_at = {};
     TimePoint   dequeued_at = {};
 
     nua_handle_t* nua_handle = nullptr;
 
+    bool is_incoming_subscribe() const {
+        return category == SipEventCategory::kSubscribe && direction == SipDirection::kIncoming;
+    }
+    // Expires: 0 on an incoming SUBSCRIBE.  Other requests and responses
+    // without the header do not end the subscription.
+    bool is_unsubscribe() const { return is_incoming_subscribe() && has_expires && expires == 0; }
+
     static std::unique_ptr<SipEvent> create_from_sofia(
         nua_event_t event, int status, const char* phrase,
         nua_handle_t* nh, const sip_t* sip);
 
     static std::unique_ptr<SipEvent> create_presence_trigger(
-        const std::string& dialog_id, const std::string& tenant_id,
+        const std::string& dialog_id, TenantId tenant_id,
         const std::string& presence_call_id,
         const std::string& caller_uri, const std::string& callee_uri,
         const std::string& blf_state, const std::string& direction,
         const std::string& dialog_info_xml_body);
 
+    static std::unique_ptr<SipEvent> create_mwi_trigger(
+        const std::string& dialog_id, TenantId tenant_id,
+        std::shared_ptr<const std::string> message_summary_body);
+
     static EventId next_id();
 private:
     static std::atomic<EventId> id_counter_;
@@ -5,6 +5,7 @@
 #ifndef SIP_STACK_MANAGER_H
 #define SIP_STACK_MANAGER_H
 #include "common/config.h"
+#include "sip/notify_backlog.h"
 #include <sofia-sip/nua.h>
 #include <sofia-sip/su_wait.h>
 #include <thread>
@@ -23,16 +24,32 @@ public:
     // Send a response to an incoming SUBSCRIBE request
     void respond_to_subscribe(nua_handle_t* nh, int status, const char* phrase,
                               uint32_t expires);
+    // 423 Interval Too Brief with Min-Expires (RFC 6665 section 4.2.1.1)
+    void respond_interval_too_brief(nua_handle_t* nh, uint32_t min_expires);
 
     // Send a NOTIFY within a subscription dialog
     void send_notify(nua_handle_t* nh, const char* event_type,
                      const char* content_type, const char* body,
                      const char* subscription_state_str);
 
+    // NOTIFYs handed to Sofia that have no final response yet, including
+    // locally generated timeouts; the overload controller's send backlog
+    int64_t notify_backlog() const { return notify_backlog_.outstanding(); }
+    // Called from the NUA callback for every final nua_r_notify
+    void on_notify_response(nua_handle_t* nh) { notify_backlog_.on_response(nh); }
+    // The dialog's owner is releasing the handle; a destroyed handle never
+    // reports the responses still owed on it, so they stop counting
+    void forget_notifies(nua_handle_t* nh) { if (nh) notify_backlog_.forget(nh); }
+
     SipStackManager(const SipStackManager&) = delete;
     SipStackManager& operator=(const SipStackManager&) = delete;
 private:
     void run_event_loop();
+
+    // Well past Timer F (64*T1 = 32s), by when Sofia has reported a 408;
+    // anything older had its response lost with the transaction
+    static constexpr Seconds kNotifyResponseTimeout{64};
+
     Config config_;
     su_root_t* root_ = nullptr;
     su_home_t home_[1];
@@ -40,6 +57,7 @@ private:
     std::thread sofia_thread_;
     std::atomic<bool> running_{false};
     std::atomic<bool> stop_requested_{false};
+    NotifyBacklog notify_backlog_{kNotifyResponseTimeout};
 };
 } // namespace sip_processor
 #endif
\ No newline at end of file
@@ -6,42 +6,96 @@
 #define BLF_SUBSCRIPTION_INDEX_H
 
 #include "common/types.h"
+#include "subscription/counting_bloom_filter.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 #include <shared_mutex>
 
 namespace sip_processor {
 
+// Maps monitored URIs to the BLF dialogs watching them. Watchers are
+// partitioned by (tenant, normalized URI) so a tenant-scoped lookup touches
+// only that tenant's watchers, even when the same extension exists in
+// hundreds of tenants. A URI -> tenants side table serves unscoped lookups.
+// Tenants and normalized URIs are interned Symbols, so keys hash and
+// compare as integers.
 class BlfSubscriptionIndex {
 public:
     static BlfSubscriptionIndex& instance();
     static std::string normalize_uri(const std::string& uri);
 
-    void add(const std::string& monitored_uri, const std::string& dialog_id,
-             const std::string& tenant_id);
-    void remove(const std::string& monitored_uri, const std::string& dialog_id);
+    void add(Symbol monitored_uri, const std::string& dialog_id, TenantId tenant_id);
+    void remove(Symbol monitored_uri, const std::string& dialog_id);
     void remove_dialog(const std::string& dialog_id);
 
     struct BlfWatcher {
         std::string dialog_id;
-        std::string tenant_id;
+        TenantId    tenant_id;
     };
     std::vector<BlfWatcher> lookup(const std::string& monitored_uri) const;
-    std::vector<BlfWatcher> lookup(const std::string& monitored_uri,
-                                   const std::string& tenant_id) const;
+    std::vector<BlfWatcher> lookup(const std::string& monitored_uri, TenantId tenant_id) const;
+    // Tenant text from outside (feed, HTTP) is resolved with Symbol::find
+    std::vector<BlfWatcher> lookup(const std::string& monitored_uri, std::string_view tenant_id) const;
+
+    // Lock-free pre-check on the raw URI: false means nobody watches it, so
+    // lookup() would find nothing.  Neither normalizes into a string nor
+    // takes the index lock.
+    bool may_be_watched(std::string_view monitored_uri) const;
+    // Sizes the counting Bloom filter behind may_be_watched (0 disables it)
+    // and refills it from the current URIs.  Meant for startup: a replaced
+    // filter is kept until exit, as readers may still hold it.
+    void configure_prefilter(size_t counters);
+    // FNV-1a of normalize_uri(uri), computed without building that string
+    static uint64_t normalized_uri_hash(std::string_view uri);
 
     size_t monitored_uri_count() const;
+    // Normalized monitored URIs, for the interest filter a node publishes
+    std::vector<std::string> monitored_uris() const;
+    // Bumped whenever a URI gains its first watcher or loses its last
+    uint64_t uri_set_version() const { return uri_set_version_.load(std::memory_order_acquire); }
+    // Called, outside the index lock, on the thread whose add() gave a URI
+    // its first watcher.  Lets interest be republished before the
+    // distributor drops that URI's events.  Empty clears it.
+    void set_uri_added_listener(std::function<void()> listener);
     size_t total_watcher_count() const;
+    // Watchers per tenant; tenants with no watchers are omitted
+    std::vector<std::pair<TenantId, size_t>> tenant_watcher_counts() const;
 
     BlfSubscriptionIndex(const BlfSubscriptionIndex&) = delete;
     BlfSubscriptionIndex& operator=(const BlfSubscriptionIndex&) = delete;
 private:
-    BlfSubscriptionIndex() = default;
+    BlfSubscriptionIndex();
+
+    struct PartitionKey {
+        TenantId tenant;
+        Symbol   uri;             // Normalized
+        bool operator==(const PartitionKey& o) const { return tenant == o.tenant && uri == o.uri; }
+    };
+    struct PartitionKeyHash {
+        size_t operator()(const PartitionKey& k) const {
+            return (static_cast<uint64_t>(k.uri.id()) << 32 | k.tenant.id()) * 0x9E3779B97F4A7C15ull >> 16;
+        }
+    };
+
+    void unlink_locked(const std::string& dialog_id, const PartitionKey& key);
+
     mutable std::shared_mutex mu_;
-    struct WatcherEntry { std::string dialog_id; std::string tenant_id; };
-    std::unordered_map<std::string, std::vector<WatcherEntry>> uri_to_watchers_;
-    std::unordered_map<std::string, std::string> dialog_to_uri_;
+    std::unordered_map<PartitionKey, std::vector<std::string>, PartitionKeyHash> partitions_;
+    std::unordered_map<Symbol, std::vector<TenantId>> uri_tenants_;
+    std::unordered_map<std::string, PartitionKey> dialog_to_key_;
+    std::unordered_map<TenantId, size_t> tenant_watchers_;
+    size_t total_watchers_ = 0;
+    std::atomic<uint64_t> uri_set_version_{0};
+    std::function<void()> uri_added_listener_;   // Guarded by mu_
+    // Holds each URI in uri_tenants_; updated under mu_, read without it
+    std::atomic<CountingBloomFilter*> prefilter_{nullptr};
+    std::vector<std::unique_ptr<CountingBloomFilter>> prefilters_;   // Current and replaced
 };
 
 } // namespace sip_processor
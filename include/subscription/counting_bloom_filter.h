@@ -0,0 +1,88 @@
+
+// =============================================================================
+// FILE: include/subscription/counting_bloom_filter.h
+// =============================================================================
+#ifndef COUNTING_BLOOM_FILTER_H
+#define COUNTING_BLOOM_FILTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace sip_processor {
+
+// Blocked counting Bloom filter over 64-bit key hashes.  All probes for a
+// key fall in one cache line of 64 one-byte counters, so a check costs one
+// miss and a few relaxed loads; no lock is taken on either side.  Counters
+// saturate at 255 and then stay there, which can only add false positives.
+class CountingBloomFilter {
+public:
+    static constexpr unsigned kProbes = 4;
+
+    // counters is rounded up to a power of two (at least one block of 64)
+    explicit CountingBloomFilter(size_t counters) {
+        size_t blocks = rounded_size(counters) / 64;
+        blocks_.reset(new Block[blocks]());
+        block_mask_ = blocks - 1;
+    }
+    static size_t rounded_size(size_t counters) {
+        size_t n = 64;
+        while (n < counters) n <<= 1;
+        return n;
+    }
+
+    void add(uint64_t hash) {
+        Block& b = block(hash);
+        uint64_t probes = mix(hash);
+        for (unsigned i = 0; i < kProbes; ++i, probes >>= 6) {
+            auto& c = b.c[probes & 63];
+            uint8_t v = c.load(std::memory_order_relaxed);
+            while (v != kSaturated && !c.compare_exchange_weak(v, static_cast<uint8_t>(v + 1), std::memory_order_relaxed)) {}
+        }
+    }
+
+    void remove(uint64_t hash) {
+        Block& b = block(hash);
+        uint64_t probes = mix(hash);
+        for (unsigned i = 0; i < kProbes; ++i, probes >>= 6) {
+            auto& c = b.c[probes & 63];
+            uint8_t v = c.load(std::memory_order_relaxed);
+            while (v != 0 && v != kSaturated &&
+                   !c.compare_exchange_weak(v, static_cast<uint8_t>(v - 1), std::memory_order_relaxed)) {}
+        }
+    }
+
+    bool may_contain(uint64_t hash) const {
+        const Block& b = block(hash);
+        uint64_t probes = mix(hash);
+        for (unsigned i = 0; i < kProbes; ++i, probes >>= 6) {
+            if (b.c[probes & 63].load(std::memory_order_relaxed) == 0) return false;
+        }
+        return true;
+    }
+
+    size_t counters() const { return (block_mask_ + 1) * 64; }
+
+    CountingBloomFilter(const CountingBloomFilter&) = delete;
+    CountingBloomFilter& operator=(const CountingBloomFilter&) = delete;
+
+private:
+    static constexpr uint8_t kSaturated = 255;
+    struct alignas(64) Block { std::atomic<uint8_t> c[64]; };
+
+    // Block from the high bits, probe slots from a remix of the whole hash
+    Block& block(uint64_t hash) const { return blocks_[(hash >> 32) & block_mask_]; }
+    static uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    std::unique_ptr<Block[]> blocks_;
+    size_t block_mask_ = 0;
+};
+
+} // namespace sip_processor
+#endif // COUNTING_BLOOM_FILTER_H
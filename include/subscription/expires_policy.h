@@ -0,0 +1,57 @@
+
+// =============================================================================
+// FILE: include/subscription/expires_policy.h
+// =============================================================================
+#ifndef EXPIRES_POLICY_H
+#define EXPIRES_POLICY_H
+#include "common/types.h"
+#include "common/config.h"
+#include "subscription/subscription_type.h"
+#include <array>
+#include <string>
+#include <unordered_map>
+
+namespace sip_processor {
+
+struct ExpiresLimits {
+    uint32_t min_sec = 0;
+    uint32_t max_sec = 0;       // 0 = no maximum
+    uint32_t default_sec = 0;   // Granted when the SUBSCRIBE has no Expires
+};
+
+// Decides the Expires granted to a SUBSCRIBE (RFC 6665 section 4.2.1.1).
+// Limits come from expires.* per subscription type; expires.tenant_overrides
+// replaces min and max for one tenant and type.  Immutable after
+// construction, so each worker can hold its own copy.
+class ExpiresPolicy {
+public:
+    struct Decision {
+        uint32_t granted = 0;
+        bool too_brief = false;     // Answer 423 with Min-Expires: min_expires
+        uint32_t min_expires = 0;
+    };
+
+    explicit ExpiresPolicy(const Config& config);
+
+    // `requested` is ignored when the SUBSCRIBE carried no Expires header.
+    // An unsubscribe (Expires: 0) is the caller's to handle.
+    Decision negotiate(TenantId tenant, SubscriptionType type,
+                       bool has_expires, uint32_t requested) const;
+
+    const ExpiresLimits& limits(TenantId tenant, SubscriptionType type) const;
+    size_t tenant_overrides() const { return tenant_limits_.size(); }
+
+    // Parses "tenant:BLF:min:max[,...]"; false on a malformed entry
+    static bool parse_overrides(const std::string& spec,
+                                std::unordered_map<TenantId, std::array<ExpiresLimits, 2>>& out,
+                                const std::array<ExpiresLimits, 2>& defaults);
+
+private:
+    static size_t slot(SubscriptionType type) { return type == SubscriptionType::kMWI ? 1 : 0; }
+
+    std::array<ExpiresLimits, 2> type_limits_;    // BLF, MWI
+    std::unordered_map<TenantId, std::array<ExpiresLimits, 2>> tenant_limits_;
+};
+
+} // namespace sip_processor
+#endif // EXPIRES_POLICY_H
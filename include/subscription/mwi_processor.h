@@ -7,12 +7,36 @@
 #include "sip/sip_event.h"
 #include "subscription/subscription_state.h"
 #include "common/types.h"
+#include <string_view>
 namespace sip_processor {
 class MwiProcessor {
 public:
     MwiProcessor() = default;
     ~MwiProcessor() = default;
     Result process(const SipEvent& event, SubscriptionRecord& record);
+
+    // RFC 3842 message-context-class
+    enum MessageClass : uint8_t { kVoice, kFax, kPager, kMultimedia, kText, kNumMessageClasses };
+    struct MessageCounts { int new_messages=0, old_messages=0, new_urgent=0, old_urgent=0; };
+    struct MessageSummary {
+        bool messages_waiting = false;
+        std::string_view account;                  // Points into the parsed body
+        MessageCounts counts[kNumMessageClasses];
+        uint8_t classes = 0;                       // Bit per MessageClass present
+        bool valid = false;
+        const MessageCounts& voice() const { return counts[kVoice]; }
+        bool has(MessageClass c) const { return classes & (1u << c); }
+    };
+
+    // Single pass over an application/simple-message-summary body; does not
+    // allocate. Counts saturate at INT_MAX; malformed lines are skipped.
+    static MessageSummary parse_message_summary(std::string_view body);
+
+    // Applies a mailbox update from the MWI feed: voice counts only, the
+    // record keeps its account. Returns false if the body is not a valid
+    // summary or the counts did not change.
+    bool apply_feed_update(std::string_view body, SubscriptionRecord& record);
+
     MwiProcessor(const MwiProcessor&) = delete;
     MwiProcessor& operator=(const MwiProcessor&) = delete;
 private:
@@ -20,8 +44,6 @@ private:
     Result handle_notify(const SipEvent& event, SubscriptionRecord& record);
     Result handle_subscribe_response(const SipEvent& event, SubscriptionRecord& record);
     Result handle_publish(const SipEvent& event, SubscriptionRecord& record);
-    struct MessageSummary { bool messages_waiting=false; int new_messages=0, old_messages=0, new_urgent=0, old_urgent=0; std::string account; bool valid=false; };
-    MessageSummary parse_message_summary(const std::string& body);
     void update_mwi_state(SubscriptionRecord& record, const MessageSummary& summary);
 };
 } // namespace sip_processor
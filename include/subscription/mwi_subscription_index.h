@@ -0,0 +1,55 @@
+
+// =============================================================================
+// FILE: include/subscription/mwi_subscription_index.h
+// =============================================================================
+#ifndef MWI_SUBSCRIPTION_INDEX_H
+#define MWI_SUBSCRIPTION_INDEX_H
+
+#include "common/types.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+
+namespace sip_processor {
+
+// Maps a mailbox (normalized mwi_account_uri) to the MWI dialogs watching
+// it, so one mailbox update becomes one lookup and a fan-out rather than a
+// scan. Accounts are interned Symbols; URIs are normalized exactly as for
+// BLF (BlfSubscriptionIndex::normalize_uri).
+class MwiSubscriptionIndex {
+public:
+    static MwiSubscriptionIndex& instance();
+
+    // Re-adding a dialog under a different account moves it
+    void add(const std::string& account_uri, const std::string& dialog_id, TenantId tenant_id);
+    void remove_dialog(const std::string& dialog_id);
+
+    struct MwiWatcher {
+        std::string dialog_id;
+        TenantId    tenant_id;
+    };
+    std::vector<MwiWatcher> lookup(const std::string& account_uri) const;
+    std::vector<MwiWatcher> lookup(const std::string& account_uri, TenantId tenant_id) const;
+    // Tenant text from outside (HTTP feed) is resolved with Symbol::find
+    std::vector<MwiWatcher> lookup(const std::string& account_uri, std::string_view tenant_id) const;
+
+    size_t account_count() const;
+    size_t total_watcher_count() const;
+
+    MwiSubscriptionIndex(const MwiSubscriptionIndex&) = delete;
+    MwiSubscriptionIndex& operator=(const MwiSubscriptionIndex&) = delete;
+private:
+    MwiSubscriptionIndex() = default;
+
+    void unlink_locked(const std::string& dialog_id, Symbol account);
+
+    mutable std::shared_mutex mu_;
+    std::unordered_map<Symbol, std::vector<MwiWatcher>> accounts_;
+    std::unordered_map<std::string, Symbol> dialog_to_account_;
+    size_t total_watchers_ = 0;
+};
+
+} // namespace sip_processor
+#endif
@@ -7,8 +7,15 @@
 
 #include "common/types.h"
 #include "subscription/subscription_type.h"
+#include <array>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -36,7 +43,7 @@ inline SubLifecycle lifecycle_from_string(const std::string& s) {
 
 struct SubscriptionRecord {
     std::string  dialog_id;
-    std::string  tenant_id;
+    TenantId     tenant_id;
     SubscriptionType type       = SubscriptionType::kUnknown;
     SubLifecycle lifecycle      = SubLifecycle::kPending;
     TimePoint    created_at     = Clock::now();
@@ -48,9 +55,11 @@ struct SubscriptionRecord {
     bool         is_processing  = false;
     TimePoint    processing_started_at = {};
     bool         dirty          = false;  // Needs MongoDB sync
+    int64_t      updated_at_ms  = 0;      // Wall-clock ms of last persisted change
+    TimePoint    persisted_expires_at = {};  // expires_at last handed to the store (not stored)
 
     // BLF-specific
-    std::string  blf_monitored_uri;
+    Symbol       blf_monitored_uri;
     std::string  blf_last_state;
     std::string  blf_last_direction;
     std::string  blf_presence_call_id;
@@ -82,36 +91,95 @@ struct SubscriptionRecord {
     }
 };
 
+// Process-wide view of live subscriptions, used for tenant limits and the
+// HTTP API. Sharded by dialog hash so workers registering different dialogs
+// never contend; totals and per-tenant counts are atomics read without a lock.
 class SubscriptionRegistry {
 public:
     static SubscriptionRegistry& instance();
 
     struct SubscriptionInfo {
         std::string      dialog_id;
-        std::string      tenant_id;
+        TenantId         tenant_id;
         SubscriptionType type;
         SubLifecycle     lifecycle;
         TimePoint        last_activity;
         size_t           worker_index;
+        Symbol           monitored_uri = {};  // BLF monitored / MWI account URI
     };
 
+    static constexpr size_t kNumShards = 64;
+
+    // Resumable position for paged scans: entries are visited shard by
+    // shard, in dialog_id order within a shard.
+    struct Cursor {
+        size_t      shard = 0;
+        std::string after;       // Last dialog_id returned from `shard`
+        bool done() const { return shard >= kNumShards; }
+    };
+    using Filter = std::function<bool(const SubscriptionInfo&)>;
+
     void register_subscription(const std::string& dialog_id, const SubscriptionInfo& info);
     void unregister_subscription(const std::string& dialog_id);
     bool lookup(const std::string& dialog_id, SubscriptionInfo& out) const;
     std::vector<SubscriptionInfo> get_tenant_subscriptions(const TenantId& tenant) const;
     std::vector<SubscriptionInfo> get_all() const;
 
+    // Snapshot iteration: each shard is copied under its own lock and the
+    // callback runs on the copy, so writers are blocked for at most one
+    // shard copy. Entries changed mid-walk may or may not be seen.
+    // Return false from the callback to stop early.
+    void for_each(const std::function<bool(const SubscriptionInfo&)>& fn) const;
+
+    // Appends up to `limit` entries matching `filter` (null = all) that come
+    // after `cursor`, and advances it. Only one shard is locked at a time,
+    // and the lock is dropped every kScanStep entries examined, so a page
+    // costs O(limit log n) plus the entries the filter rejects.
+    void scan(Cursor& cursor, size_t limit, const Filter& filter,
+              std::vector<SubscriptionInfo>& out) const;
+
     size_t total_count() const;
     size_t count_by_type(SubscriptionType type) const;
     size_t count_by_tenant(const TenantId& tenant) const;
 
+    // Stable reference to a tenant's live count (created at zero if absent).
+    // Callers on hot paths cache it so a limit check is one relaxed load.
+    const std::atomic<int64_t>& tenant_count_ref(const TenantId& tenant);
+
     SubscriptionRegistry(const SubscriptionRegistry&) = delete;
     SubscriptionRegistry& operator=(const SubscriptionRegistry&) = delete;
 private:
-    SubscriptionRegistry() = default;
-    mutable std::mutex mu_;
-    std::unordered_map<std::string, SubscriptionInfo> subscriptions_;
-    std::unordered_map<TenantId, size_t> tenant_counts_;
+    SubscriptionRegistry();
+
+    // `ordered` points into the map's nodes (which never move) so scans can
+    // seek past a cursor instead of copying and sorting the shard
+    struct alignas(64) Shard {
+        mutable std::mutex mu;
+        std::unordered_map<std::string, SubscriptionInfo> subscriptions;
+        std::map<std::string_view, const SubscriptionInfo*> ordered;
+    };
+    static constexpr size_t kScanStep = 1024;
+
+    // Counters are created on first use and never erased, so a pointer
+    // found under the shared lock stays valid after it is released.
+    using Counter = std::atomic<int64_t>;
+    struct alignas(64) TenantShard {
+        mutable std::shared_mutex mu;
+        std::unordered_map<TenantId, std::unique_ptr<Counter>> counts;
+    };
+    static constexpr size_t kNumTenantShards = 16;
+
+    Shard& shard_for(const std::string& dialog_id);
+    const Shard& shard_for(const std::string& dialog_id) const;
+    Counter& tenant_counter(const TenantId& tenant);
+    const Counter* find_tenant_counter(const TenantId& tenant) const;
+    void count_added(const SubscriptionInfo& info);
+    void count_removed(const SubscriptionInfo& info);
+
+    std::array<Shard, kNumShards> shards_;
+    std::array<TenantShard, kNumTenantShards> tenant_shards_;
+    std::atomic<int64_t> total_{0};
+    std::array<std::atomic<int64_t>, 3> type_counts_{};  // Indexed by SubscriptionType
 };
 
 } // namespace sip_processor
@@ -151,9 +151,41 @@ Config Config::load_from_file(const std::string& path) {
     }
     c.max_incoming_queue_per_worker = get_size(m, "dispatcher.max_incoming_queue_per_worker", c.max_incoming_queue_per_worker);
     c.max_dialogs_per_worker        = get_size(m, "dispatcher.max_dialogs_per_worker", c.max_dialogs_per_worker);
+    c.dispatcher_max_workers        = get_size(m, "dispatcher.max_workers", c.dispatcher_max_workers);
+    c.dispatcher_ring_vnodes        = get_size(m, "dispatcher.ring_vnodes", c.dispatcher_ring_vnodes);
+    c.dispatcher_rebalance_interval      = Seconds(get_int(m, "dispatcher.rebalance_interval_sec", 10));
+    c.dispatcher_rebalance_threshold_pct = get_size(m, "dispatcher.rebalance_threshold_pct", c.dispatcher_rebalance_threshold_pct);
+    c.dispatcher_rebalance_max_moves     = get_size(m, "dispatcher.rebalance_max_moves", c.dispatcher_rebalance_max_moves);
+    c.dispatcher_feed_batch              = get_size(m, "dispatcher.feed_batch", c.dispatcher_feed_batch);
+    c.dispatcher_feed_guard_batch        = std::max<size_t>(1, get_size(m, "dispatcher.feed_guard_batch",
+                                                                        c.dispatcher_feed_guard_batch));
+
+    // Overload control
+    c.overload_enabled             = get_bool(m, "overload.enabled", c.overload_enabled);
+    c.overload_sample_interval     = Millisecs(std::max(10, get_int(m, "overload.sample_interval_ms", 250)));
+    c.overload_queue_fill_pct      = get_size(m, "overload.queue_fill_pct", c.overload_queue_fill_pct);
+    c.overload_queue_wait_p99      = Millisecs(get_int(m, "overload.queue_wait_p99_ms", 200));
+    c.overload_notify_backlog      = get_size(m, "overload.notify_backlog", c.overload_notify_backlog);
+    c.overload_elevated_pct        = get_size(m, "overload.elevated_pct", c.overload_elevated_pct);
+    c.overload_shed_pct            = std::max(c.overload_elevated_pct,
+                                              get_size(m, "overload.shed_pct", c.overload_shed_pct));
+    c.overload_retry_after_sec     = static_cast<uint32_t>(get_size(m, "overload.retry_after_sec", c.overload_retry_after_sec));
+    c.overload_refresh_expires_sec = static_cast<uint32_t>(get_size(m, "overload.refresh_expires_sec",
+                                                                    c.overload_refresh_expires_sec));
+
+    // Expires negotiation
+    c.expires_blf_min_sec      = static_cast<uint32_t>(get_size(m, "expires.blf_min_sec", c.expires_blf_min_sec));
+    c.expires_blf_max_sec      = static_cast<uint32_t>(get_size(m, "expires.blf_max_sec", c.expires_blf_max_sec));
+    c.expires_blf_default_sec  = static_cast<uint32_t>(get_size(m, "expires.blf_default_sec", c.expires_blf_default_sec));
+    c.expires_mwi_min_sec      = static_cast<uint32_t>(get_size(m, "expires.mwi_min_sec", c.expires_mwi_min_sec));
+    c.expires_mwi_max_sec      = static_cast<uint32_t>(get_size(m, "expires.mwi_max_sec", c.expires_mwi_max_sec));
+    c.expires_mwi_default_sec  = static_cast<uint32_t>(get_size(m, "expires.mwi_default_sec", c.expires_mwi_default_sec));
+    c.expires_tenant_overrides = get_or(m, "expires.tenant_overrides", c.expires_tenant_overrides);
+    c.expires_checkpoint       = Seconds(get_int(m, "expires.checkpoint_sec", 300));
 
     // Tenant
     c.max_subscriptions_per_tenant = get_size(m, "tenant.max_subscriptions_per_tenant", c.max_subscriptions_per_tenant);
+    c.max_interned_symbols         = get_size(m, "tenant.max_interned_symbols", c.max_interned_symbols);
 
     // Reaper
     c.blf_subscription_ttl     = Seconds(get_int(m, "reaper.blf_subscription_ttl_sec", 3600));
@@ -168,12 +200,34 @@ Config Config::load_from_file(const std::string& path) {
     c.presence_reconnect_max_interval = Seconds(get_int(m, "presence.reconnect_max_interval_sec", 60));
     c.presence_read_timeout           = Seconds(get_int(m, "presence.read_timeout_sec", 30));
     c.presence_recv_buffer_size       = get_size(m, "presence.recv_buffer_size", 65536);
+    c.presence_io_backend             = get_or(m, "presence.io_backend", c.presence_io_backend);
+    c.presence_uring_buffers          = std::max<size_t>(1, get_size(m, "presence.uring_buffers", c.presence_uring_buffers));
     c.presence_heartbeat_interval     = Seconds(get_int(m, "presence.heartbeat_interval_sec", 15));
     c.presence_heartbeat_miss_threshold = get_int(m, "presence.heartbeat_miss_threshold", 3);
     c.presence_max_pending_events     = get_size(m, "presence.max_pending_events", 100000);
+    c.presence_watcher_prefilter      = get_size(m, "presence.watcher_prefilter_counters", c.presence_watcher_prefilter);
     c.presence_failover_strategy = parse_failover_strategy(get_or(m, "presence.failover_strategy", "round_robin"));
     c.presence_health_check_interval = Seconds(get_int(m, "presence.health_check_interval_sec", 30));
     c.presence_server_cooldown       = Seconds(get_int(m, "presence.server_cooldown_sec", 120));
+    c.presence_publish_interest      = get_bool(m, "presence.publish_interest", c.presence_publish_interest);
+    c.presence_interest_bits_per_uri = std::max<size_t>(1, get_size(m, "presence.interest_bits_per_uri",
+                                                                    c.presence_interest_bits_per_uri));
+    c.presence_interest_interval     = Seconds(std::max(1, get_int(m, "presence.interest_interval_sec", 5)));
+
+    c.distributor_enabled          = get_bool(m, "distributor.enabled", c.distributor_enabled);
+    c.distributor_bind_address     = get_or(m, "distributor.bind_address", c.distributor_bind_address);
+    c.distributor_listen_port      = static_cast<uint16_t>(get_int(m, "distributor.listen_port", c.distributor_listen_port));
+    c.distributor_max_node_backlog = get_size(m, "distributor.max_node_backlog", c.distributor_max_node_backlog);
+
+    // Replication
+    c.replication_role                     = parse_replication_role(get_or(m, "replication.role", "none"));
+    c.replication_bind_address             = get_or(m, "replication.bind_address", c.replication_bind_address);
+    c.replication_listen_port              = static_cast<uint16_t>(get_int(m, "replication.listen_port", c.replication_listen_port));
+    c.replication_primary_host             = get_or(m, "replication.primary_host", c.replication_primary_host);
+    c.replication_primary_port             = static_cast<uint16_t>(get_int(m, "replication.primary_port", c.replication_primary_port));
+    c.replication_heartbeat_interval       = Seconds(std::max(1, get_int(m, "replication.heartbeat_interval_sec", 1)));
+    c.replication_heartbeat_miss_threshold = std::max(1, get_int(m, "replication.heartbeat_miss_threshold", 3));
+    c.replication_max_backlog              = get_size(m, "replication.max_backlog", c.replication_max_backlog);
 
     // MongoDB
     c.mongo_uri                  = get_or(m, "mongodb.uri", c.mongo_uri);
@@ -190,19 +244,48 @@ Config Config::load_from_file(const std::string& path) {
     c.mongo_batch_size           = get_size(m, "mongodb.batch_size", 500);
     c.mongo_enable_persistence   = get_bool(m, "mongodb.enable_persistence", true);
 
+    // Local snapshot
+    c.snapshot_enabled                = get_bool(m, "snapshot.enabled", false);
+    c.snapshot_directory              = get_or(m, "snapshot.directory", c.snapshot_directory);
+    c.snapshot_interval               = Seconds(get_int(m, "snapshot.interval_sec", 300));
+    c.snapshot_journal_flush_interval = Millisecs(get_int(m, "snapshot.journal_flush_interval_ms", 200));
+    c.snapshot_fsync                  = get_bool(m, "snapshot.fsync", false);
+    c.snapshot_load_threads           = get_size(m, "snapshot.load_threads", 0);
+    c.snapshot_reconcile_with_mongo   = get_bool(m, "snapshot.reconcile_with_mongo", true);
+
+    // Recovery NOTIFY pacing
+    c.recovery_notify_window   = Seconds(get_int(m, "recovery.notify_window_sec", 60));
+    c.recovery_notify_min_rate = get_int(m, "recovery.notify_min_rate", 20);
+
     // Slow event
     c.slow_event_warn_threshold     = Millisecs(get_int(m, "slow_event.warn_threshold_ms", 50));
     c.slow_event_error_threshold    = Millisecs(get_int(m, "slow_event.error_threshold_ms", 200));
     c.slow_event_critical_threshold = Millisecs(get_int(m, "slow_event.critical_threshold_ms", 1000));
     c.slow_event_log_stack_trace    = get_bool(m, "slow_event.log_stack_trace", false);
+    c.slow_event_top_n              = get_size(m, "slow_event.top_n", 32);
+    c.slow_event_top_window         = Seconds(get_int(m, "slow_event.top_window_sec", 60));
 
     // HTTP
-    c.http_enabled         = get_bool(m, "http.enabled", true);
-    c.http_bind_address    = get_or(m, "http.bind_address", c.http_bind_address);
-    c.http_port            = static_cast<uint16_t>(get_int(m, "http.port", 8080));
-    c.http_read_timeout    = Seconds(get_int(m, "http.read_timeout_sec", 30));
-    c.http_write_timeout   = Seconds(get_int(m, "http.write_timeout_sec", 30));
-    c.http_max_connections = get_size(m, "http.max_connections", 100);
+    c.http_enabled           = get_bool(m, "http.enabled", true);
+    c.http_bind_address      = get_or(m, "http.bind_address", c.http_bind_address);
+    c.http_port              = static_cast<uint16_t>(get_int(m, "http.port", 8080));
+    c.http_read_timeout      = Seconds(get_int(m, "http.read_timeout_sec", 30));
+    c.http_write_timeout     = Seconds(get_int(m, "http.write_timeout_sec", 30));
+    c.http_max_connections   = get_size(m, "http.max_connections", 100);
+    c.http_handler_threads   = get_size(m, "http.handler_threads", 2);
+    c.http_max_request_bytes = get_size(m, "http.max_request_kb", 1024) * 1024;
+    c.http_mwi_feed_enabled  = get_bool(m, "http.mwi_feed_enabled", false);
+
+    // Thread placement
+    c.affinity_enabled     = get_bool(m, "affinity.enabled", false);
+    c.affinity_workers     = get_or(m, "affinity.workers", c.affinity_workers);
+    c.affinity_sip         = get_or(m, "affinity.sip", c.affinity_sip);
+    c.affinity_presence    = get_or(m, "affinity.presence", c.affinity_presence);
+    c.affinity_router      = get_or(m, "affinity.router", c.affinity_router);
+    c.affinity_persistence = get_or(m, "affinity.persistence", c.affinity_persistence);
+    c.affinity_http        = get_or(m, "affinity.http", c.affinity_http);
+    c.affinity_logging     = get_or(m, "affinity.logging", c.affinity_logging);
+    c.affinity_maintenance = get_or(m, "affinity.maintenance", c.affinity_maintenance);
 
     // Logging
     c.log_directory         = get_or(m, "logging.directory", c.log_directory);
@@ -210,6 +293,10 @@ Config Config::load_from_file(const std::string& path) {
     c.log_console_level_str = get_or(m, "logging.console_level", c.log_console_level_str);
     c.log_max_file_size_mb  = get_size(m, "logging.max_file_size_mb", 50);
     c.log_max_rotated_files = get_int(m, "logging.max_rotated_files", 10);
+    c.log_async             = get_bool(m, "logging.async", true);
+    c.log_thread_buffer_kb  = get_size(m, "logging.thread_buffer_kb", 256);
+    c.log_flush_interval    = Millisecs(get_int(m, "logging.flush_interval_ms", 10));
+    c.log_overflow_policy   = get_or(m, "logging.overflow_policy", c.log_overflow_policy);
 
     LOG_INFO("Config: loaded from '%s' — %zu workers, %zu presence servers, mongo=%s http=%s:%d",
              path.c_str(), c.num_workers, c.presence_servers.size(),
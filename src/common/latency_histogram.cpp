@@ -0,0 +1,201 @@
+
+// =============================================================================
+// FILE: src/common/latency_histogram.cpp
+// =============================================================================
+#include "common/latency_histogram.h"
+#include "common/metrics_registry.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace sip_processor {
+
+void LatencyHistogram::Snapshot::add(const Snapshot& o) {
+    for (size_t i = 0; i < kBuckets; ++i) counts[i] += o.counts[i];
+    count += o.count;
+    sum += o.sum;
+    max = std::max(max, o.max);
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double p) const {
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(count)));
+    rank = std::max<uint64_t>(1, std::min(rank, count));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += counts[i];
+        if (seen >= rank) return std::min(bucket_upper(i), max);
+    }
+    return max;
+}
+
+void LatencyHistogram::add_to(Snapshot& out) const {
+    for (size_t i = 0; i < kBuckets; ++i) out.counts[i] += counts_[i].load(std::memory_order_relaxed);
+    out.count += count_.load(std::memory_order_relaxed);
+    out.sum += sum_.load(std::memory_order_relaxed);
+    out.max = std::max(out.max, max_.load(std::memory_order_relaxed));
+}
+
+// =============================================================================
+// LatencyRecorder
+// =============================================================================
+
+struct LatencyRecorder::ThreadHandle {
+    std::shared_ptr<ThreadSet> set;
+    ~ThreadHandle() {
+        // Fold the exiting thread's counts into the retired totals
+        if (set) LatencyRecorder::instance().retire(set);
+    }
+};
+
+// /metrics bucket bounds. Each internal bucket is counted under the first
+// bound at or above its upper edge, so a bound is exact to within the
+// 3.2% bucket width.
+static constexpr struct { uint64_t ns; const char* le; } kExportBounds[] = {
+    {10000, "1e-05"},       {25000, "2.5e-05"},     {50000, "5e-05"},
+    {100000, "0.0001"},     {250000, "0.00025"},    {500000, "0.0005"},
+    {1000000, "0.001"},     {2500000, "0.0025"},    {5000000, "0.005"},
+    {10000000, "0.01"},     {25000000, "0.025"},    {50000000, "0.05"},
+    {100000000, "0.1"},     {250000000, "0.25"},    {500000000, "0.5"},
+    {1000000000, "1"},      {2500000000, "2.5"},    {5000000000, "5"},
+    {10000000000, "10"},
+};
+
+static void write_histogram(MetricsWriter& w, const char* name, const std::string& labels,
+                            const LatencyHistogram::Snapshot& s) {
+    constexpr size_t kBounds = sizeof(kExportBounds) / sizeof(kExportBounds[0]);
+    uint64_t cumulative = 0;
+    size_t b = 0;
+    for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+        if (!s.counts[i]) continue;
+        uint64_t upper = LatencyHistogram::bucket_upper(i);
+        for (; b < kBounds && upper > kExportBounds[b].ns; ++b) {
+            w.bucket(name, labels, kExportBounds[b].le, cumulative);
+        }
+        cumulative += s.counts[i];
+    }
+    for (; b < kBounds; ++b) w.bucket(name, labels, kExportBounds[b].le, cumulative);
+    w.bucket(name, labels, "+Inf", cumulative);
+    w.sample(name, "_count", labels, cumulative);
+    w.sample(name, "_sum", labels, static_cast<double>(s.sum) / 1e9);
+}
+
+LatencyRecorder& LatencyRecorder::instance() {
+    static LatencyRecorder recorder;
+    return recorder;
+}
+
+LatencyRecorder::LatencyRecorder() {
+    // Scratch lives in the collector; scrapes are serialised by the registry
+    MetricsRegistry::instance().add_collector(this, "sip_processor_stage_latency_seconds",
+        MetricType::kHistogram, "Pipeline stage latency",
+        [this, groups = std::vector<WorkerSnapshot>(), labels = std::string()]
+        (MetricsWriter& w, const char* name) mutable {
+            for (size_t s = 0; s < kNumLatencyStages; ++s) {
+                auto stage = static_cast<LatencyStage>(s);
+                snapshot_by_worker(stage, groups);
+                for (const auto& g : groups) {
+                    labels.clear();
+                    MetricsWriter::add_label(labels, "stage", latency_stage_name(stage));
+                    if (g.worker >= 0) {
+                        char idx[12];
+                        snprintf(idx, sizeof(idx), "%d", g.worker);
+                        MetricsWriter::add_label(labels, "worker", idx);
+                    }
+                    write_histogram(w, name, labels, g.snap);
+                }
+            }
+        });
+}
+
+void LatencyRecorder::set_thread_worker(int worker) {
+    thread_set()->worker.store(worker, std::memory_order_relaxed);
+}
+
+LatencyRecorder::ThreadSet* LatencyRecorder::thread_set() {
+    thread_local ThreadHandle handle;
+    if (!handle.set) {
+        handle.set = std::make_shared<ThreadSet>();
+        std::lock_guard<std::mutex> lk(mu_);
+        threads_.push_back(handle.set);
+    }
+    return handle.set.get();
+}
+
+void LatencyRecorder::retire(const std::shared_ptr<ThreadSet>& set) {
+    std::lock_guard<std::mutex> lk(mu_);
+    for (size_t s = 0; s < kNumLatencyStages; ++s) set->stages[s].add_to(retired_[s]);
+    threads_.erase(std::remove(threads_.begin(), threads_.end(), set), threads_.end());
+}
+
+void LatencyRecorder::record(LatencyStage stage, uint64_t ns) {
+    thread_set()->stages[static_cast<size_t>(stage)].record(ns);
+}
+
+LatencyHistogram::Snapshot LatencyRecorder::raw_snapshot_locked(LatencyStage stage) const {
+    size_t s = static_cast<size_t>(stage);
+    LatencyHistogram::Snapshot snap = retired_[s];
+    for (const auto& t : threads_) t->stages[s].add_to(snap);
+    return snap;
+}
+
+void LatencyRecorder::snapshot_by_worker(LatencyStage stage, std::vector<WorkerSnapshot>& out) const {
+    size_t s = static_cast<size_t>(stage);
+    size_t used = 0;
+    auto next = [&](int worker) -> LatencyHistogram::Snapshot& {
+        if (used == out.size()) out.emplace_back();
+        auto& g = out[used++];
+        g.worker = worker;
+        g.snap.counts.fill(0);
+        g.snap.count = g.snap.sum = g.snap.max = 0;
+        return g.snap;
+    };
+
+    std::lock_guard<std::mutex> lk(mu_);
+    int max_worker = -1;
+    auto& rest = next(-1);
+    rest.add(retired_[s]);
+    for (const auto& t : threads_) {
+        int w = t->worker.load(std::memory_order_relaxed);
+        if (w < 0) t->stages[s].add_to(rest);
+        max_worker = std::max(max_worker, w);
+    }
+    if (rest.count == 0) used--;
+
+    // Few workers and threads: a pass per worker keeps the output ordered
+    for (int w = 0; w <= max_worker; ++w) {
+        auto& snap = next(w);
+        for (const auto& t : threads_) {
+            if (t->worker.load(std::memory_order_relaxed) == w) t->stages[s].add_to(snap);
+        }
+        if (snap.count == 0) used--;
+    }
+    out.resize(used);
+}
+
+LatencyHistogram::Snapshot LatencyRecorder::snapshot(LatencyStage stage) const {
+    std::lock_guard<std::mutex> lk(mu_);
+    LatencyHistogram::Snapshot snap = raw_snapshot_locked(stage);
+    const auto& base = baseline_[static_cast<size_t>(stage)];
+    if (base.count == 0) return snap;
+
+    // The max cannot be rebased; bound it by the highest bucket still in use
+    size_t top = 0;
+    for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+        snap.counts[i] -= std::min(snap.counts[i], base.counts[i]);
+        if (snap.counts[i]) top = i;
+    }
+    snap.count -= std::min(snap.count, base.count);
+    snap.sum -= std::min(snap.sum, base.sum);
+    snap.max = snap.count ? std::min(snap.max, LatencyHistogram::bucket_upper(top)) : 0;
+    return snap;
+}
+
+void LatencyRecorder::reset() {
+    std::lock_guard<std::mutex> lk(mu_);
+    for (size_t s = 0; s < kNumLatencyStages; ++s) {
+        baseline_[s] = raw_snapshot_locked(static_cast<LatencyStage>(s));
+    }
+}
+
+} // namespace sip_processor
@@ -2,13 +2,217 @@
 // FILE: src/common/logger.cpp
 // =============================================================================
 #include "common/logger.h"
+#include "common/thread_affinity.h"
+#include <cerrno>
+#include <climits>
 #include <cstring>
+#include <deque>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <algorithm>
 
 namespace sip_processor {
 
+namespace {
+
+// Ring record header; payload follows, total padded to 8 bytes
+struct RecordHeader {
+    uint32_t len;
+    uint16_t level;
+    uint16_t flags;
+};
+static_assert(sizeof(RecordHeader) == 8, "record header must stay 8 bytes");
+
+constexpr uint16_t kRecordWrap = 0x8000;   // Skip to the start of the ring
+constexpr size_t   kMinRingBytes = 16 * 1024;
+constexpr auto     kFlushTimeout = std::chrono::seconds(2);
+
+inline size_t record_size(size_t len) {
+    return (sizeof(RecordHeader) + len + 7) & ~size_t{7};
+}
+
+// Formats "YYYY-MM-DD HH:MM:SS.mmm" (23 chars) for wall-clock `now_ms`
+// into `out`. localtime_r runs at most once per second per thread; within
+// the same millisecond the cached text is reused as is.
+void format_timestamp(char* out, int64_t now_ms) {
+    struct Cache {
+        int64_t ms  = -1;
+        int64_t sec = -1;
+        char    text[24] = {};
+    };
+    thread_local Cache c;
+
+    if (now_ms != c.ms) {
+        int64_t sec = now_ms / 1000;
+        if (sec != c.sec) {
+            time_t t = static_cast<time_t>(sec);
+            struct tm tm_buf;
+            localtime_r(&t, &tm_buf);
+            char tmp[64];
+            snprintf(tmp, sizeof(tmp), "%04d-%02d-%02d %02d:%02d:%02d.",
+                     tm_buf.tm_year + 1900, tm_buf.tm_mon + 1, tm_buf.tm_mday,
+                     tm_buf.tm_hour, tm_buf.tm_min, tm_buf.tm_sec);
+            memcpy(c.text, tmp, 20);
+            c.sec = sec;
+        }
+        int ms = static_cast<int>(now_ms % 1000);
+        c.text[20] = static_cast<char>('0' + ms / 100);
+        c.text[21] = static_cast<char>('0' + (ms / 10) % 10);
+        c.text[22] = static_cast<char>('0' + ms % 10);
+        c.text[23] = '\0';
+        c.ms = now_ms;
+    }
+    memcpy(out, c.text, 23);
+}
+
+// Reads back what log_detail::ArgWriter produced. Missing or mismatched
+// arguments degrade to 0 / "" rather than reading past the record.
+class ArgReader {
+public:
+    ArgReader(const char* p, const char* end) : p_(p), end_(end) {}
+
+    int64_t next_signed() {
+        log_detail::ArgTag tag;
+        uint64_t raw = 0;
+        if (!next_scalar(tag, raw)) return 0;
+        if (tag == log_detail::kArgDouble) return static_cast<int64_t>(as_double(raw));
+        return static_cast<int64_t>(raw);
+    }
+    uint64_t next_unsigned() { return static_cast<uint64_t>(next_signed()); }
+    double next_double() {
+        log_detail::ArgTag tag;
+        uint64_t raw = 0;
+        if (!next_scalar(tag, raw)) return 0.0;
+        if (tag == log_detail::kArgDouble) return as_double(raw);
+        if (tag == log_detail::kArgSigned) return static_cast<double>(static_cast<int64_t>(raw));
+        return static_cast<double>(raw);
+    }
+    const char* next_string() {
+        if (p_ >= end_) return "";
+        if (static_cast<uint8_t>(*p_) != log_detail::kArgString) {
+            log_detail::ArgTag tag;
+            uint64_t raw;
+            next_scalar(tag, raw);
+            return "";
+        }
+        uint32_t len;
+        if (end_ - p_ < static_cast<ptrdiff_t>(1 + sizeof(len))) { p_ = end_; return ""; }
+        memcpy(&len, p_ + 1, sizeof(len));
+        const char* s = p_ + 1 + sizeof(len);
+        if (end_ - s < static_cast<ptrdiff_t>(len) + 1) { p_ = end_; return ""; }
+        p_ = s + len + 1;
+        return s;
+    }
+
+private:
+    bool next_scalar(log_detail::ArgTag& tag, uint64_t& raw) {
+        if (p_ >= end_) return false;
+        tag = static_cast<log_detail::ArgTag>(static_cast<uint8_t>(*p_));
+        if (tag == log_detail::kArgString) { next_string(); return false; }
+        if (end_ - p_ < static_cast<ptrdiff_t>(1 + sizeof(raw))) { p_ = end_; return false; }
+        memcpy(&raw, p_ + 1, sizeof(raw));
+        p_ += 1 + sizeof(raw);
+        return true;
+    }
+    static double as_double(uint64_t raw) {
+        double d;
+        memcpy(&d, &raw, sizeof(d));
+        return d;
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+// printf-style formatting driven by ArgReader: each conversion is handed to
+// snprintf individually with its length modifier normalised to the stored
+// width (int64 / uint64 / double). Returns bytes written (< cap).
+size_t format_deferred(char* out, size_t cap, const char* fmt, ArgReader& args) {
+    size_t o = 0;
+    const char* f = fmt;
+    while (*f && o + 1 < cap) {
+        if (*f != '%') {
+            const char* next = strchr(f, '%');
+            size_t run = next ? static_cast<size_t>(next - f) : strlen(f);
+            run = std::min(run, cap - 1 - o);
+            memcpy(out + o, f, run);
+            o += run;
+            f += run;
+            continue;
+        }
+        if (f[1] == '%') {
+            out[o++] = '%';
+            f += 2;
+            continue;
+        }
+
+        char spec[48];
+        size_t s = 0;
+        spec[s++] = *f++;
+        auto copy_number = [&] {
+            if (*f == '*') {
+                s += static_cast<size_t>(snprintf(spec + s, sizeof(spec) - s, "%d",
+                                                  static_cast<int>(args.next_signed())));
+                ++f;
+            } else {
+                while (*f >= '0' && *f <= '9' && s < 24) spec[s++] = *f++;
+            }
+        };
+        while (*f && strchr("-+ #0", *f) && s < 8) spec[s++] = *f++;
+        copy_number();
+        if (*f == '.') {
+            spec[s++] = *f++;
+            copy_number();
+        }
+        while (*f && strchr("hlzjtLq", *f)) ++f;   // Replaced below
+        char conv = *f;
+        if (!conv) break;
+        ++f;
+
+        int n = 0;
+        size_t room = cap - o;
+        switch (conv) {
+            case 'd': case 'i':
+                spec[s++] = 'l'; spec[s++] = 'l'; spec[s++] = conv; spec[s] = '\0';
+                n = snprintf(out + o, room, spec, static_cast<long long>(args.next_signed()));
+                break;
+            case 'u': case 'o': case 'x': case 'X':
+                spec[s++] = 'l'; spec[s++] = 'l'; spec[s++] = conv; spec[s] = '\0';
+                n = snprintf(out + o, room, spec, static_cast<unsigned long long>(args.next_unsigned()));
+                break;
+            case 'c':
+                spec[s++] = conv; spec[s] = '\0';
+                n = snprintf(out + o, room, spec, static_cast<int>(args.next_signed()));
+                break;
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+                spec[s++] = conv; spec[s] = '\0';
+                n = snprintf(out + o, room, spec, args.next_double());
+                break;
+            case 's':
+                spec[s++] = conv; spec[s] = '\0';
+                n = snprintf(out + o, room, spec, args.next_string());
+                break;
+            case 'p':
+                spec[s++] = conv; spec[s] = '\0';
+                n = snprintf(out + o, room, spec,
+                             reinterpret_cast<void*>(static_cast<uintptr_t>(args.next_unsigned())));
+                break;
+            default:   // %n or unknown: emit nothing
+                break;
+        }
+        if (n > 0) o += std::min(static_cast<size_t>(n), room - 1);
+    }
+    return o;
+}
+
+} // namespace
+
+int64_t log_detail::now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
 // =============================================================================
 // LogSink
 // =============================================================================
@@ -21,27 +225,26 @@ LogSink::LogSink(const LogSinkConfig& config) : config_(config) {
 
 LogSink::~LogSink() {
     std::lock_guard<std::mutex> lk(mu_);
-    if (fp_ && fp_ != stderr && fp_ != stdout) {
-        fflush(fp_);
-        fclose(fp_);
-        fp_ = nullptr;
+    if (fd_ > STDERR_FILENO) {
+        ::close(fd_);
+        fd_ = -1;
     }
 }
 
 void LogSink::open_file() {
     if (config_.file_path.empty()) return;
 
-    fp_ = fopen(config_.file_path.c_str(), "a");
-    if (!fp_) {
+    fd_ = ::open(config_.file_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
         fprintf(stderr, "LOGGER: failed to open log file '%s': %s\n",
                 config_.file_path.c_str(), strerror(errno));
-        fp_ = stderr;
+        fd_ = STDERR_FILENO;
         return;
     }
 
     // Get current file size
     struct stat st;
-    if (fstat(fileno(fp_), &st) == 0) {
+    if (fstat(fd_, &st) == 0) {
         current_size_ = static_cast<size_t>(st.st_size);
     }
 }
@@ -56,11 +259,10 @@ bool LogSink::needs_rotation() const {
 }
 
 void LogSink::rotate() {
-    if (!fp_ || fp_ == stderr || fp_ == stdout) return;
+    if (fd_ <= STDERR_FILENO) return;
 
-    fflush(fp_);
-    fclose(fp_);
-    fp_ = nullptr;
+    ::close(fd_);
+    fd_ = -1;
 
     // Rotate files: .9 -> .10, .8 -> .9, ... .1 -> .2, current -> .1
     // Delete oldest if exceeds max_rotated_files
@@ -81,36 +283,135 @@ void LogSink::rotate() {
     open_file();
 }
 
+size_t LogSink::write_all(int fd, std::vector<struct iovec>& iov, uint64_t& writev_calls) {
+    size_t total = 0;
+    size_t i = 0;
+    while (i < iov.size()) {
+        int cnt = static_cast<int>(std::min<size_t>(iov.size() - i, IOV_MAX));
+        ssize_t n = ::writev(fd, &iov[i], cnt);
+        ++writev_calls;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;   // Nothing sensible to report a log write failure to
+        }
+        total += static_cast<size_t>(n);
+        // Skip fully written entries, then trim a partially written one
+        size_t left = static_cast<size_t>(n);
+        while (i < iov.size() && left >= iov[i].iov_len) {
+            left -= iov[i].iov_len;
+            ++i;
+        }
+        if (left > 0) {
+            iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + left;
+            iov[i].iov_len -= left;
+        }
+    }
+    return total;
+}
+
 void LogSink::write(LogLevel level, const char* formatted_msg, size_t len) {
     if (level < config_.min_level) return;
 
     std::lock_guard<std::mutex> lk(mu_);
 
-    if (!fp_) return;
+    if (fd_ < 0) return;
 
     // Check rotation before write
     if (needs_rotation()) {
         rotate();
-        if (!fp_) return;
+        if (fd_ < 0) return;
     }
 
-    size_t written = fwrite(formatted_msg, 1, len, fp_);
-    current_size_ += written;
+    uint64_t calls = 0;
+    std::vector<struct iovec> iov{{const_cast<char*>(formatted_msg), len}};
+    current_size_ += write_all(fd_, iov, calls);
 
     // Also write to stderr if configured
-    if (config_.also_stderr && fp_ != stderr) {
-        fwrite(formatted_msg, 1, len, stderr);
+    if (config_.also_stderr && fd_ != STDERR_FILENO) {
+        iov = {{const_cast<char*>(formatted_msg), len}};
+        write_all(STDERR_FILENO, iov, calls);
     }
+}
 
-    // Flush on WARN and above for timely visibility
-    if (level >= LogLevel::kWarn) {
-        fflush(fp_);
-    }
+void LogSink::stage(LogLevel level, const char* msg, size_t len) {
+    if (level < config_.min_level) return;
+    pending_.push_back({const_cast<char*>(msg), len});
+    if (config_.also_stderr) pending_stderr_.push_back({const_cast<char*>(msg), len});
 }
 
-void LogSink::flush() {
+size_t LogSink::commit(uint64_t& writev_calls, uint64_t& bytes) {
+    if (pending_.empty()) return 0;
+
     std::lock_guard<std::mutex> lk(mu_);
-    if (fp_) fflush(fp_);
+    size_t rotations = 0;
+    if (fd_ >= 0) {
+        if (needs_rotation()) {
+            rotate();
+            ++rotations;
+        }
+        if (fd_ >= 0) {
+            size_t n = write_all(fd_, pending_, writev_calls);
+            current_size_ += n;
+            bytes += n;
+        }
+        if (!pending_stderr_.empty() && fd_ != STDERR_FILENO) {
+            write_all(STDERR_FILENO, pending_stderr_, writev_calls);
+        }
+    }
+    pending_.clear();
+    pending_stderr_.clear();
+    return rotations;
+}
+
+
+// =============================================================================
+// Logger::ThreadBuffer
+// =============================================================================
+
+struct Logger::ThreadBufferHandle {
+    std::shared_ptr<ThreadBuffer> buf;
+    ~ThreadBufferHandle() {
+        // The writer drains what is left and then releases the ring
+        if (buf) buf->retired.store(true, std::memory_order_release);
+    }
+};
+
+Logger::ThreadBuffer::ThreadBuffer(size_t capacity) {
+    size_t cap = kMinRingBytes;
+    while (cap < capacity) cap <<= 1;
+    data.reset(new char[cap]);
+    mask = cap - 1;
+    tid = static_cast<unsigned long>(pthread_self());
+}
+
+bool Logger::ThreadBuffer::push(LogLevel level, uint16_t flags, const char* msg, size_t len) {
+    const size_t cap  = mask + 1;
+    const size_t need = record_size(len);
+    size_t h   = head.load(std::memory_order_relaxed);
+    size_t pos = h & mask;
+    size_t contiguous = cap - pos;   // Always a multiple of 8
+    size_t total = need <= contiguous ? need : contiguous + need;
+
+    if (cap - (h - tail_cache) < total) {
+        tail_cache = tail.load(std::memory_order_acquire);
+        if (cap - (h - tail_cache) < total) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    if (need > contiguous) {
+        RecordHeader wrap{0, 0, kRecordWrap};
+        memcpy(data.get() + pos, &wrap, sizeof(wrap));
+        h += contiguous;
+        pos = 0;
+    }
+
+    RecordHeader hdr{static_cast<uint32_t>(len), static_cast<uint16_t>(level), flags};
+    memcpy(data.get() + pos, &hdr, sizeof(hdr));
+    memcpy(data.get() + pos + sizeof(hdr), msg, len);
+    head.store(h + need, std::memory_order_release);
+    return true;
 }
 
 
@@ -118,10 +419,10 @@ void LogSink::flush() {
 // Logger
 // =============================================================================
 
-Logger::Logger() : level_(LogLevel::kInfo) {}
+Logger::Logger() = default;
 
 Logger::~Logger() {
-    flush_all();
+    shutdown();
 }
 
 Logger& Logger::instance() {
@@ -133,8 +434,14 @@ void Logger::configure(const std::string& log_dir,
                        const std::string& base_name,
                        LogLevel console_level,
                        size_t max_file_size_bytes,
-                       int max_rotated_files) {
-    std::lock_guard<std::mutex> lk(configure_mu_);
+                       int max_rotated_files,
+                       const AsyncLogConfig& async) {
+    std::lock_guard<std::shared_mutex> lk(configure_mu_);
+
+    // Producers fall back to stderr while the sinks are swapped; whatever is
+    // already queued is drained into the old sinks first.
+    mode_.store(Mode::kStderr, std::memory_order_release);
+    stop_writer_locked();
 
     sinks_.clear();
     slow_event_sink_.reset();
@@ -190,47 +497,59 @@ void Logger::configure(const std::string& log_dir,
         slow_event_sink_ = std::make_unique<LogSink>(cfg);
     }
 
-    stderr_fallback_ = false;
-    configured_ = true;
+    async_config_ = async;
+    thread_buffer_bytes_.store(async.thread_buffer_bytes, std::memory_order_relaxed);
+    if (async.enabled) {
+        start_writer_locked();
+        mode_.store(Mode::kAsync, std::memory_order_release);
+    } else {
+        mode_.store(Mode::kSync, std::memory_order_release);
+    }
+
+    fprintf(stderr, "Logger configured: dir=%s base=%s max_size=%zu max_files=%d async=%s\n",
+            log_dir.c_str(), base_name.c_str(), max_file_size_bytes, max_rotated_files,
+            async.enabled ? "on" : "off");
+}
 
-    fprintf(stderr, "Logger configured: dir=%s base=%s max_size=%zu max_files=%d\n",
-            log_dir.c_str(), base_name.c_str(), max_file_size_bytes, max_rotated_files);
+void Logger::shutdown() {
+    std::lock_guard<std::shared_mutex> lk(configure_mu_);
+    mode_.store(Mode::kStderr, std::memory_order_release);
+    stop_writer_locked();
+    sinks_.clear();
+    slow_event_sink_.reset();
 }
 
 void Logger::add_sink(std::unique_ptr<LogSink> sink) {
-    std::lock_guard<std::mutex> lk(configure_mu_);
+    std::lock_guard<std::shared_mutex> lk(configure_mu_);
+    // Same hand-off as configure(): park producers on stderr while the
+    // writer drains and the sink list changes
+    Mode mode = mode_.load(std::memory_order_acquire);
+    mode_.store(Mode::kStderr, std::memory_order_release);
+    stop_writer_locked();
     sinks_.push_back(std::move(sink));
+    if (mode == Mode::kAsync) start_writer_locked();
+    mode_.store(mode, std::memory_order_release);
 }
 
 size_t Logger::format_message(char* buf, size_t buf_size,
                               LogLevel level, const char* file, int line,
                               const char* fmt, va_list args) {
-    // Timestamp
-    auto now = std::chrono::system_clock::now();
-    auto t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                  now.time_since_epoch()) % 1000;
-    struct tm tm_buf;
-    localtime_r(&t, &tm_buf);
-
     // Thread ID
-    auto tid = static_cast<unsigned long>(pthread_self());
+    thread_local unsigned long tid = static_cast<unsigned long>(pthread_self());
 
     // Extract filename
     const char* base = strrchr(file, '/');
     base = base ? base + 1 : file;
 
-    // Format prefix
-    int prefix_len = snprintf(buf, buf_size,
-        "%04d-%02d-%02d %02d:%02d:%02d.%03d [%s] [tid:%lu] [%s:%d] ",
-        tm_buf.tm_year + 1900, tm_buf.tm_mon + 1, tm_buf.tm_mday,
-        tm_buf.tm_hour, tm_buf.tm_min, tm_buf.tm_sec,
-        static_cast<int>(ms.count()),
-        log_level_name(level), tid, base, line);
+    // Timestamp (cached per thread) + prefix
+    format_timestamp(buf, log_detail::now_ms());
+    int prefix_len = snprintf(buf + 23, buf_size - 23, " [%s] [tid:%lu] [%s:%d] ",
+                              log_level_name(level), tid, base, line);
 
-    if (prefix_len < 0 || static_cast<size_t>(prefix_len) >= buf_size) {
+    if (prefix_len < 0 || static_cast<size_t>(prefix_len) + 23 >= buf_size) {
         return 0;
     }
+    prefix_len += 23;
 
     // Format user message
     int msg_len = vsnprintf(buf + prefix_len,
@@ -248,35 +567,73 @@ size_t Logger::format_message(char* buf, size_t buf_size,
     return total + 1;
 }
 
-void Logger::log(LogLevel level, const char* file, int line, const char* fmt, ...) {
-    if (level < level_.load(std::memory_order_relaxed)) return;
-
-    char buf[4096];
-    va_list args;
-    va_start(args, fmt);
-    size_t len = format_message(buf, sizeof(buf), level, file, line, fmt, args);
-    va_end(args);
+Logger::ThreadBuffer* Logger::thread_buffer() {
+    thread_local ThreadBufferHandle handle;
+    if (!handle.buf) {
+        handle.buf = std::make_shared<ThreadBuffer>(
+            thread_buffer_bytes_.load(std::memory_order_relaxed));
+        std::lock_guard<std::mutex> lk(buffers_mu_);
+        buffers_.push_back(handle.buf);
+        buffers_gen_.fetch_add(1, std::memory_order_release);
+    }
+    return handle.buf.get();
+}
 
-    if (len == 0) return;
+void Logger::dispatch(LogLevel level, uint16_t flags, const char* buf, size_t len) {
+    Mode mode = mode_.load(std::memory_order_acquire);
+
+    if (mode == Mode::kAsync) {
+        ThreadBuffer* tb = thread_buffer();
+        if (tb->push(level, flags, buf, len)) {
+            // Only urgent messages or a filling ring wake the writer early;
+            // otherwise it picks records up on its flush interval.
+            size_t used = tb->head.load(std::memory_order_relaxed) - tb->tail_cache;
+            if (level >= LogLevel::kWarn || used > (tb->mask + 1) / 2) {
+                wake_cv_.notify_one();
+            }
+        }
+        if (level == LogLevel::kFatal) flush_all();
+        return;
+    }
 
-    if (stderr_fallback_ || !configured_) {
+    if (mode == Mode::kStderr) {
+        if (flags & kRecordSlow) return;   // No slow log before configure()
         fwrite(buf, 1, len, stderr);
         if (level >= LogLevel::kWarn) fflush(stderr);
         return;
     }
 
-    // Write to all matching sinks
+    // Synchronous: write to all matching sinks on the calling thread.  A
+    // reconfiguration finished while this waited changes the mode too.
+    std::shared_lock<std::shared_mutex> lk(configure_mu_);
+    if (mode_.load(std::memory_order_acquire) != Mode::kSync) {
+        lk.unlock();
+        dispatch(level, flags, buf, len);
+        return;
+    }
+    if ((flags & kRecordSlow) && slow_event_sink_) {
+        slow_event_sink_->write(level, buf, len);
+    }
     for (auto& sink : sinks_) {
         sink->write(level, buf, len);
     }
+}
 
-    if (level == LogLevel::kFatal) {
-        flush_all();
-    }
+void Logger::log(LogLevel level, const char* file, int line, const char* fmt, ...) {
+    if (level < level_.load(std::memory_order_relaxed)) return;
+
+    char buf[kMaxMessage];
+    va_list args;
+    va_start(args, fmt);
+    size_t len = format_message(buf, sizeof(buf), level, file, line, fmt, args);
+    va_end(args);
+
+    if (len == 0) return;
+    dispatch(level, 0, buf, len);
 }
 
 void Logger::log_slow(const char* file, int line, const char* fmt, ...) {
-    char buf[4096];
+    char buf[kMaxMessage];
     va_list args;
     va_start(args, fmt);
     size_t len = format_message(buf, sizeof(buf), LogLevel::kWarn, file, line, fmt, args);
@@ -284,22 +641,213 @@ void Logger::log_slow(const char* file, int line, const char* fmt, ...) {
 
     if (len == 0) return;
 
-    // Write to dedicated slow event log
-    if (slow_event_sink_) {
-        slow_event_sink_->write(LogLevel::kWarn, buf, len);
+    // Dedicated slow event log, plus the main sinks as WARN
+    dispatch(LogLevel::kWarn, kRecordSlow, buf, len);
+}
+
+size_t Logger::render_deferred(char* out, size_t cap, const char* rec, size_t len,
+                               unsigned long tid) {
+    const LogSite* site = nullptr;
+    int64_t ts = 0;
+    if (len < sizeof(site) + sizeof(ts) || cap < 64) return 0;
+    memcpy(&site, rec, sizeof(site));
+    memcpy(&ts, rec + sizeof(site), sizeof(ts));
+
+    format_timestamp(out, ts);
+    int prefix_len = snprintf(out + 23, cap - 23, " [%s] [tid:%lu] [%s:%d] ",
+                              log_level_name(site->level), tid, site->file, site->line);
+    if (prefix_len < 0 || static_cast<size_t>(prefix_len) + 23 >= cap - 1) return 0;
+    size_t o = static_cast<size_t>(prefix_len) + 23;
+
+    // Leave room for the newline
+    ArgReader args(rec + sizeof(site) + sizeof(ts), rec + len);
+    o += format_deferred(out + o, cap - 1 - o, site->fmt, args);
+    out[o] = '\n';
+    return o + 1;
+}
+
+void Logger::submit_deferred(const LogSite& site, const char* rec, size_t len) {
+    if (mode_.load(std::memory_order_acquire) == Mode::kAsync) {
+        dispatch(site.level, kRecordDeferred, rec, len);
+        return;
     }
+    // No writer thread: render on the caller as the printf path would
+    thread_local unsigned long tid = static_cast<unsigned long>(pthread_self());
+    char buf[kMaxMessage];
+    size_t n = render_deferred(buf, sizeof(buf), rec, len, tid);
+    if (n > 0) dispatch(site.level, 0, buf, n);
+}
 
-    // Also write to main sinks as WARN
-    for (auto& sink : sinks_) {
-        sink->write(LogLevel::kWarn, buf, len);
+char* Logger::render_space() {
+    if (render_pos_ + kMaxMessage > kRenderBlock) {
+        ++render_block_;
+        render_pos_ = 0;
+    }
+    if (render_block_ == render_blocks_.size()) {
+        render_blocks_.emplace_back(new char[kRenderBlock]);
     }
+    return render_blocks_[render_block_].get() + render_pos_;
 }
 
 void Logger::flush_all() {
-    for (auto& sink : sinks_) {
-        sink->flush();
+    if (mode_.load(std::memory_order_acquire) != Mode::kAsync) return;
+
+    std::unique_lock<std::mutex> lk(wake_mu_);
+    uint64_t req = ++flush_requested_;
+    wake_cv_.notify_one();
+    flushed_cv_.wait_for(lk, kFlushTimeout, [&] {
+        return flush_completed_ >= req || writer_stop_.load(std::memory_order_relaxed);
+    });
+}
+
+void Logger::start_writer_locked() {
+    if (writer_.joinable()) return;
+    writer_stop_.store(false, std::memory_order_relaxed);
+    writer_ = std::thread([this] { writer_loop(); });
+}
+
+void Logger::stop_writer_locked() {
+    if (!writer_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lk(wake_mu_);
+        writer_stop_.store(true, std::memory_order_relaxed);
     }
-    if (slow_event_sink_) slow_event_sink_->flush();
+    wake_cv_.notify_one();
+    writer_.join();
+    flushed_cv_.notify_all();
+}
+
+void Logger::writer_loop() {
+    ThreadPlacement::instance().place(ThreadRole::kLogging, 0, "log-writer");
+    for (;;) {
+        // Everything pushed before a flush request was made is visible to
+        // the drain pass that follows reading it.
+        uint64_t req;
+        {
+            std::lock_guard<std::mutex> lk(wake_mu_);
+            req = flush_requested_;
+        }
+        bool drained = drain_once();
+
+        std::unique_lock<std::mutex> lk(wake_mu_);
+        if (req > flush_completed_) {
+            flush_completed_ = req;
+            flushed_cv_.notify_all();
+        }
+        if (writer_stop_.load(std::memory_order_relaxed)) {
+            lk.unlock();
+            while (drain_once()) {}
+            break;
+        }
+        if (!drained && flush_requested_ == flush_completed_) {
+            wake_cv_.wait_for(lk, async_config_.flush_interval);
+        }
+    }
+}
+
+bool Logger::drain_once() {
+    // Writer-side copy of the ring list, refreshed when threads come or go
+    uint64_t gen = buffers_gen_.load(std::memory_order_acquire);
+    if (gen != writer_gen_) {
+        std::lock_guard<std::mutex> lk(buffers_mu_);
+        writer_buffers_ = buffers_;
+        writer_gen_ = buffers_gen_.load(std::memory_order_relaxed);
+        stats_.thread_buffers.store(writer_buffers_.size(), std::memory_order_relaxed);
+    }
+
+    struct Release { ThreadBuffer* buf; size_t tail; };
+    std::vector<Release> releases;
+    std::deque<std::string> notices;   // Stable addresses until commit
+    uint64_t records = 0;
+    bool any_retired = false;
+
+    for (auto& b : writer_buffers_) {
+        uint64_t dropped = b->dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            stats_.dropped.fetch_add(dropped, std::memory_order_relaxed);
+            if (async_config_.overflow == LogOverflowPolicy::kCount) {
+                char buf[160];
+                format_timestamp(buf, log_detail::now_ms());
+                int n = snprintf(buf + 23, sizeof(buf) - 23,
+                                 " [WARN] [tid:%lu] [logger] %lu messages dropped (ring full)\n",
+                                 b->tid, static_cast<unsigned long>(dropped));
+                notices.emplace_back(buf, 23 + static_cast<size_t>(std::max(n, 0)));
+                for (auto& sink : sinks_) {
+                    sink->stage(LogLevel::kWarn, notices.back().data(), notices.back().size());
+                }
+                ++records;
+            }
+        }
+
+        bool retired = b->retired.load(std::memory_order_acquire);
+        size_t t = b->tail.load(std::memory_order_relaxed);
+        size_t h = b->head.load(std::memory_order_acquire);
+        if (t == h) {
+            any_retired |= retired;
+            continue;
+        }
+
+        const size_t cap = b->mask + 1;
+        while (t != h) {
+            size_t pos = t & b->mask;
+            RecordHeader hdr;
+            memcpy(&hdr, b->data.get() + pos, sizeof(hdr));
+            if (hdr.flags & kRecordWrap) {
+                t += cap - pos;
+                continue;
+            }
+            const char* msg = b->data.get() + pos + sizeof(hdr);
+            size_t msg_len = hdr.len;
+            LogLevel level = static_cast<LogLevel>(hdr.level);
+            if (hdr.flags & kRecordDeferred) {
+                // Format here, off the worker; the line lives in the render
+                // blocks until commit
+                char* line = render_space();
+                msg_len = render_deferred(line, kMaxMessage, msg, hdr.len, b->tid);
+                render_pos_ += (msg_len + 7) & ~size_t{7};
+                msg = line;
+            }
+            if ((hdr.flags & kRecordSlow) && slow_event_sink_) {
+                slow_event_sink_->stage(level, msg, msg_len);
+            }
+            for (auto& sink : sinks_) {
+                sink->stage(level, msg, msg_len);
+            }
+            t += record_size(hdr.len);
+            ++records;
+        }
+        releases.push_back({b.get(), t});
+    }
+
+    if (records > 0) {
+        uint64_t calls = 0, bytes = 0;
+        size_t rotations = 0;
+        for (auto& sink : sinks_) rotations += sink->commit(calls, bytes);
+        if (slow_event_sink_) rotations += slow_event_sink_->commit(calls, bytes);
+
+        stats_.written.fetch_add(records, std::memory_order_relaxed);
+        stats_.writev_calls.fetch_add(calls, std::memory_order_relaxed);
+        stats_.bytes_written.fetch_add(bytes, std::memory_order_relaxed);
+        if (rotations) stats_.rotations.fetch_add(rotations, std::memory_order_relaxed);
+    }
+    render_block_ = 0;
+    render_pos_ = 0;
+
+    // Hand the space back to the producers only after the data is written
+    for (auto& r : releases) r.buf->tail.store(r.tail, std::memory_order_release);
+
+    // Release rings whose threads have exited and that are fully drained
+    if (any_retired) {
+        std::lock_guard<std::mutex> lk(buffers_mu_);
+        buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(), [](const auto& b) {
+            return b->retired.load(std::memory_order_acquire) &&
+                   b->tail.load(std::memory_order_relaxed) == b->head.load(std::memory_order_acquire) &&
+                   b->dropped.load(std::memory_order_relaxed) == 0;
+        }), buffers_.end());
+        buffers_gen_.fetch_add(1, std::memory_order_release);
+    }
+
+    return records > 0;
 }
 
 } // namespace sip_processor
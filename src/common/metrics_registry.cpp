@@ -0,0 +1,182 @@
+
+// =============================================================================
+// FILE: src/common/metrics_registry.cpp
+// =============================================================================
+#include "common/metrics_registry.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+namespace sip_processor {
+
+static const char* type_name(MetricType t) {
+    switch (t) {
+        case MetricType::kCounter:   return "counter";
+        case MetricType::kGauge:     return "gauge";
+        case MetricType::kHistogram: return "histogram";
+        default:                     return "unknown";
+    }
+}
+
+template <typename T>
+static void append_int(std::string& out, T v) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, static_cast<size_t>(res.ptr - buf));
+}
+
+// =============================================================================
+// MetricsWriter
+// =============================================================================
+
+void MetricsWriter::family(const char* name, MetricType type, const char* help) {
+    out_ += "# TYPE ";
+    out_ += name;
+    out_ += ' ';
+    out_ += type_name(type);
+    out_ += "\n# HELP ";
+    out_ += name;
+    out_ += ' ';
+    out_ += help;
+    out_ += '\n';
+}
+
+void MetricsWriter::begin(const char* name, const char* suffix, std::string_view labels) {
+    out_ += name;
+    out_ += suffix;
+    if (!labels.empty()) {
+        out_ += '{';
+        out_ += labels;
+        out_ += '}';
+    }
+    out_ += ' ';
+}
+
+void MetricsWriter::sample(const char* name, const char* suffix, std::string_view labels, uint64_t value) {
+    begin(name, suffix, labels);
+    append_int(out_, value);
+    out_ += '\n';
+}
+
+void MetricsWriter::sample(const char* name, const char* suffix, std::string_view labels, int64_t value) {
+    begin(name, suffix, labels);
+    append_int(out_, value);
+    out_ += '\n';
+}
+
+void MetricsWriter::sample(const char* name, const char* suffix, std::string_view labels, double value) {
+    begin(name, suffix, labels);
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "%.9g", value);
+    out_.append(buf, static_cast<size_t>(std::max(n, 0)));
+    out_ += '\n';
+}
+
+void MetricsWriter::bucket(const char* name, std::string_view labels, const char* le, uint64_t cumulative) {
+    out_ += name;
+    out_ += "_bucket{";
+    out_ += labels;
+    if (!labels.empty()) out_ += ',';
+    out_ += "le=\"";
+    out_ += le;
+    out_ += "\"} ";
+    append_int(out_, cumulative);
+    out_ += '\n';
+}
+
+void MetricsWriter::add_label(std::string& labels, std::string_view key, std::string_view value) {
+    if (!labels.empty()) labels += ',';
+    labels += key;
+    labels += "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') { labels += '\\'; labels += c; }
+        else if (c == '\n')        { labels += "\\n"; }
+        else                       { labels += c; }
+    }
+    labels += '"';
+}
+
+// =============================================================================
+// MetricsRegistry
+// =============================================================================
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Family& MetricsRegistry::family_locked(const char* name, MetricType type,
+                                                        const char* help) {
+    for (auto& f : families_) {
+        if (strcmp(f.name, name) == 0) return f;
+    }
+    families_.push_back(Family{name, help, type, {}, {}});
+    return families_.back();
+}
+
+void MetricsRegistry::add_counter(const void* owner, const char* name, const char* help,
+                                  const std::atomic<uint64_t>& value, std::string labels) {
+    std::lock_guard<std::mutex> lk(mu_);
+    family_locked(name, MetricType::kCounter, help).series.push_back({owner, std::move(labels), &value, nullptr});
+}
+
+void MetricsRegistry::add_gauge(const void* owner, const char* name, const char* help,
+                                const std::atomic<uint64_t>& value, std::string labels) {
+    std::lock_guard<std::mutex> lk(mu_);
+    family_locked(name, MetricType::kGauge, help).series.push_back({owner, std::move(labels), &value, nullptr});
+}
+
+void MetricsRegistry::add_gauge(const void* owner, const char* name, const char* help,
+                                const std::atomic<int64_t>& value, std::string labels) {
+    std::lock_guard<std::mutex> lk(mu_);
+    family_locked(name, MetricType::kGauge, help).series.push_back({owner, std::move(labels), nullptr, &value});
+}
+
+void MetricsRegistry::add_collector(const void* owner, const char* name, MetricType type,
+                                    const char* help, Collector collector) {
+    std::lock_guard<std::mutex> lk(mu_);
+    family_locked(name, type, help).collectors.emplace_back(owner, std::move(collector));
+}
+
+void MetricsRegistry::unregister(const void* owner) {
+    std::lock_guard<std::mutex> lk(mu_);
+    for (auto& f : families_) {
+        f.series.erase(std::remove_if(f.series.begin(), f.series.end(),
+                                      [owner](const Series& s) { return s.owner == owner; }),
+                       f.series.end());
+        f.collectors.erase(std::remove_if(f.collectors.begin(), f.collectors.end(),
+                                          [owner](const auto& c) { return c.first == owner; }),
+                           f.collectors.end());
+    }
+    // Families stay registered: a scrape skips the empty ones
+}
+
+void MetricsRegistry::render(std::string& out) const {
+    out.clear();
+    MetricsWriter w(out);
+    std::lock_guard<std::mutex> lk(mu_);
+    for (const auto& f : families_) {
+        if (f.series.empty() && f.collectors.empty()) continue;
+        w.family(f.name, f.type, f.help);
+        const char* suffix = f.type == MetricType::kCounter ? "_total" : "";
+        for (const auto& s : f.series) {
+            if (s.unsigned_value) {
+                w.sample(f.name, suffix, s.labels, s.unsigned_value->load(std::memory_order_relaxed));
+            } else {
+                w.sample(f.name, suffix, s.labels, s.signed_value->load(std::memory_order_relaxed));
+            }
+        }
+        for (const auto& c : f.collectors) c.second(w, f.name);
+    }
+    out += "# EOF\n";
+}
+
+size_t MetricsRegistry::series_count() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    size_t n = 0;
+    for (const auto& f : families_) n += f.series.size();
+    return n;
+}
+
+} // namespace sip_processor
@@ -3,64 +3,155 @@
 // FILE: src/common/slow_event_logger.cpp
 // =============================================================================
 #include "common/slow_event_logger.h"
+#include <algorithm>
+#include <cstring>
 
 namespace sip_processor {
 
+static int64_t to_ns(Millisecs ms) {
+    return std::chrono::duration_cast<Nanosecs>(ms).count();
+}
+
+static int64_t steady_ns(TimePoint t) {
+    return std::chrono::duration_cast<Nanosecs>(t.time_since_epoch()).count();
+}
+
+// Truncating copy into a fixed, NUL-terminated buffer
+template <size_t N>
+static void copy_truncated(char (&dst)[N], std::string_view src) {
+    size_t n = std::min(src.size(), N - 1);
+    memcpy(dst, src.data(), n);
+    dst[n] = '\0';
+}
+
+// Min-heap on duration: front() is the fastest event still kept
+static bool slower(const SlowEventLogger::Sample& a, const SlowEventLogger::Sample& b) {
+    return a.total_ns > b.total_ns;
+}
+
 SlowEventLogger::SlowEventLogger(const Config& config)
-    : warn_ms_(config.slow_event_warn_threshold.count())
-    , error_ms_(config.slow_event_error_threshold.count())
-    , critical_ms_(config.slow_event_critical_threshold.count())
+    : warn_ns_(to_ns(config.slow_event_warn_threshold))
+    , error_ns_(to_ns(config.slow_event_error_threshold))
+    , critical_ns_(to_ns(config.slow_event_critical_threshold))
     , log_stack_trace_(config.slow_event_log_stack_trace)
-{}
+    , top_n_(config.slow_event_top_n)
+    , window_(std::max(config.slow_event_top_window, Seconds(1)))
+{
+    current_.reserve(top_n_);
+    window_end_ns_.store(steady_ns(Clock::now() + window_), std::memory_order_relaxed);
+}
 
 void SlowEventLogger::set_thresholds(Millisecs warn, Millisecs error, Millisecs critical) {
-    warn_ms_.store(warn.count(), std::memory_order_relaxed);
-    error_ms_.store(error.count(), std::memory_order_relaxed);
-    critical_ms_.store(critical.count(), std::memory_order_relaxed);
+    warn_ns_.store(to_ns(warn), std::memory_order_relaxed);
+    error_ns_.store(to_ns(error), std::memory_order_relaxed);
+    critical_ns_.store(to_ns(critical), std::memory_order_relaxed);
 }
 
 SlowEventLogger::Thresholds SlowEventLogger::thresholds() const {
     return {
-        Millisecs(warn_ms_.load(std::memory_order_relaxed)),
-        Millisecs(error_ms_.load(std::memory_order_relaxed)),
-        Millisecs(critical_ms_.load(std::memory_order_relaxed))
+        std::chrono::duration_cast<Millisecs>(Nanosecs(warn_ns_.load(std::memory_order_relaxed))),
+        std::chrono::duration_cast<Millisecs>(Nanosecs(error_ns_.load(std::memory_order_relaxed))),
+        std::chrono::duration_cast<Millisecs>(Nanosecs(critical_ns_.load(std::memory_order_relaxed)))
     };
 }
 
-void SlowEventLogger::check_and_log(const char* operation,
-                                      const std::string& dialog_id,
-                                      const std::string& extra_context,
-                                      Millisecs elapsed) {
-    int64_t ms = elapsed.count();
+void SlowEventLogger::on_finish(const Timer& timer, TimePoint now) {
+    int64_t ns = timer.elapsed_.count();
 
     // Update max duration
-    uint64_t prev_max = stats_.max_duration_ms.load(std::memory_order_relaxed);
-    while (static_cast<uint64_t>(ms) > prev_max) {
-        if (stats_.max_duration_ms.compare_exchange_weak(prev_max, ms,
+    uint64_t us = static_cast<uint64_t>(ns / 1000);
+    uint64_t prev_max = stats_.max_duration_us.load(std::memory_order_relaxed);
+    while (us > prev_max) {
+        if (stats_.max_duration_us.compare_exchange_weak(prev_max, us,
                 std::memory_order_relaxed)) break;
     }
 
-    int64_t crit = critical_ms_.load(std::memory_order_relaxed);
-    int64_t err  = error_ms_.load(std::memory_order_relaxed);
-    int64_t warn = warn_ms_.load(std::memory_order_relaxed);
+    // Take the lock only to beat the fastest kept event or to rotate
+    if (top_n_ > 0 && (static_cast<uint64_t>(ns) > admit_floor_ns_.load(std::memory_order_relaxed) ||
+                       steady_ns(now) >= window_end_ns_.load(std::memory_order_relaxed))) {
+        capture(timer, static_cast<uint64_t>(ns), now);
+    }
+
+    int64_t crit = critical_ns_.load(std::memory_order_relaxed);
+    int64_t err  = error_ns_.load(std::memory_order_relaxed);
+    int64_t warn = warn_ns_.load(std::memory_order_relaxed);
+    if (ns < warn) return;
 
-    if (ms >= crit) {
+    // Slow events are rare; only now pay for copying the context
+    std::string dialog_id(timer.dialog_id_);
+    std::string extra(timer.extra_context_);
+    double ms = static_cast<double>(ns) / 1e6;
+    if (ns >= crit) {
         stats_.critical_count.fetch_add(1, std::memory_order_relaxed);
-        LOG_ERROR("SLOW_EVENT CRITICAL: %s took %ldms dialog=%s %s",
-                  operation, ms, dialog_id.c_str(), extra_context.c_str());
-    } else if (ms >= err) {
+        LOG_ERROR("SLOW_EVENT CRITICAL: %s took %.3fms dialog=%s %s",
+                  timer.operation_, ms, dialog_id.c_str(), extra.c_str());
+    } else if (ns >= err) {
         stats_.error_count.fetch_add(1, std::memory_order_relaxed);
-        LOG_ERROR("SLOW_EVENT: %s took %ldms dialog=%s %s",
-                  operation, ms, dialog_id.c_str(), extra_context.c_str());
-    } else if (ms >= warn) {
+        LOG_ERROR("SLOW_EVENT: %s took %.3fms dialog=%s %s",
+                  timer.operation_, ms, dialog_id.c_str(), extra.c_str());
+    } else {
         stats_.warn_count.fetch_add(1, std::memory_order_relaxed);
-        LOG_WARN("SLOW_EVENT: %s took %ldms dialog=%s %s",
-                 operation, ms, dialog_id.c_str(), extra_context.c_str());
+        LOG_WARN("SLOW_EVENT: %s took %.3fms dialog=%s %s",
+                 timer.operation_, ms, dialog_id.c_str(), extra.c_str());
+    }
+}
+
+void SlowEventLogger::rotate_locked(TimePoint now) {
+    previous_.swap(current_);
+    current_.clear();
+    admit_floor_ns_.store(0, std::memory_order_relaxed);
+    window_end_ns_.store(steady_ns(now + window_), std::memory_order_relaxed);
+}
+
+void SlowEventLogger::capture(const Timer& timer, uint64_t ns, TimePoint now) {
+    std::lock_guard<std::mutex> lk(top_mu_);
+    if (steady_ns(now) >= window_end_ns_.load(std::memory_order_relaxed)) rotate_locked(now);
+
+    if (current_.size() >= top_n_) {
+        if (ns <= current_.front().total_ns) return;
+        std::pop_heap(current_.begin(), current_.end(), slower);
+        current_.pop_back();
+    }
+
+    Sample s;
+    s.operation = timer.operation_;
+    s.total_ns = ns;
+    s.wall_ms = wall_clock_ms();
+    copy_truncated(s.dialog_id, timer.dialog_id_);
+    copy_truncated(s.context, timer.extra_context_);
+    s.num_stages = timer.num_stages_;
+    s.stages = timer.stages_;
+    current_.push_back(s);
+    std::push_heap(current_.begin(), current_.end(), slower);
+    stats_.samples_captured.fetch_add(1, std::memory_order_relaxed);
+
+    if (current_.size() >= top_n_) {
+        admit_floor_ns_.store(current_.front().total_ns, std::memory_order_relaxed);
+    }
+}
+
+std::vector<SlowEventLogger::Sample> SlowEventLogger::slowest(size_t limit) const {
+    std::vector<Sample> out;
+    {
+        std::lock_guard<std::mutex> lk(top_mu_);
+        // Rotation is lazy: with no events since the window ended, "current"
+        // is really the previous window, and older windows have aged out
+        int64_t now = steady_ns(Clock::now());
+        int64_t end = window_end_ns_.load(std::memory_order_relaxed);
+        if (now < end) {
+            out = previous_;
+            out.insert(out.end(), current_.begin(), current_.end());
+        } else if (now < end + std::chrono::duration_cast<Nanosecs>(window_).count()) {
+            out = current_;
+        }
     }
+    std::sort(out.begin(), out.end(), slower);
+    if (out.size() > limit) out.resize(limit);
+    return out;
 }
 
 SlowEventLogger::Timer::Timer(SlowEventLogger& logger, const char* operation,
-                                const std::string& dialog_id, const std::string& extra)
+                                std::string_view dialog_id, std::string_view extra)
     : logger_(logger), operation_(operation), dialog_id_(dialog_id)
     , extra_context_(extra), start_(Clock::now())
 {}
@@ -71,9 +162,10 @@ SlowEventLogger::Timer::~Timer() {
 
 void SlowEventLogger::Timer::finish() {
     if (finished_) return;
+    auto now = Clock::now();
+    elapsed_ = std::chrono::duration_cast<Nanosecs>(now - start_);
     finished_ = true;
-    auto elapsed = std::chrono::duration_cast<Millisecs>(Clock::now() - start_);
-    logger_.check_and_log(operation_, dialog_id_, extra_context_, elapsed);
+    logger_.on_finish(*this, now);
 }
 
 } // namespace sip_processor
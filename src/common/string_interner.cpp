@@ -0,0 +1,92 @@
+
+// =============================================================================
+// FILE: src/common/string_interner.cpp
+// =============================================================================
+#include "common/string_interner.h"
+#include <algorithm>
+
+namespace sip_processor {
+
+StringInterner& StringInterner::instance() {
+    static StringInterner interner;
+    return interner;
+}
+
+StringInterner::StringInterner() : pages_(new std::atomic<Entry*>[kMaxPages]) {
+    for (size_t i = 0; i < kMaxPages; ++i) pages_[i].store(nullptr, std::memory_order_relaxed);
+    // Page 0 exists from the start; its slot 0 is the empty string
+    page_storage_.emplace_back(new Entry[kPageSize]);
+    pages_[0].store(page_storage_.back().get(), std::memory_order_release);
+}
+
+void StringInterner::set_capacity(size_t n) {
+    capacity_.store(std::clamp<size_t>(n, 1, kMaxSymbols), std::memory_order_relaxed);
+}
+
+// Returns 0 when full
+uint32_t StringInterner::allocate_locked(std::string_view s) {
+    std::lock_guard<std::mutex> lk(alloc_mu_);
+    if (next_id_ >= capacity_.load(std::memory_order_relaxed)) return 0;
+
+    size_t need = s.size() + 1;
+    if (need > arena_left_) {
+        size_t block = std::max(need, kArenaBlock);
+        arena_.emplace_back(new char[block]);
+        arena_pos_ = arena_.back().get();
+        arena_left_ = block;
+    }
+    char* data = arena_pos_;
+    std::memcpy(data, s.data(), s.size());
+    data[s.size()] = '\0';
+    arena_pos_ += need;
+    arena_left_ -= need;
+
+    uint32_t id = next_id_++;
+    size_t page = id >> kPageBits;
+    Entry* entries = pages_[page].load(std::memory_order_relaxed);
+    if (!entries) {
+        page_storage_.emplace_back(new Entry[kPageSize]);
+        entries = page_storage_.back().get();
+    }
+    entries[id & (kPageSize - 1)] = Entry{data, static_cast<uint32_t>(s.size())};
+    // Publish the page after the entry is written; ids reach other threads
+    // through the shard lock or the caller's own synchronization.
+    pages_[page].store(entries, std::memory_order_release);
+
+    count_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(need + sizeof(Entry), std::memory_order_relaxed);
+    return id;
+}
+
+uint32_t StringInterner::intern(std::string_view s) {
+    if (s.empty()) return 0;
+    auto& shard = shards_[std::hash<std::string_view>{}(s) % kNumShards];
+    {
+        std::shared_lock<std::shared_mutex> lk(shard.mu);
+        auto it = shard.ids.find(s);
+        if (it != shard.ids.end()) return it->second;
+    }
+    std::unique_lock<std::shared_mutex> lk(shard.mu);
+    auto it = shard.ids.find(s);
+    if (it != shard.ids.end()) return it->second;
+
+    uint32_t id = allocate_locked(s);
+    if (id == 0) {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    shard.ids.emplace(view(id), id);
+    return id;
+}
+
+bool StringInterner::find(std::string_view s, uint32_t& id) const {
+    if (s.empty()) { id = 0; return true; }
+    const auto& shard = shards_[std::hash<std::string_view>{}(s) % kNumShards];
+    std::shared_lock<std::shared_mutex> lk(shard.mu);
+    auto it = shard.ids.find(s);
+    if (it == shard.ids.end()) return false;
+    id = it->second;
+    return true;
+}
+
+} // namespace sip_processor
@@ -0,0 +1,145 @@
+
+// =============================================================================
+// FILE: src/common/thread_affinity.cpp
+// =============================================================================
+#include "common/thread_affinity.h"
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace sip_processor {
+
+const char* thread_role_name(ThreadRole role) {
+    switch (role) {
+        case ThreadRole::kWorker:      return "workers";
+        case ThreadRole::kSip:         return "sip";
+        case ThreadRole::kPresence:    return "presence";
+        case ThreadRole::kRouter:      return "router";
+        case ThreadRole::kPersistence: return "persistence";
+        case ThreadRole::kHttp:        return "http";
+        case ThreadRole::kLogging:     return "logging";
+        case ThreadRole::kMaintenance: return "maintenance";
+        default:                       return "unknown";
+    }
+}
+
+static bool parse_int(const std::string& s, int& out) {
+    if (s.empty()) return false;
+    char* end = nullptr;
+    long v = std::strtol(s.c_str(), &end, 10);
+    if (*end != '\0' || v < 0 || v >= CPU_SETSIZE) return false;
+    out = static_cast<int>(v);
+    return true;
+}
+
+bool parse_cpu_list(const std::string& spec, std::vector<int>& out) {
+    out.clear();
+    std::string list = spec;
+    list.erase(std::remove_if(list.begin(), list.end(), ::isspace), list.end());
+    if (list.empty()) return true;
+
+    if (list.compare(0, 4, "node") == 0) {
+        int node;
+        if (!parse_int(list.substr(4), node)) return false;
+        std::ifstream f("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!f || !std::getline(f, list) || list.empty()) return false;
+    }
+
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        auto dash = item.find('-');
+        int lo, hi;
+        if (dash == std::string::npos) {
+            if (!parse_int(item, lo)) return false;
+            hi = lo;
+        } else if (!parse_int(item.substr(0, dash), lo) || !parse_int(item.substr(dash + 1), hi) || hi < lo) {
+            return false;
+        }
+        for (int c = lo; c <= hi; ++c) out.push_back(c);
+    }
+    return !out.empty();
+}
+
+ThreadPlacement& ThreadPlacement::instance() {
+    static ThreadPlacement placement;
+    return placement;
+}
+
+bool ThreadPlacement::configure(const Config& config) {
+    const std::string* specs[] = {
+        &config.affinity_workers, &config.affinity_sip, &config.affinity_presence,
+        &config.affinity_router, &config.affinity_persistence, &config.affinity_http,
+        &config.affinity_logging, &config.affinity_maintenance,
+    };
+    static_assert(sizeof(specs) / sizeof(specs[0]) == static_cast<size_t>(ThreadRole::kCount),
+                  "one CPU list per role");
+
+    std::lock_guard<std::mutex> lk(mu_);
+    enabled_ = config.affinity_enabled;
+    bool ok = true;
+    for (size_t i = 0; i < cpus_.size(); ++i) {
+        if (!parse_cpu_list(*specs[i], cpus_[i])) {
+            cpus_[i].clear();
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool ThreadPlacement::enabled() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return enabled_;
+}
+
+int ThreadPlacement::worker_cpu(size_t index) const {
+    std::lock_guard<std::mutex> lk(mu_);
+    const auto& cpus = cpus_[static_cast<size_t>(ThreadRole::kWorker)];
+    if (!enabled_ || cpus.empty()) return -1;
+    return cpus[index % cpus.size()];
+}
+
+void ThreadPlacement::set_thread_name(const char* name) {
+    char buf[16];
+    std::strncpy(buf, name, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    pthread_setname_np(pthread_self(), buf);
+}
+
+bool ThreadPlacement::place(ThreadRole role, size_t index, const char* name) {
+    if (name) set_thread_name(name);
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        const auto& cpus = cpus_[static_cast<size_t>(role)];
+        if (!enabled_ || cpus.empty()) return false;
+        // A worker owns one CPU so its dialog table stays in that CPU's
+        // caches; the other roles may float within their list
+        if (role == ThreadRole::kWorker) CPU_SET(cpus[index % cpus.size()], &set);
+        else for (int c : cpus) CPU_SET(c, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+std::string ThreadPlacement::describe() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (!enabled_) return "disabled";
+    std::string out;
+    for (size_t i = 0; i < cpus_.size(); ++i) {
+        if (cpus_[i].empty()) continue;
+        if (!out.empty()) out += ' ';
+        out += thread_role_name(static_cast<ThreadRole>(i));
+        out += '=';
+        out += std::to_string(cpus_[i].size()) + " cpus from " + std::to_string(cpus_[i].front());
+    }
+    return out.empty() ? "no roles pinned" : out;
+}
+
+} // namespace sip_processor
@@ -3,52 +3,226 @@
 // FILE: src/dispatch/dialog_dispatcher.cpp
 // =============================================================================
 #include "dispatch/dialog_dispatcher.h"
+#include "dispatch/overload_controller.h"
 #include "sip/sip_dialog_id.h"
+#include "common/latency_histogram.h"
+#include "common/metrics_registry.h"
 #include "common/logger.h"
-#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
 
 namespace sip_processor {
 
+// Below this spread in owned dialogs a rebalance is not worth the handoffs
+static constexpr int64_t kMinRebalanceGap = 16;
+
+static size_t worker_count(const Config& config) {
+    return config.num_workers > 0 ? config.num_workers : 8;
+}
+
+static size_t slot_count(const Config& config) {
+    return std::max(worker_count(config), config.dispatcher_max_workers);
+}
+
 DialogDispatcher::DialogDispatcher(const Config& config,
                                      std::shared_ptr<SlowEventLogger> slow_logger,
                                      std::shared_ptr<SubscriptionStore> sub_store,
                                      SipStackManager* stack_mgr)
-    : config_(config) {
-    size_t n = config_.num_workers > 0 ? config_.num_workers : 8;
-    workers_.reserve(n);
-    for (size_t i = 0; i < n; ++i)
-        workers_.push_back(std::make_unique<DialogWorker>(i, config_, slow_logger, sub_store, stack_mgr));
+    : config_(config), slow_logger_(std::move(slow_logger)), sub_store_(std::move(sub_store))
+    , stack_mgr_(stack_mgr), routing_(slot_count(config)), workers_(slot_count(config)) {
+    size_t n = worker_count(config_);
+    for (size_t i = 0; i < n; ++i) create_worker(i);
+    ring_ = std::make_shared<const HashRing>(n, config_.dispatcher_ring_vnodes);
+    active_.store(n);
+    live_.store(n);
+
+    auto& m = MetricsRegistry::instance();
+    m.add_collector(this, "sip_processor_dispatcher_imbalance_ratio", MetricType::kGauge,
+        "Busiest worker's dialogs over the per-worker mean",
+        [this](MetricsWriter& w, const char* name) { w.sample(name, "", {}, balance().imbalance()); });
+    m.add_collector(this, "sip_processor_dispatcher_workers", MetricType::kGauge,
+        "Workers on the hash ring and draining after a shrink",
+        [this](MetricsWriter& w, const char* name) {
+            size_t active = active_workers(), live = num_workers();
+            w.sample(name, "", "state=\"active\"", static_cast<uint64_t>(active));
+            w.sample(name, "", "state=\"draining\"", static_cast<uint64_t>(live > active ? live - active : 0));
+        });
+    m.add_counter(this, "sip_processor_dispatcher_events_unroutable",
+        "Events dropped because their dialog has no owner", events_unroutable_);
+}
+
+DialogDispatcher::~DialogDispatcher() {
+    stop();
+    MetricsRegistry::instance().unregister(this);
 }
 
-DialogDispatcher::~DialogDispatcher() { stop(); }
+void DialogDispatcher::create_worker(size_t idx) {
+    workers_[idx] = std::make_unique<DialogWorker>(idx, config_, slow_logger_, sub_store_, stack_mgr_, this);
+    std::string labels;
+    MetricsWriter::add_label(labels, "worker", std::to_string(idx));
+    MetricsRegistry::instance().add_gauge(this, "sip_processor_worker_dialogs_owned",
+        "Dialogs routed to the worker", routing_.owned_ref(static_cast<uint32_t>(idx)), std::move(labels));
+}
 
 Result DialogDispatcher::start() {
     if (started_) return Result::kAlreadyExists;
-    for (auto& w : workers_) { auto r = w->start(); if (r != Result::kOk) { stop(); return r; } }
+    for (size_t i = 0; i < num_workers(); ++i) {
+        auto r = workers_[i]->start();
+        if (r != Result::kOk) { started_ = true; stop(); return r; }
+    }
     started_ = true; return Result::kOk;
 }
 
 void DialogDispatcher::stop() {
     if (!started_) return;
-    for (auto& w : workers_) w->stop();
+    std::lock_guard<std::mutex> lk(resize_mu_);
+    for (size_t i = 0; i < num_workers(); ++i) workers_[i]->stop();
     started_ = false;
 }
 
-size_t DialogDispatcher::worker_index_for(const std::string& did) const {
-    return std::hash<std::string>{}(did) % workers_.size();
+// Queued events count as much as owned dialogs: a worker with a backlog is
+// busy now, one with many dialogs will be busy later
+int64_t DialogDispatcher::load_of(size_t idx) const {
+    return routing_.owned(static_cast<uint32_t>(idx)) +
+           static_cast<int64_t>(workers_[idx]->stats().queue_depth.load(std::memory_order_relaxed));
+}
+
+size_t DialogDispatcher::least_loaded_worker() const {
+    size_t best = 0;
+    int64_t best_load = INT64_MAX;
+    for (size_t i = 0; i < active_workers(); ++i) {
+        int64_t load = load_of(i);
+        if (load < best_load) { best = i; best_load = load; }
+    }
+    return best;
+}
+
+// Consistent hashing with bounded load: the ring home wins unless taking one
+// more dialog would put it rebalance_threshold_pct above the mean
+size_t DialogDispatcher::choose_worker(const std::string& did) const {
+    auto r = ring();
+    size_t n = std::min(r->num_workers(), active_workers());
+    if (n == 0) return 0;
+    size_t home = r->owner(did);
+    if (home >= n) return least_loaded_worker();
+
+    int64_t total = 0;
+    for (size_t i = 0; i < n; ++i) total += load_of(i);
+    double cap = (static_cast<double>(total + 1) / n) *
+                 (1.0 + config_.dispatcher_rebalance_threshold_pct / 100.0);
+    return load_of(home) + 1 <= static_cast<int64_t>(std::ceil(cap)) ? home : least_loaded_worker();
+}
+
+size_t DialogDispatcher::place(const std::string& did) {
+    return routing_.find_or_place(did, [&] { return choose_worker(did); });
 }
 
 Result DialogDispatcher::dispatch(std::unique_ptr<SipEvent> event) {
     if (!started_) return Result::kShuttingDown;
     if (!event || !DialogIdBuilder::is_valid(event->dialog_id)) return Result::kInvalidArgument;
     event->enqueued_at = Clock::now();
-    return workers_[worker_index_for(event->dialog_id)]->enqueue(std::move(event));
+    bool from_stack = event->source == SipEventSource::kSipStack;
+    if (from_stack) {
+        LatencyRecorder::instance().record(LatencyStage::kSipCallbackToDispatch,
+                                           event->created_at, event->enqueued_at);
+    }
+
+    // Under overload a share of new SUBSCRIBEs is refused before placement;
+    // refreshes find their dialog and always pass
+    if (from_stack && overload_ && overload_->level() >= OverloadLevel::kShedding &&
+        event->category == SipEventCategory::kSubscribe && event->direction == SipDirection::kIncoming &&
+        routing_.find(event->dialog_id) == DialogRoutingTable::kNoWorker &&
+        !overload_->admit_new_subscription()) {
+        return Result::kOverloaded;
+    }
+
+    // Only the SIP stack creates dialogs; a feed event for an unknown dialog
+    // must not leave a routing entry behind.  The owner stays pinned until the
+    // event is queued, so a handoff cannot land between lookup and enqueue
+    // and overtake it with the dialog's next event.
+    DialogRoutingTable::Guard pin(routing_, event->dialog_id);
+    bool placed = false;
+    uint32_t owner = from_stack
+        ? pin.find_or_place(event->dialog_id, [&] { placed = true; return choose_worker(event->dialog_id); })
+        : pin.find(event->dialog_id);
+    if (owner == DialogRoutingTable::kNoWorker) {
+        events_unroutable_.fetch_add(1, std::memory_order_relaxed);
+        return Result::kNotFound;
+    }
+
+    std::string did = placed ? event->dialog_id : std::string();
+    Result r = workers_[owner]->enqueue(std::move(event));
+    // The worker binds the dialog again if an earlier event did get through
+    if (r != Result::kOk && placed) pin.release(did, owner);
+    return r;
+}
+
+Result DialogDispatcher::forward(std::unique_ptr<SipEvent> event) {
+    if (!started_) return Result::kShuttingDown;
+    DialogRoutingTable::Guard pin(routing_, event->dialog_id);
+    uint32_t owner = pin.find(event->dialog_id);
+    if (owner == DialogRoutingTable::kNoWorker) return Result::kNotFound;
+    return workers_[owner]->enqueue(std::move(event));
+}
+
+size_t DialogDispatcher::dispatch_batch(std::vector<std::unique_ptr<SipEvent>> events) {
+    if (!started_) return 0;
+    std::vector<const std::string*> dialog_ids;
+    dialog_ids.reserve(events.size());
+    for (auto& ev : events) {
+        if (ev && DialogIdBuilder::is_valid(ev->dialog_id)) dialog_ids.push_back(&ev->dialog_id);
+    }
+    // As in dispatch(), owners stay pinned until every group is queued
+    DialogRoutingTable::Guard pin(routing_, dialog_ids);
+
+    // Dialogs this batch placed, with how many of their events it carries;
+    // a placement none of whose events is queued is rolled back
+    std::unordered_map<std::string, size_t> placed;
+    std::vector<std::vector<std::unique_ptr<SipEvent>>> per_worker(num_workers());
+    TimePoint now = Clock::now();
+    uint64_t unroutable = 0;
+    for (auto& ev : events) {
+        if (!ev || !DialogIdBuilder::is_valid(ev->dialog_id)) { ++unroutable; continue; }
+        uint32_t owner;
+        if (ev->source == SipEventSource::kSipStack) {
+            bool fresh = false;
+            owner = pin.find_or_place(ev->dialog_id, [&] { fresh = true; return choose_worker(ev->dialog_id); });
+            if (fresh) placed.emplace(ev->dialog_id, 1);
+            else if (!placed.empty()) {
+                auto pit = placed.find(ev->dialog_id);
+                if (pit != placed.end()) ++pit->second;
+            }
+        } else {
+            owner = pin.find(ev->dialog_id);
+        }
+        if (owner >= per_worker.size()) { ++unroutable; continue; }
+        ev->enqueued_at = now;
+        per_worker[owner].push_back(std::move(ev));
+    }
+    size_t accepted = 0;
+    for (size_t i = 0; i < per_worker.size(); ++i) {
+        if (per_worker[i].empty()) continue;
+        accepted += workers_[i]->enqueue_batch(per_worker[i]);
+        if (placed.empty()) continue;
+        for (const auto& ev : per_worker[i]) {
+            if (!ev) continue;   // Queued
+            auto pit = placed.find(ev->dialog_id);
+            if (pit != placed.end() && --pit->second == 0) pin.release(ev->dialog_id, static_cast<uint32_t>(i));
+        }
+    }
+    if (unroutable > 0) {
+        events_unroutable_.fetch_add(unroutable, std::memory_order_relaxed);
+        LOG_DEBUG("Dispatcher: %lu of %zu batched events had no owner", static_cast<unsigned long>(unroutable), events.size());
+    }
+    return accepted;
 }
 
 DialogDispatcher::AggregateStats DialogDispatcher::aggregate_stats() const {
     AggregateStats a{};
-    for (const auto& w : workers_) {
-        const auto& s = w->stats();
+    for (size_t i = 0; i < num_workers(); ++i) {
+        const auto& s = workers_[i]->stats();
         a.total_events_received += s.events_received.load();
         a.total_events_processed += s.events_processed.load();
         a.total_events_dropped += s.events_dropped.load();
@@ -56,11 +230,129 @@ DialogDispatcher::AggregateStats DialogDispatcher::aggregate_stats() const {
         a.total_dialogs_active += s.dialogs_active.load();
         a.total_dialogs_reaped += s.dialogs_reaped.load();
         a.total_slow_events += s.slow_events.load();
+        a.recovery_notify_owed += s.recovery_notify_owed.load();
+        a.recovery_notify_queued += s.recovery_notify_queued.load();
+        a.recovery_notify_sent += s.recovery_notify_sent.load();
         uint64_t qd = s.queue_depth.load();
         if (qd > a.max_queue_depth) a.max_queue_depth = qd;
     }
+    a.total_events_unroutable = events_unroutable_.load(std::memory_order_relaxed);
     return a;
 }
 
+DialogDispatcher::Balance DialogDispatcher::balance() const {
+    Balance b;
+    size_t n = active_workers();
+    if (n == 0) return b;
+    int64_t dialogs = 0;
+    uint64_t queued = 0;
+    b.dialogs_min = INT64_MAX;
+    for (size_t i = 0; i < n; ++i) {
+        int64_t owned = routing_.owned(static_cast<uint32_t>(i));
+        uint64_t qd = workers_[i]->stats().queue_depth.load(std::memory_order_relaxed);
+        dialogs += owned;
+        queued += qd;
+        if (owned > b.dialogs_max || i == 0) { b.dialogs_max = owned; b.busiest = i; }
+        if (owned < b.dialogs_min) { b.dialogs_min = owned; b.idlest = i; }
+        if (qd > b.queue_depth_max) b.queue_depth_max = qd;
+    }
+    b.dialogs_mean = static_cast<double>(dialogs) / n;
+    b.queue_depth_mean = static_cast<double>(queued) / n;
+    return b;
+}
+
+size_t DialogDispatcher::rebalance() {
+    std::lock_guard<std::mutex> lk(resize_mu_);
+    if (!started_ || active_workers() < 2) return 0;
+    Balance b = balance();
+    int64_t gap = b.dialogs_max - b.dialogs_min;
+    double limit = b.dialogs_mean * (1.0 + config_.dispatcher_rebalance_threshold_pct / 100.0);
+    if (gap < kMinRebalanceGap || b.dialogs_max <= limit) return 0;
+
+    size_t moves = std::min(static_cast<size_t>(gap / 2), config_.dispatcher_rebalance_max_moves);
+    LOG_INFO("Dispatcher: rebalancing %zu dialogs from worker %zu (%ld) to worker %zu (%ld)",
+             moves, b.busiest, static_cast<long>(b.dialogs_max), b.idlest, static_cast<long>(b.dialogs_min));
+    workers_[b.busiest]->migrate_to(*workers_[b.idlest], moves);
+    return moves;
+}
+
+Result DialogDispatcher::resize(size_t n) {
+    std::lock_guard<std::mutex> lk(resize_mu_);
+    if (!started_) return Result::kShuttingDown;
+    if (n == 0 || n > workers_.size()) return Result::kInvalidArgument;
+    size_t old_active = active_workers(), live = num_workers();
+    if (n == old_active) return Result::kOk;
+
+    auto next = std::make_shared<const HashRing>(n, config_.dispatcher_ring_vnodes);
+    // Handoffs still queued for the previous ring stop moving dialogs
+    uint64_t gen = resize_generation_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    auto rehome = [this, next, gen](const std::string& did) {
+        return resize_current(gen) ? next->owner(did) : DialogRoutingTable::kNoWorker;
+    };
+    if (n > old_active) {
+        // Workers still draining from an earlier shrink rejoin as they are
+        for (size_t i = live; i < n; ++i) {
+            if (!workers_[i]) create_worker(i);
+            if (workers_[i]->start() != Result::kOk) return Result::kError;
+            live_.store(i + 1, std::memory_order_release);
+        }
+        std::atomic_store(&ring_, std::shared_ptr<const HashRing>(next));
+        active_.store(n, std::memory_order_release);
+
+        // Consistent hashing moves keys only onto the new workers, so only
+        // those dialogs are handed off
+        auto target = [this, next, gen, old_active](const std::string& did) {
+            if (!resize_current(gen)) return DialogRoutingTable::kNoWorker;
+            uint32_t home = next->owner(did);
+            return home >= old_active ? home : DialogRoutingTable::kNoWorker;
+        };
+        for (size_t i = 0; i < old_active; ++i) workers_[i]->migrate_where(target, SIZE_MAX);
+        // Rejoining or still draining workers keep only what the new ring
+        // gives them
+        for (size_t i = old_active; i < live; ++i) workers_[i]->migrate_where(rehome, SIZE_MAX);
+    } else {
+        std::atomic_store(&ring_, std::shared_ptr<const HashRing>(next));
+        active_.store(n, std::memory_order_release);
+        for (size_t i = n; i < live; ++i) workers_[i]->migrate_where(rehome, SIZE_MAX);
+    }
+
+    LOG_INFO("Dispatcher: resized from %zu to %zu workers (%zu running)",
+             old_active, n, num_workers());
+    return Result::kOk;
+}
+
+void DialogDispatcher::finish_resize() {
+    std::lock_guard<std::mutex> lk(resize_mu_);
+    if (!started_) return;
+    size_t active = active_workers(), live = num_workers();
+    if (live <= active) return;
+
+    // Retire from the tail so running workers stay contiguous.  The check
+    // runs with every routing shard held: a dispatch that looked this worker
+    // up has finished queueing, so an unowned worker with an empty queue gets
+    // no further events and stop() cannot strand one with kShuttingDown.
+    while (live > active) {
+        {
+            DialogRoutingTable::Guard quiesce(routing_);
+            if (routing_.owned(static_cast<uint32_t>(live - 1)) != 0 ||
+                workers_[live - 1]->stats().queue_depth.load() != 0) break;
+            live_.store(live - 1, std::memory_order_release);
+        }
+        workers_[live - 1]->stop();
+        LOG_INFO("Dispatcher: worker %zu drained and stopped", live - 1);
+        --live;
+    }
+
+    // Dialogs that were busy on the last pass get another chance
+    auto r = ring();
+    uint64_t gen = resize_generation_.load(std::memory_order_acquire);
+    auto target = [this, r, gen](const std::string& did) {
+        return resize_current(gen) ? r->owner(did) : DialogRoutingTable::kNoWorker;
+    };
+    for (size_t i = active; i < live; ++i) {
+        if (!workers_[i]->has_pending_migrations()) workers_[i]->migrate_where(target, SIZE_MAX);
+    }
+}
+
 } // namespace sip_processor
 
@@ -0,0 +1,104 @@
+
+// =============================================================================
+// FILE: src/dispatch/dialog_routing_table.cpp
+// =============================================================================
+#include "dispatch/dialog_routing_table.h"
+
+namespace sip_processor {
+
+DialogRoutingTable::DialogRoutingTable(size_t num_workers)
+    : num_workers_(num_workers), owned_(std::make_unique<Counter[]>(num_workers)) {}
+
+uint32_t DialogRoutingTable::find_locked(const Shard& sh, const std::string& dialog_id) {
+    auto it = sh.owners.find(dialog_id);
+    return it != sh.owners.end() ? it->second : kNoWorker;
+}
+
+uint32_t DialogRoutingTable::find(const std::string& dialog_id) const {
+    auto& sh = shard_for(dialog_id);
+    std::lock_guard<std::mutex> lk(sh.mu);
+    return find_locked(sh, dialog_id);
+}
+
+void DialogRoutingTable::bind(const std::string& dialog_id, uint32_t worker) {
+    auto& sh = shard_for(dialog_id);
+    std::lock_guard<std::mutex> lk(sh.mu);
+    auto [it, inserted] = sh.owners.emplace(dialog_id, worker);
+    if (inserted) {
+        count(worker, 1);
+    } else if (it->second != worker) {
+        count(it->second, -1);
+        count(worker, 1);
+        it->second = worker;
+    }
+}
+
+void DialogRoutingTable::release_locked(Shard& sh, const std::string& dialog_id, uint32_t worker) {
+    auto it = sh.owners.find(dialog_id);
+    if (it == sh.owners.end() || it->second != worker) return;
+    sh.owners.erase(it);
+    count(worker, -1);
+}
+
+void DialogRoutingTable::release(const std::string& dialog_id, uint32_t worker) {
+    auto& sh = shard_for(dialog_id);
+    std::lock_guard<std::mutex> lk(sh.mu);
+    release_locked(sh, dialog_id, worker);
+}
+
+DialogRoutingTable::Move DialogRoutingTable::move(const std::string& dialog_id, uint32_t from, uint32_t to) {
+    auto& sh = shard_for(dialog_id);
+    std::unique_lock<std::mutex> lk(sh.mu, std::try_to_lock);
+    if (!lk.owns_lock()) return Move::kBusy;
+    auto it = sh.owners.find(dialog_id);
+    if (it == sh.owners.end() || it->second != from) return Move::kNotOwner;
+    it->second = to;
+    count(from, -1);
+    count(to, 1);
+    return Move::kMoved;
+}
+
+DialogRoutingTable::Guard::Guard(DialogRoutingTable& table) : table_(table) {
+    held_.set();
+    for (auto& sh : table_.shards_) sh.mu.lock();
+}
+
+DialogRoutingTable::Guard::Guard(DialogRoutingTable& table, const std::string& dialog_id)
+    : table_(table) {
+    size_t i = shard_index(dialog_id);
+    table_.shards_[i].mu.lock();
+    held_.set(i);
+}
+
+DialogRoutingTable::Guard::Guard(DialogRoutingTable& table, const std::vector<const std::string*>& dialog_ids)
+    : table_(table) {
+    for (const auto* did : dialog_ids) held_.set(shard_index(*did));
+    for (size_t i = 0; i < kNumShards; ++i) {
+        if (held_.test(i)) table_.shards_[i].mu.lock();
+    }
+}
+
+DialogRoutingTable::Guard::~Guard() {
+    for (size_t i = kNumShards; i-- > 0;) {
+        if (held_.test(i)) table_.shards_[i].mu.unlock();
+    }
+}
+
+uint32_t DialogRoutingTable::Guard::find(const std::string& dialog_id) const {
+    return find_locked(table_.shard_for(dialog_id), dialog_id);
+}
+
+void DialogRoutingTable::Guard::release(const std::string& dialog_id, uint32_t worker) {
+    table_.release_locked(table_.shard_for(dialog_id), dialog_id, worker);
+}
+
+size_t DialogRoutingTable::size() const {
+    size_t n = 0;
+    for (const auto& sh : shards_) {
+        std::lock_guard<std::mutex> lk(sh.mu);
+        n += sh.owners.size();
+    }
+    return n;
+}
+
+} // namespace sip_processor
@@ -3,105 +3,337 @@
 // FILE: src/dispatch/dialog_worker.cpp
 // =============================================================================
 #include "dispatch/dialog_worker.h"
+#include "dispatch/dialog_dispatcher.h"
+#include "dispatch/overload_controller.h"
 #include "subscription/blf_processor.h"
 #include "subscription/mwi_processor.h"
+#include "subscription/mwi_subscription_index.h"
 #include "subscription/blf_subscription_index.h"
 #include "subscription/subscription_type.h"
 #include "persistence/subscription_store.h"
 #include "sip/sip_stack_manager.h"
+#include "common/latency_histogram.h"
+#include "common/metrics_registry.h"
 #include "common/slow_event_logger.h"
+#include "common/thread_affinity.h"
 #include "common/logger.h"
+#include <algorithm>
 
 namespace sip_processor {
 
+// Slow-event operation names, indexed [SipEventCategory][SubscriptionType],
+// so timing an event never builds a string
+static constexpr const char* kEventOpNames[][3] = {
+    {"SUBSCRIBE Unknown",        "SUBSCRIBE BLF",        "SUBSCRIBE MWI"},
+    {"NOTIFY Unknown",           "NOTIFY BLF",           "NOTIFY MWI"},
+    {"PUBLISH Unknown",          "PUBLISH BLF",          "PUBLISH MWI"},
+    {"PRESENCE_TRIGGER Unknown", "PRESENCE_TRIGGER BLF", "PRESENCE_TRIGGER MWI"},
+    {"UNKNOWN Unknown",          "UNKNOWN BLF",          "UNKNOWN MWI"},
+};
+
+static const char* event_op_name(SipEventCategory category, SubscriptionType type) {
+    size_t c = static_cast<size_t>(category), t = static_cast<size_t>(type);
+    constexpr size_t kCategories = sizeof(kEventOpNames) / sizeof(kEventOpNames[0]);
+    if (c >= kCategories || t >= 3) return "INVALID";
+    return kEventOpNames[c][t];
+}
+
+static const MetricField<WorkerStats> kWorkerMetrics[] = {
+    {"sip_processor_worker_events_received", MetricType::kCounter, "Events accepted into the worker queue", &WorkerStats::events_received},
+    {"sip_processor_worker_events_processed", MetricType::kCounter, "Events processed by the worker", &WorkerStats::events_processed},
+    {"sip_processor_worker_events_dropped", MetricType::kCounter, "Events rejected because the worker queue was full", &WorkerStats::events_dropped},
+    {"sip_processor_worker_presence_triggers", MetricType::kCounter, "Presence triggers processed", &WorkerStats::presence_triggers_processed},
+    {"sip_processor_worker_mwi_triggers", MetricType::kCounter, "MWI feed updates processed", &WorkerStats::mwi_triggers_processed},
+    {"sip_processor_worker_dialogs_active", MetricType::kGauge, "Dialogs owned by the worker", &WorkerStats::dialogs_active},
+    {"sip_processor_worker_dialogs_reaped", MetricType::kCounter, "Dialogs removed by the stale reaper", &WorkerStats::dialogs_reaped},
+    {"sip_processor_worker_queue_depth", MetricType::kGauge, "Events waiting in the worker queue", &WorkerStats::queue_depth},
+    {"sip_processor_worker_transaction_queue_depth", MetricType::kGauge, "SIP transactions waiting in the worker queue", &WorkerStats::transaction_queue_depth},
+    {"sip_processor_worker_feed_queue_depth", MetricType::kGauge, "Presence and MWI feed events waiting in the worker queue", &WorkerStats::feed_queue_depth},
+    {"sip_processor_worker_feed_throttled_cycles", MetricType::kCounter, "Cycles that took only the guard batch of feed events", &WorkerStats::feed_throttled_cycles},
+    {"sip_processor_worker_slow_events", MetricType::kCounter, "Events above the slow-event warn threshold", &WorkerStats::slow_events},
+    {"sip_processor_worker_notify_sent", MetricType::kCounter, "NOTIFY requests sent", &WorkerStats::notify_sent},
+    {"sip_processor_worker_notify_errors", MetricType::kCounter, "NOTIFY requests that failed", &WorkerStats::notify_errors},
+    {"sip_processor_worker_subscribe_responses", MetricType::kCounter, "SUBSCRIBE responses sent", &WorkerStats::subscribe_responses_sent},
+    {"sip_processor_worker_reconciled_applied", MetricType::kCounter, "MongoDB records applied during reconcile", &WorkerStats::reconciled_applied},
+    {"sip_processor_worker_reconciled_skipped", MetricType::kCounter, "MongoDB records skipped during reconcile", &WorkerStats::reconciled_skipped},
+    {"sip_processor_worker_migrations_in", MetricType::kCounter, "Dialogs handed to the worker by rebalancing", &WorkerStats::migrations_in},
+    {"sip_processor_worker_migrations_out", MetricType::kCounter, "Dialogs handed off by rebalancing", &WorkerStats::migrations_out},
+    {"sip_processor_worker_presence_coalesced", MetricType::kCounter, "Queued presence triggers replaced by a newer one under overload", &WorkerStats::presence_coalesced},
+    {"sip_processor_worker_subscribes_too_brief", MetricType::kCounter, "SUBSCRIBEs answered 423 Interval Too Brief", &WorkerStats::subscribes_too_brief},
+    {"sip_processor_worker_refresh_fast_path", MetricType::kCounter, "Re-SUBSCRIBEs answered on the refresh fast path", &WorkerStats::refresh_fast_path},
+    {"sip_processor_worker_refresh_checkpoints", MetricType::kCounter, "Refreshes that rewrote the stored expiry", &WorkerStats::refresh_checkpoints},
+    {"sip_processor_worker_replicated_applied", MetricType::kCounter, "Replicated records applied on the standby", &WorkerStats::replicated_applied},
+    {"sip_processor_worker_replicated_removed", MetricType::kCounter, "Replicas removed by a primary delete or resync", &WorkerStats::replicated_removed},
+    {"sip_processor_worker_replicated_skipped", MetricType::kCounter, "Replicated records skipped for a dialog live here", &WorkerStats::replicated_skipped},
+    {"sip_processor_worker_recovery_notify_owed", MetricType::kGauge, "Recovered dialogs still owed a full-state NOTIFY", &WorkerStats::recovery_notify_owed},
+    {"sip_processor_worker_recovery_notify_queued", MetricType::kGauge, "Re-attached recovered dialogs waiting for their paced NOTIFY", &WorkerStats::recovery_notify_queued},
+    {"sip_processor_worker_recovery_notify_sent", MetricType::kCounter, "Paced full-state NOTIFYs sent to recovered dialogs", &WorkerStats::recovery_notify_sent},
+    {"sip_processor_worker_recovery_notify_superseded", MetricType::kCounter, "Paced NOTIFYs dropped because a live NOTIFY carried full state first", &WorkerStats::recovery_notify_superseded},
+    {"sip_processor_worker_recovery_notify_rate", MetricType::kGauge, "Current pace of recovery NOTIFYs per second (0 = unpaced)", &WorkerStats::recovery_notify_rate},
+    {"sip_processor_worker_events_forwarded", MetricType::kCounter, "Events re-routed after their dialog was handed off", &WorkerStats::events_forwarded},
+};
+
 DialogWorker::DialogWorker(size_t idx, const Config& config,
                              std::shared_ptr<SlowEventLogger> slow_logger,
                              std::shared_ptr<SubscriptionStore> sub_store,
-                             SipStackManager* stack_mgr)
+                             SipStackManager* stack_mgr,
+                             DialogDispatcher* dispatcher)
     : worker_index_(idx), config_(config)
     , slow_logger_(std::move(slow_logger)), sub_store_(std::move(sub_store))
-    , stack_mgr_(stack_mgr)
+    , stack_mgr_(stack_mgr), dispatcher_(dispatcher)
+    , routing_(dispatcher ? &dispatcher->routing() : nullptr)
     , blf_processor_(std::make_unique<BlfProcessor>())
     , mwi_processor_(std::make_unique<MwiProcessor>())
-{}
+    , expires_policy_(config)
+{
+    std::string labels;
+    MetricsWriter::add_label(labels, "worker", std::to_string(worker_index_));
+    MetricsRegistry::instance().add_fields(this, stats_, kWorkerMetrics, labels);
+}
 
-DialogWorker::~DialogWorker() { stop(); }
+DialogWorker::~DialogWorker() {
+    stop();
+    MetricsRegistry::instance().unregister(this);
+}
 
 Result DialogWorker::start() {
     if (running_.load()) return Result::kAlreadyExists;
     stop_requested_.store(false); running_.store(true);
+    { std::lock_guard<std::mutex> lk(migrate_mu_); accepting_migrations_ = true; }
+    pace_owed_notifies();
     thread_ = std::thread(&DialogWorker::run, this);
     return Result::kOk;
 }
 
 void DialogWorker::stop() {
     if (!running_.load()) return;
+    { std::lock_guard<std::mutex> lk(migrate_mu_); accepting_migrations_ = false; }
     { std::lock_guard<std::mutex> lk(incoming_mu_); stop_requested_.store(true); }
     incoming_cv_.notify_one();
     if (thread_.joinable()) thread_.join();
     running_.store(false);
     for (auto& [id, ctx] : dialogs_) {
-        if (ctx.record.type == SubscriptionType::kBLF)
-            deindex_blf_subscription(id, ctx.record);
+        deindex_subscription(id, ctx.record);
         release_nua_handle(ctx);
     }
     dialogs_.clear();
+    recovery_notify_ = RecoveryNotifyScheduler{};
+    stats_.recovery_notify_owed.store(0);
+    stats_.recovery_notify_queued.store(0);
+    stats_.recovery_notify_rate.store(0);
+    std::lock_guard<std::mutex> lk(migrate_mu_);
+    for (auto& ctx : migrated_in_) {
+        deindex_subscription(ctx.record.dialog_id, ctx.record);
+        release_nua_handle(ctx);
+    }
+    migrated_in_.clear();
+    pending_migrations_.clear();
 }
 
 Result DialogWorker::enqueue(std::unique_ptr<SipEvent> event) {
     if (stop_requested_.load()) return Result::kShuttingDown;
     {
         std::lock_guard<std::mutex> lk(incoming_mu_);
-        if (incoming_queue_.size() >= config_.max_incoming_queue_per_worker) {
+        auto& lane = lanes_[lane_of(*event)];
+        if (lane.size() >= config_.max_incoming_queue_per_worker) {
             stats_.events_dropped.fetch_add(1); return Result::kCapacityExceeded;
         }
-        incoming_queue_.push(std::move(event));
+        lane.push(std::move(event));
         stats_.events_received.fetch_add(1);
-        stats_.queue_depth.store(incoming_queue_.size());
+        publish_queue_depth_locked();
     }
     incoming_cv_.notify_one();
     return Result::kOk;
 }
 
+size_t DialogWorker::enqueue_batch(std::vector<std::unique_ptr<SipEvent>>& events) {
+    if (stop_requested_.load()) return 0;
+    size_t taken = 0;
+    {
+        std::lock_guard<std::mutex> lk(incoming_mu_);
+        for (auto& ev : events) {
+            auto& lane = lanes_[lane_of(*ev)];
+            if (lane.size() >= config_.max_incoming_queue_per_worker) continue;
+            lane.push(std::move(ev));
+            ++taken;
+        }
+        stats_.events_received.fetch_add(taken);
+        publish_queue_depth_locked();
+    }
+    if (taken < events.size()) stats_.events_dropped.fetch_add(events.size() - taken);
+    if (taken > 0) incoming_cv_.notify_one();
+    return taken;
+}
+
+void DialogWorker::publish_queue_depth_locked() {
+    size_t tx = lanes_[kTransactionLane].size(), feed = lanes_[kFeedLane].size();
+    stats_.transaction_queue_depth.store(tx, std::memory_order_relaxed);
+    stats_.feed_queue_depth.store(feed, std::memory_order_relaxed);
+    stats_.queue_depth.store(tx + feed, std::memory_order_relaxed);
+}
+
 Result DialogWorker::load_recovered_subscription(SubscriptionRecord record) {
     // Called before start() — no locking needed
+    mark_full_state_owed(adopt_recovered(std::move(record)));
+    return Result::kOk;
+}
+
+DialogWorker::DialogContext& DialogWorker::adopt_recovered(SubscriptionRecord record) {
     DialogContext ctx;
     ctx.record = std::move(record);
     // Note: nua_handle is null for recovered subscriptions (no active Sofia dialog)
+    // The stored expiry is current; the first refresh need not rewrite it
+    ctx.record.persisted_expires_at = ctx.record.expires_at;
 
-    // Index BLF subscriptions
-    if (ctx.record.type == SubscriptionType::kBLF && !ctx.record.blf_monitored_uri.empty()) {
-        BlfSubscriptionIndex::instance().add(
-            ctx.record.blf_monitored_uri, ctx.record.dialog_id, ctx.record.tenant_id);
-    }
+    index_subscription(ctx.record.dialog_id, ctx.record);
+    register_in_registry(ctx.record);
+    if (routing_) routing_->bind(ctx.record.dialog_id, static_cast<uint32_t>(worker_index_));
 
-    SubscriptionRegistry::SubscriptionInfo info{
-        ctx.record.dialog_id, ctx.record.tenant_id, ctx.record.type,
-        ctx.record.lifecycle, ctx.record.last_activity, worker_index_};
-    SubscriptionRegistry::instance().register_subscription(ctx.record.dialog_id, info);
+    LOG_DEBUG("Worker %zu: recovered subscription %s (%s)",
+              worker_index_, ctx.record.dialog_id.c_str(),
+              subscription_type_to_string(ctx.record.type));
 
-    dialogs_.emplace(ctx.record.dialog_id, std::move(ctx));
+    std::string did = ctx.record.dialog_id;
+    auto& adopted = dialogs_.emplace(std::move(did), std::move(ctx)).first->second;
     stats_.dialogs_active.store(dialogs_.size());
+    return adopted;
+}
 
-    LOG_DEBUG("Worker %zu: recovered subscription %s (%s)",
-              worker_index_, record.dialog_id.c_str(),
-              subscription_type_to_string(record.type));
+Result DialogWorker::reconcile_subscriptions(std::vector<SubscriptionRecord> records) {
+    if (stop_requested_.load()) return Result::kShuttingDown;
+    {
+        std::lock_guard<std::mutex> lk(reconcile_mu_);
+        if (pending_reconciles_.empty()) {
+            pending_reconciles_ = std::move(records);
+        } else {
+            std::move(records.begin(), records.end(), std::back_inserter(pending_reconciles_));
+        }
+    }
+    incoming_cv_.notify_one();
+    return Result::kOk;
+}
+
+void DialogWorker::apply_reconciled(SubscriptionRecord record) {
+    auto it = dialogs_.find(record.dialog_id);
+    if (it == dialogs_.end()) {
+        if (record.is_expired() || record.lifecycle == SubLifecycle::kTerminated) {
+            // Recovery placed it here before knowing it would be skipped
+            if (routing_) routing_->release(record.dialog_id, static_cast<uint32_t>(worker_index_));
+            return;
+        }
+        mark_full_state_owed(adopt_recovered(std::move(record)));
+        stats_.reconciled_applied.fetch_add(1);
+        return;
+    }
+
+    auto& ctx = it->second;
+    // Local state is at least as new, or the phone has re-established the
+    // dialog since restart and the live state wins.
+    if (ctx.record.updated_at_ms >= record.updated_at_ms || ctx.nua_handle) {
+        stats_.reconciled_skipped.fetch_add(1);
+        return;
+    }
+
+    deindex_subscription(it->first, ctx.record);
+    ctx.record = std::move(record);
+    index_subscription(it->first, ctx.record);
+    register_in_registry(ctx.record);
+    stats_.reconciled_applied.fetch_add(1);
+}
+
+Result DialogWorker::apply_replicated(std::vector<ReplicatedChange> changes) {
+    if (stop_requested_.load()) return Result::kShuttingDown;
+    {
+        std::lock_guard<std::mutex> lk(reconcile_mu_);
+        if (pending_replicated_.empty()) {
+            pending_replicated_ = std::move(changes);
+        } else {
+            std::move(changes.begin(), changes.end(), std::back_inserter(pending_replicated_));
+        }
+        replicated_waiting_.store(true, std::memory_order_relaxed);
+    }
+    incoming_cv_.notify_one();
     return Result::kOk;
 }
 
-void DialogWorker::index_blf_subscription(const std::string& did, const SubscriptionRecord& rec) {
-    if (rec.type != SubscriptionType::kBLF || rec.blf_monitored_uri.empty()) return;
+void DialogWorker::apply_replicated_change(ReplicatedChange& change) {
+    if (change.kind == ReplicatedChange::kSyncEnd) {
+        for (auto it = dialogs_.begin(); it != dialogs_.end();) {
+            auto next = std::next(it);
+            if (!it->second.nua_handle && it->second.replica_generation != change.generation) drop_replica(it);
+            it = next;
+        }
+        return;
+    }
+
+    auto& record = change.record;
+    auto it = dialogs_.find(record.dialog_id);
+    if (it != dialogs_.end() && it->second.nua_handle) {
+        stats_.replicated_skipped.fetch_add(1);
+        return;
+    }
+    if (change.kind == ReplicatedChange::kErase || record.is_expired() ||
+        record.lifecycle == SubLifecycle::kTerminated) {
+        if (it != dialogs_.end()) drop_replica(it);
+        else if (routing_) routing_->release(record.dialog_id, static_cast<uint32_t>(worker_index_));
+        return;
+    }
+
+    if (it == dialogs_.end()) {
+        // Owed like a recovered dialog, for when this node takes over
+        auto& ctx = adopt_recovered(std::move(record));
+        ctx.replica_generation = change.generation;
+        mark_full_state_owed(ctx);
+    } else {
+        auto& ctx = it->second;
+        deindex_subscription(it->first, ctx.record);
+        ctx.record = std::move(record);
+        ctx.replica_generation = change.generation;
+        index_subscription(it->first, ctx.record);
+        register_in_registry(ctx.record);
+    }
+    stats_.replicated_applied.fetch_add(1);
+}
+
+void DialogWorker::drop_replica(DialogMap::iterator it) {
+    settle_full_state(it->second);
+    deindex_subscription(it->first, it->second.record);
+    SubscriptionRegistry::instance().unregister_subscription(it->first);
+    if (routing_) routing_->release(it->first, static_cast<uint32_t>(worker_index_));
+    dialogs_.erase(it);
+    stats_.dialogs_active.store(dialogs_.size());
+    stats_.replicated_removed.fetch_add(1);
+}
+
+void DialogWorker::index_subscription(const std::string& did, const SubscriptionRecord& rec) {
     if (rec.lifecycle != SubLifecycle::kActive) return;
-    BlfSubscriptionIndex::instance().add(rec.blf_monitored_uri, did, rec.tenant_id);
+    if (rec.type == SubscriptionType::kBLF && !rec.blf_monitored_uri.empty()) {
+        BlfSubscriptionIndex::instance().add(rec.blf_monitored_uri, did, rec.tenant_id);
+    } else if (rec.type == SubscriptionType::kMWI && !rec.mwi_account_uri.empty()) {
+        MwiSubscriptionIndex::instance().add(rec.mwi_account_uri, did, rec.tenant_id);
+    }
 }
 
-void DialogWorker::deindex_blf_subscription(const std::string& did, const SubscriptionRecord& rec) {
-    if (rec.type != SubscriptionType::kBLF) return;
-    BlfSubscriptionIndex::instance().remove_dialog(did);
+void DialogWorker::register_in_registry(const SubscriptionRecord& rec) {
+    // Only admitted dialogs are registered; an MWI account shares the
+    // normalized Symbol the mailbox index interns rather than adding another
+    SubscriptionRegistry::SubscriptionInfo info{
+        rec.dialog_id, rec.tenant_id, rec.type, rec.lifecycle, rec.last_activity, worker_index_,
+        rec.type == SubscriptionType::kMWI ? Symbol(BlfSubscriptionIndex::normalize_uri(rec.mwi_account_uri))
+                                           : rec.blf_monitored_uri};
+    SubscriptionRegistry::instance().register_subscription(rec.dialog_id, info);
 }
 
-void DialogWorker::persist_record(const SubscriptionRecord& record, bool immediate) {
-    if (!sub_store_ || !sub_store_->is_enabled()) return;
+void DialogWorker::deindex_subscription(const std::string& did, const SubscriptionRecord& rec) {
+    if (rec.type == SubscriptionType::kBLF) BlfSubscriptionIndex::instance().remove_dialog(did);
+    else if (rec.type == SubscriptionType::kMWI) MwiSubscriptionIndex::instance().remove_dialog(did);
+}
+
+void DialogWorker::persist_record(SubscriptionRecord& record, bool immediate) {
+    record.persisted_expires_at = record.expires_at;
+    // The store forwards to the local snapshot even when MongoDB is disabled
+    if (!sub_store_) return;
+    record.updated_at_ms = wall_clock_ms();
     if (immediate) sub_store_->save_immediately(record);
     else sub_store_->queue_upsert(record);
 }
@@ -112,6 +344,7 @@ void DialogWorker::persist_record(const SubscriptionRecord& record, bool immedia
 
 void DialogWorker::release_nua_handle(DialogContext& ctx) {
     if (ctx.nua_handle) {
+        if (stack_mgr_) stack_mgr_->forget_notifies(ctx.nua_handle);
         nua_handle_unref(ctx.nua_handle);
         ctx.nua_handle = nullptr;
     }
@@ -135,19 +368,19 @@ void DialogWorker::send_subscribe_response(DialogContext& ctx, const SipEvent& e
     stats_.subscribe_responses_sent.fetch_add(1);
 }
 
-void DialogWorker::send_sip_notify(DialogContext& ctx, const std::string& content_type,
+bool DialogWorker::send_sip_notify(DialogContext& ctx, const std::string& content_type,
                                     const std::string& body, const char* sub_state) {
     if (!stack_mgr_ || !ctx.nua_handle) {
         LOG_WARN("Worker %zu: cannot send NOTIFY dialog=%s (no stack/handle)",
                  worker_index_, ctx.record.dialog_id.c_str());
-        return;
+        return false;
     }
 
     const char* event_type = subscription_type_to_event_header(ctx.record.type);
     if (!event_type) {
         LOG_WARN("Worker %zu: unknown event type for NOTIFY dialog=%s",
                  worker_index_, ctx.record.dialog_id.c_str());
-        return;
+        return false;
     }
 
     // Increment outgoing NOTIFY CSeq
@@ -160,6 +393,9 @@ void DialogWorker::send_sip_notify(DialogContext& ctx, const std::string& conten
     stack_mgr_->send_notify(ctx.nua_handle, event_type,
                              content_type.c_str(), body.c_str(), sub_state);
     stats_.notify_sent.fetch_add(1);
+    // Presence and MWI bodies are full state, so any NOTIFY pays the debt
+    settle_full_state(ctx);
+    return true;
 }
 
 void DialogWorker::send_initial_notify(DialogContext& ctx) {
@@ -179,7 +415,7 @@ void DialogWorker::send_initial_notify(DialogContext& ctx) {
                    "<dialog-info xmlns=\"urn:ietf:params:xml:ns:dialog-info\"\n"
                    "  version=\"0\"\n"
                    "  state=\"full\"\n"
-                   "  entity=\"" + ctx.record.blf_monitored_uri + "\">\n"
+                   "  entity=\"" + ctx.record.blf_monitored_uri.str() + "\">\n"
                    "</dialog-info>\n";
         }
     } else if (ctx.record.type == SubscriptionType::kMWI) {
@@ -226,7 +462,7 @@ void DialogWorker::handle_notify_response(const std::string& did, DialogContext&
     }
 
     if (event.status >= 400) {
-        deindex_blf_subscription(did, rec);
+        deindex_subscription(did, rec);
         rec.lifecycle = SubLifecycle::kTerminated;
         persist_record(rec, true);
         if (sub_store_) sub_store_->queue_delete(did);
@@ -239,28 +475,57 @@ void DialogWorker::handle_notify_response(const std::string& did, DialogContext&
 // ─────────────────────────────────────────────────────────────────────────────
 
 void DialogWorker::run() {
-    std::queue<std::unique_ptr<SipEvent>> local_batch;
+    std::string name = "sip-worker-" + std::to_string(worker_index_);
+    if (ThreadPlacement::instance().place(ThreadRole::kWorker, worker_index_, name.c_str()) &&
+        dialogs_.empty()) {
+        // First touch on the pinned CPU puts the bucket array on its node
+        dialogs_.reserve(kInitialDialogReserve);
+    }
+    LatencyRecorder::instance().set_thread_worker(static_cast<int>(worker_index_));
+    std::queue<std::unique_ptr<SipEvent>> local_transactions;
+    std::vector<std::unique_ptr<SipEvent>> local_feed;
+    std::vector<DialogMap::value_type*> transaction_dialogs;
     std::vector<std::string> local_terminates;
+    std::vector<SubscriptionRecord> local_reconciles;
+    std::vector<ReplicatedChange> local_replicated;
 
     while (true) {
         {
             std::unique_lock<std::mutex> lk(incoming_mu_);
             incoming_cv_.wait_for(lk, Millisecs(100), [this] {
-                return !incoming_queue_.empty() || stop_requested_.load();
+                return !lanes_empty_locked() || stop_requested_.load() ||
+                       migrations_waiting_.load(std::memory_order_relaxed) ||
+                       replicated_waiting_.load(std::memory_order_relaxed);
             });
-            if (stop_requested_.load() && incoming_queue_.empty()) {
+            if (stop_requested_.load() && lanes_empty_locked()) {
                 process_dialog_queues(); break;
             }
-            std::swap(local_batch, incoming_queue_);
-            stats_.queue_depth.store(0);
+            // SIP transactions are taken whole.  Feed events are taken a batch
+            // at a time, so a presence burst holds a SUBSCRIBE back for at most
+            // one cycle; the guard batch keeps the feed moving while
+            // transactions keep arriving.
+            auto& tx = lanes_[kTransactionLane];
+            auto& feed = lanes_[kFeedLane];
+            size_t feed_take = tx.empty() ? config_.dispatcher_feed_batch : config_.dispatcher_feed_guard_batch;
+            if (feed_take == 0 || feed_take > feed.size()) feed_take = feed.size();
+            else if (!tx.empty()) stats_.feed_throttled_cycles.fetch_add(1, std::memory_order_relaxed);
+            std::swap(local_transactions, tx);
+            for (; feed_take > 0; --feed_take) {
+                local_feed.push_back(std::move(feed.front()));
+                feed.pop();
+            }
+            publish_queue_depth_locked();
         }
 
+        // Contexts handed over before their first event was routed here
+        adopt_migrated();
+
         // Force-terminates
         { std::lock_guard<std::mutex> lk(terminate_mu_); std::swap(local_terminates, pending_terminates_); }
         for (const auto& did : local_terminates) {
             auto it = dialogs_.find(did);
             if (it != dialogs_.end()) {
-                deindex_blf_subscription(did, it->second.record);
+                deindex_subscription(did, it->second.record);
                 it->second.record.lifecycle = SubLifecycle::kTerminated;
 
                 // Send final NOTIFY with terminated state
@@ -271,7 +536,7 @@ void DialogWorker::run() {
                                     "<dialog-info xmlns=\"urn:ietf:params:xml:ns:dialog-info\"\n"
                                     "  version=\"" + std::to_string(it->second.record.blf_notify_version) + "\"\n"
                                     "  state=\"full\"\n"
-                                    "  entity=\"" + it->second.record.blf_monitored_uri + "\">\n"
+                                    "  entity=\"" + it->second.record.blf_monitored_uri.str() + "\">\n"
                                     "</dialog-info>\n";
                         send_sip_notify(it->second, "application/dialog-info+xml",
                                         term_body, "terminated");
@@ -291,32 +556,201 @@ void DialogWorker::run() {
         }
         local_terminates.clear();
 
-        // Distribute events to per-dialog queues
-        while (!local_batch.empty()) {
-            auto& ev = local_batch.front();
-            auto it = dialogs_.find(ev->dialog_id);
-            if (it == dialogs_.end()) {
-                if (ev->source == SipEventSource::kPresenceFeed) {
-                    stats_.events_dropped.fetch_add(1); local_batch.pop(); continue;
-                }
-                handle_new_subscription(ev->dialog_id, *ev);
-                it = dialogs_.find(ev->dialog_id);
-                if (it == dialogs_.end()) { stats_.events_dropped.fetch_add(1); local_batch.pop(); continue; }
+        // Background MongoDB reconciliation after a snapshot start
+        { std::lock_guard<std::mutex> lk(reconcile_mu_); std::swap(local_reconciles, pending_reconciles_); }
+        for (auto& rec : local_reconciles) apply_reconciled(std::move(rec));
+        local_reconciles.clear();
+
+        // Hot-standby stream from the replication primary
+        {
+            std::lock_guard<std::mutex> lk(reconcile_mu_);
+            std::swap(local_replicated, pending_replicated_);
+            replicated_waiting_.store(false, std::memory_order_relaxed);
+        }
+        for (auto& change : local_replicated) apply_replicated_change(change);
+        local_replicated.clear();
+
+        // Transactions first: each one is processed, behind whatever its
+        // dialog already had queued, before any feed event is distributed
+        while (!local_transactions.empty()) {
+            if (auto* entry = route_to_dialog(std::move(local_transactions.front()))) {
+                transaction_dialogs.push_back(entry);
             }
-            it->second.event_queue.push(std::move(ev));
-            local_batch.pop();
+            local_transactions.pop();
         }
+        for (auto* entry : transaction_dialogs) serve_transaction(*entry);
+        transaction_dialogs.clear();
+
+        for (auto& ev : local_feed) route_to_dialog(std::move(ev));
+        local_feed.clear();
 
         process_dialog_queues();
+        if (owed_added_) pace_owed_notifies();
+        send_owed_notifies();
         if (++process_cycle_ % kCleanupInterval == 0) cleanup_terminated_dialogs();
+        migrate_out();
+    }
+}
+
+DialogWorker::DialogMap::value_type* DialogWorker::route_to_dialog(std::unique_ptr<SipEvent> ev) {
+    auto it = dialogs_.find(ev->dialog_id);
+    if (it == dialogs_.end()) {
+        uint32_t owner = routing_ ? routing_->find(ev->dialog_id) : DialogRoutingTable::kNoWorker;
+        if (owner != DialogRoutingTable::kNoWorker && owner != worker_index_) {
+            // Rebound elsewhere (replication, recovery) after it was queued here
+            if (dispatcher_->forward(std::move(ev)) == Result::kOk) stats_.events_forwarded.fetch_add(1);
+            else stats_.events_dropped.fetch_add(1);
+            return nullptr;
+        }
+        if (ev->source != SipEventSource::kSipStack) {   // Feed update for a gone dialog
+            stats_.events_dropped.fetch_add(1); return nullptr;
+        }
+        handle_new_subscription(ev->dialog_id, *ev);
+        it = dialogs_.find(ev->dialog_id);
+        if (it == dialogs_.end()) { stats_.events_dropped.fetch_add(1); return nullptr; }
+    }
+    auto& queue = it->second.event_queue;
+    // Under overload a presence trigger still waiting for this dialog is
+    // superseded by the newer one: BLF state is last-writer-wins
+    if (ev->category == SipEventCategory::kPresenceTrigger && !queue.empty() &&
+        queue.back()->category == SipEventCategory::kPresenceTrigger &&
+        dispatcher_ && dispatcher_->overload() && dispatcher_->overload()->coalesce_presence()) {
+        queue.back() = std::move(ev);
+        stats_.presence_coalesced.fetch_add(1, std::memory_order_relaxed);
+        return &*it;
     }
+    queue.push(std::move(ev));
+    return &*it;
 }
 
-void DialogWorker::handle_new_subscription(const std::string& did, const SipEvent& ev) {
+void DialogWorker::serve_transaction(DialogMap::value_type& entry) {
+    auto& ctx = entry.second;
+    while (!ctx.event_queue.empty()) {
+        bool transaction = lane_of(*ctx.event_queue.front()) == kTransactionLane;
+        auto event = std::move(ctx.event_queue.front());
+        ctx.event_queue.pop();
+        process_event(entry.first, ctx, std::move(event));
+        if (transaction) break;
+    }
+}
+
+void DialogWorker::migrate_to(DialogWorker& target, size_t max_dialogs) {
+    if (&target == this) return;
+    uint32_t idx = static_cast<uint32_t>(target.worker_index_);
+    migrate_where([idx](const std::string&) { return idx; }, max_dialogs);
+}
+
+void DialogWorker::migrate_where(MigrationTarget target_for, size_t max_dialogs) {
+    if (max_dialogs == 0 || !routing_ || !dispatcher_) return;
+    std::lock_guard<std::mutex> lk(migrate_mu_);
+    pending_migrations_.push_back({std::move(target_for), max_dialogs});
+}
+
+bool DialogWorker::has_pending_migrations() const {
+    std::lock_guard<std::mutex> lk(migrate_mu_);
+    return !pending_migrations_.empty();
+}
+
+void DialogWorker::migrate_out() {
+    std::vector<MigrationRequest> requests;
+    {
+        std::lock_guard<std::mutex> lk(migrate_mu_);
+        if (pending_migrations_.empty()) return;
+        std::swap(requests, pending_migrations_);
+    }
+
+    std::vector<MigrationRequest> retry;
+    std::vector<DialogWorker*> notify;
+    for (auto& req : requests) {
+        size_t moved = 0;
+        {
+            // Holding the ingress lock keeps new events out while dialogs are
+            // picked; with it empty, a dialog with an empty queue is idle.
+            std::lock_guard<std::mutex> in_lk(incoming_mu_);
+            if (!lanes_empty_locked()) { retry.push_back(std::move(req)); continue; }
+
+            bool busy = false;
+            for (auto it = dialogs_.begin(); it != dialogs_.end() && moved < req.max_dialogs;) {
+                auto& ctx = it->second;
+                bool idle = ctx.event_queue.empty() && !ctx.record.is_processing &&
+                            ctx.record.lifecycle != SubLifecycle::kTerminated && !ctx.record.is_expired();
+                uint32_t to = idle ? req.target_for(it->first) : DialogRoutingTable::kNoWorker;
+                if (to == DialogRoutingTable::kNoWorker || to == worker_index_ ||
+                    to >= dispatcher_->num_workers()) {
+                    ++it; continue;
+                }
+                DialogWorker& target = dispatcher_->worker(to);
+                std::lock_guard<std::mutex> out_lk(target.migrate_mu_);
+                if (!target.accepting_migrations_) { ++it; continue; }
+                auto mv = routing_->move(it->first, static_cast<uint32_t>(worker_index_), to);
+                if (mv != DialogRoutingTable::Move::kMoved) {
+                    // A dispatcher holding the shard is queueing to us; the
+                    // rest of the request is retried next cycle
+                    busy |= mv == DialogRoutingTable::Move::kBusy;
+                    ++it; continue;
+                }
+                if (ctx.full_state_owed) stats_.recovery_notify_owed.fetch_sub(1, std::memory_order_relaxed);
+                target.migrated_in_.push_back(std::move(ctx));
+                target.migrations_waiting_.store(true, std::memory_order_relaxed);
+                it = dialogs_.erase(it);
+                ++moved;
+                if (std::find(notify.begin(), notify.end(), &target) == notify.end()) notify.push_back(&target);
+            }
+            if (busy && moved < req.max_dialogs) retry.push_back({req.target_for, req.max_dialogs - moved});
+        }
+        if (moved == 0) continue;
+        stats_.migrations_out.fetch_add(moved);
+        stats_.dialogs_active.store(dialogs_.size());
+        LOG_DEBUG("Worker %zu: handed off %zu dialogs", worker_index_, moved);
+    }
+    for (auto* target : notify) target->incoming_cv_.notify_one();
+
+    if (!retry.empty()) {
+        std::lock_guard<std::mutex> lk(migrate_mu_);
+        std::move(retry.begin(), retry.end(), std::back_inserter(pending_migrations_));
+    }
+}
+
+void DialogWorker::adopt_migrated() {
+    std::deque<DialogContext> adopted;
+    {
+        std::lock_guard<std::mutex> lk(migrate_mu_);
+        if (migrated_in_.empty()) return;
+        std::swap(adopted, migrated_in_);
+        migrations_waiting_.store(false, std::memory_order_relaxed);
+    }
+    for (auto& ctx : adopted) {
+        register_in_registry(ctx.record);   // Registry reports the new owner
+        std::string did = ctx.record.dialog_id;
+        auto& moved = dialogs_.emplace(std::move(did), std::move(ctx)).first->second;
+        if (moved.full_state_owed) {
+            // The source's queue entry goes stale; owe and queue it here
+            moved.full_state_owed = false;
+            moved.full_state_queued = false;
+            mark_full_state_owed(moved);
+            queue_full_state(moved);
+        }
+    }
+    stats_.migrations_in.fetch_add(adopted.size());
+    stats_.dialogs_active.store(dialogs_.size());
+}
+
+void DialogWorker::handle_new_subscription(const std::string& did, SipEvent& ev) {
+    // The tenant is interned only once the dialog is admitted below; a
+    // tenant never interned has no subscriptions and no Expires override
+    TenantId tenant;
+    int64_t tenant_subs = 0;
+    if (Symbol::find(ev.tenant_id, tenant)) {
+        auto& tenant_count = tenant_counts_[tenant];
+        if (!tenant_count) tenant_count = &SubscriptionRegistry::instance().tenant_count_ref(tenant);
+        tenant_subs = tenant_count->load(std::memory_order_relaxed);
+    }
+
     // Check tenant limit
-    if (SubscriptionRegistry::instance().count_by_tenant(ev.tenant_id) >= config_.max_subscriptions_per_tenant) {
+    if (tenant_subs >= static_cast<int64_t>(config_.max_subscriptions_per_tenant)) {
         LOG_WARN("Worker %zu: tenant %s at subscription limit, rejecting dialog=%s",
                  worker_index_, ev.tenant_id.c_str(), did.c_str());
+        if (routing_) routing_->release(did, static_cast<uint32_t>(worker_index_));
         if (ev.nua_handle && stack_mgr_) {
             stack_mgr_->respond_to_subscribe(ev.nua_handle, 403, "Forbidden", 0);
             nua_handle_unref(ev.nua_handle);
@@ -327,6 +761,7 @@ void DialogWorker::handle_new_subscription(const std::string& did, const SipEven
     // Check worker capacity
     if (dialogs_.size() >= config_.max_dialogs_per_worker) {
         LOG_WARN("Worker %zu: at capacity, rejecting dialog=%s", worker_index_, did.c_str());
+        if (routing_) routing_->release(did, static_cast<uint32_t>(worker_index_));
         if (ev.nua_handle && stack_mgr_) {
             stack_mgr_->respond_to_subscribe(ev.nua_handle, 503, "Service Unavailable", 0);
             nua_handle_unref(ev.nua_handle);
@@ -338,6 +773,7 @@ void DialogWorker::handle_new_subscription(const std::string& did, const SipEven
     if (ev.sub_type == SubscriptionType::kUnknown) {
         LOG_WARN("Worker %zu: unsupported event type for dialog=%s event=%s",
                  worker_index_, did.c_str(), ev.event_header.c_str());
+        if (routing_) routing_->release(did, static_cast<uint32_t>(worker_index_));
         if (ev.nua_handle && stack_mgr_) {
             stack_mgr_->respond_to_subscribe(ev.nua_handle, 489, "Bad Event", 0);
             nua_handle_unref(ev.nua_handle);
@@ -345,9 +781,42 @@ void DialogWorker::handle_new_subscription(const std::string& did, const SipEven
         return;
     }
 
+    // In-process events set expires without the header flag
+    if (ev.is_incoming_subscribe() && !ev.is_unsubscribe()) {
+        auto d = expires_policy_.negotiate(tenant, ev.sub_type,
+                                           ev.has_expires || ev.expires > 0, ev.expires);
+        if (d.too_brief) {
+            stats_.subscribes_too_brief.fetch_add(1, std::memory_order_relaxed);
+            if (routing_) routing_->release(did, static_cast<uint32_t>(worker_index_));
+            if (ev.nua_handle && stack_mgr_) {
+                stack_mgr_->respond_interval_too_brief(ev.nua_handle, d.min_expires);
+                nua_handle_unref(ev.nua_handle);
+            }
+            return;
+        }
+        ev.expires = d.granted;
+        ev.has_expires = true;
+    }
+
+    // Admitting interns the tenant and monitored URI for good; once the
+    // interner is full, a dialog that needs new text is turned away
+    if (tenant.empty()) tenant = TenantId(ev.tenant_id);
+    Symbol monitored = ev.sub_type == SubscriptionType::kBLF ? Symbol(ev.to_uri) : Symbol();
+    if ((tenant.empty() && !ev.tenant_id.empty()) ||
+        (monitored.empty() && ev.sub_type == SubscriptionType::kBLF && !ev.to_uri.empty())) {
+        LOG_WARN("Worker %zu: string interner full (%zu symbols), rejecting dialog=%s",
+                 worker_index_, StringInterner::instance().size(), did.c_str());
+        if (routing_) routing_->release(did, static_cast<uint32_t>(worker_index_));
+        if (ev.nua_handle && stack_mgr_) {
+            stack_mgr_->respond_to_subscribe(ev.nua_handle, 503, "Service Unavailable", 0);
+            nua_handle_unref(ev.nua_handle);
+        }
+        return;
+    }
+
     DialogContext ctx;
     ctx.record.dialog_id = did;
-    ctx.record.tenant_id = ev.tenant_id;
+    ctx.record.tenant_id = tenant;
     ctx.record.type = ev.sub_type;
     ctx.record.lifecycle = SubLifecycle::kPending;
     if (ev.expires > 0) ctx.record.expires_at = Clock::now() + Seconds(ev.expires);
@@ -358,14 +827,15 @@ void DialogWorker::handle_new_subscription(const std::string& did, const SipEven
     ctx.record.call_id = ev.call_id;
     ctx.record.contact_uri = ev.contact_uri;
 
-    if (ev.sub_type == SubscriptionType::kBLF) ctx.record.blf_monitored_uri = ev.to_uri;
+    if (ev.sub_type == SubscriptionType::kBLF) ctx.record.blf_monitored_uri = monitored;
     else if (ev.sub_type == SubscriptionType::kMWI) ctx.record.mwi_account_uri = ev.to_uri;
 
     // Store Sofia handle (ref was taken by callback handler)
     ctx.nua_handle = ev.nua_handle;
+    ev.nua_handle = nullptr;
 
-    SubscriptionRegistry::SubscriptionInfo info{did, ev.tenant_id, ev.sub_type, SubLifecycle::kPending, Clock::now(), worker_index_};
-    SubscriptionRegistry::instance().register_subscription(did, info);
+    register_in_registry(ctx.record);
+    if (routing_) routing_->bind(did, static_cast<uint32_t>(worker_index_));
 
     // Persist immediately on creation
     persist_record(ctx.record, true);
@@ -387,15 +857,36 @@ void DialogWorker::process_event(const std::string& did, DialogContext& ctx,
                                    std::unique_ptr<SipEvent> event) {
     auto& rec = ctx.record;
     event->dequeued_at = Clock::now();
+    auto& latency = LatencyRecorder::instance();
+    latency.record(LatencyStage::kQueueWait, event->enqueued_at, event->dequeued_at);
+    latency.record(lane_of(*event) == kTransactionLane ? LatencyStage::kQueueWaitSip : LatencyStage::kQueueWaitFeed,
+                   event->enqueued_at, event->dequeued_at);
     rec.is_processing = true;
     rec.processing_started_at = Clock::now();
     rec.touch();
     rec.events_processed++;
 
+    if (event->is_incoming_subscribe()) {
+        take_subscribe_handle(ctx, *event);
+        queue_full_state(ctx);
+    }
+
+    // Refreshes are most of the SUBSCRIBE traffic and change nothing but the
+    // expiry, so they skip the processors and the slow-event timer
+    if (event->is_incoming_subscribe() && !event->is_unsubscribe() &&
+        rec.lifecycle == SubLifecycle::kActive) {
+        refresh_subscription(ctx, *event);
+        rec.is_processing = false;
+        latency.record(LatencyStage::kProcessEvent, event->dequeued_at, Clock::now());
+        stats_.events_processed.fetch_add(1);
+        return;
+    }
+
     // Slow event timing
-    std::string ctx_str = std::string(event_category_to_string(event->category)) +
-                          " " + subscription_type_to_string(rec.type);
-    SlowEventLogger::Timer timer(*slow_logger_, ctx_str.c_str(), did);
+    SlowEventLogger::Timer timer(*slow_logger_, event_op_name(event->category, rec.type),
+                                 did, rec.tenant_id.view());
+    timer.add_stage("to_dispatch", event->created_at, event->enqueued_at);
+    timer.add_stage("queue_wait", event->enqueued_at, event->dequeued_at);
 
     Result result = Result::kError;
     SubLifecycle prev_lifecycle = rec.lifecycle;
@@ -412,11 +903,23 @@ void DialogWorker::process_event(const std::string& did, DialogContext& ctx,
         result = Result::kOk;
         stats_.presence_triggers_processed.fetch_add(1);
     }
+    else if (event->source == SipEventSource::kMwiFeed) {
+        process_mwi_trigger(did, ctx, *event);
+        result = Result::kOk;
+        stats_.mwi_triggers_processed.fetch_add(1);
+    }
     // Handle SIP events (SUBSCRIBE, NOTIFY, PUBLISH)
     else {
         switch (rec.type) {
             case SubscriptionType::kBLF: result = blf_processor_->process(*event, rec); break;
-            case SubscriptionType::kMWI: result = mwi_processor_->process(*event, rec); break;
+            case SubscriptionType::kMWI: {
+                // NOTIFY/PUBLISH may move the dialog to another known
+                // mailbox; keep the mailbox index pointing at it
+                std::string prev_account = rec.mwi_account_uri;
+                result = mwi_processor_->process(*event, rec);
+                if (rec.mwi_account_uri != prev_account) index_subscription(did, rec);
+                break;
+            }
             case SubscriptionType::kUnknown:
                 if (event->sub_type != SubscriptionType::kUnknown) {
                     rec.type = event->sub_type;
@@ -429,8 +932,9 @@ void DialogWorker::process_event(const std::string& did, DialogContext& ctx,
     }
 
     // Lifecycle transitions
-    if (event->subscription_state == "terminated" || event->expires == 0) {
-        if (rec.lifecycle != SubLifecycle::kTerminated) deindex_blf_subscription(did, rec);
+    if (event->subscription_state == "terminated" || event->is_unsubscribe() ||
+        rec.lifecycle == SubLifecycle::kTerminating) {
+        if (rec.lifecycle != SubLifecycle::kTerminated) deindex_subscription(did, rec);
         rec.lifecycle = SubLifecycle::kTerminated;
 
         // Respond to SUBSCRIBE with Expires: 0 (unsubscribe)
@@ -443,7 +947,7 @@ void DialogWorker::process_event(const std::string& did, DialogContext& ctx,
                                         "<dialog-info xmlns=\"urn:ietf:params:xml:ns:dialog-info\"\n"
                                         "  version=\"" + std::to_string(rec.blf_notify_version++) + "\"\n"
                                         "  state=\"full\"\n"
-                                        "  entity=\"" + rec.blf_monitored_uri + "\">\n"
+                                        "  entity=\"" + rec.blf_monitored_uri.str() + "\">\n"
                                         "</dialog-info>\n";
                 send_sip_notify(ctx, "application/dialog-info+xml", term_body, "terminated");
             } else if (rec.type == SubscriptionType::kMWI) {
@@ -456,7 +960,7 @@ void DialogWorker::process_event(const std::string& did, DialogContext& ctx,
         if (sub_store_) sub_store_->queue_delete(did);
     } else if (rec.lifecycle == SubLifecycle::kActive && prev_lifecycle == SubLifecycle::kPending) {
         // Subscription just activated
-        index_blf_subscription(did, rec);
+        index_subscription(did, rec);
 
         // Respond 200 OK and send initial NOTIFY
         if (event->category == SipEventCategory::kSubscribe &&
@@ -466,12 +970,6 @@ void DialogWorker::process_event(const std::string& did, DialogContext& ctx,
         }
 
         persist_record(rec, true);
-    } else if (event->category == SipEventCategory::kSubscribe &&
-               event->direction == SipDirection::kIncoming &&
-               rec.lifecycle == SubLifecycle::kActive) {
-        // Re-SUBSCRIBE (refresh) — respond 200 OK
-        send_subscribe_response(ctx, *event, 200, "OK");
-        persist_record(rec, false);
     } else if (rec.dirty) {
         persist_record(rec, false);
         rec.dirty = false;
@@ -484,14 +982,63 @@ void DialogWorker::process_event(const std::string& did, DialogContext& ctx,
 
     // Finish timer — logs if slow
     timer.finish();
-    auto elapsed = timer.elapsed();
-    if (elapsed >= config_.slow_event_warn_threshold) {
+    if (timer.elapsed() >= config_.slow_event_warn_threshold) {
         stats_.slow_events.fetch_add(1);
     }
+    latency.record(LatencyStage::kProcessEvent, event->dequeued_at, Clock::now());
 
     stats_.events_processed.fetch_add(1);
 }
 
+void DialogWorker::take_subscribe_handle(DialogContext& ctx, SipEvent& event) {
+    nua_handle_t* nh = event.nua_handle;
+    if (!nh) return;
+    event.nua_handle = nullptr;
+    if (!ctx.nua_handle) {
+        ctx.nua_handle = nh;            // Recovered dialog: the refresh re-attaches it
+    } else if (ctx.nua_handle == nh) {
+        nua_handle_unref(nh);
+    } else {
+        release_nua_handle(ctx);
+        ctx.nua_handle = nh;
+    }
+}
+
+void DialogWorker::refresh_subscription(DialogContext& ctx, SipEvent& event) {
+    auto& rec = ctx.record;
+    auto d = expires_policy_.negotiate(rec.tenant_id, rec.type,
+                                       event.has_expires || event.expires > 0, event.expires);
+    if (d.too_brief) {
+        // The subscription keeps its current expiry (RFC 6665 section 4.2.1.1)
+        stats_.subscribes_too_brief.fetch_add(1, std::memory_order_relaxed);
+        if (stack_mgr_ && ctx.nua_handle) stack_mgr_->respond_interval_too_brief(ctx.nua_handle, d.min_expires);
+        return;
+    }
+
+    // Under overload a longer Expires makes phones refresh less often
+    uint32_t granted = d.granted;
+    if (dispatcher_ && dispatcher_->overload()) {
+        granted = dispatcher_->overload()->refresh_expires(granted, rec.type);
+    }
+    if (event.cseq > 0) rec.cseq = event.cseq;
+    rec.expires_at = Clock::now() + Seconds(granted);
+    if (stack_mgr_ && ctx.nua_handle) {
+        stack_mgr_->respond_to_subscribe(ctx.nua_handle, 200, "OK", granted);
+        stats_.subscribe_responses_sent.fetch_add(1);
+    }
+    stats_.refresh_fast_path.fetch_add(1, std::memory_order_relaxed);
+
+    // Recovery drops a record whose stored expiry has passed, so the stored
+    // expiry must outlast the next refresh.  Skipping only while the lag is
+    // under half the granted interval keeps it more than granted/2 ahead of
+    // now, and a phone refreshing less often than that is stored every time.
+    auto lag = std::min<Clock::duration>(config_.expires_checkpoint, Seconds(granted) / 2);
+    if (rec.expires_at - rec.persisted_expires_at >= lag) {
+        persist_record(rec, false);
+        stats_.refresh_checkpoints.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
 void DialogWorker::process_presence_trigger(const std::string& did,
                                               DialogContext& ctx,
                                               const SipEvent& event) {
@@ -508,9 +1055,31 @@ void DialogWorker::process_presence_trigger(const std::string& did,
              worker_index_, did.c_str(), event.presence_state.c_str(),
              event.presence_call_id.c_str());
 
-    // Send the NOTIFY via Sofia SIP stack
-    send_sip_notify(ctx, action.content_type, action.body,
-                    action.subscription_state_header.c_str());
+    // Send the NOTIFY via Sofia SIP stack. created_at of a presence trigger
+    // is when the feed delivered the call-state event.
+    if (send_sip_notify(ctx, action.content_type, action.body,
+                        action.subscription_state_header.c_str())) {
+        LatencyRecorder::instance().record(LatencyStage::kPresenceToNotify,
+                                           event.created_at, Clock::now());
+    }
+}
+
+void DialogWorker::process_mwi_trigger(const std::string& did,
+                                         DialogContext& ctx,
+                                         const SipEvent& event) {
+    auto& rec = ctx.record;
+    if (rec.type != SubscriptionType::kMWI || rec.lifecycle != SubLifecycle::kActive) return;
+    if (!event.shared_body) return;
+
+    const std::string& body = *event.shared_body;
+    if (!mwi_processor_->apply_feed_update(body, rec) && rec.mwi_last_notify_body == body) return;
+
+    rec.mwi_last_notify_body = body;
+    rec.dirty = true;
+
+    LOG_DEBUG("Worker %zu: MWI NOTIFY dialog=%s new=%d old=%d",
+              worker_index_, did.c_str(), rec.mwi_new_messages, rec.mwi_old_messages);
+    send_sip_notify(ctx, event.content_type, body, "active");
 }
 
 void DialogWorker::cleanup_terminated_dialogs() {
@@ -521,8 +1090,10 @@ void DialogWorker::cleanup_terminated_dialogs() {
         bool remove = (ctx.record.lifecycle == SubLifecycle::kTerminated && ctx.event_queue.empty()) ||
                       (ctx.record.is_expired() && ctx.event_queue.empty());
         if (remove) {
-            deindex_blf_subscription(did, ctx.record);
+            settle_full_state(ctx);
+            deindex_subscription(did, ctx.record);
             SubscriptionRegistry::instance().unregister_subscription(did);
+            if (routing_) routing_->release(did, static_cast<uint32_t>(worker_index_));
             release_nua_handle(ctx);
             it = dialogs_.erase(it); cleaned++;
         } else { ++it; }
@@ -530,6 +1101,66 @@ void DialogWorker::cleanup_terminated_dialogs() {
     if (cleaned > 0) stats_.dialogs_active.store(dialogs_.size());
 }
 
+void DialogWorker::mark_full_state_owed(DialogContext& ctx) {
+    if (ctx.full_state_owed) return;
+    ctx.full_state_owed = true;
+    owed_added_ = true;
+    stats_.recovery_notify_owed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DialogWorker::pace_owed_notifies() {
+    // Spread what is owed now over the window, but never slower than the
+    // floor; a zero window sends each one as its dialog re-attaches.
+    // Re-run when a reconcile, replica or migration adds to the debt, so
+    // it is not held to the rate sized for what start() saw
+    owed_added_ = false;
+    double rate = 0;
+    if (config_.recovery_notify_window.count() > 0) {
+        double owed = static_cast<double>(stats_.recovery_notify_owed.load());
+        rate = std::max(static_cast<double>(config_.recovery_notify_min_rate),
+                        owed / static_cast<double>(config_.recovery_notify_window.count()));
+    }
+    recovery_notify_.set_rate(rate, std::max(1.0, rate / 10));
+    stats_.recovery_notify_rate.store(static_cast<uint64_t>(rate), std::memory_order_relaxed);
+}
+
+void DialogWorker::settle_full_state(DialogContext& ctx) {
+    if (!ctx.full_state_owed) return;
+    ctx.full_state_owed = false;
+    stats_.recovery_notify_owed.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void DialogWorker::queue_full_state(DialogContext& ctx) {
+    if (!ctx.full_state_owed || ctx.full_state_queued || !ctx.nua_handle) return;
+    ctx.full_state_queued = true;
+    recovery_notify_.schedule(ctx.record.dialog_id, ctx.record.expires_at);
+    stats_.recovery_notify_queued.store(recovery_notify_.queued(), std::memory_order_relaxed);
+}
+
+void DialogWorker::send_owed_notifies() {
+    if (recovery_notify_.queued() == 0) return;
+    recovery_notify_.drain(Clock::now(), [this](const std::string& did) {
+        auto it = dialogs_.find(did);
+        // Gone, handed off, or a duplicate entry from a round trip
+        if (it == dialogs_.end() || !it->second.full_state_queued) return false;
+        auto& ctx = it->second;
+        ctx.full_state_queued = false;
+        if (!ctx.full_state_owed) {
+            stats_.recovery_notify_superseded.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        // Still owed; queued again when the phone next re-attaches
+        if (!ctx.nua_handle || ctx.record.lifecycle != SubLifecycle::kActive ||
+            ctx.record.is_expired()) return false;
+        send_initial_notify(ctx);
+        if (ctx.full_state_owed) return false;
+        persist_record(ctx.record);   // New NOTIFY CSeq
+        stats_.recovery_notify_sent.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    });
+    stats_.recovery_notify_queued.store(recovery_notify_.queued(), std::memory_order_relaxed);
+}
+
 std::vector<DialogWorker::StaleInfo> DialogWorker::get_stale_subscriptions(
     Seconds blf_ttl, Seconds mwi_ttl, Seconds stuck_timeout) const {
     std::vector<StaleInfo> stale;
@@ -0,0 +1,45 @@
+
+// =============================================================================
+// FILE: src/dispatch/hash_ring.cpp
+// =============================================================================
+#include "dispatch/hash_ring.h"
+#include <algorithm>
+
+namespace sip_processor {
+
+// splitmix64 finaliser: spreads FNV output and vnode seeds over the ring
+static uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t HashRing::key_hash(std::string_view key) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 0x100000001B3ULL;
+    }
+    return mix(h);
+}
+
+HashRing::HashRing(size_t num_workers, size_t vnodes) : num_workers_(num_workers) {
+    if (vnodes == 0) vnodes = 1;
+    points_.reserve(num_workers * vnodes);
+    for (size_t w = 0; w < num_workers; ++w) {
+        for (size_t v = 0; v < vnodes; ++v) {
+            points_.emplace_back(mix((static_cast<uint64_t>(w) << 32) | v), static_cast<uint32_t>(w));
+        }
+    }
+    std::sort(points_.begin(), points_.end());
+}
+
+uint32_t HashRing::owner_of_hash(uint64_t hash) const {
+    if (points_.empty()) return 0;
+    auto it = std::lower_bound(points_.begin(), points_.end(), hash,
+                               [](const auto& p, uint64_t h) { return p.first < h; });
+    return it == points_.end() ? points_.front().second : it->second;
+}
+
+} // namespace sip_processor
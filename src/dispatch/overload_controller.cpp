@@ -0,0 +1,187 @@
+
+// =============================================================================
+// FILE: src/dispatch/overload_controller.cpp
+// =============================================================================
+#include "dispatch/overload_controller.h"
+#include "dispatch/dialog_dispatcher.h"
+#include "sip/sip_stack_manager.h"
+#include "common/metrics_registry.h"
+#include "common/thread_affinity.h"
+#include "common/logger.h"
+#include <algorithm>
+
+namespace sip_processor {
+
+static const MetricField<OverloadController::Stats> kOverloadMetrics[] = {
+    {"sip_processor_overload_level", MetricType::kGauge, "Overload level: 0 normal, 1 elevated, 2 shedding, 3 critical", &OverloadController::Stats::level},
+    {"sip_processor_overload_pressure_pct", MetricType::kGauge, "Worst overload signal as a percentage of its limit", &OverloadController::Stats::pressure_pct},
+    {"sip_processor_overload_shed_permille", MetricType::kGauge, "Share of new SUBSCRIBEs being shed, per mille", &OverloadController::Stats::shed_permille},
+    {"sip_processor_overload_level_changes", MetricType::kCounter, "Overload level transitions", &OverloadController::Stats::level_changes},
+    {"sip_processor_overload_subscribes_shed", MetricType::kCounter, "New SUBSCRIBEs answered 503 by the overload controller", &OverloadController::Stats::subscribes_shed},
+    {"sip_processor_overload_refreshes_extended", MetricType::kCounter, "Refresh 200 OKs granted a longer Expires under overload", &OverloadController::Stats::refreshes_extended},
+};
+
+const char* overload_level_name(OverloadLevel level) {
+    switch (level) {
+        case OverloadLevel::kNormal:   return "normal";
+        case OverloadLevel::kElevated: return "elevated";
+        case OverloadLevel::kShedding: return "shedding";
+        case OverloadLevel::kCritical: return "critical";
+        default:                       return "unknown";
+    }
+}
+
+OverloadController::OverloadController(const Config& config, DialogDispatcher& dispatcher,
+                                       SipStackManager* stack)
+    : config_(config), dispatcher_(dispatcher), stack_(stack) {
+    MetricsRegistry::instance().add_fields(this, stats_, kOverloadMetrics);
+}
+
+OverloadController::~OverloadController() {
+    stop();
+    MetricsRegistry::instance().unregister(this);
+}
+
+Result OverloadController::start() {
+    if (!config_.overload_enabled) return Result::kOk;
+    if (running_.load()) return Result::kAlreadyExists;
+    last_wait_ = LatencyRecorder::instance().snapshot(LatencyStage::kQueueWait);
+    stop_requested_.store(false); running_.store(true);
+    thread_ = std::thread(&OverloadController::run, this);
+    return Result::kOk;
+}
+
+void OverloadController::stop() {
+    if (!running_.load()) return;
+    { std::lock_guard<std::mutex> lk(mu_); stop_requested_.store(true); }
+    cv_.notify_one();
+    if (thread_.joinable()) thread_.join();
+    running_.store(false);
+}
+
+void OverloadController::run() {
+    ThreadPlacement::instance().place(ThreadRole::kMaintenance, 0, "overload");
+    while (!stop_requested_.load()) {
+        { std::unique_lock<std::mutex> lk(mu_);
+          cv_.wait_for(lk, config_.overload_sample_interval, [this]{ return stop_requested_.load(); }); }
+        if (stop_requested_.load()) break;
+        update(sample());
+    }
+}
+
+OverloadController::Signals OverloadController::sample() {
+    Signals s;
+    size_t cap = std::max<size_t>(1, config_.max_incoming_queue_per_worker);
+    for (size_t i = 0; i < dispatcher_.num_workers(); ++i) {
+        const auto& ws = dispatcher_.worker(i).stats();
+        uint64_t lane = std::max(ws.transaction_queue_depth.load(std::memory_order_relaxed),
+                                 ws.feed_queue_depth.load(std::memory_order_relaxed));
+        s.queue_fill = std::max(s.queue_fill, static_cast<double>(lane) / cap);
+    }
+
+    // p99 of the waits recorded since the previous sample
+    auto now = LatencyRecorder::instance().snapshot(LatencyStage::kQueueWait);
+    LatencyHistogram::Snapshot window;
+    if (now.count >= last_wait_.count) {
+        for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+            window.counts[i] = now.counts[i] >= last_wait_.counts[i] ? now.counts[i] - last_wait_.counts[i] : 0;
+        }
+        window.count = now.count - last_wait_.count;
+        window.max = now.max;
+    }
+    last_wait_ = now;
+    s.queue_wait_p99_us = window.percentile(99) / 1000;
+
+    if (stack_) s.notify_backlog = stack_->notify_backlog();
+    return s;
+}
+
+double OverloadController::pressure(const Signals& s) const {
+    double p = 0;
+    if (config_.overload_queue_fill_pct > 0) {
+        p = std::max(p, s.queue_fill * 100.0 / config_.overload_queue_fill_pct);
+    }
+    if (config_.overload_queue_wait_p99.count() > 0) {
+        p = std::max(p, s.queue_wait_p99_us / (config_.overload_queue_wait_p99.count() * 1000.0));
+    }
+    if (config_.overload_notify_backlog > 0) {
+        p = std::max(p, static_cast<double>(s.notify_backlog) / config_.overload_notify_backlog);
+    }
+    return p;
+}
+
+double OverloadController::threshold(OverloadLevel level) const {
+    switch (level) {
+        case OverloadLevel::kElevated: return config_.overload_elevated_pct / 100.0;
+        case OverloadLevel::kShedding: return config_.overload_shed_pct / 100.0;
+        case OverloadLevel::kCritical: return 1.0;
+        default:                       return 0.0;
+    }
+}
+
+void OverloadController::update(const Signals& s) {
+    double p = pressure(s);
+    stats_.pressure_pct.store(static_cast<uint64_t>(p * 100), std::memory_order_relaxed);
+    stats_.queue_fill_pct.store(static_cast<uint64_t>(s.queue_fill * 100), std::memory_order_relaxed);
+    stats_.queue_wait_p99_us.store(s.queue_wait_p99_us, std::memory_order_relaxed);
+    stats_.notify_backlog.store(static_cast<uint64_t>(s.notify_backlog), std::memory_order_relaxed);
+
+    OverloadLevel prev = level();
+    OverloadLevel target = OverloadLevel::kNormal;
+    for (auto l : {OverloadLevel::kElevated, OverloadLevel::kShedding, OverloadLevel::kCritical}) {
+        if (p >= threshold(l)) target = l;
+    }
+    OverloadLevel next = prev;
+    if (target > prev) {
+        next = target;
+    } else if (prev > OverloadLevel::kNormal && p < threshold(prev) - 0.1) {
+        next = static_cast<OverloadLevel>(static_cast<uint8_t>(prev) - 1);
+    }
+
+    // Inside the shedding band the shed share ramps from 0 to all
+    uint64_t permille = 0;
+    if (next == OverloadLevel::kCritical) {
+        permille = 1000;
+    } else if (next == OverloadLevel::kShedding) {
+        double lo = threshold(OverloadLevel::kShedding);
+        double share = lo < 1.0 ? (p - lo) / (1.0 - lo) : 1.0;
+        permille = static_cast<uint64_t>(std::clamp(share, 0.1, 1.0) * 1000);
+    }
+    stats_.shed_permille.store(permille, std::memory_order_relaxed);
+
+    if (next != prev) {
+        stats_.level.store(static_cast<uint64_t>(next), std::memory_order_relaxed);
+        stats_.level_changes.fetch_add(1, std::memory_order_relaxed);
+        LOG_WARN("Overload: %s -> %s (pressure=%.0f%% queue_fill=%.0f%% wait_p99=%luus notify_backlog=%ld)",
+                 overload_level_name(prev), overload_level_name(next), p * 100, s.queue_fill * 100,
+                 static_cast<unsigned long>(s.queue_wait_p99_us), static_cast<long>(s.notify_backlog));
+    }
+}
+
+bool OverloadController::admit_new_subscription() {
+    if (level() < OverloadLevel::kShedding) return true;
+    uint64_t permille = stats_.shed_permille.load(std::memory_order_relaxed);
+    // 617 is coprime with 1000, so consecutive requests visit every slot
+    // once per thousand and the sheds are spread out rather than bunched
+    uint64_t slot = (admission_seq_.fetch_add(1, std::memory_order_relaxed) * 617) % 1000;
+    if (slot >= permille) return true;
+    stats_.subscribes_shed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+uint32_t OverloadController::retry_after_sec() {
+    uint32_t base = std::max<uint32_t>(1, config_.overload_retry_after_sec);
+    return base + static_cast<uint32_t>(admission_seq_.load(std::memory_order_relaxed) % base);
+}
+
+uint32_t OverloadController::refresh_expires(uint32_t requested, SubscriptionType type) {
+    if (level() < OverloadLevel::kElevated || config_.overload_refresh_expires_sec == 0) return requested;
+    // Beyond the reaper TTL an idle dialog would be reaped before it refreshes
+    Seconds ttl = type == SubscriptionType::kMWI ? config_.mwi_subscription_ttl : config_.blf_subscription_ttl;
+    uint32_t granted = std::min<uint32_t>(config_.overload_refresh_expires_sec, static_cast<uint32_t>(ttl.count()));
+    if (granted <= requested) return requested;
+    stats_.refreshes_extended.fetch_add(1, std::memory_order_relaxed);
+    return granted;
+}
+
+} // namespace sip_processor
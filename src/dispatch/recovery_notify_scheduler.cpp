@@ -0,0 +1,38 @@
+
+// =============================================================================
+// FILE: src/dispatch/recovery_notify_scheduler.cpp
+// =============================================================================
+#include "dispatch/recovery_notify_scheduler.h"
+#include <algorithm>
+
+namespace sip_processor {
+
+void RecoveryNotifyScheduler::configure(double rate_per_sec, double burst) {
+    rate_ = std::max(0.0, rate_per_sec);
+    burst_ = std::max(1.0, burst);
+    // Start with one burst so the first cycle sends without waiting
+    tokens_ = burst_;
+    last_refill_ = Clock::now();
+}
+
+void RecoveryNotifyScheduler::set_rate(double rate_per_sec, double burst) {
+    // Unpaced until now: nothing was earned, start like configure()
+    if (rate_ <= 0) { configure(rate_per_sec, burst); return; }
+    refill(Clock::now());
+    rate_ = std::max(0.0, rate_per_sec);
+    burst_ = std::max(1.0, burst);
+    tokens_ = std::min(tokens_, burst_);
+}
+
+void RecoveryNotifyScheduler::schedule(std::string dialog_id, TimePoint expires_at) {
+    heap_.push({expires_at, std::move(dialog_id)});
+}
+
+void RecoveryNotifyScheduler::refill(TimePoint now) {
+    if (rate_ <= 0 || now <= last_refill_) return;
+    double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+    tokens_ = std::min(burst_, tokens_ + elapsed * rate_);
+    last_refill_ = now;
+}
+
+} // namespace sip_processor
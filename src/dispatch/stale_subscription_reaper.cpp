@@ -6,6 +6,7 @@
 #include "dispatch/dialog_dispatcher.h"
 #include "persistence/subscription_store.h"
 #include "common/logger.h"
+#include "common/thread_affinity.h"
 
 namespace sip_processor {
 
@@ -33,6 +34,7 @@ void StaleSubscriptionReaper::stop() {
 }
 
 void StaleSubscriptionReaper::run() {
+    ThreadPlacement::instance().place(ThreadRole::kMaintenance, 0, "reaper");
     while (!stop_requested_.load()) {
         { std::unique_lock<std::mutex> lk(mu_);
           cv_.wait_for(lk, config_.reaper_scan_interval, [this]{ return stop_requested_.load(); }); }
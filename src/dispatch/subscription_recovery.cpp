@@ -0,0 +1,140 @@
+
+// =============================================================================
+// FILE: src/dispatch/subscription_recovery.cpp
+// =============================================================================
+#include "dispatch/subscription_recovery.h"
+#include "dispatch/dialog_dispatcher.h"
+#include "persistence/subscription_store.h"
+#include "persistence/local_snapshot_store.h"
+#include "common/logger.h"
+#include "common/thread_affinity.h"
+
+namespace sip_processor {
+
+SubscriptionRecovery::SubscriptionRecovery(const Config& config, DialogDispatcher& dispatcher,
+                                           std::shared_ptr<SubscriptionStore> sub_store,
+                                           std::shared_ptr<LocalSnapshotStore> snapshot)
+    : config_(config), dispatcher_(dispatcher)
+    , sub_store_(std::move(sub_store)), snapshot_(std::move(snapshot)) {}
+
+SubscriptionRecovery::~SubscriptionRecovery() { stop(); }
+
+void SubscriptionRecovery::load_into_workers(DialogDispatcher& dispatcher,
+                                             std::vector<SubscriptionRecord> records) {
+    size_t n = dispatcher.num_workers();
+    std::vector<std::vector<SubscriptionRecord>> per_worker(n);
+    for (auto& rec : records) {
+        per_worker[dispatcher.place(rec.dialog_id)].push_back(std::move(rec));
+    }
+    records.clear();
+
+    // Workers are not started yet; each loader thread touches only its own
+    // worker plus the (thread-safe) registry and BLF index.
+    std::vector<std::thread> loaders;
+    loaders.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (per_worker[i].empty()) continue;
+        loaders.emplace_back([&dispatcher, &per_worker, i] {
+            // Load on the worker's own CPU so its table is first touched on
+            // the node the worker will run on
+            ThreadPlacement::instance().place(ThreadRole::kWorker, i, "recovery-load");
+            auto& w = dispatcher.worker(i);
+            for (auto& rec : per_worker[i]) w.load_recovered_subscription(std::move(rec));
+            per_worker[i].clear();
+        });
+    }
+    for (auto& t : loaders) t.join();
+}
+
+void SubscriptionRecovery::add_replay_listener(std::shared_ptr<SubscriptionChangeListener> listener) {
+    if (listener) replay_listeners_.push_back(std::move(listener));
+}
+
+Result SubscriptionRecovery::recover() {
+    ScopedTimer timer;
+    std::vector<SubscriptionRecord> records;
+
+    if (snapshot_ && snapshot_->is_enabled()) {
+        size_t threads = config_.snapshot_load_threads > 0
+            ? config_.snapshot_load_threads : dispatcher_.num_workers();
+        if (snapshot_->load(records, threads) == Result::kOk && !records.empty()) {
+            stats_.source.store(static_cast<int>(Source::kSnapshot));
+        }
+    }
+
+    if (records.empty() && sub_store_ && sub_store_->is_enabled()) {
+        std::vector<SubscriptionStore::StoredSubscription> stored;
+        if (sub_store_->load_active_subscriptions(stored) != Result::kOk) {
+            return Result::kPersistenceError;
+        }
+        records.reserve(stored.size());
+        for (auto& s : stored) records.push_back(std::move(s.record));
+        stats_.source.store(static_cast<int>(Source::kMongo));
+
+        // Seed the local snapshot so the next restart does not need MongoDB;
+        // these go to the journal once start() opens it, and the next
+        // compaction folds them into the snapshot file.
+        if (snapshot_ && snapshot_->is_enabled()) {
+            for (const auto& rec : records) snapshot_->on_upsert(rec);
+        }
+    }
+
+    for (auto& l : replay_listeners_) {
+        for (const auto& rec : records) l->on_upsert(rec);
+    }
+
+    size_t count = records.size();
+    LOG_INFO("Recovering %zu subscriptions from %s...", count, recovery_source_to_string(source()));
+    load_into_workers(dispatcher_, std::move(records));
+
+    stats_.records_loaded.store(count);
+    stats_.load_ms.store(static_cast<uint64_t>(timer.elapsed_ms().count()));
+    LOG_INFO("Recovery complete: %zu subscriptions loaded in %lums",
+             count, stats_.load_ms.load());
+    return Result::kOk;
+}
+
+void SubscriptionRecovery::start_reconcile() {
+    if (source() != Source::kSnapshot || !config_.snapshot_reconcile_with_mongo ||
+        !sub_store_ || !sub_store_->is_enabled()) {
+        stats_.reconcile_done.store(true);
+        return;
+    }
+    stop_requested_.store(false);
+    reconcile_thread_ = std::thread(&SubscriptionRecovery::reconcile_thread_func, this);
+}
+
+void SubscriptionRecovery::stop() {
+    stop_requested_.store(true);
+    if (reconcile_thread_.joinable()) reconcile_thread_.join();
+}
+
+void SubscriptionRecovery::reconcile_thread_func() {
+    ThreadPlacement::instance().place(ThreadRole::kPersistence, 0, "reconcile");
+    ScopedTimer timer;
+    std::vector<SubscriptionStore::StoredSubscription> stored;
+    if (sub_store_->load_active_subscriptions(stored) != Result::kOk) {
+        LOG_WARN("Recovery: MongoDB reconcile failed, keeping snapshot state");
+        stats_.reconcile_done.store(true);
+        return;
+    }
+    stats_.reconcile_fetched.store(stored.size());
+
+    // Records still only in the snapshot are left alone: the write-behind
+    // queue may not have reached MongoDB before the restart.
+    std::vector<std::vector<SubscriptionRecord>> per_worker(dispatcher_.num_workers());
+    for (auto& s : stored) {
+        if (stop_requested_.load()) return;
+        per_worker[dispatcher_.place(s.record.dialog_id)].push_back(std::move(s.record));
+    }
+    for (size_t i = 0; i < per_worker.size() && !stop_requested_.load(); ++i) {
+        if (!per_worker[i].empty()) dispatcher_.worker(i).reconcile_subscriptions(std::move(per_worker[i]));
+    }
+
+    stats_.reconcile_ms.store(static_cast<uint64_t>(timer.elapsed_ms().count()));
+    stats_.reconcile_done.store(true);
+    LOG_INFO("Recovery: reconciled %zu MongoDB records against snapshot in %lums",
+             stored.size(), stats_.reconcile_ms.load());
+}
+
+} // namespace sip_processor
@@ -0,0 +1,66 @@
+
+// =============================================================================
+// FILE: src/distributor_main.cpp
+//
+// Standalone presence distributor: consumes the presence feed from
+// [presence] servers and forwards each call-state event to the processor
+// nodes connected on [distributor] listen_port whose published interest
+// covers it.  Nodes point their [presence] servers at this process and set
+// publish_interest = true.
+//
+// Run: ./presence_distributor [config_file]
+// =============================================================================
+#include "common/config.h"
+#include "common/logger.h"
+#include "common/thread_affinity.h"
+#include "presence/presence_distributor.h"
+#include "presence/presence_failover_manager.h"
+#include "presence/presence_tcp_client.h"
+#include <csignal>
+#include <atomic>
+#include <thread>
+
+using namespace sip_processor;
+
+static std::atomic<bool> g_shutdown{false};
+
+static void signal_handler(int) {
+    g_shutdown.store(true, std::memory_order_release);
+}
+
+int main(int argc, char* argv[]) {
+    Logger::instance().set_level(LogLevel::kInfo);
+    Config config = (argc > 1) ? Config::load_from_file(argv[1]) : Config::load_defaults();
+    ThreadPlacement::instance().configure(config);
+    Logger::instance().set_level(parse_log_level(config.log_level_str));
+    LOG_INFO("Presence distributor starting...");
+
+    struct sigaction sa{}; sa.sa_handler = signal_handler; sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr); sigaction(SIGTERM, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    PresenceDistributor distributor(config);
+    if (distributor.start() != Result::kOk) { LOG_FATAL("Distributor failed to listen"); return 1; }
+
+    // The distributor is the one consumer of the upstream feed
+    PresenceTcpClient client(config, std::make_shared<PresenceFailoverManager>(config));
+    client.set_event_callback([&](CallStateEvent&& ev) { distributor.on_call_state_event(ev); });
+    client.start();
+
+    uint64_t tick = 0;
+    while (!g_shutdown.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(Seconds(1));
+        if (++tick % 30 != 0) continue;
+        const auto& s = distributor.stats();
+        LOG_INFO("Distributor: nodes=%lu events=%lu forwarded=%lu unwanted=%lu dropped=%lu upstream=%s",
+                 s.nodes_connected.load(), s.events_received.load(), s.events_forwarded.load(),
+                 s.events_unwanted.load(), s.events_dropped.load(),
+                 client.is_connected() ? "connected" : "disconnected");
+    }
+
+    LOG_INFO("Presence distributor shutting down...");
+    client.stop();
+    distributor.stop();
+    Logger::instance().shutdown();
+    return 0;
+}
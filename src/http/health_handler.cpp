@@ -4,6 +4,7 @@
 // =============================================================================
 #include "http/health_handler.h"
 #include "dispatch/dialog_dispatcher.h"
+#include "dispatch/overload_controller.h"
 #include "presence/presence_tcp_client.h"
 #include "presence/presence_failover_manager.h"
 #include "persistence/mongo_client.h"
@@ -15,13 +16,16 @@ namespace sip_processor {
 void HealthHandler::register_routes(HttpServer& server, const Dependencies& deps) {
     auto deps_copy = deps;  // Capture by value for lambda lifetime
 
+    // Probes only read flags, so they run on the event loop and are never
+    // queued behind a slow admin request
+
     server.route("GET", "/health", [deps_copy](const HttpServer::Request& req) {
         return handle_health(req, deps_copy);
-    });
+    }, HttpServer::Dispatch::kInline);
 
     server.route("GET", "/ready", [deps_copy](const HttpServer::Request& req) {
         return handle_ready(req, deps_copy);
-    });
+    }, HttpServer::Dispatch::kInline);
 }
 
 HttpServer::Response HealthHandler::handle_health(const HttpServer::Request&,
@@ -57,8 +61,18 @@ HttpServer::Response HealthHandler::handle_health(const HttpServer::Request&,
         json << ",\"presence_healthy_servers\":" << deps.failover_mgr->healthy_count();
     }
 
+    // Overload (degraded while shedding, never unhealthy: a restart would
+    // only move the load)
+    bool shedding = false;
+    if (const OverloadController* ov = deps.dispatcher ? deps.dispatcher->overload() : nullptr) {
+        shedding = ov->level() >= OverloadLevel::kShedding;
+        json << ",\"overload\":{\"level\":\"" << overload_level_name(ov->level()) << "\"";
+        json << ",\"pressure_pct\":" << ov->stats().pressure_pct.load();
+        json << ",\"shed_permille\":" << ov->stats().shed_permille.load() << "}";
+    }
+
     json << ",\"healthy\":" << (healthy ? "true" : "false");
-    json << ",\"degraded\":" << (!presence_ok ? "true" : "false");
+    json << ",\"degraded\":" << (!presence_ok || shedding ? "true" : "false");
     json << "}";
 
     resp.status_code = healthy ? 200 : 503;
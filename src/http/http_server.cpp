@@ -4,33 +4,108 @@
 // =============================================================================
 #include "http/http_server.h"
 #include "common/logger.h"
+#include "common/thread_affinity.h"
+#include "common/metrics_registry.h"
 
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
-#include <poll.h>
+#include <cctype>
 #include <cerrno>
+#include <cstdio>
 #include <cstring>
 #include <sstream>
 #include <algorithm>
 
 namespace sip_processor {
 
-HttpServer::HttpServer(const Config& config) : config_(config) {}
+static constexpr size_t kMaxHeaderBytes = 64 * 1024;
+static constexpr size_t kReadChunk      = 16 * 1024;
+static constexpr int    kMaxEvents      = 64;
+
+using ServerStats = HttpServer::ServerStats;
+static const MetricField<ServerStats> kHttpMetrics[] = {
+    {"sip_processor_http_requests", MetricType::kCounter, "HTTP requests received", &ServerStats::requests_total},
+    {"sip_processor_http_requests_ok", MetricType::kCounter, "HTTP requests answered below 400", &ServerStats::requests_ok},
+    {"sip_processor_http_requests_error", MetricType::kCounter, "HTTP requests answered with an error", &ServerStats::requests_error},
+    {"sip_processor_http_active_connections", MetricType::kGauge, "Open HTTP connections", &ServerStats::active_connections},
+    {"sip_processor_http_connections_accepted", MetricType::kCounter, "HTTP connections accepted", &ServerStats::connections_accepted},
+    {"sip_processor_http_connections_rejected", MetricType::kCounter, "HTTP connections closed at max_connections", &ServerStats::connections_rejected},
+    {"sip_processor_http_keepalive_reuses", MetricType::kCounter, "HTTP requests served on a reused connection", &ServerStats::keepalive_reuses},
+};
+
+// Per-socket state, touched only by the event loop thread
+struct HttpServer::Connection {
+    int         fd;
+    uint64_t    id;
+    std::string in;                     // Received, not yet parsed
+    std::string out;                    // Pending response bytes
+    size_t      out_off = 0;
+    std::shared_ptr<Response> stream;   // Chunked response in progress
+    bool        busy = false;           // A job for this connection is on the pool
+    bool        close_after_write = false;
+    bool        chunked = true;         // Current request is HTTP/1.1: may stream chunked
+    bool        want_write = false;     // EPOLLOUT registered
+    bool        read_closed = false;    // Peer shut down its side; answer, then close
+    uint64_t    requests = 0;
+    TimePoint   last_active;
+};
+
+static bool iequals(const std::string& a, const char* b) {
+    size_t n = strlen(b);
+    if (a.size() != n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i]))) return false;
+    }
+    return true;
+}
+
+static const std::string* find_header(const HttpServer::Request& req, const char* name) {
+    for (const auto& [k, v] : req.headers) {
+        if (iequals(k, name)) return &v;
+    }
+    return nullptr;
+}
+
+HttpServer::HttpServer(const Config& config) : config_(config) {
+    MetricsRegistry::instance().add_fields(this, stats_, kHttpMetrics);
+}
 
-HttpServer::~HttpServer() { stop(); }
+HttpServer::~HttpServer() {
+    stop();
+    MetricsRegistry::instance().unregister(this);
+}
 
-void HttpServer::route(const std::string& method, const std::string& path, Handler handler) {
+void HttpServer::route(const std::string& method, const std::string& path, Handler handler,
+                       Dispatch dispatch) {
     std::lock_guard<std::mutex> lk(routes_mu_);
-    routes_[method + ":" + path] = std::move(handler);
+    auto& r = routes_[method + " " + path];
+    r.handler = std::move(handler);
+    r.dispatch = dispatch;
+}
+
+const HttpServer::Route* HttpServer::find_route(const std::string& method, const std::string& path) const {
+    // Exact path first, then each parent: /a/b/c → /a/b → /a
+    std::string key = method + " " + path;
+    std::lock_guard<std::mutex> lk(routes_mu_);
+    while (true) {
+        auto it = routes_.find(key);
+        if (it != routes_.end()) return &it->second;
+        auto slash = key.rfind('/');
+        if (slash == std::string::npos || slash <= method.size() + 1) return nullptr;
+        key.resize(slash);
+    }
 }
 
 Result HttpServer::start() {
     if (!config_.http_enabled) { LOG_INFO("HTTP server disabled"); return Result::kOk; }
     if (running_.load()) return Result::kAlreadyExists;
 
-    server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    server_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (server_fd_ < 0) { LOG_ERROR("HTTP: socket failed: %s", strerror(errno)); return Result::kError; }
 
     int opt = 1;
@@ -52,97 +127,433 @@ Result HttpServer::start() {
         LOG_ERROR("HTTP: listen failed"); close(server_fd_); server_fd_ = -1;
         return Result::kError;
     }
+    socklen_t len = sizeof(addr);
+    getsockname(server_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    bound_port_ = ntohs(addr.sin_port);
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        LOG_ERROR("HTTP: epoll/eventfd failed: %s", strerror(errno));
+        if (epoll_fd_ >= 0) close(epoll_fd_);
+        if (wake_fd_ >= 0) close(wake_fd_);
+        close(server_fd_);
+        server_fd_ = epoll_fd_ = wake_fd_ = -1;
+        return Result::kError;
+    }
+    struct epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = server_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, server_fd_, &ev);
+    ev.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
 
     stop_requested_.store(false); running_.store(true);
-    server_thread_ = std::thread(&HttpServer::server_thread_func, this);
+    size_t threads = std::max<size_t>(1, config_.http_handler_threads);
+    for (size_t i = 0; i < threads; ++i) {
+        handler_threads_.emplace_back(&HttpServer::handler_thread_func, this);
+    }
+    loop_thread_ = std::thread(&HttpServer::event_loop, this);
 
-    LOG_INFO("HTTP server started on %s:%d", config_.http_bind_address.c_str(), config_.http_port);
+    LOG_INFO("HTTP server started on %s:%d (%zu handler threads)",
+             config_.http_bind_address.c_str(), bound_port_, threads);
     return Result::kOk;
 }
 
 void HttpServer::stop() {
     if (!running_.load()) return;
     stop_requested_.store(true);
-    if (server_fd_ >= 0) { shutdown(server_fd_, SHUT_RDWR); close(server_fd_); server_fd_ = -1; }
-    if (server_thread_.joinable()) server_thread_.join();
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) { /* Loop also polls the flag */ }
+    if (loop_thread_.joinable()) loop_thread_.join();
+
+    {
+        std::lock_guard<std::mutex> lk(jobs_mu_);
+        jobs_.clear();
+    }
+    jobs_cv_.notify_all();
+    for (auto& t : handler_threads_) if (t.joinable()) t.join();
+    handler_threads_.clear();
+    done_.clear();
+
+    close(epoll_fd_); close(wake_fd_); close(server_fd_);
+    epoll_fd_ = wake_fd_ = server_fd_ = -1;
     running_.store(false);
     LOG_INFO("HTTP server stopped");
 }
 
-void HttpServer::server_thread_func() {
-    while (!stop_requested_.load(std::memory_order_acquire)) {
-        struct pollfd pfd{server_fd_, POLLIN, 0};
-        int pr = poll(&pfd, 1, 500);
-        if (pr <= 0) continue;
-        if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) break;
+// =============================================================================
+// Event loop
+// =============================================================================
 
-        struct sockaddr_in client_addr{};
-        socklen_t addr_len = sizeof(client_addr);
-        int client_fd = accept(server_fd_, reinterpret_cast<sockaddr*>(&client_addr), &addr_len);
-        if (client_fd < 0) { if (errno != EINTR) LOG_WARN("HTTP: accept failed"); continue; }
+void HttpServer::event_loop() {
+    ThreadPlacement::instance().place(ThreadRole::kHttp, 0, "http-loop");
+    struct epoll_event events[kMaxEvents];
+    TimePoint last_sweep = Clock::now();
 
-        stats_.requests_total.fetch_add(1);
-        handle_client(client_fd);
-        close(client_fd);
+    while (!stop_requested_.load(std::memory_order_acquire)) {
+        int n = epoll_wait(epoll_fd_, events, kMaxEvents, 500);
+        if (n < 0 && errno != EINTR) { LOG_ERROR("HTTP: epoll_wait failed: %s", strerror(errno)); break; }
+
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            uint32_t ev = events[i].events;
+            if (fd == server_fd_) { accept_connections(); continue; }
+            if (fd == wake_fd_) {
+                uint64_t v;
+                while (read(wake_fd_, &v, sizeof(v)) > 0) {}
+                drain_completions();
+                continue;
+            }
+            auto it = conns_.find(fd);
+            if (it == conns_.end()) continue;
+            Connection& c = *it->second;
+            if (ev & (EPOLLERR | EPOLLHUP)) { close_connection(fd); continue; }
+            if (ev & EPOLLIN) {
+                on_readable(c);
+                if (conns_.find(fd) == conns_.end()) continue;   // Closed while reading
+            }
+            if (ev & EPOLLOUT) on_writable(c);
+        }
+
+        TimePoint now = Clock::now();
+        if (now - last_sweep >= Seconds(1)) {
+            sweep_idle(now);
+            last_sweep = now;
+        }
     }
+
+    while (!conns_.empty()) close_connection(conns_.begin()->first);
 }
 
-void HttpServer::handle_client(int client_fd) {
-    // Set read timeout
-    struct timeval tv;
-    tv.tv_sec = config_.http_read_timeout.count(); tv.tv_usec = 0;
-    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+void HttpServer::accept_connections() {
+    while (true) {
+        int fd = accept4(server_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) LOG_WARN("HTTP: accept failed: %s", strerror(errno));
+            return;
+        }
+        if (conns_.size() >= config_.http_max_connections) {
+            stats_.connections_rejected.fetch_add(1, std::memory_order_relaxed);
+            close(fd);
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        auto c = std::make_unique<Connection>();
+        c->fd = fd;
+        c->id = next_conn_id_++;
+        c->last_active = Clock::now();
+
+        struct epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) { close(fd); continue; }
+        conns_.emplace(fd, std::move(c));
+        stats_.connections_accepted.fetch_add(1, std::memory_order_relaxed);
+        stats_.active_connections.store(conns_.size(), std::memory_order_relaxed);
+    }
+}
 
-    char buf[8192];
-    ssize_t n = recv(client_fd, buf, sizeof(buf) - 1, 0);
-    if (n <= 0) return;
-    buf[n] = '\0';
+void HttpServer::close_connection(int fd) {
+    auto it = conns_.find(fd);
+    if (it == conns_.end()) return;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    conns_.erase(it);   // A pending job's completion no longer finds the id
+    stats_.active_connections.store(conns_.size(), std::memory_order_relaxed);
+}
 
-    Request req = parse_request(std::string(buf, n));
+void HttpServer::set_writable_interest(Connection& c, bool want) {
+    if (c.want_write == want) return;
+    c.want_write = want;
+    struct epoll_event ev{};
+    ev.events = (c.read_closed ? 0u : EPOLLIN | EPOLLRDHUP) | (want ? EPOLLOUT : 0u);
+    ev.data.fd = c.fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, c.fd, &ev);
+}
 
-    // Find handler — try exact match, then prefix match
-    Handler handler;
-    {
-        std::lock_guard<std::mutex> lk(routes_mu_);
+void HttpServer::on_readable(Connection& c) {
+    char buf[kReadChunk];
+    while (true) {
+        ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            c.in.append(buf, static_cast<size_t>(n));
+            c.last_active = Clock::now();
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n < 0) { close_connection(c.fd); return; }
+
+        // Half-close: stop polling for input but answer what was sent
+        c.read_closed = true;
+        struct epoll_event ev{};
+        ev.events = c.want_write ? EPOLLOUT : 0u;
+        ev.data.fd = c.fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, c.fd, &ev);
+        break;
+    }
+    if (c.in.size() > kMaxHeaderBytes + config_.http_max_request_bytes) {
+        close_connection(c.fd);   // Flooding past the request limit
+        return;
+    }
+    process_input(c);
+}
 
-        std::string key = req.method + ":" + req.path;
-        auto it = routes_.find(key);
-        if (it != routes_.end()) {
-            handler = it->second;
-        } else {
-            // Prefix match (e.g., /subscriptions/xxx matches /subscriptions)
-            for (auto& [route_key, h] : routes_) {
-                auto colon = route_key.find(':');
-                if (colon == std::string::npos) continue;
-                std::string rm = route_key.substr(0, colon);
-                std::string rp = route_key.substr(colon + 1);
-                if (rm == req.method && req.path.find(rp) == 0) {
-                    handler = h;
-                    break;
-                }
-            }
+// Starts the next buffered request once the previous response is out.
+// Pipelined requests therefore wait in `in` and are answered in order.
+void HttpServer::process_input(Connection& c) {
+    if (c.busy || c.stream || c.out_off < c.out.size() || c.close_after_write) return;
+
+    size_t head_end = c.in.find("\r\n\r\n");
+    if (head_end == std::string::npos) {
+        if (c.in.size() > kMaxHeaderBytes) {
+            Response resp;
+            resp.status_code = 431;
+            resp.body = R"({"error":"header_too_large"})";
+            stats_.requests_error.fetch_add(1, std::memory_order_relaxed);
+            start_response(c, std::move(resp), false);
+        } else if (c.read_closed) {
+            close_connection(c.fd);
         }
+        return;
     }
 
-    Response resp;
-    if (handler) {
-        try {
-            resp = handler(req);
-            stats_.requests_ok.fetch_add(1);
-        } catch (const std::exception& e) {
-            resp.status_code = 500;
-            resp.body = R"({"error":")" + std::string(e.what()) + R"("})";
-            stats_.requests_error.fetch_add(1);
+    Request req = parse_request(c.in.substr(0, head_end + 2));
+    size_t body_len = 0;
+    if (const std::string* cl = find_header(req, "Content-Length")) {
+        char* end = nullptr;
+        unsigned long long v = strtoull(cl->c_str(), &end, 10);
+        if (cl->empty() || *end != '\0') {
+            Response resp;
+            resp.status_code = 400;
+            resp.body = R"({"error":"invalid_content_length"})";
+            stats_.requests_error.fetch_add(1, std::memory_order_relaxed);
+            start_response(c, std::move(resp), false);
+            return;
         }
-    } else {
+        body_len = static_cast<size_t>(v);
+    }
+    if (body_len > config_.http_max_request_bytes) {
+        Response resp;
+        resp.status_code = 413;
+        resp.body = R"({"error":"request_too_large"})";
+        stats_.requests_error.fetch_add(1, std::memory_order_relaxed);
+        start_response(c, std::move(resp), false);
+        return;
+    }
+    size_t total = head_end + 4 + body_len;
+    if (c.in.size() < total) {   // Body still arriving
+        if (c.read_closed) close_connection(c.fd);
+        return;
+    }
+    req.body = c.in.substr(head_end + 4, body_len);
+    c.in.erase(0, total);
+
+    const std::string* conn_hdr = find_header(req, "Connection");
+    bool keep_alive = req.version == "HTTP/1.1"
+        ? !(conn_hdr && iequals(*conn_hdr, "close"))
+        : (conn_hdr && iequals(*conn_hdr, "keep-alive"));
+    c.chunked = req.version == "HTTP/1.1";
+
+    stats_.requests_total.fetch_add(1, std::memory_order_relaxed);
+    if (c.requests++ > 0) stats_.keepalive_reuses.fetch_add(1, std::memory_order_relaxed);
+
+    const Route* route = find_route(req.method, req.path);
+    if (!route) {
+        Response resp;
         resp.status_code = 404;
         resp.body = R"({"error":"not_found","path":")" + req.path + R"("})";
+        stats_.requests_error.fetch_add(1, std::memory_order_relaxed);
+        start_response(c, std::move(resp), keep_alive);
+    } else if (route->dispatch == Dispatch::kInline) {
+        start_response(c, run_handler(*route, req), keep_alive);
+    } else {
+        c.busy = true;
+        Job job;
+        job.fd = c.fd;
+        job.conn_id = c.id;
+        job.route = route;
+        job.request = std::move(req);
+        job.keep_alive = keep_alive;
+        job.chunked = c.chunked;
+        submit(std::move(job));
     }
+}
+
+void HttpServer::start_response(Connection& c, Response resp, bool keep_alive) {
+    if (resp.stream && !c.chunked) keep_alive = false;   // Body ends at close
+    c.out += serialize_response(resp, keep_alive, c.chunked);
+    if (!keep_alive) c.close_after_write = true;
+    if (resp.stream) c.stream = std::make_shared<Response>(std::move(resp));
+    on_writable(c);
+}
+
+void HttpServer::on_writable(Connection& c) {
+    while (c.out_off < c.out.size()) {
+        ssize_t n = send(c.fd, c.out.data() + c.out_off, c.out.size() - c.out_off, MSG_NOSIGNAL);
+        if (n > 0) {
+            c.out_off += static_cast<size_t>(n);
+            c.last_active = Clock::now();
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            set_writable_interest(c, true);
+            return;
+        }
+        close_connection(c.fd);
+        return;
+    }
+    c.out.clear();
+    c.out_off = 0;
+    set_writable_interest(c, false);
+
+    if (c.stream) {
+        // Ask for the next chunk only once this one is on the wire
+        if (!c.busy) {
+            c.busy = true;
+            Job job;
+            job.fd = c.fd;
+            job.conn_id = c.id;
+            job.stream = c.stream;
+            job.chunked = c.chunked;
+            submit(std::move(job));
+        }
+        return;
+    }
+    if (c.close_after_write) {
+        close_connection(c.fd);
+        return;
+    }
+    process_input(c);   // Next pipelined request, if any
+}
+
+void HttpServer::drain_completions() {
+    std::vector<Completion> done;
+    {
+        std::lock_guard<std::mutex> lk(done_mu_);
+        done.swap(done_);
+    }
+    for (auto& d : done) {
+        auto it = conns_.find(d.fd);
+        if (it == conns_.end() || it->second->id != d.conn_id) continue;   // Closed meanwhile
+        Connection& c = *it->second;
+        c.busy = false;
+        c.out += d.data;
+        c.stream = std::move(d.stream);
+        if (d.close) c.close_after_write = true;
+        on_writable(c);
+    }
+}
+
+void HttpServer::sweep_idle(TimePoint now) {
+    std::vector<int> expired;
+    for (const auto& [fd, c] : conns_) {
+        if (c->busy) continue;   // Handler still running
+        bool writing = c->out_off < c->out.size();
+        auto limit = writing ? config_.http_write_timeout : config_.http_read_timeout;
+        if (now - c->last_active > limit) expired.push_back(fd);
+    }
+    for (int fd : expired) close_connection(fd);
+}
+
+// =============================================================================
+// Handler pool
+// =============================================================================
+
+void HttpServer::submit(Job job) {
+    {
+        std::lock_guard<std::mutex> lk(jobs_mu_);
+        jobs_.push_back(std::move(job));
+    }
+    jobs_cv_.notify_one();
+}
 
-    std::string raw_resp = serialize_response(resp);
-    send(client_fd, raw_resp.c_str(), raw_resp.size(), MSG_NOSIGNAL);
+void HttpServer::complete(Completion done) {
+    {
+        std::lock_guard<std::mutex> lk(done_mu_);
+        done_.push_back(std::move(done));
+    }
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) { /* Counter saturated: loop is awake anyway */ }
+}
+
+std::string HttpServer::chunk_frame(const std::string& chunk, bool last) {
+    std::string out;
+    if (!chunk.empty()) {
+        char size_line[32];
+        int n = snprintf(size_line, sizeof(size_line), "%zx\r\n", chunk.size());
+        out.reserve(chunk.size() + n + 7);
+        out.append(size_line, n);
+        out.append(chunk);
+        out.append("\r\n");
+    }
+    if (last) out.append("0\r\n\r\n");
+    return out;
+}
+
+HttpServer::Response HttpServer::run_handler(const Route& route, const Request& req) {
+    Response resp;
+    try {
+        resp = route.handler(req);
+        if (resp.status_code < 400) stats_.requests_ok.fetch_add(1, std::memory_order_relaxed);
+        else                        stats_.requests_error.fetch_add(1, std::memory_order_relaxed);
+    } catch (const std::exception& e) {
+        resp = Response();
+        resp.status_code = 500;
+        resp.body = R"({"error":")" + std::string(e.what()) + R"("})";
+        stats_.requests_error.fetch_add(1, std::memory_order_relaxed);
+    }
+    return resp;
+}
+
+void HttpServer::handler_thread_func() {
+    ThreadPlacement::instance().place(ThreadRole::kHttp, 0, "http-pool");
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lk(jobs_mu_);
+            jobs_cv_.wait(lk, [this] { return !jobs_.empty() || stop_requested_.load(); });
+            if (jobs_.empty()) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        Completion done{job.fd, job.conn_id, {}, nullptr, false};
+        if (job.stream) {
+            std::string chunk;
+            bool more = false;
+            try {
+                more = job.stream->stream(chunk);
+            } catch (const std::exception& e) {
+                // Headers are already out; truncate so the client sees an error
+                LOG_WARN("HTTP: stream producer failed: %s", e.what());
+                stats_.requests_error.fetch_add(1, std::memory_order_relaxed);
+                done.close = true;
+                complete(std::move(done));
+                continue;
+            }
+            done.data = job.chunked ? chunk_frame(chunk, !more) : std::move(chunk);
+            if (more) done.stream = std::move(job.stream);
+        } else {
+            Response resp = run_handler(*job.route, job.request);
+            bool keep_alive = job.keep_alive && (job.chunked || !resp.stream);
+            done.data = serialize_response(resp, keep_alive, job.chunked);
+            done.close = !keep_alive;
+            if (resp.stream) done.stream = std::make_shared<Response>(std::move(resp));
+        }
+        complete(std::move(done));
+    }
 }
 
+// =============================================================================
+// Parsing and serialisation
+// =============================================================================
+
 HttpServer::Request HttpServer::parse_request(const std::string& raw) {
     Request req;
     std::istringstream stream(raw);
@@ -156,6 +567,7 @@ HttpServer::Request HttpServer::parse_request(const std::string& raw) {
         if (sp1 != std::string::npos && sp2 != std::string::npos) {
             req.method = line.substr(0, sp1);
             std::string full_path = line.substr(sp1 + 1, sp2 - sp1 - 1);
+            req.version = line.substr(sp2 + 1);
 
             auto qm = full_path.find('?');
             if (qm != std::string::npos) {
@@ -184,6 +596,24 @@ HttpServer::Request HttpServer::parse_request(const std::string& raw) {
     return req;
 }
 
+static std::string url_decode(const std::string& in) {
+    std::string out;
+    out.reserve(in.size());
+    for (size_t i = 0; i < in.size(); ++i) {
+        if (in[i] == '%' && i + 2 < in.size() &&
+            isxdigit(static_cast<unsigned char>(in[i + 1])) &&
+            isxdigit(static_cast<unsigned char>(in[i + 2]))) {
+            out.push_back(static_cast<char>(std::stoi(in.substr(i + 1, 2), nullptr, 16)));
+            i += 2;
+        } else if (in[i] == '+') {
+            out.push_back(' ');
+        } else {
+            out.push_back(in[i]);
+        }
+    }
+    return out;
+}
+
 std::unordered_map<std::string, std::string> HttpServer::parse_query_string(const std::string& qs) {
     std::unordered_map<std::string, std::string> params;
     std::istringstream stream(qs);
@@ -191,18 +621,21 @@ std::unordered_map<std::string, std::string> HttpServer::parse_query_string(cons
     while (std::getline(stream, pair, '&')) {
         auto eq = pair.find('=');
         if (eq != std::string::npos)
-            params[pair.substr(0, eq)] = pair.substr(eq + 1);
+            params[url_decode(pair.substr(0, eq))] = url_decode(pair.substr(eq + 1));
         else
-            params[pair] = "";
+            params[url_decode(pair)] = "";
     }
     return params;
 }
 
-std::string HttpServer::serialize_response(const Response& resp) {
+std::string HttpServer::serialize_response(const Response& resp, bool keep_alive, bool chunked) {
     std::string status_text;
     switch (resp.status_code) {
         case 200: status_text = "OK"; break;
+        case 400: status_text = "Bad Request"; break;
         case 404: status_text = "Not Found"; break;
+        case 413: status_text = "Payload Too Large"; break;
+        case 431: status_text = "Request Header Fields Too Large"; break;
         case 500: status_text = "Internal Server Error"; break;
         case 503: status_text = "Service Unavailable"; break;
         default:  status_text = "Unknown"; break;
@@ -211,13 +644,13 @@ std::string HttpServer::serialize_response(const Response& resp) {
     std::ostringstream ss;
     ss << "HTTP/1.1 " << resp.status_code << " " << status_text << "\r\n";
     ss << "Content-Type: " << resp.content_type << "\r\n";
-    ss << "Content-Length: " << resp.body.size() << "\r\n";
-    ss << "Connection: close\r\n";
+    if (!resp.stream) ss << "Content-Length: " << resp.body.size() << "\r\n";
+    else if (chunked) ss << "Transfer-Encoding: chunked\r\n";
+    ss << "Connection: " << (keep_alive ? "keep-alive" : "close") << "\r\n";
     for (auto& [k, v] : resp.headers) ss << k << ": " << v << "\r\n";
     ss << "\r\n";
-    ss << resp.body;
+    if (!resp.stream) ss << resp.body;
     return ss.str();
 }
 
 } // namespace sip_processor
-
@@ -0,0 +1,103 @@
+
+// =============================================================================
+// FILE: src/http/mwi_handler.cpp
+// =============================================================================
+#include "http/mwi_handler.h"
+#include "dispatch/dialog_dispatcher.h"
+#include "subscription/mwi_processor.h"
+#include "subscription/mwi_subscription_index.h"
+#include "common/metrics_registry.h"
+#include "common/logger.h"
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace sip_processor {
+
+using FeedStats = MwiHandler::FeedStats;
+static FeedStats g_feed_stats;
+
+static const MetricField<FeedStats> kFeedMetrics[] = {
+    {"sip_processor_mwi_feed_updates", MetricType::kCounter, "Mailbox updates received on POST /mwi", &FeedStats::updates_received},
+    {"sip_processor_mwi_feed_invalid", MetricType::kCounter, "Mailbox updates rejected as malformed", &FeedStats::updates_invalid},
+    {"sip_processor_mwi_feed_watchers_not_found", MetricType::kCounter, "Mailbox updates with no MWI watcher", &FeedStats::watchers_not_found},
+    {"sip_processor_mwi_feed_triggers", MetricType::kCounter, "MWI triggers handed to workers", &FeedStats::triggers_dispatched},
+    {"sip_processor_mwi_feed_triggers_dropped", MetricType::kCounter, "MWI triggers refused by a full worker queue or with no dialog owner", &FeedStats::triggers_dropped},
+};
+
+const FeedStats& MwiHandler::stats() { return g_feed_stats; }
+
+void MwiHandler::register_routes(HttpServer& server, const Dependencies& deps) {
+    static std::once_flag metrics_once;
+    std::call_once(metrics_once, [] {
+        MetricsRegistry::instance().add_fields(&g_feed_stats, g_feed_stats, kFeedMetrics);
+    });
+
+    auto d = deps;
+    server.route("POST", "/mwi", [d](const HttpServer::Request& r) { return handle_update(r, d); });
+}
+
+static HttpServer::Response bad_request(const char* parameter) {
+    HttpServer::Response resp;
+    resp.status_code = 400;
+    resp.body = std::string(R"({"error":"invalid_parameter","parameter":")") + parameter + "\"}";
+    return resp;
+}
+
+HttpServer::Response MwiHandler::handle_update(const HttpServer::Request& req,
+                                                const Dependencies& deps) {
+    g_feed_stats.updates_received.fetch_add(1, std::memory_order_relaxed);
+
+    auto summary = MwiProcessor::parse_message_summary(req.body);
+    if (!summary.valid) {
+        g_feed_stats.updates_invalid.fetch_add(1, std::memory_order_relaxed);
+        return bad_request("body");
+    }
+
+    std::string account;
+    auto ait = req.query_params.find("account");
+    if (ait != req.query_params.end()) account = ait->second;
+    else account.assign(summary.account.data(), summary.account.size());
+    if (account.empty()) {
+        g_feed_stats.updates_invalid.fetch_add(1, std::memory_order_relaxed);
+        return bad_request("account");
+    }
+
+    auto& idx = MwiSubscriptionIndex::instance();
+    auto tit = req.query_params.find("tenant");
+    auto watchers = (tit == req.query_params.end() || tit->second.empty())
+        ? idx.lookup(account)
+        : idx.lookup(account, tit->second);
+
+    size_t accepted = 0;
+    if (watchers.empty()) {
+        g_feed_stats.watchers_not_found.fetch_add(1, std::memory_order_relaxed);
+    } else if (deps.dispatcher) {
+        // One body for the whole fan-out; each trigger holds a reference
+        auto body = std::make_shared<const std::string>(req.body);
+        std::vector<std::unique_ptr<SipEvent>> triggers;
+        triggers.reserve(watchers.size());
+        for (const auto& w : watchers) {
+            triggers.push_back(SipEvent::create_mwi_trigger(w.dialog_id, w.tenant_id, body));
+        }
+        accepted = deps.dispatcher->dispatch_batch(std::move(triggers));
+        g_feed_stats.triggers_dispatched.fetch_add(accepted, std::memory_order_relaxed);
+        g_feed_stats.triggers_dropped.fetch_add(watchers.size() - accepted, std::memory_order_relaxed);
+        if (accepted < watchers.size()) {
+            LOG_WARN("MwiFeed: account=%s dispatched %zu of %zu watchers",
+                     account.c_str(), accepted, watchers.size());
+        }
+    }
+
+    LOG_DEBUG("MwiFeed: account=%s new=%d old=%d watchers=%zu",
+              account.c_str(), summary.voice().new_messages, summary.voice().old_messages,
+              watchers.size());
+
+    std::ostringstream j;
+    j << "{\"watchers\":" << watchers.size() << ",\"dispatched\":" << accepted << "}";
+    HttpServer::Response resp;
+    resp.body = j.str();
+    return resp;
+}
+
+} // namespace sip_processor
@@ -4,16 +4,29 @@
 // =============================================================================
 #include "http/stats_handler.h"
 #include "dispatch/dialog_dispatcher.h"
+#include "dispatch/overload_controller.h"
 #include "dispatch/stale_subscription_reaper.h"
+#include "dispatch/subscription_recovery.h"
 #include "presence/presence_tcp_client.h"
 #include "presence/presence_event_router.h"
 #include "presence/presence_failover_manager.h"
 #include "persistence/mongo_client.h"
 #include "persistence/subscription_store.h"
+#include "persistence/local_snapshot_store.h"
 #include "subscription/subscription_state.h"
 #include "subscription/blf_subscription_index.h"
+#include "subscription/mwi_subscription_index.h"
 #include "common/slow_event_logger.h"
 #include "common/config.h"
+#include "common/latency_histogram.h"
+#include "common/logger.h"
+#include "common/metrics_registry.h"
+#include "common/string_interner.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <memory>
 #include <sstream>
 
 namespace sip_processor {
@@ -24,10 +37,42 @@ void StatsHandler::register_routes(HttpServer& server, const Dependencies& deps)
     server.route("GET", "/stats", [d](const HttpServer::Request& r) { return handle_stats(r, d); });
     server.route("GET", "/stats/workers", [d](const HttpServer::Request& r) { return handle_stats_workers(r, d); });
     server.route("GET", "/stats/presence", [d](const HttpServer::Request& r) { return handle_stats_presence(r, d); });
+    server.route("GET", "/stats/latency", [d](const HttpServer::Request& r) { return handle_stats_latency(r, d); });
+    server.route("GET", "/stats/slow", [d](const HttpServer::Request& r) { return handle_stats_slow(r, d); });
+    server.route("GET", "/metrics", [d](const HttpServer::Request& r) { return handle_metrics(r, d); });
     server.route("GET", "/subscriptions", [d](const HttpServer::Request& r) { return handle_subscriptions(r, d); });
     server.route("GET", "/config", [d](const HttpServer::Request& r) { return handle_config(r, d); });
 }
 
+static void append_json_string(std::string& out, std::string_view s) {
+    out.push_back('"');
+    for (char c : s) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        if (static_cast<unsigned char>(c) >= 0x20) out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+// Nanoseconds as microseconds with one decimal
+static std::string ns_to_us(uint64_t ns) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.1f", static_cast<double>(ns) / 1000.0);
+    return buf;
+}
+
+// Summary fields of one stage, without the enclosing braces
+static void append_latency(std::ostringstream& j, const LatencyHistogram::Snapshot& s, bool detail) {
+    j << "\"count\":" << s.count;
+    j << ",\"p50_us\":" << ns_to_us(s.percentile(50));
+    j << ",\"p90_us\":" << ns_to_us(s.percentile(90));
+    j << ",\"p99_us\":" << ns_to_us(s.percentile(99));
+    j << ",\"p999_us\":" << ns_to_us(s.percentile(99.9));
+    j << ",\"max_us\":" << ns_to_us(s.max);
+    if (detail) {
+        j << ",\"mean_us\":" << ns_to_us(static_cast<uint64_t>(s.mean()));
+    }
+}
+
 HttpServer::Response StatsHandler::handle_stats(const HttpServer::Request&, const Dependencies& d) {
     HttpServer::Response resp;
     std::ostringstream j;
@@ -40,12 +85,28 @@ HttpServer::Response StatsHandler::handle_stats(const HttpServer::Request&, cons
         j << "\"events_received\":" << agg.total_events_received;
         j << ",\"events_processed\":" << agg.total_events_processed;
         j << ",\"events_dropped\":" << agg.total_events_dropped;
+        j << ",\"events_unroutable\":" << agg.total_events_unroutable;
         j << ",\"presence_triggers\":" << agg.total_presence_triggers;
         j << ",\"dialogs_active\":" << agg.total_dialogs_active;
         j << ",\"dialogs_reaped\":" << agg.total_dialogs_reaped;
         j << ",\"max_queue_depth\":" << agg.max_queue_depth;
         j << ",\"slow_events\":" << agg.total_slow_events;
         j << "}";
+
+        if (const OverloadController* ov = d.dispatcher->overload()) {
+            const auto& os = ov->stats();
+            j << ",\"overload\":{";
+            j << "\"level\":\"" << overload_level_name(ov->level()) << "\"";
+            j << ",\"pressure_pct\":" << os.pressure_pct.load();
+            j << ",\"shed_permille\":" << os.shed_permille.load();
+            j << ",\"queue_fill_pct\":" << os.queue_fill_pct.load();
+            j << ",\"queue_wait_p99_us\":" << os.queue_wait_p99_us.load();
+            j << ",\"notify_backlog\":" << os.notify_backlog.load();
+            j << ",\"level_changes\":" << os.level_changes.load();
+            j << ",\"subscribes_shed\":" << os.subscribes_shed.load();
+            j << ",\"refreshes_extended\":" << os.refreshes_extended.load();
+            j << "}";
+        }
     }
 
     // Registry
@@ -61,6 +122,55 @@ HttpServer::Response StatsHandler::handle_stats(const HttpServer::Request&, cons
     j << ",\"blf_index\":{";
     j << "\"monitored_uris\":" << idx.monitored_uri_count();
     j << ",\"total_watchers\":" << idx.total_watcher_count();
+    j << ",\"watchers_by_tenant\":{";
+    {
+        auto per_tenant = idx.tenant_watcher_counts();
+        std::string key;
+        for (size_t i = 0; i < per_tenant.size(); ++i) {
+            if (i > 0) j << ",";
+            key.clear();
+            append_json_string(key, per_tenant[i].first.view());
+            j << key << ":" << per_tenant[i].second;
+        }
+    }
+    j << "}}";
+
+    auto& mwi_idx = MwiSubscriptionIndex::instance();
+    j << ",\"mwi_index\":{";
+    j << "\"accounts\":" << mwi_idx.account_count();
+    j << ",\"total_watchers\":" << mwi_idx.total_watcher_count();
+    j << "}";
+
+    // Interned tenant ids / URIs
+    auto& interner = StringInterner::instance();
+    j << ",\"interner\":{";
+    j << "\"symbols\":" << interner.size();
+    j << ",\"bytes\":" << interner.bytes();
+    j << ",\"capacity\":" << interner.capacity();
+    j << ",\"rejected\":" << interner.rejected();
+    j << "}";
+
+    // Per-stage latency (merged across threads)
+    j << ",\"latency\":{";
+    for (size_t s = 0; s < kNumLatencyStages; ++s) {
+        auto stage = static_cast<LatencyStage>(s);
+        if (s > 0) j << ",";
+        j << "\"" << latency_stage_name(stage) << "\":{";
+        append_latency(j, LatencyRecorder::instance().snapshot(stage), false);
+        j << "}";
+    }
+    j << "}";
+
+    // Async logging pipeline
+    auto& ls = Logger::instance().stats();
+    j << ",\"logging\":{";
+    j << "\"async\":" << (Logger::instance().async() ? "true" : "false");
+    j << ",\"written\":" << ls.written.load();
+    j << ",\"dropped\":" << ls.dropped.load();
+    j << ",\"writev_calls\":" << ls.writev_calls.load();
+    j << ",\"bytes_written\":" << ls.bytes_written.load();
+    j << ",\"rotations\":" << ls.rotations.load();
+    j << ",\"thread_buffers\":" << ls.thread_buffers.load();
     j << "}";
 
     // Reaper
@@ -82,7 +192,8 @@ HttpServer::Response StatsHandler::handle_stats(const HttpServer::Request&, cons
         j << "\"warn_count\":" << ss.warn_count.load();
         j << ",\"error_count\":" << ss.error_count.load();
         j << ",\"critical_count\":" << ss.critical_count.load();
-        j << ",\"max_duration_ms\":" << ss.max_duration_ms.load();
+        j << ",\"max_duration_us\":" << ss.max_duration_us.load();
+        j << ",\"samples_captured\":" << ss.samples_captured.load();
         j << ",\"warn_threshold_ms\":" << th.warn.count();
         j << ",\"error_threshold_ms\":" << th.error.count();
         j << ",\"critical_threshold_ms\":" << th.critical.count();
@@ -111,6 +222,38 @@ HttpServer::Response StatsHandler::handle_stats(const HttpServer::Request&, cons
         j << "}";
     }
 
+    if (d.snapshot_store && d.snapshot_store->is_enabled()) {
+        auto& ss = d.snapshot_store->stats();
+        j << ",\"snapshot\":{";
+        j << "\"journal_appends\":" << ss.journal_appends.load();
+        j << ",\"journal_bytes\":" << ss.journal_bytes.load();
+        j << ",\"journal_flushes\":" << ss.journal_flushes.load();
+        j << ",\"snapshots_written\":" << ss.snapshots_written.load();
+        j << ",\"snapshot_records\":" << ss.snapshot_records.load();
+        j << ",\"last_snapshot_ms\":" << ss.last_snapshot_ms.load();
+        j << ",\"corrupt_frames\":" << ss.corrupt_frames.load();
+        j << ",\"errors\":" << ss.errors.load();
+        j << "}";
+    }
+
+    if (d.recovery) {
+        auto& rs = d.recovery->stats();
+        j << ",\"recovery\":{";
+        j << "\"source\":\"" << recovery_source_to_string(d.recovery->source()) << "\"";
+        j << ",\"records_loaded\":" << rs.records_loaded.load();
+        j << ",\"load_ms\":" << rs.load_ms.load();
+        j << ",\"reconcile_done\":" << (rs.reconcile_done.load() ? "true" : "false");
+        j << ",\"reconcile_fetched\":" << rs.reconcile_fetched.load();
+        j << ",\"reconcile_ms\":" << rs.reconcile_ms.load();
+        if (d.dispatcher) {
+            auto a = d.dispatcher->aggregate_stats();
+            j << ",\"notify_owed\":" << a.recovery_notify_owed;
+            j << ",\"notify_queued\":" << a.recovery_notify_queued;
+            j << ",\"notify_sent\":" << a.recovery_notify_sent;
+        }
+        j << "}";
+    }
+
     j << "}";
     resp.body = j.str();
     return resp;
@@ -128,18 +271,47 @@ HttpServer::Response StatsHandler::handle_stats_workers(const HttpServer::Reques
             auto& w = d.dispatcher->worker(i);
             auto& s = w.stats();
             j << "{\"index\":" << i;
+            j << ",\"state\":\"" << (i < d.dispatcher->active_workers() ? "active" : "draining") << "\"";
             j << ",\"events_received\":" << s.events_received.load();
             j << ",\"events_processed\":" << s.events_processed.load();
             j << ",\"events_dropped\":" << s.events_dropped.load();
             j << ",\"presence_triggers\":" << s.presence_triggers_processed.load();
             j << ",\"dialogs_active\":" << s.dialogs_active.load();
+            j << ",\"dialogs_owned\":" << d.dispatcher->routing().owned(static_cast<uint32_t>(i));
             j << ",\"queue_depth\":" << s.queue_depth.load();
+            j << ",\"transaction_queue_depth\":" << s.transaction_queue_depth.load();
+            j << ",\"feed_queue_depth\":" << s.feed_queue_depth.load();
+            j << ",\"feed_throttled_cycles\":" << s.feed_throttled_cycles.load();
+            j << ",\"presence_coalesced\":" << s.presence_coalesced.load();
+            j << ",\"refresh_fast_path\":" << s.refresh_fast_path.load();
+            j << ",\"refresh_checkpoints\":" << s.refresh_checkpoints.load();
+            j << ",\"subscribes_too_brief\":" << s.subscribes_too_brief.load();
             j << ",\"slow_events\":" << s.slow_events.load();
+            j << ",\"migrations_in\":" << s.migrations_in.load();
+            j << ",\"migrations_out\":" << s.migrations_out.load();
+            j << ",\"events_forwarded\":" << s.events_forwarded.load();
             j << "}";
         }
     }
+    j << "]";
 
-    j << "]}";
+    if (d.dispatcher) {
+        auto b = d.dispatcher->balance();
+        j << ",\"active_workers\":" << d.dispatcher->active_workers();
+        j << ",\"max_workers\":" << d.dispatcher->max_workers();
+        j << ",\"balance\":{";
+        j << "\"dialogs_max\":" << b.dialogs_max;
+        j << ",\"dialogs_min\":" << b.dialogs_min;
+        j << ",\"dialogs_mean\":" << b.dialogs_mean;
+        j << ",\"imbalance_ratio\":" << b.imbalance();
+        j << ",\"busiest_worker\":" << b.busiest;
+        j << ",\"idlest_worker\":" << b.idlest;
+        j << ",\"queue_depth_max\":" << b.queue_depth_max;
+        j << ",\"queue_depth_mean\":" << b.queue_depth_mean;
+        j << "}";
+    }
+
+    j << "}";
     resp.body = j.str();
     return resp;
 }
@@ -172,6 +344,8 @@ HttpServer::Response StatsHandler::handle_stats_presence(const HttpServer::Reque
         j << ",\"events_processed\":" << rs.events_processed.load();
         j << ",\"notifications_generated\":" << rs.notifications_generated.load();
         j << ",\"watchers_not_found\":" << rs.watchers_not_found.load();
+        j << ",\"prefilter_rejected\":" << rs.prefilter_rejected.load();
+        j << ",\"tenant_scoped_events\":" << rs.tenant_scoped_events.load();
         j << ",\"queue_depth\":" << rs.queue_depth.load();
         j << "}";
     }
@@ -199,40 +373,269 @@ HttpServer::Response StatsHandler::handle_stats_presence(const HttpServer::Reque
     return resp;
 }
 
-HttpServer::Response StatsHandler::handle_subscriptions(const HttpServer::Request& req,
-                                                          const Dependencies& d) {
+// GET /stats/latency[?stage=<name>][&buckets=true]
+// Percentiles, mean and max per pipeline stage; buckets=true adds the
+// non-empty histogram buckets as [upper_bound_ns, count] pairs.
+HttpServer::Response StatsHandler::handle_stats_latency(const HttpServer::Request& req,
+                                                         const Dependencies&) {
     HttpServer::Response resp;
-    auto& reg = SubscriptionRegistry::instance();
-
-    auto tenant_it = req.query_params.find("tenant");
-    std::vector<SubscriptionRegistry::SubscriptionInfo> subs;
+    auto param = [&](const char* key) -> const std::string* {
+        auto it = req.query_params.find(key);
+        return (it != req.query_params.end() && !it->second.empty()) ? &it->second : nullptr;
+    };
+    const std::string* only = param("stage");
+    const std::string* buckets = param("buckets");
+    bool with_buckets = buckets && (*buckets == "true" || *buckets == "1");
 
-    if (tenant_it != req.query_params.end()) {
-        subs = reg.get_tenant_subscriptions(tenant_it->second);
-    } else {
-        subs = reg.get_all();
+    if (only) {
+        bool known = false;
+        for (size_t s = 0; s < kNumLatencyStages; ++s) {
+            known |= (*only == latency_stage_name(static_cast<LatencyStage>(s)));
+        }
+        if (!known) {
+            resp.status_code = 400;
+            resp.body = R"({"error":"invalid_parameter","parameter":"stage"})";
+            return resp;
+        }
     }
 
     std::ostringstream j;
-    j << "{\"count\":" << subs.size() << ",\"subscriptions\":[";
-    for (size_t i = 0; i < subs.size() && i < 1000; ++i) {  // Limit response
-        if (i > 0) j << ",";
-        auto& s = subs[i];
-        j << "{\"dialog_id\":\"" << s.dialog_id << "\"";
-        j << ",\"tenant_id\":\"" << s.tenant_id << "\"";
-        j << ",\"type\":\"" << subscription_type_to_string(s.type) << "\"";
-        j << ",\"lifecycle\":\"" << lifecycle_to_string(s.lifecycle) << "\"";
-        j << ",\"worker\":" << s.worker_index;
+    j << "{\"unit\":\"us\",\"stages\":{";
+    bool first = true;
+    for (size_t s = 0; s < kNumLatencyStages; ++s) {
+        auto stage = static_cast<LatencyStage>(s);
+        if (only && *only != latency_stage_name(stage)) continue;
+        auto snap = LatencyRecorder::instance().snapshot(stage);
+        if (!first) j << ",";
+        first = false;
+        j << "\"" << latency_stage_name(stage) << "\":{";
+        append_latency(j, snap, true);
+        if (with_buckets) {
+            j << ",\"buckets\":[";
+            bool first_bucket = true;
+            for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+                if (!snap.counts[i]) continue;
+                if (!first_bucket) j << ",";
+                first_bucket = false;
+                j << "[" << LatencyHistogram::bucket_upper(i) << "," << snap.counts[i] << "]";
+            }
+            j << "]";
+        }
         j << "}";
     }
-    if (subs.size() > 1000) j << "],\"truncated\":true";
-    else j << "]";
-    j << "}";
-
+    j << "}}";
     resp.body = j.str();
     return resp;
 }
 
+// GET /stats/slow[?limit=N]
+// The slowest events of the current and previous window, slowest first,
+// with the per-stage breakdown recorded by each timer.
+HttpServer::Response StatsHandler::handle_stats_slow(const HttpServer::Request& req,
+                                                      const Dependencies& d) {
+    HttpServer::Response resp;
+    if (!d.slow_logger) {
+        resp.status_code = 404;
+        resp.body = R"({"error":"not_found","path":"/stats/slow"})";
+        return resp;
+    }
+
+    size_t limit = d.slow_logger->top_n();
+    auto it = req.query_params.find("limit");
+    if (it != req.query_params.end() && !it->second.empty()) {
+        const std::string& v = it->second;
+        if (v.find_first_not_of("0123456789") != std::string::npos || v.size() > 9) {
+            resp.status_code = 400;
+            resp.body = R"({"error":"invalid_parameter","parameter":"limit"})";
+            return resp;
+        }
+        limit = std::stoul(v);
+    }
+
+    auto th = d.slow_logger->thresholds();
+    std::string out = "{\"top_n\":" + std::to_string(d.slow_logger->top_n());
+    out += ",\"window_sec\":" + std::to_string(d.slow_logger->window().count());
+    out += ",\"warn_threshold_ms\":" + std::to_string(th.warn.count());
+    out += ",\"events\":[";
+    bool first = true;
+    for (const auto& s : d.slow_logger->slowest(limit)) {
+        if (!first) out += ",";
+        first = false;
+        out += "{\"operation\":";  append_json_string(out, s.operation);
+        out += ",\"duration_us\":" + ns_to_us(s.total_ns);
+        out += ",\"at_ms\":" + std::to_string(s.wall_ms);
+        out += ",\"dialog_id\":";  append_json_string(out, s.dialog_id);
+        out += ",\"context\":";    append_json_string(out, s.context);
+        out += ",\"stages_us\":{";
+        for (size_t i = 0; i < s.num_stages; ++i) {
+            if (i) out += ",";
+            append_json_string(out, s.stages[i].name);
+            out += ":" + ns_to_us(s.stages[i].ns);
+        }
+        out += "}}";
+    }
+    out += "]}";
+    resp.body = std::move(out);
+    return resp;
+}
+
+// GET /metrics
+// OpenMetrics exposition of everything in MetricsRegistry, rendered straight
+// into the response body. The body is reserved from the last scrape's size,
+// so it is allocated once rather than grown while rendering.
+HttpServer::Response StatsHandler::handle_metrics(const HttpServer::Request&, const Dependencies&) {
+    static std::atomic<size_t> last_size{0};
+
+    HttpServer::Response resp;
+    resp.content_type = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    // Some headroom for series registered since
+    resp.body.reserve(last_size.load(std::memory_order_relaxed) * 9 / 8);
+    MetricsRegistry::instance().render(resp.body);
+    last_size.store(resp.body.size(), std::memory_order_relaxed);
+    return resp;
+}
+
+static constexpr size_t kDefaultLimit = 1000;
+static constexpr size_t kMaxLimit     = 100000;
+static constexpr size_t kChunkEntries = 256;   // Entries rendered per HTTP chunk
+
+// Cursor tokens are "<shard>.<hex of last dialog_id>" so they survive any
+// characters a dialog id may contain.
+static std::string encode_cursor(const SubscriptionRegistry::Cursor& c) {
+    static const char* kHex = "0123456789abcdef";
+    std::string out = std::to_string(c.shard) + ".";
+    for (unsigned char ch : c.after) { out.push_back(kHex[ch >> 4]); out.push_back(kHex[ch & 0xF]); }
+    return out;
+}
+
+// Longer than any token encode_cursor produces for a real dialog id
+static constexpr size_t kMaxCursorLen = 4096;
+
+static bool decode_cursor(const std::string& token, SubscriptionRegistry::Cursor& c) {
+    auto dot = token.find('.');
+    if (token.size() > kMaxCursorLen || dot == 0 || dot == std::string::npos ||
+        (token.size() - dot - 1) % 2 != 0) return false;
+    const char* first = token.data();
+    auto [end, ec] = std::from_chars(first, first + dot, c.shard);
+    if (ec != std::errc() || end != first + dot) return false;
+    c.after.clear();
+    for (size_t i = dot + 1; i < token.size(); i += 2) {
+        unsigned byte = 0;
+        auto [hex_end, hex_ec] = std::from_chars(first + i, first + i + 2, byte, 16);
+        if (hex_ec != std::errc() || hex_end != first + i + 2) return false;
+        c.after.push_back(static_cast<char>(byte));
+    }
+    return c.shard <= SubscriptionRegistry::kNumShards;
+}
+
+HttpServer::Response StatsHandler::handle_subscriptions(const HttpServer::Request& req,
+                                                          const Dependencies&) {
+    HttpServer::Response resp;
+    auto param = [&](const char* key) -> const std::string* {
+        auto it = req.query_params.find(key);
+        return (it != req.query_params.end() && !it->second.empty()) ? &it->second : nullptr;
+    };
+    auto bad_request = [&](const std::string& what) {
+        resp.status_code = 400;
+        resp.body = R"({"error":"invalid_parameter","parameter":")" + what + R"("})";
+        return resp;
+    };
+
+    // Filters
+    std::string uri_prefix;
+    TenantId tenant;
+    bool by_tenant = false, unknown_tenant = false;
+    bool by_type = false, by_lifecycle = false, by_worker = false;
+    SubscriptionType type = SubscriptionType::kUnknown;
+    SubLifecycle lifecycle = SubLifecycle::kPending;
+    size_t worker = 0, limit = kDefaultLimit;
+
+    if (auto v = param("tenant")) {
+        by_tenant = true;
+        unknown_tenant = !Symbol::find(*v, tenant);   // Never seen: nothing can match
+    }
+    if (auto v = param("uri_prefix")) uri_prefix = *v;
+    if (auto v = param("type")) {
+        type = subscription_type_from_string(*v);
+        if (type == SubscriptionType::kUnknown) return bad_request("type");
+        by_type = true;
+    }
+    if (auto v = param("lifecycle")) {
+        lifecycle = lifecycle_from_string(*v);
+        if (*v != lifecycle_to_string(lifecycle)) return bad_request("lifecycle");
+        by_lifecycle = true;
+    }
+    if (auto v = param("worker")) {
+        if (v->find_first_not_of("0123456789") != std::string::npos || v->size() > 9) return bad_request("worker");
+        worker = std::stoul(*v);
+        by_worker = true;
+    }
+    if (auto v = param("limit")) {
+        if (v->find_first_not_of("0123456789") != std::string::npos || v->size() > 9) return bad_request("limit");
+        limit = std::min(std::max<size_t>(std::stoul(*v), 1), kMaxLimit);
+    }
+
+    SubscriptionRegistry::Cursor cursor;
+    if (auto v = param("cursor")) {
+        if (!decode_cursor(*v, cursor)) return bad_request("cursor");
+    }
+
+    SubscriptionRegistry::Filter filter;
+    if (unknown_tenant) {
+        filter = [](const SubscriptionRegistry::SubscriptionInfo&) { return false; };
+    } else if (by_tenant || !uri_prefix.empty() || by_type || by_lifecycle || by_worker) {
+        filter = [=](const SubscriptionRegistry::SubscriptionInfo& s) {
+            return (!by_tenant || s.tenant_id == tenant) &&
+                   (!by_type || s.type == type) &&
+                   (!by_lifecycle || s.lifecycle == lifecycle) &&
+                   (!by_worker || s.worker_index == worker) &&
+                   (uri_prefix.empty() || s.monitored_uri.view().compare(0, uri_prefix.size(), uri_prefix) == 0);
+        };
+    }
+
+    // Render incrementally from shard-at-a-time scans; memory is bounded by
+    // one chunk and no registry lock is held while the socket is written.
+    struct StreamState {
+        SubscriptionRegistry::Cursor cursor;
+        size_t remaining;
+        size_t count = 0;
+        bool started = false;
+        std::vector<SubscriptionRegistry::SubscriptionInfo> batch;
+    };
+    auto st = std::make_shared<StreamState>();
+    st->cursor = std::move(cursor);
+    st->remaining = limit;
+
+    resp.stream = [st, filter](std::string& chunk) {
+        if (!st->started) { chunk += "{\"subscriptions\":["; st->started = true; }
+
+        st->batch.clear();
+        if (st->remaining > 0 && !st->cursor.done()) {
+            SubscriptionRegistry::instance().scan(
+                st->cursor, std::min(kChunkEntries, st->remaining), filter, st->batch);
+        }
+        for (const auto& s : st->batch) {
+            if (st->count++ > 0) chunk += ",";
+            chunk += "{\"dialog_id\":";         append_json_string(chunk, s.dialog_id);
+            chunk += ",\"tenant_id\":";         append_json_string(chunk, s.tenant_id.view());
+            chunk += ",\"type\":\"";            chunk += subscription_type_to_string(s.type);
+            chunk += "\",\"lifecycle\":\"";     chunk += lifecycle_to_string(s.lifecycle);
+            chunk += "\",\"worker\":";          chunk += std::to_string(s.worker_index);
+            chunk += ",\"monitored_uri\":";     append_json_string(chunk, s.monitored_uri.view());
+            chunk += "}";
+        }
+        st->remaining -= st->batch.size();
+        if (st->remaining > 0 && !st->cursor.done()) return true;
+
+        chunk += "],\"count\":" + std::to_string(st->count) + ",\"next_cursor\":";
+        if (st->cursor.done()) chunk += "null";
+        else chunk += "\"" + encode_cursor(st->cursor) + "\"";
+        chunk += "}";
+        return false;
+    };
+    return resp;
+}
+
 HttpServer::Response StatsHandler::handle_config(const HttpServer::Request&,
                                                    const Dependencies& d) {
     HttpServer::Response resp;
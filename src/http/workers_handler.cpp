@@ -0,0 +1,49 @@
+
+// =============================================================================
+// FILE: src/http/workers_handler.cpp
+// =============================================================================
+#include "http/workers_handler.h"
+#include "dispatch/dialog_dispatcher.h"
+#include <cstdlib>
+#include <sstream>
+
+namespace sip_processor {
+
+void WorkersHandler::register_routes(HttpServer& server, const Dependencies& deps) {
+    auto d = deps;
+    server.route("POST", "/workers", [d](const HttpServer::Request& r) { return handle_resize(r, d); });
+}
+
+static HttpServer::Response bad_request(const char* parameter) {
+    HttpServer::Response resp;
+    resp.status_code = 400;
+    resp.body = std::string(R"({"error":"invalid_parameter","parameter":")") + parameter + "\"}";
+    return resp;
+}
+
+HttpServer::Response WorkersHandler::handle_resize(const HttpServer::Request& req,
+                                                    const Dependencies& deps) {
+    HttpServer::Response resp;
+    if (!deps.dispatcher) { resp.status_code = 503; return resp; }
+
+    auto it = req.query_params.find("count");
+    if (it == req.query_params.end() || it->second.empty()) return bad_request("count");
+    char* end = nullptr;
+    unsigned long count = std::strtoul(it->second.c_str(), &end, 10);
+    if (*end != '\0' || count == 0 || count > deps.dispatcher->max_workers()) return bad_request("count");
+
+    Result r = deps.dispatcher->resize(count);
+    if (r != Result::kOk) {
+        resp.status_code = r == Result::kShuttingDown ? 503 : 500;
+        resp.body = std::string(R"({"error":")") + result_to_string(r) + "\"}";
+        return resp;
+    }
+
+    std::ostringstream j;
+    j << "{\"active_workers\":" << deps.dispatcher->active_workers()
+      << ",\"running_workers\":" << deps.dispatcher->num_workers() << "}";
+    resp.body = j.str();
+    return resp;
+}
+
+} // namespace sip_processor
@@ -5,28 +5,42 @@
 #include "common/config.h"
 #include "common/logger.h"
 #include "common/slow_event_logger.h"
+#include "common/string_interner.h"
+#include "common/thread_affinity.h"
 #include "sip/sip_callback_handler.h"
 #include "sip/sip_stack_manager.h"
 #include "dispatch/dialog_dispatcher.h"
+#include "dispatch/overload_controller.h"
 #include "dispatch/stale_subscription_reaper.h"
+#include "dispatch/subscription_recovery.h"
 #include "presence/presence_tcp_client.h"
 #include "presence/presence_event_router.h"
 #include "presence/presence_failover_manager.h"
+#include "presence/presence_distributor.h"
+#include "presence/interest_publisher.h"
 #include "persistence/mongo_client.h"
 #include "persistence/subscription_store.h"
+#include "persistence/local_snapshot_store.h"
+#include "persistence/subscription_replication.h"
 #include "subscription/blf_subscription_index.h"
 #include "http/http_server.h"
 #include "http/health_handler.h"
+#include "http/mwi_handler.h"
+#include "http/workers_handler.h"
 #include "http/stats_handler.h"
 #include <csignal>
 #include <atomic>
+#include <thread>
 
 using namespace sip_processor;
 
 static std::atomic<bool> g_shutdown{false};
+static std::atomic<int> g_signal{0};
 
+// Logging is not async-signal-safe (it pushes into the interrupted thread's
+// ring), so the handler only records the signal for the main loop.
 static void signal_handler(int sig) {
-    LOG_INFO("Signal %d received", sig);
+    g_signal.store(sig, std::memory_order_relaxed);
     g_shutdown.store(true, std::memory_order_release);
 }
 
@@ -36,15 +50,25 @@ int main(int argc, char* argv[]) {
 
     // 1. Load config
     Config config = (argc > 1) ? Config::load_from_file(argv[1]) : Config::load_defaults();
+    // Before the logger starts its writer thread, so that thread is placed too
+    bool placement_ok = ThreadPlacement::instance().configure(config);
 
     // Configure file-based logging with rotation
+    AsyncLogConfig async_log;
+    async_log.enabled             = config.log_async;
+    async_log.thread_buffer_bytes = config.log_thread_buffer_kb * 1024;
+    async_log.flush_interval      = config.log_flush_interval;
+    async_log.overflow            = parse_log_overflow_policy(config.log_overflow_policy);
     Logger::instance().configure(
         config.log_directory,
         config.log_base_name,
         parse_log_level(config.log_console_level_str),
         config.log_max_file_size_mb * 1024 * 1024,
-        config.log_max_rotated_files);
+        config.log_max_rotated_files,
+        async_log);
     Logger::instance().set_level(parse_log_level(config.log_level_str));
+    if (!placement_ok) LOG_WARN("Malformed [affinity] CPU list; those roles are left unpinned");
+    LOG_INFO("Thread placement: %s", ThreadPlacement::instance().describe().c_str());
 
     // Signals
     struct sigaction sa{}; sa.sa_handler = signal_handler; sigemptyset(&sa.sa_mask);
@@ -52,6 +76,7 @@ int main(int argc, char* argv[]) {
     signal(SIGPIPE, SIG_IGN);
 
     // 2. Shared components
+    StringInterner::instance().set_capacity(config.max_interned_symbols);   // Before recovery interns
     auto slow_logger = std::make_shared<SlowEventLogger>(config);
 
     // 3. MongoDB
@@ -68,27 +93,51 @@ int main(int argc, char* argv[]) {
         sub_store = std::make_shared<SubscriptionStore>(config, nullptr);
     }
 
+    // Local snapshot + journal sees every change the store sees
+    auto snapshot_store = std::make_shared<LocalSnapshotStore>(config);
+    if (snapshot_store->is_enabled()) sub_store->add_change_listener(snapshot_store);
+
+    // Hot standby: the primary streams the same changes to its standby
+    std::shared_ptr<ReplicationSender> replication_sender;
+    if (config.replication_role == ReplicationRole::kPrimary) {
+        replication_sender = std::make_shared<ReplicationSender>(config);
+        sub_store->add_change_listener(replication_sender);
+    }
+
     // 4. SIP stack (create before dispatcher so workers can reference it)
     SipStackManager stack(config);
 
     // 5. Dispatcher (pass stack pointer so workers can send responses/NOTIFYs)
     DialogDispatcher dispatcher(config, slow_logger, sub_store, &stack);
     SipCallbackHandler::set_dispatcher(&dispatcher);
+    OverloadController overload(config, dispatcher, &stack);
+    dispatcher.set_overload_controller(&overload);
 
-    // 6. Recovery: load subscriptions from MongoDB BEFORE starting dispatcher
-    if (sub_store && sub_store->is_enabled()) {
-        std::vector<SubscriptionStore::StoredSubscription> recovered;
-        if (sub_store->load_active_subscriptions(recovered) == Result::kOk) {
-            LOG_INFO("Recovering %zu subscriptions from MongoDB...", recovered.size());
-            for (auto& stored : recovered) {
-                size_t widx = dispatcher.worker_index_for(stored.record.dialog_id);
-                dispatcher.worker(widx).load_recovered_subscription(std::move(stored.record));
-            }
-            LOG_INFO("Recovery complete: %zu subscriptions loaded", recovered.size());
-        }
+    // Sized before recovery fills the index
+    BlfSubscriptionIndex::instance().configure_prefilter(config.presence_watcher_prefilter);
+
+    // 6. Recovery: local snapshot (or MongoDB) BEFORE starting dispatcher
+    SubscriptionRecovery recovery(config, dispatcher, sub_store, snapshot_store);
+    if (replication_sender) recovery.add_replay_listener(replication_sender);
+    if (recovery.recover() != Result::kOk) {
+        LOG_ERROR("Recovery failed — starting with no subscriptions");
+    }
+    if (snapshot_store->start() != Result::kOk) {
+        LOG_ERROR("Local snapshot unavailable — warm restart will fall back to MongoDB");
     }
 
     if (dispatcher.start() != Result::kOk) { LOG_FATAL("Dispatcher start failed"); return 1; }
+    recovery.start_reconcile();
+    overload.start();
+
+    if (replication_sender && replication_sender->start() != Result::kOk) {
+        LOG_ERROR("Replication sender failed to listen — no standby can attach");
+    }
+    std::unique_ptr<ReplicationReceiver> replication_receiver;
+    if (config.replication_role == ReplicationRole::kStandby) {
+        replication_receiver = std::make_unique<ReplicationReceiver>(config, dispatcher);
+        replication_receiver->start();
+    }
 
     // 7. Start SIP stack (after dispatcher so callbacks have a target)
     if (stack.start() != Result::kOk) { LOG_FATAL("SIP stack failed"); return 1; }
@@ -99,8 +148,19 @@ int main(int argc, char* argv[]) {
     PresenceEventRouter presence_router(config, dispatcher, slow_logger);
     presence_router.start();
 
+    // Embedded distributor: other nodes take their share of this feed
+    std::unique_ptr<PresenceDistributor> distributor;
+    if (config.distributor_enabled) {
+        distributor = std::make_unique<PresenceDistributor>(config);
+        if (distributor->start() != Result::kOk) {
+            LOG_ERROR("Presence distributor failed to start — not redistributing");
+            distributor.reset();
+        }
+    }
+
     PresenceTcpClient presence_client(config, failover_mgr);
     presence_client.set_event_callback([&](CallStateEvent&& ev) {
+        if (distributor) distributor->on_call_state_event(ev);
         presence_router.on_call_state_event(std::move(ev));
     });
     presence_client.set_state_callback([&](PresenceTcpClient::ConnectionState state,
@@ -109,6 +169,10 @@ int main(int argc, char* argv[]) {
             state == PresenceTcpClient::ConnectionState::kConnected, detail);
     });
     presence_client.start();  // Non-fatal if it fails
+    InterestPublisher interest_publisher(config, [&](std::string message) {
+        presence_client.publish_interest(std::move(message));
+    });
+    interest_publisher.start();
 
     // 9. Reaper
     StaleSubscriptionReaper reaper(config, dispatcher, &stack, sub_store);
@@ -123,9 +187,16 @@ int main(int argc, char* argv[]) {
 
         StatsHandler::Dependencies sdeps{&config, &dispatcher, &stack, &presence_client,
                                           &presence_router, failover_mgr.get(), &reaper,
-                                          mongo.get(), sub_store.get(), slow_logger.get()};
+                                          mongo.get(), sub_store.get(), slow_logger.get(),
+                                          snapshot_store.get(), &recovery};
         StatsHandler::register_routes(http, sdeps);
 
+        WorkersHandler::register_routes(http, WorkersHandler::Dependencies{&dispatcher});
+
+        if (config.http_mwi_feed_enabled) {
+            MwiHandler::register_routes(http, MwiHandler::Dependencies{&dispatcher});
+        }
+
         http.start();
     }
 
@@ -135,7 +206,11 @@ int main(int argc, char* argv[]) {
     uint64_t tick = 0;
     while (!g_shutdown.load(std::memory_order_acquire)) {
         std::this_thread::sleep_for(Seconds(1));
-        if (++tick % 30 == 0) {
+        ++tick;
+        dispatcher.finish_resize();
+        uint64_t rebalance_every = static_cast<uint64_t>(config.dispatcher_rebalance_interval.count());
+        if (rebalance_every > 0 && tick % rebalance_every == 0) dispatcher.rebalance();
+        if (tick % 30 == 0) {
             auto agg = dispatcher.aggregate_stats();
             LOG_INFO("Stats: events=%lu/%lu dialogs=%lu slow=%lu presence=%s",
                      agg.total_events_processed, agg.total_events_received,
@@ -145,17 +220,26 @@ int main(int argc, char* argv[]) {
     }
 
     // Shutdown (reverse order)
+    LOG_INFO("Signal %d received", g_signal.load(std::memory_order_relaxed));
     LOG_INFO("Shutting down...");
     http.stop();
     reaper.stop();
+    interest_publisher.stop();
     presence_client.stop();
+    if (distributor) distributor->stop();
     presence_router.stop();
     stack.stop();
     SipCallbackHandler::set_dispatcher(nullptr);
+    recovery.stop();
+    if (replication_receiver) replication_receiver->stop();
+    overload.stop();
     dispatcher.stop();
+    if (replication_sender) replication_sender->stop();
+    snapshot_store->stop();
     if (sub_store) sub_store->stop();
     if (mongo) mongo->disconnect();
 
     LOG_INFO("SIP Event Processor stopped cleanly.");
+    Logger::instance().shutdown();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,517 @@
+
+// =============================================================================
+// FILE: src/persistence/local_snapshot_store.cpp
+// =============================================================================
+#include "persistence/local_snapshot_store.h"
+#include "persistence/subscription_codec.h"
+#include "common/logger.h"
+#include "common/thread_affinity.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sip_processor {
+
+namespace {
+
+constexpr char     kSnapshotMagic[8] = {'S','E','P','S','N','A','P','1'};
+constexpr char     kJournalMagic[8]  = {'S','E','P','J','R','N','L','1'};
+constexpr uint32_t kFileVersion      = 1;
+constexpr size_t   kHeaderSize       = 32;
+constexpr size_t   kFrameHeaderSize  = 8;
+constexpr size_t   kMaxFrameSize     = 16 * 1024 * 1024;
+constexpr size_t   kFlushWatermark   = 1024 * 1024;
+
+void put_le(char* p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) p[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+}
+
+uint64_t get_le(const char* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+    return v;
+}
+
+std::string make_header(const char* magic, uint64_t count) {
+    std::string h(kHeaderSize, '\0');
+    std::memcpy(&h[0], magic, 8);
+    put_le(&h[8], kFileVersion, 4);
+    put_le(&h[16], count, 8);
+    put_le(&h[24], static_cast<uint64_t>(wall_clock_ms()), 8);
+    return h;
+}
+
+bool header_ok(const char* data, size_t len, const char* magic) {
+    return len >= kHeaderSize && std::memcmp(data, magic, 8) == 0 &&
+           get_le(data + 8, 4) == kFileVersion;
+}
+
+void append_frame_to(std::string& out, const char* payload, size_t len) {
+    char fh[kFrameHeaderSize];
+    put_le(fh, len, 4);
+    put_le(fh + 4, SubscriptionCodec::checksum(payload, len), 4);
+    out.append(fh, kFrameHeaderSize);
+    out.append(payload, len);
+}
+
+bool write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n; len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Makes a rename or unlink in `dir` durable
+bool sync_directory(const std::string& dir) {
+    int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+// Read-only mapping of a whole file; empty if missing
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        struct stat st{};
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data_ = static_cast<const char*>(p);
+                size_ = static_cast<size_t>(st.st_size);
+                ::madvise(p, size_, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+    }
+    ~MappedFile() { if (data_) ::munmap(const_cast<char*>(data_), size_); }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+struct Frame {
+    const char* payload;
+    uint32_t    len;
+    uint32_t    checksum;
+};
+
+// Split a mapped file into frames; stops at the first truncated frame
+std::vector<Frame> scan_frames(const char* data, size_t size) {
+    std::vector<Frame> frames;
+    size_t off = kHeaderSize;
+    while (size - off >= kFrameHeaderSize) {
+        auto len = static_cast<uint32_t>(get_le(data + off, 4));
+        auto sum = static_cast<uint32_t>(get_le(data + off + 4, 4));
+        if (len == 0 || len > kMaxFrameSize || size - off - kFrameHeaderSize < len) break;
+        frames.push_back({data + off + kFrameHeaderSize, len, sum});
+        off += kFrameHeaderSize + len;
+    }
+    return frames;
+}
+
+bool is_live(const SubscriptionRecord& rec) {
+    return rec.lifecycle != SubLifecycle::kTerminated &&
+           rec.lifecycle != SubLifecycle::kTerminating &&
+           !rec.is_expired() && !rec.dialog_id.empty();
+}
+
+} // namespace
+
+LocalSnapshotStore::LocalSnapshotStore(const Config& config)
+    : config_(config), enabled_(config.snapshot_enabled)
+{
+    std::string base = config_.snapshot_directory;
+    if (!base.empty() && base.back() != '/') base += '/';
+    base += config_.service_id;
+    snapshot_path_   = base + ".snapshot";
+    journal_path_    = base + ".journal";
+    compacting_path_ = base + ".journal.compacting";
+}
+
+LocalSnapshotStore::~LocalSnapshotStore() { stop(); }
+
+Result LocalSnapshotStore::start() {
+    if (!enabled_) { LOG_INFO("Snapshot: local snapshot disabled"); return Result::kOk; }
+    if (running_.load()) return Result::kAlreadyExists;
+
+    ::mkdir(config_.snapshot_directory.c_str(), 0755);
+
+    // A journal left by the previous run (or an interrupted compaction) is
+    // folded into the snapshot before the new journal is opened.
+    Result r = compact();
+    if (r != Result::kOk) return r;
+
+    stop_requested_.store(false); running_.store(true);
+    writer_thread_ = std::thread(&LocalSnapshotStore::writer_thread_func, this);
+
+    LOG_INFO("Snapshot started (path=%s, interval=%lds, journal_flush=%ldms)",
+             snapshot_path_.c_str(), config_.snapshot_interval.count(),
+             config_.snapshot_journal_flush_interval.count());
+    return Result::kOk;
+}
+
+void LocalSnapshotStore::stop() {
+    if (!running_.load()) return;
+    { std::lock_guard<std::mutex> lk(buffer_mu_); stop_requested_.store(true); }
+    buffer_cv_.notify_one();
+    if (writer_thread_.joinable()) writer_thread_.join();
+
+    // Leave a fully compacted snapshot behind so the next start is a pure map
+    compact();
+    { std::lock_guard<std::mutex> lk(file_mu_); close_journal_locked(); }
+    running_.store(false);
+    LOG_INFO("Snapshot stopped");
+}
+
+void LocalSnapshotStore::on_upsert(const SubscriptionRecord& record) {
+    if (!enabled_) return;
+    thread_local std::string scratch;
+    scratch.clear();
+    SubscriptionCodec::encode(record, scratch);
+    append_frame(kOpUpsert, scratch);
+}
+
+void LocalSnapshotStore::on_delete(const std::string& dialog_id) {
+    if (!enabled_) return;
+    append_frame(kOpDelete, dialog_id);
+}
+
+void LocalSnapshotStore::append_frame(uint8_t op, const std::string& body) {
+    size_t len = body.size() + 1;
+    char fh[kFrameHeaderSize + 1];
+    put_le(fh, len, 4);
+    fh[kFrameHeaderSize] = static_cast<char>(op);
+
+    // Checksum covers op byte + body; computed incrementally to avoid a copy
+    uint32_t h = 2166136261u;
+    h ^= op; h *= 16777619u;
+    for (char c : body) { h ^= static_cast<uint8_t>(c); h *= 16777619u; }
+    put_le(fh + 4, h, 4);
+
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lk(buffer_mu_);
+        pending_.append(fh, sizeof(fh));
+        pending_.append(body);
+        wake = pending_.size() >= kFlushWatermark;
+    }
+    stats_.journal_appends.fetch_add(1, std::memory_order_relaxed);
+    if (wake) buffer_cv_.notify_one();
+}
+
+void LocalSnapshotStore::writer_thread_func() {
+    ThreadPlacement::instance().place(ThreadRole::kPersistence, 0, "snapshot-wr");
+    auto last_snapshot = Clock::now();
+    while (!stop_requested_.load(std::memory_order_acquire)) {
+        {
+            std::unique_lock<std::mutex> lk(buffer_mu_);
+            buffer_cv_.wait_for(lk, config_.snapshot_journal_flush_interval, [this] {
+                return stop_requested_.load() || pending_.size() >= kFlushWatermark;
+            });
+        }
+        if (stop_requested_.load()) break;
+
+        if (Clock::now() - last_snapshot >= config_.snapshot_interval) {
+            compact();
+            last_snapshot = Clock::now();
+        } else {
+            std::lock_guard<std::mutex> lk(file_mu_);
+            flush_journal_locked();
+        }
+    }
+}
+
+Result LocalSnapshotStore::open_journal_locked() {
+    journal_fd_ = ::open(journal_path_.c_str(),
+                         O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (journal_fd_ < 0) {
+        stats_.errors.fetch_add(1, std::memory_order_relaxed);
+        LOG_ERROR("Snapshot: cannot open journal %s: %s", journal_path_.c_str(), strerror(errno));
+        return Result::kPersistenceError;
+    }
+    std::string header = make_header(kJournalMagic, 0);
+    if (!write_all(journal_fd_, header.data(), header.size())) {
+        stats_.errors.fetch_add(1, std::memory_order_relaxed);
+        return Result::kPersistenceError;
+    }
+    return Result::kOk;
+}
+
+void LocalSnapshotStore::close_journal_locked() {
+    if (journal_fd_ >= 0) { ::close(journal_fd_); journal_fd_ = -1; }
+}
+
+Result LocalSnapshotStore::flush_journal_locked() {
+    std::string batch;
+    {
+        std::lock_guard<std::mutex> lk(buffer_mu_);
+        batch.swap(pending_);
+    }
+    if (journal_fd_ < 0) {
+        // Not started yet — keep the changes for the journal start() opens
+        std::lock_guard<std::mutex> lk(buffer_mu_);
+        batch.append(pending_);
+        pending_.swap(batch);
+        return Result::kOk;
+    }
+    if (batch.empty()) return Result::kOk;
+
+    if (!write_all(journal_fd_, batch.data(), batch.size())) {
+        stats_.errors.fetch_add(1, std::memory_order_relaxed);
+        LOG_ERROR("Snapshot: journal write failed: %s", strerror(errno));
+        return Result::kPersistenceError;
+    }
+    if (config_.snapshot_fsync) ::fdatasync(journal_fd_);
+
+    stats_.journal_bytes.fetch_add(batch.size(), std::memory_order_relaxed);
+    stats_.journal_flushes.fetch_add(1, std::memory_order_relaxed);
+    return Result::kOk;
+}
+
+bool LocalSnapshotStore::read_journal(const std::string& path, JournalMap& latest) const {
+    MappedFile file(path);
+    if (!file.data()) return false;
+    if (!header_ok(file.data(), file.size(), kJournalMagic)) {
+        stats_.corrupt_frames.fetch_add(1, std::memory_order_relaxed);
+        LOG_WARN("Snapshot: ignoring journal %s with bad header", path.c_str());
+        return false;
+    }
+
+    SubscriptionCodec::Summary sum;
+    std::string_view did;
+    for (const auto& f : scan_frames(file.data(), file.size())) {
+        if (SubscriptionCodec::checksum(f.payload, f.len) != f.checksum) {
+            // Torn tail from a crash mid-write — nothing after it is trusted
+            stats_.corrupt_frames.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        auto op = static_cast<uint8_t>(f.payload[0]);
+        if (op == kOpUpsert) {
+            if (!SubscriptionCodec::peek(f.payload + 1, f.len - 1, sum)) continue;
+            did = sum.dialog_id;
+        } else if (op == kOpDelete) {
+            did = std::string_view(f.payload + 1, f.len - 1);
+        } else {
+            continue;
+        }
+        latest[std::string(did)].assign(f.payload, f.len);
+    }
+    return true;
+}
+
+Result LocalSnapshotStore::load(std::vector<SubscriptionRecord>& out, size_t num_threads) const {
+    if (!enabled_) return Result::kOk;
+    ScopedTimer timer;
+
+    JournalMap latest;
+    read_journal(compacting_path_, latest);
+    read_journal(journal_path_, latest);
+
+    MappedFile snap(snapshot_path_);
+    std::vector<Frame> frames;
+    if (snap.data()) {
+        if (header_ok(snap.data(), snap.size(), kSnapshotMagic)) {
+            frames = scan_frames(snap.data(), snap.size());
+        } else {
+            stats_.corrupt_frames.fetch_add(1, std::memory_order_relaxed);
+            LOG_WARN("Snapshot: ignoring %s with bad header", snapshot_path_.c_str());
+        }
+    }
+
+    // Decode snapshot frames in parallel; each thread owns a slice
+    num_threads = std::max<size_t>(1, std::min(num_threads, frames.size() / 1024 + 1));
+    std::vector<std::vector<SubscriptionRecord>> parts(num_threads);
+    std::vector<std::thread> threads;
+    size_t per_thread = (frames.size() + num_threads - 1) / num_threads;
+
+    auto decode_slice = [&](size_t t) {
+        size_t begin = t * per_thread;
+        size_t end = std::min(frames.size(), begin + per_thread);
+        auto& part = parts[t];
+        part.reserve(end > begin ? end - begin : 0);
+        int64_t now_ms = wall_clock_ms();
+        SubscriptionCodec::Summary sum;
+        for (size_t i = begin; i < end; ++i) {
+            const auto& f = frames[i];
+            if (SubscriptionCodec::checksum(f.payload, f.len) != f.checksum ||
+                static_cast<uint8_t>(f.payload[0]) != kOpUpsert) {
+                stats_.corrupt_frames.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (!SubscriptionCodec::peek(f.payload + 1, f.len - 1, sum)) {
+                stats_.corrupt_frames.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (!sum.is_live(now_ms)) continue;
+            if (!latest.empty() && latest.count(std::string(sum.dialog_id))) {
+                continue;  // Superseded by the journal
+            }
+            SubscriptionRecord rec;
+            if (!SubscriptionCodec::decode(f.payload + 1, f.len - 1, rec)) {
+                stats_.corrupt_frames.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (is_live(rec)) part.push_back(std::move(rec));
+        }
+    };
+
+    for (size_t t = 1; t < num_threads; ++t) threads.emplace_back(decode_slice, t);
+    decode_slice(0);
+    for (auto& th : threads) th.join();
+
+    size_t total = latest.size();
+    for (auto& p : parts) total += p.size();
+    out.reserve(out.size() + total);
+    for (auto& p : parts) {
+        std::move(p.begin(), p.end(), std::back_inserter(out));
+    }
+
+    for (auto& [did, payload] : latest) {
+        if (static_cast<uint8_t>(payload[0]) != kOpUpsert) continue;
+        SubscriptionRecord rec;
+        if (SubscriptionCodec::decode(payload.data() + 1, payload.size() - 1, rec) && is_live(rec)) {
+            out.push_back(std::move(rec));
+        }
+    }
+
+    stats_.records_loaded.store(out.size(), std::memory_order_relaxed);
+    LOG_INFO("Snapshot: loaded %zu subscriptions (%zu snapshot frames, %zu journal entries, "
+             "%zu threads) in %ldms",
+             out.size(), frames.size(), latest.size(), num_threads, timer.elapsed_ms().count());
+    return Result::kOk;
+}
+
+Result LocalSnapshotStore::compact() {
+    if (!enabled_) return Result::kOk;
+    std::lock_guard<std::mutex> lk(file_mu_);
+    ScopedTimer timer;
+
+    // Rotate the live journal out of the way; new changes go to a fresh one.
+    // If a previous compaction was interrupted its journal is still present
+    // and is merged first (it is older than the live journal).
+    if (journal_fd_ >= 0) flush_journal_locked();
+    close_journal_locked();
+
+    JournalMap latest;
+    bool have_compacting = read_journal(compacting_path_, latest);
+    if (have_compacting) {
+        read_journal(journal_path_, latest);
+        ::unlink(journal_path_.c_str());
+    } else if (::rename(journal_path_.c_str(), compacting_path_.c_str()) == 0) {
+        read_journal(compacting_path_, latest);
+    }
+
+    Result r = open_journal_locked();
+    if (r != Result::kOk) return r;
+    flush_journal_locked();
+
+    r = write_snapshot_locked(latest);
+    if (r != Result::kOk) return r;
+    ::unlink(compacting_path_.c_str());
+
+    auto ms = static_cast<uint64_t>(timer.elapsed_ms().count());
+    stats_.snapshots_written.fetch_add(1, std::memory_order_relaxed);
+    stats_.last_snapshot_ms.store(ms, std::memory_order_relaxed);
+    LOG_INFO("Snapshot: wrote %lu records (%zu journal entries folded) in %lums",
+             stats_.snapshot_records.load(), latest.size(), ms);
+    return Result::kOk;
+}
+
+Result LocalSnapshotStore::write_snapshot_locked(const JournalMap& latest) {
+    std::string tmp_path = snapshot_path_ + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        stats_.errors.fetch_add(1, std::memory_order_relaxed);
+        LOG_ERROR("Snapshot: cannot create %s: %s", tmp_path.c_str(), strerror(errno));
+        return Result::kPersistenceError;
+    }
+
+    uint64_t count = 0;
+    bool ok = true;
+    std::string out = make_header(kSnapshotMagic, 0);
+    out.reserve(4 * kFlushWatermark);
+
+    auto drain = [&](bool force) {
+        if (ok && (force || out.size() >= 4 * kFlushWatermark)) {
+            ok = write_all(fd, out.data(), out.size());
+            out.clear();
+        }
+    };
+
+    // Unchanged records are copied frame-for-frame from the old snapshot;
+    // terminated and expired ones are dropped here.
+    int64_t now_ms = wall_clock_ms();
+    SubscriptionCodec::Summary sum;
+    {
+        MappedFile old(snapshot_path_);
+        if (old.data() && header_ok(old.data(), old.size(), kSnapshotMagic)) {
+            for (const auto& f : scan_frames(old.data(), old.size())) {
+                if (SubscriptionCodec::checksum(f.payload, f.len) != f.checksum) continue;
+                if (!SubscriptionCodec::peek(f.payload + 1, f.len - 1, sum)) continue;
+                if (!sum.is_live(now_ms)) continue;
+                if (!latest.empty() && latest.count(std::string(sum.dialog_id))) continue;
+                append_frame_to(out, f.payload, f.len);
+                ++count;
+                drain(false);
+            }
+        }
+    }
+
+    for (const auto& [did, payload] : latest) {
+        if (static_cast<uint8_t>(payload[0]) != kOpUpsert) continue;
+        if (!SubscriptionCodec::peek(payload.data() + 1, payload.size() - 1, sum) ||
+            !sum.is_live(now_ms)) {
+            continue;
+        }
+        append_frame_to(out, payload.data(), payload.size());
+        ++count;
+        drain(false);
+    }
+    drain(true);
+
+    // Patch the record count into the header, then publish atomically
+    char cnt[8];
+    put_le(cnt, count, 8);
+    ok = ok && ::pwrite(fd, cnt, sizeof(cnt), 16) == static_cast<ssize_t>(sizeof(cnt));
+    ok = ok && ::fsync(fd) == 0;
+    ::close(fd);
+
+    if (!ok || ::rename(tmp_path.c_str(), snapshot_path_.c_str()) != 0) {
+        stats_.errors.fetch_add(1, std::memory_order_relaxed);
+        LOG_ERROR("Snapshot: failed to write %s: %s", snapshot_path_.c_str(), strerror(errno));
+        ::unlink(tmp_path.c_str());
+        return Result::kPersistenceError;
+    }
+    // The new snapshot's entry must outlive the journal it replaces
+    if (!sync_directory(config_.snapshot_directory)) {
+        stats_.errors.fetch_add(1, std::memory_order_relaxed);
+        LOG_ERROR("Snapshot: cannot sync %s: %s", config_.snapshot_directory.c_str(), strerror(errno));
+        return Result::kPersistenceError;
+    }
+
+    stats_.snapshot_records.store(count, std::memory_order_relaxed);
+    return Result::kOk;
+}
+
+} // namespace sip_processor
@@ -0,0 +1,184 @@
+
+// =============================================================================
+// FILE: src/persistence/subscription_codec.cpp
+// =============================================================================
+#include "persistence/subscription_codec.h"
+#include <cstring>
+
+namespace sip_processor {
+
+namespace {
+
+void put_u8(std::string& out, uint8_t v) { out.push_back(static_cast<char>(v)); }
+
+void put_u32(std::string& out, uint32_t v) {
+    char b[4];
+    for (int i = 0; i < 4; ++i) b[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+    out.append(b, 4);
+}
+
+void put_u64(std::string& out, uint64_t v) {
+    char b[8];
+    for (int i = 0; i < 8; ++i) b[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+    out.append(b, 8);
+}
+
+void put_str(std::string& out, std::string_view s) {
+    put_u32(out, static_cast<uint32_t>(s.size()));
+    out.append(s.data(), s.size());
+}
+
+// Bounds-checked sequential reader over an encoded record
+class Reader {
+public:
+    Reader(const char* data, size_t len) : p_(data), end_(data + len) {}
+
+    bool u8(uint8_t& v) {
+        if (end_ - p_ < 1) return false;
+        v = static_cast<uint8_t>(*p_++);
+        return true;
+    }
+    bool u32(uint32_t& v) {
+        if (end_ - p_ < 4) return false;
+        v = 0;
+        for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<uint8_t>(p_[i])) << (8 * i);
+        p_ += 4;
+        return true;
+    }
+    bool u64(uint64_t& v) {
+        if (end_ - p_ < 8) return false;
+        v = 0;
+        for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(static_cast<uint8_t>(p_[i])) << (8 * i);
+        p_ += 8;
+        return true;
+    }
+    bool view(std::string_view& v) {
+        uint32_t n;
+        if (!u32(n) || static_cast<size_t>(end_ - p_) < n) return false;
+        v = std::string_view(p_, n);
+        p_ += n;
+        return true;
+    }
+    bool str(std::string& s) {
+        std::string_view v;
+        if (!view(v)) return false;
+        s.assign(v.data(), v.size());
+        return true;
+    }
+    bool sym(Symbol& s) {
+        std::string_view v;
+        if (!view(v)) return false;
+        s = Symbol(v);
+        return true;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+};
+
+} // namespace
+
+void SubscriptionCodec::encode(const SubscriptionRecord& r, std::string& out) {
+    int64_t expires_wall_ms = 0;
+    if (r.expires_at != TimePoint{}) {
+        expires_wall_ms = wall_clock_ms() +
+            std::chrono::duration_cast<Millisecs>(r.expires_at - Clock::now()).count();
+    }
+
+    put_u8(out, kFormatVersion);
+    put_str(out, r.dialog_id);
+    put_u8(out, static_cast<uint8_t>(r.type));
+    put_u8(out, static_cast<uint8_t>(r.lifecycle));
+    put_u32(out, r.cseq);
+    put_u32(out, r.notify_cseq);
+    put_u32(out, r.blf_notify_version);
+    put_u32(out, static_cast<uint32_t>(r.mwi_new_messages));
+    put_u32(out, static_cast<uint32_t>(r.mwi_old_messages));
+    put_u64(out, static_cast<uint64_t>(expires_wall_ms));
+    put_u64(out, static_cast<uint64_t>(r.updated_at_ms));
+    put_str(out, r.tenant_id.view());
+    put_str(out, r.blf_monitored_uri.view());
+    put_str(out, r.blf_last_state);
+    put_str(out, r.blf_last_direction);
+    put_str(out, r.blf_presence_call_id);
+    put_str(out, r.blf_last_notify_body);
+    put_str(out, r.mwi_account_uri);
+    put_str(out, r.mwi_last_notify_body);
+    put_str(out, r.from_uri);
+    put_str(out, r.from_tag);
+    put_str(out, r.to_uri);
+    put_str(out, r.to_tag);
+    put_str(out, r.call_id);
+    put_str(out, r.contact_uri);
+}
+
+bool SubscriptionCodec::decode(const char* data, size_t len, SubscriptionRecord& r) {
+    Reader in(data, len);
+    uint8_t version, type, lifecycle;
+    uint32_t mwi_new, mwi_old;
+    uint64_t expires_wall_ms, updated_at_ms;
+
+    if (!in.u8(version) || version != kFormatVersion) return false;
+    if (!in.str(r.dialog_id)) return false;
+    if (!in.u8(type) || !in.u8(lifecycle)) return false;
+    if (type > static_cast<uint8_t>(SubscriptionType::kMWI)) return false;
+    if (lifecycle > static_cast<uint8_t>(SubLifecycle::kTerminated)) return false;
+    if (!in.u32(r.cseq) || !in.u32(r.notify_cseq) || !in.u32(r.blf_notify_version)) return false;
+    if (!in.u32(mwi_new) || !in.u32(mwi_old)) return false;
+    if (!in.u64(expires_wall_ms) || !in.u64(updated_at_ms)) return false;
+    if (!in.sym(r.tenant_id) ||
+        !in.sym(r.blf_monitored_uri) || !in.str(r.blf_last_state) ||
+        !in.str(r.blf_last_direction) || !in.str(r.blf_presence_call_id) ||
+        !in.str(r.blf_last_notify_body) ||
+        !in.str(r.mwi_account_uri) || !in.str(r.mwi_last_notify_body) ||
+        !in.str(r.from_uri) || !in.str(r.from_tag) ||
+        !in.str(r.to_uri) || !in.str(r.to_tag) ||
+        !in.str(r.call_id) || !in.str(r.contact_uri)) {
+        return false;
+    }
+
+    r.type             = static_cast<SubscriptionType>(type);
+    r.lifecycle        = static_cast<SubLifecycle>(lifecycle);
+    r.mwi_new_messages = static_cast<int>(mwi_new);
+    r.mwi_old_messages = static_cast<int>(mwi_old);
+    r.updated_at_ms    = static_cast<int64_t>(updated_at_ms);
+    r.expires_at       = TimePoint{};
+    if (expires_wall_ms != 0) {
+        r.expires_at = Clock::now() +
+            Millisecs(static_cast<int64_t>(expires_wall_ms) - wall_clock_ms());
+    }
+
+    auto now = Clock::now();
+    r.created_at       = now;
+    r.last_activity    = now;
+    r.events_processed = 0;
+    r.is_processing    = false;
+    r.dirty            = false;
+    return true;
+}
+
+bool SubscriptionCodec::peek(const char* data, size_t len, Summary& out) {
+    Reader in(data, len);
+    uint8_t version, type, lifecycle;
+    uint32_t skip;
+    uint64_t expires_wall_ms;
+    if (!in.u8(version) || version != kFormatVersion) return false;
+    if (!in.view(out.dialog_id) || !in.u8(type) || !in.u8(lifecycle)) return false;
+    for (int i = 0; i < 5; ++i) if (!in.u32(skip)) return false;
+    if (!in.u64(expires_wall_ms)) return false;
+    out.lifecycle = static_cast<SubLifecycle>(lifecycle);
+    out.expires_wall_ms = static_cast<int64_t>(expires_wall_ms);
+    return true;
+}
+
+uint32_t SubscriptionCodec::checksum(const char* data, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<uint8_t>(data[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+} // namespace sip_processor
@@ -0,0 +1,529 @@
+// =============================================================================
+// FILE: src/persistence/subscription_replication.cpp
+// =============================================================================
+#include "persistence/subscription_replication.h"
+#include "persistence/subscription_codec.h"
+#include "dispatch/dialog_dispatcher.h"
+#include "dispatch/dialog_routing_table.h"
+#include "common/logger.h"
+#include "common/metrics_registry.h"
+#include "common/thread_affinity.h"
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace sip_processor {
+
+using SenderStats = ReplicationSender::SenderStats;
+static const MetricField<SenderStats> kSenderMetrics[] = {
+    {"sip_processor_replication_changes_sent", MetricType::kCounter, "Subscription changes streamed to the standby", &SenderStats::changes_sent},
+    {"sip_processor_replication_bytes_sent", MetricType::kCounter, "Bytes written to the standby", &SenderStats::bytes_sent},
+    {"sip_processor_replication_full_syncs", MetricType::kCounter, "Full-table syncs sent to the standby", &SenderStats::full_syncs},
+    {"sip_processor_replication_backlog_overflows", MetricType::kCounter, "Times the standby fell behind and was resynced", &SenderStats::backlog_overflows},
+    {"sip_processor_replication_records_tracked", MetricType::kGauge, "Live subscriptions held for standby syncs", &SenderStats::records_tracked},
+    {"sip_processor_replication_standby_connected", MetricType::kGauge, "1 while a standby is attached", &SenderStats::standby_connected},
+};
+
+using ReceiverStats = ReplicationReceiver::ReceiverStats;
+static const MetricField<ReceiverStats> kReceiverMetrics[] = {
+    {"sip_processor_replication_records_received", MetricType::kCounter, "Subscription upserts received from the primary", &ReceiverStats::records_received},
+    {"sip_processor_replication_deletes_received", MetricType::kCounter, "Subscription deletes received from the primary", &ReceiverStats::deletes_received},
+    {"sip_processor_replication_syncs_received", MetricType::kCounter, "Full-table syncs received from the primary", &ReceiverStats::full_syncs},
+    {"sip_processor_replication_bytes_received", MetricType::kCounter, "Bytes read from the primary", &ReceiverStats::bytes_received},
+    {"sip_processor_replication_corrupt_frames", MetricType::kCounter, "Malformed frames; each one forces a reconnect and resync", &ReceiverStats::corrupt_frames},
+    {"sip_processor_replication_primary_lost", MetricType::kCounter, "Times the primary connection ended or went silent", &ReceiverStats::primary_lost},
+    {"sip_processor_replication_primary_connected", MetricType::kGauge, "1 while connected to the primary", &ReceiverStats::primary_connected},
+};
+
+namespace {
+
+void put_le(char* p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) p[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+}
+
+uint64_t get_le(const char* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+    return v;
+}
+
+// Process-wide, so a replica written by an earlier receiver is never
+// mistaken for one the current sync refreshed
+std::atomic<uint64_t> g_sync_generation{0};
+
+bool is_live(const SubscriptionRecord& rec) {
+    return rec.lifecycle != SubLifecycle::kTerminated &&
+           rec.lifecycle != SubLifecycle::kTerminating &&
+           !rec.is_expired() && !rec.dialog_id.empty();
+}
+
+} // namespace
+
+void replication::append_frame(std::string& out, uint8_t op, const char* body, size_t len) {
+    // The checksum covers the op byte, so hash the payload once it is in place
+    size_t start = out.size();
+    out.resize(start + kFrameHeaderSize);
+    out.push_back(static_cast<char>(op));
+    out.append(body, len);
+    const char* payload = out.data() + start + kFrameHeaderSize;
+    put_le(&out[start], len + 1, 4);
+    put_le(&out[start + 4], SubscriptionCodec::checksum(payload, len + 1), 4);
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Primary
+// ─────────────────────────────────────────────────────────────────────────────
+
+ReplicationSender::ReplicationSender(const Config& config) : config_(config) {
+    MetricsRegistry::instance().add_fields(this, stats_, kSenderMetrics);
+}
+
+ReplicationSender::~ReplicationSender() {
+    stop();
+    MetricsRegistry::instance().unregister(this);
+}
+
+Result ReplicationSender::start() {
+    if (running_.load(std::memory_order_acquire)) return Result::kAlreadyExists;
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) { LOG_ERROR("Replication: socket failed: %s", strerror(errno)); return Result::kError; }
+    int opt = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config_.replication_listen_port);
+    inet_pton(AF_INET, config_.replication_bind_address.c_str(), &addr.sin_addr);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listen_fd_, 4) < 0) {
+        LOG_ERROR("Replication: cannot listen on %s:%u: %s", config_.replication_bind_address.c_str(),
+                  config_.replication_listen_port, strerror(errno));
+        close(listen_fd_); listen_fd_ = -1;
+        return Result::kError;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        LOG_ERROR("Replication: eventfd failed: %s", strerror(errno));
+        close(listen_fd_); listen_fd_ = -1;
+        return Result::kError;
+    }
+
+    stop_requested_.store(false); running_.store(true);
+    io_thread_ = std::thread(&ReplicationSender::io_thread_func, this);
+    LOG_INFO("Replication: primary listening for a standby on %s:%u",
+             config_.replication_bind_address.c_str(), port_);
+    return Result::kOk;
+}
+
+void ReplicationSender::stop() {
+    if (!running_.load(std::memory_order_acquire)) return;
+    stop_requested_.store(true);
+    wake();
+    if (io_thread_.joinable()) io_thread_.join();
+    if (standby_fd_ >= 0) drop_standby();
+    close(listen_fd_); close(wake_fd_);
+    listen_fd_ = wake_fd_ = -1;
+    running_.store(false);
+    LOG_INFO("Replication sender stopped");
+}
+
+void ReplicationSender::wake() {
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) { /* Already pending */ }
+}
+
+void ReplicationSender::on_upsert(const SubscriptionRecord& record) {
+    if (!is_live(record)) { on_delete(record.dialog_id); return; }
+
+    // Encoded outside the lock; workers only contend on the copy
+    std::string body;
+    SubscriptionCodec::encode(record, body);
+    bool need_wake = false;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (standby_attached_ && !resync_needed_) {
+            if (outbox_.size() + body.size() > config_.replication_max_backlog) {
+                // Cheaper to resend the table than to queue without bound
+                outbox_.clear();
+                resync_needed_ = true;
+                need_wake = true;
+                stats_.backlog_overflows.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                need_wake = outbox_.empty();
+                replication::append_frame(outbox_, replication::kOpUpsert, body.data(), body.size());
+                stats_.changes_sent.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        table_[record.dialog_id] = std::move(body);
+        stats_.records_tracked.store(table_.size(), std::memory_order_relaxed);
+    }
+    if (need_wake) wake();
+}
+
+void ReplicationSender::on_delete(const std::string& dialog_id) {
+    bool need_wake = false;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (table_.erase(dialog_id) == 0) return;
+        stats_.records_tracked.store(table_.size(), std::memory_order_relaxed);
+        if (standby_attached_ && !resync_needed_) {
+            need_wake = outbox_.empty();
+            replication::append_frame(outbox_, replication::kOpDelete, dialog_id.data(), dialog_id.size());
+            stats_.changes_sent.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (need_wake) wake();
+}
+
+void ReplicationSender::queue_full_sync_locked() {
+    replication::append_frame(outbox_, replication::kOpSyncBegin, nullptr, 0);
+    for (const auto& [did, body] : table_) {
+        replication::append_frame(outbox_, replication::kOpUpsert, body.data(), body.size());
+    }
+    replication::append_frame(outbox_, replication::kOpSyncEnd, nullptr, 0);
+    resync_needed_ = false;
+    stats_.full_syncs.fetch_add(1, std::memory_order_relaxed);
+    LOG_INFO("Replication: full sync of %zu subscriptions queued for the standby", table_.size());
+}
+
+void ReplicationSender::io_thread_func() {
+    ThreadPlacement::instance().place(ThreadRole::kPersistence, 1, "repl-send");
+    const auto heartbeat_every = config_.replication_heartbeat_interval;
+    TimePoint next_heartbeat = Clock::now() + heartbeat_every;
+
+    while (!stop_requested_.load(std::memory_order_acquire)) {
+        struct pollfd fds[3] = {{listen_fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}, {standby_fd_, POLLIN, 0}};
+        if (standby_fd_ >= 0) {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (!sending_.empty() || !outbox_.empty()) fds[2].events |= POLLOUT;
+        }
+        nfds_t nfds = standby_fd_ >= 0 ? 3 : 2;
+
+        auto wait = std::chrono::duration_cast<Millisecs>(next_heartbeat - Clock::now()).count();
+        int pr = poll(fds, nfds, static_cast<int>(std::max<int64_t>(0, wait)));
+        if (pr < 0 && errno != EINTR) { LOG_ERROR("Replication: poll failed: %s", strerror(errno)); break; }
+
+        if (fds[1].revents & POLLIN) {
+            uint64_t v;
+            while (read(wake_fd_, &v, sizeof(v)) > 0) {}
+        }
+        if (fds[0].revents & POLLIN) accept_standby();
+        if (standby_fd_ < 0) continue;
+
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            // Built once the partial frames ahead of it are out, so the
+            // sync goes straight to sending_ and never counts as backlog
+            if (resync_needed_ && sending_.empty()) queue_full_sync_locked();
+            if (Clock::now() >= next_heartbeat) {
+                replication::append_frame(outbox_, replication::kOpHeartbeat, nullptr, 0);
+                next_heartbeat = Clock::now() + heartbeat_every;
+            }
+        }
+
+        // The standby never writes; readable means it closed or failed
+        if (nfds == 3 && (fds[2].revents & (POLLIN | POLLHUP | POLLERR))) {
+            char junk[256];
+            ssize_t n = recv(standby_fd_, junk, sizeof(junk), 0);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                LOG_WARN("Replication: standby disconnected");
+                drop_standby();
+                continue;
+            }
+        }
+        if (!flush_standby()) {
+            LOG_WARN("Replication: write to standby failed: %s", strerror(errno));
+            drop_standby();
+        }
+    }
+}
+
+void ReplicationSender::accept_standby() {
+    struct sockaddr_in peer{};
+    socklen_t len = sizeof(peer);
+    int fd = accept4(listen_fd_, reinterpret_cast<sockaddr*>(&peer), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;
+
+    // One standby at a time; a new connection is the standby restarting
+    if (standby_fd_ >= 0) {
+        LOG_WARN("Replication: new standby connection replaces the current one");
+        drop_standby();
+    }
+    int opt = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    standby_fd_ = fd;
+
+    char ip[INET_ADDRSTRLEN] = "?";
+    inet_ntop(AF_INET, &peer.sin_addr, ip, sizeof(ip));
+    LOG_INFO("Replication: standby %s:%u attached", ip, ntohs(peer.sin_port));
+
+    std::lock_guard<std::mutex> lk(mu_);
+    standby_attached_ = true;
+    outbox_.clear();
+    queue_full_sync_locked();
+    stats_.standby_connected.store(1);
+}
+
+bool ReplicationSender::flush_standby() {
+    if (sending_.empty()) {
+        std::lock_guard<std::mutex> lk(mu_);
+        sending_.swap(outbox_);
+    }
+    size_t off = 0;
+    while (off < sending_.size()) {
+        ssize_t n = send(standby_fd_, sending_.data() + off, sending_.size() - off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        off += static_cast<size_t>(n);
+    }
+    stats_.bytes_sent.fetch_add(off, std::memory_order_relaxed);
+    sending_.erase(0, off);
+    return true;
+}
+
+void ReplicationSender::drop_standby() {
+    close(standby_fd_);
+    standby_fd_ = -1;
+    sending_.clear();
+    std::lock_guard<std::mutex> lk(mu_);
+    standby_attached_ = false;
+    resync_needed_ = false;
+    outbox_.clear();
+    stats_.standby_connected.store(0);
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Standby
+// ─────────────────────────────────────────────────────────────────────────────
+
+ReplicationReceiver::ReplicationReceiver(const Config& config, DialogDispatcher& dispatcher)
+    : config_(config), dispatcher_(dispatcher)
+{
+    MetricsRegistry::instance().add_fields(this, stats_, kReceiverMetrics);
+}
+
+ReplicationReceiver::~ReplicationReceiver() {
+    stop();
+    MetricsRegistry::instance().unregister(this);
+}
+
+Result ReplicationReceiver::start() {
+    if (running_.load(std::memory_order_acquire)) return Result::kAlreadyExists;
+    stop_requested_.store(false); running_.store(true);
+    thread_ = std::thread(&ReplicationReceiver::receiver_thread_func, this);
+    LOG_INFO("Replication: standby following primary %s:%u",
+             config_.replication_primary_host.c_str(), config_.replication_primary_port);
+    return Result::kOk;
+}
+
+void ReplicationReceiver::stop() {
+    if (!running_.load(std::memory_order_acquire)) return;
+    {
+        std::lock_guard<std::mutex> lk(stop_mu_);
+        stop_requested_.store(true);
+    }
+    stop_cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+    running_.store(false);
+    LOG_INFO("Replication receiver stopped");
+}
+
+void ReplicationReceiver::pause(Clock::duration d) {
+    std::unique_lock<std::mutex> lk(stop_mu_);
+    stop_cv_.wait_for(lk, d, [this] { return stop_requested_.load(); });
+}
+
+void ReplicationReceiver::receiver_thread_func() {
+    ThreadPlacement::instance().place(ThreadRole::kPersistence, 1, "repl-recv");
+    while (!stop_requested_.load()) {
+        int fd = connect_primary();
+        if (fd < 0) {
+            pause(config_.replication_heartbeat_interval);
+            continue;
+        }
+        LOG_INFO("Replication: connected to primary %s:%u",
+                 config_.replication_primary_host.c_str(), config_.replication_primary_port);
+        stats_.primary_connected.store(1, std::memory_order_release);
+
+        bool clean = stream(fd);
+        close(fd);
+        inbox_.clear();
+        stats_.primary_connected.store(0, std::memory_order_release);
+        if (stop_requested_.load()) break;
+
+        stats_.primary_lost.fetch_add(1);
+        LOG_WARN("Replication: %s primary %s:%u; %lu subscriptions held for takeover",
+                 clean ? "lost" : "corrupt stream from", config_.replication_primary_host.c_str(),
+                 config_.replication_primary_port, dispatcher_.aggregate_stats().total_dialogs_active);
+        pause(config_.replication_heartbeat_interval);
+    }
+}
+
+int ReplicationReceiver::connect_primary() {
+    struct addrinfo hints{}, *res = nullptr;
+    hints.ai_family = AF_INET; hints.ai_socktype = SOCK_STREAM;
+    std::string port_str = std::to_string(config_.replication_primary_port);
+    int gai = getaddrinfo(config_.replication_primary_host.c_str(), port_str.c_str(), &hints, &res);
+    if (gai != 0) {
+        LOG_ERROR("Replication: DNS failed for %s: %s", config_.replication_primary_host.c_str(), gai_strerror(gai));
+        return -1;
+    }
+
+    int fd = socket(res->ai_family, res->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, res->ai_protocol);
+    if (fd < 0) { freeaddrinfo(res); return -1; }
+    int cr = connect(fd, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    if (cr < 0 && errno != EINPROGRESS) { close(fd); return -1; }
+    if (cr < 0) {
+        auto timeout = config_.replication_heartbeat_interval * config_.replication_heartbeat_miss_threshold;
+        struct pollfd pfd{fd, POLLOUT, 0};
+        int sock_err = 0; socklen_t el = sizeof(sock_err);
+        if (poll(&pfd, 1, static_cast<int>(std::chrono::duration_cast<Millisecs>(timeout).count())) <= 0 ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &sock_err, &el) != 0 || sock_err != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+bool ReplicationReceiver::stream(int fd) {
+    const auto silence = config_.replication_heartbeat_interval * config_.replication_heartbeat_miss_threshold;
+    const int poll_ms = static_cast<int>(std::min<int64_t>(
+        200, std::chrono::duration_cast<Millisecs>(config_.replication_heartbeat_interval).count()));
+    TimePoint last_rx = Clock::now();
+    char buf[64 * 1024];
+
+    while (!stop_requested_.load()) {
+        struct pollfd pfd{fd, POLLIN, 0};
+        int pr = poll(&pfd, 1, poll_ms);
+        if (pr < 0 && errno != EINTR) return true;
+        if (pr <= 0) {
+            if (Clock::now() - last_rx > silence) {
+                LOG_WARN("Replication: no heartbeat from primary for %lds",
+                         static_cast<long>(std::chrono::duration_cast<Seconds>(silence).count()));
+                return true;
+            }
+            continue;
+        }
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+        if (n <= 0) return true;
+
+        last_rx = Clock::now();
+        stats_.bytes_received.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+        inbox_.append(buf, static_cast<size_t>(n));
+        bool ok = consume_frames();
+        flush_batches();
+        if (!ok) return false;
+    }
+    return true;
+}
+
+bool ReplicationReceiver::consume_frames() {
+    using namespace replication;
+    auto batch = [this](size_t w) -> std::vector<DialogWorker::ReplicatedChange>& {
+        if (w >= batches_.size()) batches_.resize(w + 1);
+        return batches_[w];
+    };
+
+    size_t off = 0;
+    bool ok = true;
+    while (inbox_.size() - off >= kFrameHeaderSize) {
+        auto len = static_cast<uint32_t>(get_le(inbox_.data() + off, 4));
+        auto sum = static_cast<uint32_t>(get_le(inbox_.data() + off + 4, 4));
+        if (len == 0 || len > kMaxFrameSize) { ok = false; break; }
+        if (inbox_.size() - off - kFrameHeaderSize < len) break;
+        const char* payload = inbox_.data() + off + kFrameHeaderSize;
+        if (SubscriptionCodec::checksum(payload, len) != sum) { ok = false; break; }
+        off += kFrameHeaderSize + len;
+
+        const char* body = payload + 1;
+        size_t body_len = len - 1;
+        switch (static_cast<uint8_t>(payload[0])) {
+            case kOpUpsert: {
+                DialogWorker::ReplicatedChange c;
+                c.generation = generation_;
+                if (!SubscriptionCodec::decode(body, body_len, c.record)) { ok = false; break; }
+                size_t w = dispatcher_.place(c.record.dialog_id);
+                batch(w).push_back(std::move(c));
+                stats_.records_received.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            case kOpDelete: {
+                DialogWorker::ReplicatedChange c;
+                c.kind = DialogWorker::ReplicatedChange::kErase;
+                c.record.dialog_id.assign(body, body_len);
+                stats_.deletes_received.fetch_add(1, std::memory_order_relaxed);
+                uint32_t w = dispatcher_.routing().find(c.record.dialog_id);
+                if (w != DialogRoutingTable::kNoWorker) batch(w).push_back(std::move(c));
+                break;
+            }
+            case kOpSyncBegin:
+                generation_ = g_sync_generation.fetch_add(1) + 1;
+                break;
+            case kOpSyncEnd: {
+                // Only running workers: slots past a shrink are stopped
+                for (size_t w = 0; w < dispatcher_.num_workers(); ++w) {
+                    DialogWorker::ReplicatedChange c;
+                    c.kind = DialogWorker::ReplicatedChange::kSyncEnd;
+                    c.generation = generation_;
+                    batch(w).push_back(std::move(c));
+                }
+                stats_.full_syncs.fetch_add(1, std::memory_order_relaxed);
+                LOG_INFO("Replication: full sync %lu received", generation_);
+                break;
+            }
+            default:
+                break;   // Heartbeat, or an op from a newer primary
+        }
+        if (!ok) break;
+    }
+    if (!ok) stats_.corrupt_frames.fetch_add(1);
+    inbox_.erase(0, off);
+    return ok;
+}
+
+void ReplicationReceiver::flush_batches() {
+    // A shrink since the changes were batched stopped the workers past
+    // `live`: place their records again.  Every running worker already has
+    // its own sync end, and a dialog with no owner left needs no erase.
+    size_t live = std::min(dispatcher_.num_workers(), batches_.size());
+    for (size_t w = live; w < batches_.size(); ++w) {
+        for (auto& c : batches_[w]) {
+            size_t owner;
+            if (c.kind == DialogWorker::ReplicatedChange::kUpsert) {
+                owner = dispatcher_.place(c.record.dialog_id);
+            } else if (c.kind == DialogWorker::ReplicatedChange::kErase) {
+                owner = dispatcher_.routing().find(c.record.dialog_id);
+            } else {
+                continue;
+            }
+            if (owner < live) batches_[owner].push_back(std::move(c));
+        }
+        batches_[w].clear();
+    }
+    for (size_t w = 0; w < live; ++w) {
+        if (batches_[w].empty()) continue;
+        dispatcher_.worker(w).apply_replicated(std::move(batches_[w]));
+        batches_[w].clear();
+    }
+}
+
+} // namespace sip_processor
@@ -3,18 +3,36 @@
 // =============================================================================
 #include "persistence/subscription_store.h"
 #include "persistence/mongo_client.h"
+#include "common/latency_histogram.h"
+#include "common/metrics_registry.h"
 #include "common/logger.h"
+#include "common/thread_affinity.h"
 #include "MongoPool.h"
 
 #include <mongoc/mongoc.h>
 
 namespace sip_processor {
 
+using StoreStats = SubscriptionStore::StoreStats;
+static const MetricField<StoreStats> kStoreMetrics[] = {
+    {"sip_processor_store_upserts", MetricType::kCounter, "Subscription records written to MongoDB", &StoreStats::upserts},
+    {"sip_processor_store_deletes", MetricType::kCounter, "Subscription records deleted from MongoDB", &StoreStats::deletes},
+    {"sip_processor_store_loads", MetricType::kCounter, "Subscription records loaded from MongoDB", &StoreStats::loads},
+    {"sip_processor_store_errors", MetricType::kCounter, "Failed MongoDB operations", &StoreStats::errors},
+    {"sip_processor_store_batch_writes", MetricType::kCounter, "Batched MongoDB flushes", &StoreStats::batch_writes},
+    {"sip_processor_store_queue_depth", MetricType::kGauge, "Records waiting to be flushed", &StoreStats::queue_depth},
+};
+
 SubscriptionStore::SubscriptionStore(const Config& config, std::shared_ptr<MongoClient> mongo)
     : config_(config), mongo_(std::move(mongo)), enabled_(config.mongo_enable_persistence)
-{}
+{
+    MetricsRegistry::instance().add_fields(this, stats_, kStoreMetrics);
+}
 
-SubscriptionStore::~SubscriptionStore() { stop(); }
+SubscriptionStore::~SubscriptionStore() {
+    stop();
+    MetricsRegistry::instance().unregister(this);
+}
 
 Result SubscriptionStore::start() {
     if (!enabled_) { LOG_INFO("SubStore: persistence disabled"); return Result::kOk; }
@@ -38,7 +56,12 @@ void SubscriptionStore::stop() {
     LOG_INFO("SubStore stopped");
 }
 
+void SubscriptionStore::add_change_listener(std::shared_ptr<SubscriptionChangeListener> listener) {
+    if (listener) listeners_.push_back(std::move(listener));
+}
+
 void SubscriptionStore::queue_upsert(const SubscriptionRecord& record) {
+    for (auto& l : listeners_) l->on_upsert(record);
     if (!enabled_) return;
     std::lock_guard<std::mutex> lk(queue_mu_);
     pending_ops_.push({PendingOp::kUpsert, record, record.dialog_id});
@@ -47,6 +70,7 @@ void SubscriptionStore::queue_upsert(const SubscriptionRecord& record) {
 }
 
 void SubscriptionStore::queue_delete(const std::string& dialog_id) {
+    for (auto& l : listeners_) l->on_delete(dialog_id);
     if (!enabled_) return;
     std::lock_guard<std::mutex> lk(queue_mu_);
     SubscriptionRecord empty;
@@ -55,13 +79,24 @@ void SubscriptionStore::queue_delete(const std::string& dialog_id) {
 }
 
 Result SubscriptionStore::save_immediately(const SubscriptionRecord& record) {
+    for (auto& l : listeners_) l->on_upsert(record);
+    return write_record(record);
+}
+
+Result SubscriptionStore::delete_immediately(const std::string& dialog_id) {
+    for (auto& l : listeners_) l->on_delete(dialog_id);
+    return remove_record(dialog_id);
+}
+
+Result SubscriptionStore::write_record(const SubscriptionRecord& record) {
     if (!enabled_ || !mongo_ || !mongo_->is_connected()) return Result::kOk;
 
     ScopedTimer timer;
 
-    auto now_ms = static_cast<int32_t>(
-        std::chrono::duration_cast<Millisecs>(
-            std::chrono::system_clock::now().time_since_epoch()).count() / 1000);
+    // updated_at carries the time of the change (not of this write) so that
+    // recovery can tell which of Mongo and the local snapshot is newer.
+    int64_t changed_ms = record.updated_at_ms > 0 ? record.updated_at_ms : wall_clock_ms();
+    auto now_ms = static_cast<int32_t>(changed_ms / 1000);
 
     auto expires_ms = record.expires_at != TimePoint{}
         ? static_cast<int32_t>(
@@ -190,7 +225,7 @@ Result SubscriptionStore::save_immediately(const SubscriptionRecord& record) {
     return Result::kOk;
 }
 
-Result SubscriptionStore::delete_immediately(const std::string& dialog_id) {
+Result SubscriptionStore::remove_record(const std::string& dialog_id) {
     if (!enabled_ || !mongo_ || !mongo_->is_connected()) return Result::kOk;
 
     bson_t *filter = bson_new();
@@ -238,11 +273,11 @@ Result SubscriptionStore::load_active_subscriptions(std::vector<StoredSubscripti
             auto& rec = stored.record;
 
             rec.dialog_id            = pool.getString("dialog_id");
-            rec.tenant_id            = pool.getString("tenant_id");
+            rec.tenant_id            = TenantId(pool.getString("tenant_id"));
             rec.type                 = subscription_type_from_string(pool.getString("type"));
             rec.lifecycle            = lifecycle_from_string(pool.getString("lifecycle"));
             rec.cseq                 = static_cast<uint32_t>(pool.getInt("cseq"));
-            rec.blf_monitored_uri    = pool.getString("blf_monitored_uri");
+            rec.blf_monitored_uri    = Symbol(pool.getString("blf_monitored_uri"));
             rec.blf_last_state       = pool.getString("blf_last_state");
             rec.blf_last_direction   = pool.getString("blf_last_direction");
             rec.blf_presence_call_id = pool.getString("blf_presence_call_id");
@@ -258,6 +293,7 @@ Result SubscriptionStore::load_active_subscriptions(std::vector<StoredSubscripti
             rec.to_tag               = pool.getString("to_tag");
             rec.call_id              = pool.getString("call_id");
             rec.contact_uri          = pool.getString("contact_uri");
+            rec.updated_at_ms        = static_cast<int64_t>(pool.getInt("updated_at")) * 1000;
 
             int exp_sec = pool.getInt("expires_at");
             if (exp_sec > 0) {
@@ -313,11 +349,11 @@ Result SubscriptionStore::load_subscription(const std::string& dialog_id,
 
     auto& rec = out.record;
     rec.dialog_id            = pool.getString("dialog_id");
-    rec.tenant_id            = pool.getString("tenant_id");
+    rec.tenant_id            = TenantId(pool.getString("tenant_id"));
     rec.type                 = subscription_type_from_string(pool.getString("type"));
     rec.lifecycle            = lifecycle_from_string(pool.getString("lifecycle"));
     rec.cseq                 = static_cast<uint32_t>(pool.getInt("cseq"));
-    rec.blf_monitored_uri    = pool.getString("blf_monitored_uri");
+    rec.blf_monitored_uri    = Symbol(pool.getString("blf_monitored_uri"));
     rec.blf_last_state       = pool.getString("blf_last_state");
     rec.blf_last_direction   = pool.getString("blf_last_direction");
     rec.blf_presence_call_id = pool.getString("blf_presence_call_id");
@@ -333,6 +369,7 @@ Result SubscriptionStore::load_subscription(const std::string& dialog_id,
     rec.to_tag               = pool.getString("to_tag");
     rec.call_id              = pool.getString("call_id");
     rec.contact_uri          = pool.getString("contact_uri");
+    rec.updated_at_ms        = static_cast<int64_t>(pool.getInt("updated_at")) * 1000;
 
     int exp_sec = pool.getInt("expires_at");
     if (exp_sec > 0) {
@@ -347,6 +384,7 @@ Result SubscriptionStore::load_subscription(const std::string& dialog_id,
 }
 
 void SubscriptionStore::sync_thread_func() {
+    ThreadPlacement::instance().place(ThreadRole::kPersistence, 0, "mongo-sync");
     while (!stop_requested_.load(std::memory_order_acquire)) {
         {
             std::unique_lock<std::mutex> lk(queue_mu_);
@@ -370,21 +408,23 @@ void SubscriptionStore::flush_pending() {
 
     if (batch.empty()) return;
 
-    ScopedTimer timer;
+    TimePoint started = Clock::now();
     size_t count = batch.size();
 
     while (!batch.empty()) {
         auto& op = batch.front();
         if (op.type == PendingOp::kUpsert) {
-            save_immediately(op.record);
+            write_record(op.record);
         } else {
-            delete_immediately(op.dialog_id);
+            remove_record(op.dialog_id);
         }
         batch.pop();
     }
 
     stats_.batch_writes.fetch_add(1, std::memory_order_relaxed);
-    auto ms = timer.elapsed_ms().count();
+    TimePoint finished = Clock::now();
+    LatencyRecorder::instance().record(LatencyStage::kMongoFlush, started, finished);
+    auto ms = std::chrono::duration_cast<Millisecs>(finished - started).count();
     if (ms > 100) {
         LOG_WARN("SubStore: batch flush of %zu ops took %ldms", count, ms);
     }
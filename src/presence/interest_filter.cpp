@@ -0,0 +1,133 @@
+
+// =============================================================================
+// FILE: src/presence/interest_filter.cpp
+// =============================================================================
+#include "presence/interest_filter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace sip_processor {
+
+static constexpr size_t kMaxBits = size_t(1) << 32;
+
+InterestFilter::Hashes InterestFilter::hash(std::string_view uri) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : uri) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    // Second hash from a splitmix64 finalizer; odd so every probe differs
+    uint64_t z = h + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return {h, z | 1};
+}
+
+InterestFilter::InterestFilter(size_t bits, unsigned hashes)
+    : hashes_(std::max(1u, std::min(hashes, 16u)))
+{
+    size_t n = 64;
+    while (n < bits && n < kMaxBits) n <<= 1;
+    words_.assign(n / 64, 0);
+}
+
+InterestFilter InterestFilter::for_uris(const std::vector<std::string>& uris, size_t bits_per_uri) {
+    bits_per_uri = std::max<size_t>(1, bits_per_uri);
+    // k = bits/n * ln 2 minimizes the false positive rate
+    unsigned k = static_cast<unsigned>(std::lround(static_cast<double>(bits_per_uri) * 0.6931));
+    InterestFilter f(uris.size() * bits_per_uri, std::max(1u, k));
+    for (const auto& uri : uris) f.add(uri);
+    return f;
+}
+
+void InterestFilter::add(const Hashes& h) {
+    if (words_.empty()) return;
+    uint64_t mask = bits() - 1;
+    for (unsigned i = 0; i < hashes_; ++i) {
+        uint64_t bit = (h.h1 + i * h.h2) & mask;
+        words_[bit >> 6] |= uint64_t(1) << (bit & 63);
+    }
+}
+
+bool InterestFilter::may_contain(const Hashes& h) const {
+    if (words_.empty()) return false;
+    uint64_t mask = bits() - 1;
+    for (unsigned i = 0; i < hashes_; ++i) {
+        uint64_t bit = (h.h1 + i * h.h2) & mask;
+        if (!(words_[bit >> 6] & (uint64_t(1) << (bit & 63)))) return false;
+    }
+    return true;
+}
+
+double InterestFilter::fill_ratio() const {
+    if (words_.empty()) return 0.0;
+    size_t set = 0;
+    for (uint64_t w : words_) set += static_cast<size_t>(__builtin_popcountll(w));
+    return static_cast<double>(set) / static_cast<double>(bits());
+}
+
+std::string InterestFilter::to_message() const {
+    static const char kHex[] = "0123456789abcdef";
+    std::string msg = "<Interest bits=\"" + std::to_string(bits()) +
+                      "\" hashes=\"" + std::to_string(hashes_) + "\">";
+    msg.reserve(msg.size() + words_.size() * 16 + 12);
+    for (uint64_t w : words_) {
+        for (int shift = 60; shift >= 0; shift -= 4) msg += kHex[(w >> shift) & 0xF];
+    }
+    msg += "</Interest>\n";
+    return msg;
+}
+
+static bool attribute(std::string_view tag, std::string_view name, size_t& out) {
+    std::string key = std::string(name) + "=\"";
+    size_t s = tag.find(key);
+    if (s == std::string_view::npos) return false;
+    s += key.size();
+    size_t e = tag.find('"', s);
+    if (e == std::string_view::npos || e == s) return false;
+    std::string digits(tag.substr(s, e - s));
+    char* end = nullptr;
+    unsigned long long v = std::strtoull(digits.c_str(), &end, 10);
+    if (*end != '\0') return false;
+    out = static_cast<size_t>(v);
+    return true;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool InterestFilter::parse_message(std::string_view msg, InterestFilter& out) {
+    const std::string_view open = "<Interest ", close = "</Interest>";
+    size_t s = msg.find(open);
+    if (s == std::string_view::npos) return false;
+    size_t gt = msg.find('>', s);
+    size_t e = msg.find(close, s);
+    if (gt == std::string_view::npos || e == std::string_view::npos || gt > e) return false;
+
+    std::string_view tag = msg.substr(s, gt - s);
+    size_t bits = 0, hashes = 0;
+    if (!attribute(tag, "bits", bits) || !attribute(tag, "hashes", hashes)) return false;
+    // The sender rounds to a power of two; anything else is not ours
+    if (bits < 64 || bits > kMaxBits || (bits & (bits - 1)) != 0 || hashes == 0 || hashes > 16) return false;
+
+    std::string_view hex = msg.substr(gt + 1, e - gt - 1);
+    if (hex.size() != bits / 4) return false;
+    InterestFilter f;
+    f.hashes_ = static_cast<unsigned>(hashes);
+    f.words_.assign(bits / 64, 0);
+    for (size_t i = 0; i < hex.size(); ++i) {
+        int v = hex_value(hex[i]);
+        if (v < 0) return false;
+        f.words_[i / 16] = (f.words_[i / 16] << 4) | static_cast<uint64_t>(v);
+    }
+    out = std::move(f);
+    return true;
+}
+
+} // namespace sip_processor
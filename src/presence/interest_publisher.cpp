@@ -0,0 +1,61 @@
+// =============================================================================
+// FILE: src/presence/interest_publisher.cpp
+// =============================================================================
+#include "presence/interest_publisher.h"
+#include "presence/interest_filter.h"
+#include "subscription/blf_subscription_index.h"
+#include "common/logger.h"
+#include "common/thread_affinity.h"
+#include <cstdint>
+
+namespace sip_processor {
+
+InterestPublisher::InterestPublisher(const Config& config, PublishFn publish)
+    : config_(config), publish_(std::move(publish)) {}
+
+InterestPublisher::~InterestPublisher() { stop(); }
+
+void InterestPublisher::start() {
+    if (!config_.presence_publish_interest || thread_.joinable()) return;
+    stop_ = false;
+    BlfSubscriptionIndex::instance().set_uri_added_listener([this] { wake(); });
+    thread_ = std::thread([this] {
+        ThreadPlacement::instance().place(ThreadRole::kPresence, 0, "presence-intr");
+        run();
+    });
+}
+
+void InterestPublisher::stop() {
+    if (!thread_.joinable()) return;
+    BlfSubscriptionIndex::instance().set_uri_added_listener(nullptr);
+    { std::lock_guard<std::mutex> lk(mu_); stop_ = true; }
+    cv_.notify_one();
+    thread_.join();
+}
+
+void InterestPublisher::wake() {
+    { std::lock_guard<std::mutex> lk(mu_); woken_ = true; }
+    cv_.notify_one();
+}
+
+void InterestPublisher::run() {
+    uint64_t published_version = UINT64_MAX;
+    std::unique_lock<std::mutex> lk(mu_);
+    while (!stop_) {
+        woken_ = false;
+        lk.unlock();
+        auto& idx = BlfSubscriptionIndex::instance();
+        // Read before the URIs, so a URI added meanwhile bumps it again
+        uint64_t version = idx.uri_set_version();
+        if (version != published_version) {
+            auto filter = InterestFilter::for_uris(idx.monitored_uris(), config_.presence_interest_bits_per_uri);
+            publish_(filter.to_message());
+            published_version = version;
+            LOG_DEBUG("Presence interest published: %zu URIs in %zu bits", idx.monitored_uri_count(), filter.bits());
+        }
+        lk.lock();
+        cv_.wait_for(lk, config_.presence_interest_interval, [this] { return stop_ || woken_; });
+    }
+}
+
+} // namespace sip_processor
@@ -0,0 +1,309 @@
+
+// =============================================================================
+// FILE: src/presence/presence_distributor.cpp
+// =============================================================================
+#include "presence/presence_distributor.h"
+#include "subscription/blf_subscription_index.h"
+#include "common/logger.h"
+#include "common/metrics_registry.h"
+#include "common/thread_affinity.h"
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <poll.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace sip_processor {
+
+// A node's filter is one line of hex; anything far larger is not a node
+static constexpr size_t kMaxInboxBytes = 64 * 1024 * 1024;
+
+using DistributorStats = PresenceDistributor::DistributorStats;
+static const MetricField<DistributorStats> kDistributorMetrics[] = {
+    {"sip_processor_distributor_events_received", MetricType::kCounter, "Call-state events offered to the distributor", &DistributorStats::events_received},
+    {"sip_processor_distributor_events_forwarded", MetricType::kCounter, "Call-state events sent to nodes (one per node)", &DistributorStats::events_forwarded},
+    {"sip_processor_distributor_events_unwanted", MetricType::kCounter, "Call-state events no node was interested in", &DistributorStats::events_unwanted},
+    {"sip_processor_distributor_events_dropped", MetricType::kCounter, "Call-state events dropped on a full node backlog", &DistributorStats::events_dropped},
+    {"sip_processor_distributor_interest_updates", MetricType::kCounter, "Interest filters received from nodes", &DistributorStats::interest_updates},
+    {"sip_processor_distributor_nodes", MetricType::kGauge, "Nodes connected to the distributor", &DistributorStats::nodes_connected},
+};
+
+// State names the presence parser reads back to the same CallState
+static const char* feed_state(CallState s) {
+    switch (s) {
+        case CallState::kTrying:     return "trying";
+        case CallState::kRinging:    return "ringing";
+        case CallState::kConfirmed:  return "confirmed";
+        case CallState::kTerminated: return "terminated";
+        case CallState::kHeld:       return "held";
+        case CallState::kResumed:    return "resumed";
+        default:                     return "unknown";
+    }
+}
+
+static std::string to_feed_xml(const CallStateEvent& ev) {
+    std::string xml;
+    xml.reserve(256 + ev.caller_uri.size() + ev.callee_uri.size());
+    xml += "<CallStateEvent><CallId>" + ev.presence_call_id + "</CallId>";
+    xml += "<CallerUri>" + ev.caller_uri + "</CallerUri>";
+    xml += "<CalleeUri>" + ev.callee_uri + "</CalleeUri>";
+    xml += "<State>";
+    xml += feed_state(ev.state);
+    xml += "</State>";
+    if (!ev.direction.empty()) xml += "<Direction>" + ev.direction + "</Direction>";
+    if (!ev.tenant_id.empty()) xml += "<TenantId>" + ev.tenant_id + "</TenantId>";
+    if (!ev.timestamp_str.empty()) xml += "<Timestamp>" + ev.timestamp_str + "</Timestamp>";
+    xml += "</CallStateEvent>\n";
+    return xml;
+}
+
+PresenceDistributor::PresenceDistributor(const Config& config) : config_(config) {
+    MetricsRegistry::instance().add_fields(this, stats_, kDistributorMetrics);
+}
+
+PresenceDistributor::~PresenceDistributor() {
+    stop();
+    MetricsRegistry::instance().unregister(this);
+}
+
+Result PresenceDistributor::start() {
+    if (running_.load(std::memory_order_acquire)) return Result::kAlreadyExists;
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) { LOG_ERROR("Distributor: socket failed: %s", strerror(errno)); return Result::kError; }
+    int opt = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config_.distributor_listen_port);
+    inet_pton(AF_INET, config_.distributor_bind_address.c_str(), &addr.sin_addr);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listen_fd_, 64) < 0) {
+        LOG_ERROR("Distributor: cannot listen on %s:%u: %s", config_.distributor_bind_address.c_str(),
+                  config_.distributor_listen_port, strerror(errno));
+        close(listen_fd_); listen_fd_ = -1;
+        return Result::kError;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        LOG_ERROR("Distributor: eventfd failed: %s", strerror(errno));
+        close(listen_fd_); listen_fd_ = -1;
+        return Result::kError;
+    }
+
+    stop_requested_.store(false); running_.store(true);
+    io_thread_ = std::thread(&PresenceDistributor::io_thread_func, this);
+    LOG_INFO("Distributor: listening for nodes on %s:%u", config_.distributor_bind_address.c_str(), port_);
+    return Result::kOk;
+}
+
+void PresenceDistributor::stop() {
+    if (!running_.load(std::memory_order_acquire)) return;
+    stop_requested_.store(true);
+    wake();
+    if (io_thread_.joinable()) io_thread_.join();
+
+    {
+        std::lock_guard<std::mutex> lk(nodes_mu_);
+        for (auto& node : nodes_) close(node->fd);
+        nodes_.clear();
+    }
+    stats_.nodes_connected.store(0);
+    close(listen_fd_); close(wake_fd_);
+    listen_fd_ = wake_fd_ = -1;
+    running_.store(false);
+    LOG_INFO("Distributor stopped");
+}
+
+void PresenceDistributor::wake() {
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) { /* Already pending */ }
+}
+
+void PresenceDistributor::on_call_state_event(const CallStateEvent& event) {
+    stats_.events_received.fetch_add(1, std::memory_order_relaxed);
+    if (!event.is_valid) return;
+
+    // Hashed once, tested against every node's filter
+    auto uri_hash = [](const std::string& uri, bool& present) {
+        present = !uri.empty();
+        return present ? InterestFilter::hash(BlfSubscriptionIndex::normalize_uri(uri)) : InterestFilter::Hashes{};
+    };
+    bool has_callee = false, has_caller = false;
+    auto callee = uri_hash(event.callee_uri, has_callee);
+    auto caller = uri_hash(event.caller_uri, has_caller);
+
+    std::string xml;
+    uint64_t sent = 0, dropped = 0;
+    bool need_wake = false;
+    {
+        std::lock_guard<std::mutex> lk(nodes_mu_);
+        for (auto& node : nodes_) {
+            const auto& f = node->interest;
+            if (f && !(has_callee && f->may_contain(callee)) && !(has_caller && f->may_contain(caller))) continue;
+            if (xml.empty()) xml = to_feed_xml(event);
+            if (node->outbox.size() + xml.size() > config_.distributor_max_node_backlog) { ++dropped; continue; }
+            need_wake |= node->outbox.empty();
+            node->outbox += xml;
+            ++sent;
+        }
+    }
+    if (need_wake) wake();
+
+    if (dropped) stats_.events_dropped.fetch_add(dropped, std::memory_order_relaxed);
+    if (sent) stats_.events_forwarded.fetch_add(sent, std::memory_order_relaxed);
+    else if (!dropped) stats_.events_unwanted.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PresenceDistributor::io_thread_func() {
+    ThreadPlacement::instance().place(ThreadRole::kPresence, 1, "presence-dist");
+    const auto heartbeat_every = std::max<Clock::duration>(config_.presence_heartbeat_interval, Seconds(1));
+    TimePoint next_heartbeat = Clock::now() + heartbeat_every;
+    std::vector<struct pollfd> fds;
+
+    while (!stop_requested_.load(std::memory_order_acquire)) {
+        // Only this thread adds or removes nodes, so indices stay valid
+        // between building the poll set and handling it
+        fds.clear();
+        fds.push_back({listen_fd_, POLLIN, 0});
+        fds.push_back({wake_fd_, POLLIN, 0});
+        {
+            std::lock_guard<std::mutex> lk(nodes_mu_);
+            for (auto& node : nodes_) {
+                short events = POLLIN;
+                if (!node->outbox.empty()) events |= POLLOUT;
+                fds.push_back({node->fd, events, 0});
+            }
+        }
+
+        auto wait = std::chrono::duration_cast<Millisecs>(next_heartbeat - Clock::now()).count();
+        int pr = poll(fds.data(), fds.size(), static_cast<int>(std::max<int64_t>(0, wait)));
+        if (pr < 0 && errno != EINTR) { LOG_ERROR("Distributor: poll failed: %s", strerror(errno)); break; }
+
+        if (fds[1].revents & POLLIN) {
+            uint64_t v;
+            while (read(wake_fd_, &v, sizeof(v)) > 0) {}
+        }
+        if (Clock::now() >= next_heartbeat) {
+            queue_heartbeats();
+            next_heartbeat = Clock::now() + heartbeat_every;
+        }
+
+        // Nodes that fail to read or write are dropped in one pass
+        std::vector<size_t> gone;
+        for (size_t i = 0; i + 2 < fds.size(); ++i) {
+            Node& node = *nodes_[i];
+            bool alive = true;
+            if (fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR)) alive = read_node(node);
+            if (alive) alive = flush_node(node);
+            if (!alive) gone.push_back(i);
+        }
+        if (!gone.empty()) {
+            std::lock_guard<std::mutex> lk(nodes_mu_);
+            for (auto it = gone.rbegin(); it != gone.rend(); ++it) {
+                LOG_INFO("Distributor: node %s disconnected", nodes_[*it]->peer.c_str());
+                close(nodes_[*it]->fd);
+                nodes_.erase(nodes_.begin() + static_cast<std::ptrdiff_t>(*it));
+            }
+            stats_.nodes_connected.store(nodes_.size());
+        }
+
+        if (fds[0].revents & POLLIN) accept_nodes();
+    }
+}
+
+void PresenceDistributor::accept_nodes() {
+    while (true) {
+        struct sockaddr_in peer{};
+        socklen_t len = sizeof(peer);
+        int fd = accept4(listen_fd_, reinterpret_cast<sockaddr*>(&peer), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) LOG_WARN("Distributor: accept failed: %s", strerror(errno));
+            return;
+        }
+        auto node = std::make_unique<Node>();
+        node->fd = fd;
+        char host[INET_ADDRSTRLEN] = "";
+        inet_ntop(AF_INET, &peer.sin_addr, host, sizeof(host));
+        node->peer = std::string(host) + ":" + std::to_string(ntohs(peer.sin_port));
+        LOG_INFO("Distributor: node %s connected", node->peer.c_str());
+
+        std::lock_guard<std::mutex> lk(nodes_mu_);
+        nodes_.push_back(std::move(node));
+        stats_.nodes_connected.store(nodes_.size());
+    }
+}
+
+bool PresenceDistributor::read_node(Node& node) {
+    char buf[65536];
+    while (true) {
+        ssize_t n = recv(node.fd, buf, sizeof(buf), 0);
+        if (n == 0) return false;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        node.inbox.append(buf, static_cast<size_t>(n));
+        if (node.inbox.size() > kMaxInboxBytes) {
+            LOG_WARN("Distributor: node %s sent an oversized message", node.peer.c_str());
+            return false;
+        }
+    }
+
+    static const std::string kClose = "</Interest>";
+    size_t end;
+    while ((end = node.inbox.find(kClose)) != std::string::npos) {
+        end += kClose.size();
+        auto filter = std::make_shared<InterestFilter>();
+        if (InterestFilter::parse_message(std::string_view(node.inbox).substr(0, end), *filter)) {
+            LOG_INFO("Distributor: node %s interest %zu bits, %.1f%% set", node.peer.c_str(),
+                     filter->bits(), filter->fill_ratio() * 100.0);
+            std::lock_guard<std::mutex> lk(nodes_mu_);
+            node.interest = std::move(filter);
+            stats_.interest_updates.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            LOG_WARN("Distributor: malformed interest from node %s, keeping the previous one",
+                     node.peer.c_str());
+        }
+        node.inbox.erase(0, end);
+    }
+    if (node.inbox.find('<') == std::string::npos) node.inbox.clear();
+    return true;
+}
+
+bool PresenceDistributor::flush_node(Node& node) {
+    std::lock_guard<std::mutex> lk(nodes_mu_);
+    size_t off = 0;
+    while (off < node.outbox.size()) {
+        ssize_t n = send(node.fd, node.outbox.data() + off, node.outbox.size() - off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        off += static_cast<size_t>(n);
+    }
+    node.outbox.erase(0, off);
+    return true;
+}
+
+void PresenceDistributor::queue_heartbeats() {
+    auto secs = std::chrono::duration_cast<Seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    std::string hb = "<Heartbeat><Timestamp>" + std::to_string(secs) + "</Timestamp></Heartbeat>\n";
+    std::lock_guard<std::mutex> lk(nodes_mu_);
+    for (auto& node : nodes_) {
+        if (node->outbox.size() + hb.size() <= config_.distributor_max_node_backlog) node->outbox += hb;
+    }
+}
+
+} // namespace sip_processor
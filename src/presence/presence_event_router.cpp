@@ -5,18 +5,38 @@
 #include "dispatch/dialog_dispatcher.h"
 #include "subscription/blf_subscription_index.h"
 #include "sip/sip_event.h"
+#include "common/latency_histogram.h"
+#include "common/metrics_registry.h"
 #include "common/slow_event_logger.h"
 #include "common/logger.h"
+#include "common/thread_affinity.h"
 
 namespace sip_processor {
 
+using RouterStats = PresenceEventRouter::RouterStats;
+static const MetricField<RouterStats> kRouterMetrics[] = {
+    {"sip_processor_router_events_received", MetricType::kCounter, "Call-state events queued for routing", &RouterStats::events_received},
+    {"sip_processor_router_events_processed", MetricType::kCounter, "Call-state events routed", &RouterStats::events_processed},
+    {"sip_processor_router_events_dropped", MetricType::kCounter, "Call-state events dropped on a full queue", &RouterStats::events_dropped},
+    {"sip_processor_router_notifications", MetricType::kCounter, "NOTIFY triggers sent to workers", &RouterStats::notifications_generated},
+    {"sip_processor_router_watchers_not_found", MetricType::kCounter, "Call-state events with no BLF watcher", &RouterStats::watchers_not_found},
+    {"sip_processor_router_prefilter_rejected", MetricType::kCounter, "Call-state events the watcher prefilter dropped without a lookup", &RouterStats::prefilter_rejected},
+    {"sip_processor_router_tenant_scoped_events", MetricType::kCounter, "Call-state events carrying a tenant", &RouterStats::tenant_scoped_events},
+    {"sip_processor_router_queue_depth", MetricType::kGauge, "Call-state events waiting to be routed", &RouterStats::queue_depth},
+};
+
 PresenceEventRouter::PresenceEventRouter(const Config& config,
                                          DialogDispatcher& dispatcher,
                                          std::shared_ptr<SlowEventLogger> slow_logger)
     : config_(config), dispatcher_(dispatcher), slow_logger_(std::move(slow_logger))
-{}
+{
+    MetricsRegistry::instance().add_fields(this, stats_, kRouterMetrics);
+}
 
-PresenceEventRouter::~PresenceEventRouter() { stop(); }
+PresenceEventRouter::~PresenceEventRouter() {
+    stop();
+    MetricsRegistry::instance().unregister(this);
+}
 
 Result PresenceEventRouter::start() {
     if (running_.load(std::memory_order_acquire)) return Result::kAlreadyExists;
@@ -63,6 +83,7 @@ void PresenceEventRouter::on_connection_state_changed(bool connected,
 }
 
 void PresenceEventRouter::router_thread_func() {
+    ThreadPlacement::instance().place(ThreadRole::kRouter, 0, "presence-route");
     LOG_INFO("PresenceRouter: thread started");
 
     while (!stop_requested_.load(std::memory_order_acquire)) {
@@ -80,7 +101,11 @@ void PresenceEventRouter::router_thread_func() {
             stats_.queue_depth.store(event_queue_.size(), std::memory_order_relaxed);
         }
 
+        auto& latency = LatencyRecorder::instance();
+        auto picked_up = Clock::now();
+        latency.record(LatencyStage::kPresenceToRouter, event.received_at, picked_up);
         process_call_state_event(event);
+        latency.record(LatencyStage::kPresenceRoute, picked_up, Clock::now());
     }
 
     LOG_INFO("PresenceRouter: thread exiting");
@@ -88,15 +113,38 @@ void PresenceEventRouter::router_thread_func() {
 
 void PresenceEventRouter::process_call_state_event(const CallStateEvent& event) {
     if (!event.is_valid) return;
+    if (!event.tenant_id.empty()) stats_.tenant_scoped_events.fetch_add(1, std::memory_order_relaxed);
+
+    // Most events have no watcher; the prefilter says so before any
+    // normalization, index lock or timer
+    auto& idx = BlfSubscriptionIndex::instance();
+    bool callee_watched = idx.may_be_watched(event.callee_uri);
+    bool caller_watched = idx.may_be_watched(event.caller_uri);
+    if (!callee_watched && !caller_watched) {
+        stats_.prefilter_rejected.fetch_add(1, std::memory_order_relaxed);
+        stats_.watchers_not_found.fetch_add(1, std::memory_order_relaxed);
+        stats_.events_processed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    SlowEventLogger::Timer timer(*slow_logger_, "PRESENCE_ROUTE", event.presence_call_id,
+                                 event.tenant_id);
+    timer.add_stage("feed_wait", event.received_at, timer.started_at());
 
-    SlowEventLogger::Timer timer(*slow_logger_, "PRESENCE_ROUTE", event.presence_call_id);
+    // Scope lookups to the event's tenant when the feed provides one, so
+    // the same extension in other tenants is never touched
+    auto lookup = [&](const std::string& uri, bool maybe_watched) {
+        if (!maybe_watched) return std::vector<BlfSubscriptionIndex::BlfWatcher>{};
+        return event.tenant_id.empty() ? idx.lookup(uri) : idx.lookup(uri, event.tenant_id);
+    };
 
     // Look up all BLF watchers monitoring the callee URI
-    auto watchers = BlfSubscriptionIndex::instance().lookup(event.callee_uri);
+    auto watchers = lookup(event.callee_uri, callee_watched);
 
     // Also look up watchers monitoring the caller URI (for outbound BLF)
-    auto caller_watchers = BlfSubscriptionIndex::instance().lookup(event.caller_uri);
+    auto caller_watchers = lookup(event.caller_uri, caller_watched);
     watchers.insert(watchers.end(), caller_watchers.begin(), caller_watchers.end());
+    timer.add_stage("lookup", timer.elapsed());
 
     if (watchers.empty()) {
         stats_.watchers_not_found.fetch_add(1, std::memory_order_relaxed);
@@ -182,14 +230,14 @@ std::string PresenceEventRouter::build_dialog_info_xml(
 
 std::unique_ptr<SipEvent> PresenceEventRouter::create_notify_trigger(
     const std::string& dialog_id,
-    const std::string& tenant_id,
+    TenantId tenant_id,
     const CallStateEvent& event,
     const std::string& monitored_uri)
 {
     std::string blf_state = call_state_to_blf_state(event.state);
     std::string xml_body = build_dialog_info_xml(event, monitored_uri);
 
-    return SipEvent::create_presence_trigger(
+    auto trigger = SipEvent::create_presence_trigger(
         dialog_id, tenant_id,
         event.presence_call_id,
         event.caller_uri,
@@ -197,6 +245,9 @@ std::unique_ptr<SipEvent> PresenceEventRouter::create_notify_trigger(
         blf_state,
         event.direction,
         xml_body);
+    // Carry the feed receive time so the worker can measure receive -> NOTIFY
+    if (trigger) trigger->created_at = event.received_at;
+    return trigger;
 }
 
 } // namespace sip_processor
@@ -5,7 +5,10 @@
 #include "presence/presence_tcp_client.h"
 #include "presence/presence_xml_parser.h"
 #include "presence/presence_failover_manager.h"
+#include "presence/uring_receiver.h"
 #include "common/logger.h"
+#include "common/thread_affinity.h"
+#include "common/metrics_registry.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
@@ -14,11 +17,27 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 
 namespace sip_processor {
 
+using ClientStats = PresenceTcpClient::ClientStats;
+static const MetricField<ClientStats> kClientMetrics[] = {
+    {"sip_processor_presence_events_received", MetricType::kCounter, "Events read from the presence feed", &ClientStats::events_received},
+    {"sip_processor_presence_events_delivered", MetricType::kCounter, "Presence events handed to the router", &ClientStats::events_delivered},
+    {"sip_processor_presence_bytes_received", MetricType::kCounter, "Bytes read from the presence feed", &ClientStats::bytes_received},
+    {"sip_processor_presence_connect_attempts", MetricType::kCounter, "Presence server connect attempts", &ClientStats::connect_attempts},
+    {"sip_processor_presence_connect_successes", MetricType::kCounter, "Successful presence server connects", &ClientStats::connect_successes},
+    {"sip_processor_presence_disconnects", MetricType::kCounter, "Presence connections lost", &ClientStats::disconnect_count},
+    {"sip_processor_presence_failovers", MetricType::kCounter, "Failovers to another presence server", &ClientStats::failover_count},
+    {"sip_processor_presence_heartbeat_timeouts", MetricType::kCounter, "Presence heartbeat timeouts", &ClientStats::heartbeat_timeouts},
+    {"sip_processor_presence_parse_errors", MetricType::kCounter, "Unparseable presence messages", &ClientStats::parse_errors},
+    {"sip_processor_presence_interest_published", MetricType::kCounter, "Interest filters sent to the presence distributor", &ClientStats::interest_published},
+    {"sip_processor_presence_read_syscalls", MetricType::kCounter, "Syscalls spent waiting for and reading feed data", &ClientStats::read_syscalls},
+};
+
 PresenceTcpClient::PresenceTcpClient(const Config& config,
                                        std::shared_ptr<PresenceFailoverManager> failover_mgr)
     : config_(config)
@@ -26,9 +45,14 @@ PresenceTcpClient::PresenceTcpClient(const Config& config,
     , current_backoff_(config.presence_reconnect_interval)
     , parser_(std::make_unique<PresenceXmlParser>())
     , recv_buffer_(config.presence_recv_buffer_size, '\0')
-{}
+{
+    MetricsRegistry::instance().add_fields(this, stats_, kClientMetrics);
+}
 
-PresenceTcpClient::~PresenceTcpClient() { stop(); }
+PresenceTcpClient::~PresenceTcpClient() {
+    stop();
+    MetricsRegistry::instance().unregister(this);
+}
 
 void PresenceTcpClient::set_event_callback(EventCallback cb) { event_callback_ = std::move(cb); }
 void PresenceTcpClient::set_state_callback(StateCallback cb) { state_callback_ = std::move(cb); }
@@ -39,6 +63,28 @@ std::string PresenceTcpClient::connected_server() const {
     return current_server_.host + ":" + std::to_string(current_server_.port);
 }
 
+void PresenceTcpClient::publish_interest(std::string message) {
+    std::lock_guard<std::mutex> lk(send_mu_);
+    interest_message_ = std::move(message);
+    send_interest_locked();
+}
+
+void PresenceTcpClient::send_interest_locked() {
+    if (socket_fd_ < 0 || interest_message_.empty()) return;
+    size_t off = 0;
+    while (off < interest_message_.size()) {
+        ssize_t n = send(socket_fd_, interest_message_.data() + off, interest_message_.size() - off, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            // The reader notices the broken connection; resent on reconnect
+            LOG_WARN("PresenceTcp: interest publish failed: %s", strerror(errno));
+            return;
+        }
+        off += static_cast<size_t>(n);
+    }
+    stats_.interest_published.fetch_add(1, std::memory_order_relaxed);
+}
+
 Result PresenceTcpClient::start() {
     if (running_.load(std::memory_order_acquire)) return Result::kAlreadyExists;
     if (!event_callback_) return Result::kInvalidArgument;
@@ -122,16 +168,25 @@ Result PresenceTcpClient::connect_to_server(const PresenceServerEndpoint& ep) {
 
     { std::lock_guard<std::mutex> lk(heartbeat_mu_); last_heartbeat_ = Clock::now(); }
     parser_->reset();
+    { std::lock_guard<std::mutex> lk(send_mu_); send_interest_locked(); }
 
     return Result::kOk;
 }
 
 void PresenceTcpClient::close_socket() {
+    std::lock_guard<std::mutex> lk(send_mu_);
     if (socket_fd_ >= 0) { shutdown(socket_fd_, SHUT_RDWR); close(socket_fd_); socket_fd_ = -1; }
     connected_.store(false);
 }
 
 void PresenceTcpClient::reader_thread_func() {
+    ThreadPlacement::instance().place(ThreadRole::kPresence, 0, "presence-rx");
+    if (config_.presence_io_backend == "io_uring") {
+        // Created here so the rings and buffers are local to this thread's node
+        uring_ = UringReceiver::create(config_.presence_recv_buffer_size, config_.presence_uring_buffers);
+        if (uring_) LOG_INFO("PresenceTcp: receiving with io_uring (%zu buffers)", config_.presence_uring_buffers);
+        else LOG_WARN("PresenceTcp: io_uring unavailable, receiving with poll");
+    }
     while (!stop_requested_.load(std::memory_order_acquire)) {
         // Get next server from failover manager
         if (!failover_mgr_) break;
@@ -167,9 +222,16 @@ void PresenceTcpClient::reader_thread_func() {
 }
 
 void PresenceTcpClient::read_loop() {
+    if (uring_) {
+        if (uring_read_loop()) return;
+        LOG_WARN("PresenceTcp: kernel lacks multishot recv, receiving with poll");
+        uring_.reset();
+    }
+
     while (!stop_requested_.load(std::memory_order_acquire)) {
         struct pollfd pfd{socket_fd_, POLLIN, 0};
         int pr = poll(&pfd, 1, 1000);
+        stats_.read_syscalls.fetch_add(1, std::memory_order_relaxed);
 
         if (pr < 0) { if (errno == EINTR) continue; return; }
         if (pr == 0) { check_heartbeat_timeout(); if (socket_fd_ < 0) return; continue; }
@@ -177,24 +239,64 @@ void PresenceTcpClient::read_loop() {
 
         if (pfd.revents & POLLIN) {
             ssize_t bytes = recv(socket_fd_, recv_buffer_.data(), recv_buffer_.size(), 0);
+            stats_.read_syscalls.fetch_add(1, std::memory_order_relaxed);
             if (bytes <= 0) { if (bytes < 0 && (errno == EINTR || errno == EAGAIN)) continue; return; }
+            handle_received(recv_buffer_.data(), static_cast<size_t>(bytes));
+        }
+    }
+}
 
-            stats_.bytes_received.fetch_add(static_cast<uint64_t>(bytes));
+bool PresenceTcpClient::uring_read_loop() {
+    uint64_t syscalls = uring_->syscalls();
+    auto account = [&] {
+        uint64_t now = uring_->syscalls();
+        stats_.read_syscalls.fetch_add(now - syscalls, std::memory_order_relaxed);
+        syscalls = now;
+    };
+    if (!uring_->arm(socket_fd_)) { account(); return true; }
+
+    // Chunks are parsed straight out of the kernel-filled buffers
+    auto on_data = [this](const char* data, size_t len) { handle_received(data, len); };
+    bool supported = true;
+    while (!stop_requested_.load(std::memory_order_acquire)) {
+        auto w = uring_->wait(heartbeat_wait(), on_data);
+        account();
+        if (w == UringReceiver::Wait::kData) continue;
+        if (w == UringReceiver::Wait::kTimeout) {
+            check_heartbeat_timeout();
+            if (socket_fd_ >= 0) continue;
+        }
+        supported = w != UringReceiver::Wait::kUnsupported;
+        break;
+    }
+    uring_->disarm();
+    account();
+    return supported;
+}
 
-            auto pr_result = parser_->feed(recv_buffer_.data(), static_cast<size_t>(bytes));
-            if (!pr_result.error.empty()) stats_.parse_errors.fetch_add(1);
+void PresenceTcpClient::handle_received(const char* data, size_t len) {
+    stats_.bytes_received.fetch_add(static_cast<uint64_t>(len));
 
-            if (pr_result.received_heartbeat || !pr_result.events.empty()) {
-                std::lock_guard<std::mutex> lk(heartbeat_mu_);
-                last_heartbeat_ = Clock::now();
-            }
+    auto pr_result = parser_->feed(data, len);
+    if (!pr_result.error.empty()) stats_.parse_errors.fetch_add(1);
 
-            for (auto& ev : pr_result.events) {
-                stats_.events_received.fetch_add(1);
-                if (event_callback_) { event_callback_(std::move(ev)); stats_.events_delivered.fetch_add(1); }
-            }
-        }
+    if (pr_result.received_heartbeat || !pr_result.events.empty()) {
+        std::lock_guard<std::mutex> lk(heartbeat_mu_);
+        last_heartbeat_ = Clock::now();
     }
+
+    for (auto& ev : pr_result.events) {
+        stats_.events_received.fetch_add(1);
+        if (event_callback_) { event_callback_(std::move(ev)); stats_.events_delivered.fetch_add(1); }
+    }
+}
+
+Millisecs PresenceTcpClient::heartbeat_wait() {
+    auto timeout = config_.presence_heartbeat_interval * config_.presence_heartbeat_miss_threshold;
+    std::lock_guard<std::mutex> lk(heartbeat_mu_);
+    auto left = std::chrono::duration_cast<Millisecs>(last_heartbeat_ + timeout - Clock::now());
+    // Just past the deadline, since the check wants elapsed > timeout
+    return std::max(Millisecs(10), left + Millisecs(1));
 }
 
 void PresenceTcpClient::check_heartbeat_timeout() {
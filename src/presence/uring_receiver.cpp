@@ -0,0 +1,341 @@
+
+// =============================================================================
+// FILE: src/presence/uring_receiver.cpp
+// =============================================================================
+#include "presence/uring_receiver.h"
+#include "common/logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_FEAT_EXT_ARG) && defined(__NR_io_uring_setup)
+#define SIP_PROCESSOR_HAVE_IO_URING 1
+#endif
+#endif
+
+namespace sip_processor {
+
+#ifdef SIP_PROCESSOR_HAVE_IO_URING
+
+namespace {
+
+constexpr uint64_t kRecvTag     = 1;
+constexpr uint64_t kCancelTag   = 2;
+constexpr uint64_t kProvideTag  = 3;
+constexpr uint16_t kBufferGroup = 0;
+constexpr unsigned kRingEntries = 32;
+constexpr size_t   kMaxBuffers  = 32768;
+
+int io_uring_setup(unsigned entries, io_uring_params* p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                   const void* arg, size_t argsz) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz));
+}
+
+int io_uring_register(int fd, unsigned op, const void* arg, unsigned nr) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, op, arg, nr));
+}
+
+}  // namespace
+
+// Kernel-shared memory: the SQ/CQ rings (one mapping), the SQE array and
+// the provided buffer ring
+struct UringReceiver::Ring {
+    int fd = -1;
+    void*   rings = MAP_FAILED;
+    size_t  rings_size = 0;
+    void*   sqes_map = MAP_FAILED;
+    size_t  sqes_size = 0;
+
+    io_uring_sqe* sqes = nullptr;
+    unsigned* sq_head  = nullptr;
+    unsigned* sq_tail  = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned  sq_mask  = 0;
+    unsigned  sq_entries = 0;
+    unsigned* cq_head  = nullptr;
+    unsigned* cq_tail  = nullptr;
+    unsigned  cq_mask  = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    io_uring_buf_ring* buf_ring = nullptr;
+    unsigned buf_mask = 0;
+    uint16_t buf_tail = 0;          // Local; published with release semantics
+
+    ~Ring() {
+        if (sqes_map != MAP_FAILED) munmap(sqes_map, sqes_size);
+        if (rings != MAP_FAILED) munmap(rings, rings_size);
+        if (fd >= 0) close(fd);     // Also drops the buffer ring registration
+        std::free(buf_ring);
+    }
+
+    // Queued SQEs go to the kernel with the next io_uring_enter
+    unsigned pending() const { return *sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE); }
+    int flush() { return io_uring_enter(fd, pending(), 0, 0, nullptr, 0); }
+
+    // Only this thread writes the SQ tail
+    io_uring_sqe* prepare(uint64_t& syscalls) {
+        if (pending() == sq_entries) { ++syscalls; flush(); }
+        unsigned idx = *sq_tail & sq_mask;
+        io_uring_sqe* sqe = &sqes[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array[idx] = idx;
+        return sqe;
+    }
+    void commit() { __atomic_store_n(sq_tail, *sq_tail + 1, __ATOMIC_RELEASE); }
+
+    // Entries start at the ring itself: the tail overlays the first one's
+    // reserved field.  Under C++ the uapi header's bufs[] sits past that
+    // overlay, so it cannot be used to index them (liburing does the same).
+    void add_buffer(char* addr, size_t len, uint16_t bid) {
+        io_uring_buf* b = reinterpret_cast<io_uring_buf*>(buf_ring) + (buf_tail & buf_mask);
+        b->addr = reinterpret_cast<uint64_t>(addr);
+        b->len  = static_cast<uint32_t>(len);
+        b->bid  = bid;
+        ++buf_tail;
+    }
+    void publish_buffers() { __atomic_store_n(&buf_ring->tail, buf_tail, __ATOMIC_RELEASE); }
+};
+
+std::unique_ptr<UringReceiver> UringReceiver::create(size_t buffer_size, size_t buffer_count) {
+    if (buffer_size == 0 || buffer_size > UINT32_MAX) return nullptr;
+    size_t count = 1;
+    while (count < buffer_count && count < kMaxBuffers) count <<= 1;
+
+    auto ring = std::make_unique<Ring>();
+    io_uring_params p{};
+    ring->fd = io_uring_setup(kRingEntries, &p);
+    if (ring->fd < 0) {
+        LOG_INFO("io_uring: setup failed: %s", strerror(errno));
+        return nullptr;
+    }
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_EXT_ARG)) {
+        LOG_INFO("io_uring: kernel lacks single-mmap rings or extended wait arguments");
+        return nullptr;
+    }
+
+    ring->rings_size = std::max<size_t>(p.sq_off.array + p.sq_entries * sizeof(unsigned),
+                                        p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe));
+    ring->rings = mmap(nullptr, ring->rings_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    ring->sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+    ring->sqes_map = mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->rings == MAP_FAILED || ring->sqes_map == MAP_FAILED) {
+        LOG_INFO("io_uring: ring mmap failed: %s", strerror(errno));
+        return nullptr;
+    }
+
+    char* base = static_cast<char*>(ring->rings);
+    ring->sqes     = static_cast<io_uring_sqe*>(ring->sqes_map);
+    ring->sq_head  = reinterpret_cast<unsigned*>(base + p.sq_off.head);
+    ring->sq_tail  = reinterpret_cast<unsigned*>(base + p.sq_off.tail);
+    ring->sq_array = reinterpret_cast<unsigned*>(base + p.sq_off.array);
+    ring->sq_mask  = *reinterpret_cast<unsigned*>(base + p.sq_off.ring_mask);
+    ring->sq_entries = p.sq_entries;
+    ring->cq_head  = reinterpret_cast<unsigned*>(base + p.cq_off.head);
+    ring->cq_tail  = reinterpret_cast<unsigned*>(base + p.cq_off.tail);
+    ring->cq_mask  = *reinterpret_cast<unsigned*>(base + p.cq_off.ring_mask);
+    ring->cqes     = reinterpret_cast<io_uring_cqe*>(base + p.cq_off.cqes);
+
+    void* mem = nullptr;
+    size_t ring_bytes = count * sizeof(io_uring_buf);
+    if (posix_memalign(&mem, static_cast<size_t>(sysconf(_SC_PAGESIZE)), ring_bytes) != 0) return nullptr;
+    std::memset(mem, 0, ring_bytes);
+    ring->buf_ring = static_cast<io_uring_buf_ring*>(mem);
+    ring->buf_mask = static_cast<unsigned>(count - 1);
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr    = reinterpret_cast<uint64_t>(mem);
+    reg.ring_entries = static_cast<uint32_t>(count);
+    reg.bgid         = kBufferGroup;
+    bool mapped = io_uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) == 0;
+    if (!mapped) {
+        LOG_INFO("io_uring: provided buffer rings unsupported (%s), providing buffers by SQE",
+                 strerror(errno));
+    }
+    return std::unique_ptr<UringReceiver>(new UringReceiver(std::move(ring), buffer_size, count, mapped));
+}
+
+UringReceiver::UringReceiver(std::unique_ptr<Ring> ring, size_t buffer_size, size_t buffer_count,
+                             bool ring_mapped)
+    : ring_(std::move(ring)), buffer_size_(buffer_size), buffer_count_(buffer_count)
+    , buffers_(buffer_size * buffer_count), ring_mapped_(ring_mapped)
+{
+    if (!ring_mapped_) {
+        provide(0, buffer_count_);   // Submitted with the first recv
+        return;
+    }
+    for (size_t i = 0; i < buffer_count_; ++i) {
+        ring_->add_buffer(&buffers_[i * buffer_size_], buffer_size_, static_cast<uint16_t>(i));
+    }
+    ring_->publish_buffers();
+}
+
+UringReceiver::~UringReceiver() {
+    disarm();
+}
+
+bool UringReceiver::arm(int fd) {
+    if (armed_) disarm();
+    fd_ = fd;
+    return submit_recv();
+}
+
+bool UringReceiver::submit_recv() {
+    io_uring_sqe* sqe = ring_->prepare(syscalls_);
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = fd_;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kBufferGroup;
+    sqe->user_data = kRecvTag;
+    ring_->commit();
+    ++syscalls_;
+    if (ring_->flush() < 0) {
+        LOG_WARN("io_uring: recv submit failed: %s", strerror(errno));
+        return false;
+    }
+    armed_ = true;
+    return true;
+}
+
+bool UringReceiver::submit_cancel() {
+    io_uring_sqe* sqe = ring_->prepare(syscalls_);
+    sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+    sqe->fd        = -1;
+    sqe->addr      = kRecvTag;
+    sqe->user_data = kCancelTag;
+    ring_->commit();
+    ++syscalls_;
+    return ring_->flush() >= 0;
+}
+
+void UringReceiver::recycle(uint16_t bid) {
+    if (ring_mapped_) ring_->add_buffer(&buffers_[static_cast<size_t>(bid) * buffer_size_], buffer_size_, bid);
+    else provide(bid, 1);
+}
+
+void UringReceiver::provide(uint16_t bid, size_t count) {
+    io_uring_sqe* sqe = ring_->prepare(syscalls_);
+    sqe->opcode    = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd        = static_cast<int>(count);
+    sqe->addr      = reinterpret_cast<uint64_t>(&buffers_[static_cast<size_t>(bid) * buffer_size_]);
+    sqe->len       = static_cast<uint32_t>(buffer_size_);
+    sqe->off       = bid;
+    sqe->buf_group = kBufferGroup;
+    sqe->user_data = kProvideTag;
+    ring_->commit();
+}
+
+UringReceiver::Wait UringReceiver::drain(const DataFn& on_data) {
+    bool data = false, closed = false, error = false, unsupported = false, rearm = false;
+    unsigned head = *ring_->cq_head;
+    unsigned tail = __atomic_load_n(ring_->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        const io_uring_cqe& cqe = ring_->cqes[head & ring_->cq_mask];
+        if (cqe.user_data != kRecvTag) continue;     // Cancel and provide completions
+        bool more = cqe.flags & IORING_CQE_F_MORE;
+        if (!more) armed_ = false;
+
+        if (cqe.flags & IORING_CQE_F_BUFFER) {
+            uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            if (cqe.res > 0 && on_data) {
+                on_data(&buffers_[static_cast<size_t>(bid) * buffer_size_], static_cast<size_t>(cqe.res));
+            }
+            recycle(bid);
+        }
+        if (cqe.res > 0) {
+            data = true;
+            starved_ = false;
+            rearm |= !more;
+        } else if (cqe.res == 0) {
+            closed = true;
+        } else if (cqe.res == -ENOBUFS) {
+            // Every buffer was in use and is back now; starving twice in a
+            // row means the kernel cannot use provided buffers
+            if (starved_) unsupported = true;
+            starved_ = true;
+            rearm = true;
+        } else if (cqe.res == -EINVAL) {
+            unsupported = true;      // Kernel without multishot recv
+        } else if (cqe.res != -ECANCELED) {
+            error = true;
+        }
+    }
+    __atomic_store_n(ring_->cq_head, head, __ATOMIC_RELEASE);
+    if (ring_mapped_) ring_->publish_buffers();
+
+    if (unsupported) return Wait::kUnsupported;
+    if (error) return Wait::kError;
+    if (closed) return Wait::kClosed;
+    if (rearm && fd_ >= 0 && !armed_ && !submit_recv()) return Wait::kError;
+    return data ? Wait::kData : Wait::kTimeout;
+}
+
+UringReceiver::Wait UringReceiver::wait(Millisecs timeout, const DataFn& on_data) {
+    // A re-armed recv or an interrupted wait is not the timeout
+    TimePoint deadline = Clock::now() + timeout;
+    for (;;) {
+        if (!armed_) return fd_ >= 0 ? Wait::kError : Wait::kClosed;
+        if (*ring_->cq_head == __atomic_load_n(ring_->cq_tail, __ATOMIC_ACQUIRE)) {
+            auto left = std::max<Clock::duration>(deadline - Clock::now(), Clock::duration::zero());
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+            __kernel_timespec ts{};
+            ts.tv_sec  = ns / 1000000000;
+            ts.tv_nsec = ns % 1000000000;
+            io_uring_getevents_arg arg{};
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+            // Buffers returned by SQE ride along with the wait
+            ++syscalls_;
+            int r = io_uring_enter(ring_->fd, ring_->pending(), 1,
+                                   IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+            if (r < 0 && errno != ETIME && errno != EINTR) return Wait::kError;
+        }
+        Wait w = drain(on_data);
+        if (w != Wait::kTimeout || Clock::now() >= deadline) return w;
+    }
+}
+
+void UringReceiver::disarm() {
+    fd_ = -1;                        // No re-arm while draining
+    if (!armed_) return;
+    if (submit_cancel()) {
+        // The recv's last completion returns its buffer
+        for (int i = 0; i < 10 && armed_; ++i) wait(Millisecs(100), nullptr);
+    }
+    armed_ = false;
+}
+
+#else  // !SIP_PROCESSOR_HAVE_IO_URING
+
+struct UringReceiver::Ring {};
+
+std::unique_ptr<UringReceiver> UringReceiver::create(size_t, size_t) {
+    LOG_INFO("io_uring: not available in this build");
+    return nullptr;
+}
+UringReceiver::UringReceiver(std::unique_ptr<Ring> ring, size_t buffer_size, size_t buffer_count, bool)
+    : ring_(std::move(ring)), buffer_size_(buffer_size), buffer_count_(buffer_count) {}
+UringReceiver::~UringReceiver() = default;
+bool UringReceiver::arm(int) { return false; }
+UringReceiver::Wait UringReceiver::wait(Millisecs, const DataFn&) { return Wait::kUnsupported; }
+void UringReceiver::disarm() {}
+bool UringReceiver::submit_recv() { return false; }
+bool UringReceiver::submit_cancel() { return false; }
+UringReceiver::Wait UringReceiver::drain(const DataFn&) { return Wait::kUnsupported; }
+void UringReceiver::recycle(uint16_t) {}
+void UringReceiver::provide(uint16_t, size_t) {}
+
+#endif  // SIP_PROCESSOR_HAVE_IO_URING
+
+} // namespace sip_processor
@@ -0,0 +1,81 @@
+// =============================================================================
+// FILE: src/sip/notify_backlog.cpp
+// =============================================================================
+#include "sip/notify_backlog.h"
+
+namespace sip_processor {
+
+NotifyBacklog::NotifyBacklog(Seconds timeout, TimePoint now)
+    : timeout_sec_(std::clamp<int64_t>(timeout.count(), 1, static_cast<int64_t>(kBuckets) / 2)) {
+    clear();
+    expired_through_.store(second_of(now) - timeout_sec_, std::memory_order_relaxed);
+}
+
+int64_t NotifyBacklog::second_of(TimePoint t) {
+    return std::chrono::duration_cast<Seconds>(t.time_since_epoch()).count();
+}
+
+std::atomic<int32_t>& NotifyBacklog::slot(const void* handle) {
+    uint64_t h = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle) >> 4) * 0x9E3779B97F4A7C15ull;
+    return slots_[h >> 50];   // Top 14 bits
+}
+
+void NotifyBacklog::on_sent(const void* handle, TimePoint now) {
+    slot(handle).fetch_add(1, std::memory_order_relaxed);
+    buckets_[static_cast<uint64_t>(second_of(now)) % kBuckets].fetch_add(1, std::memory_order_relaxed);
+    total_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void NotifyBacklog::on_response(const void* handle) {
+    auto& s = slot(handle);
+    int32_t v = s.load(std::memory_order_relaxed);
+    while (v > 0 && !s.compare_exchange_weak(v, v - 1, std::memory_order_relaxed)) {}
+    if (v > 0) take_oldest(1);
+}
+
+void NotifyBacklog::forget(const void* handle) {
+    int32_t n = slot(handle).exchange(0, std::memory_order_relaxed);
+    if (n > 0) take_oldest(n);
+}
+
+// Oldest first, from the first second not yet expired.  Races with
+// expire() are harmless: each NOTIFY leaves its bucket, and total_, once.
+void NotifyBacklog::take_oldest(int64_t n) {
+    int64_t first = expired_through_.load(std::memory_order_relaxed) + 1;
+    int64_t taken = 0;
+    for (size_t i = 0; i < kBuckets && taken < n; ++i) {
+        auto& b = buckets_[static_cast<uint64_t>(first + static_cast<int64_t>(i)) % kBuckets];
+        int64_t v = b.load(std::memory_order_relaxed);
+        while (v > 0) {
+            int64_t take = std::min(v, n - taken);
+            if (b.compare_exchange_weak(v, v - take, std::memory_order_relaxed)) {
+                taken += take;
+                break;
+            }
+        }
+    }
+    if (taken > 0) total_.fetch_sub(taken, std::memory_order_relaxed);
+}
+
+int64_t NotifyBacklog::expire(TimePoint now) {
+    int64_t cutoff = second_of(now) - timeout_sec_;
+    int64_t from = expired_through_.load(std::memory_order_relaxed);
+    if (cutoff <= from) return 0;
+    // After a stall longer than the ring, each bucket is visited once
+    from = std::max(from, cutoff - static_cast<int64_t>(kBuckets));
+    int64_t expired = 0;
+    for (int64_t s = from + 1; s <= cutoff; ++s) {
+        expired += buckets_[static_cast<uint64_t>(s) % kBuckets].exchange(0, std::memory_order_relaxed);
+    }
+    expired_through_.store(cutoff, std::memory_order_relaxed);
+    if (expired > 0) total_.fetch_sub(expired, std::memory_order_relaxed);
+    return expired;
+}
+
+void NotifyBacklog::clear() {
+    for (auto& b : buckets_) b.store(0, std::memory_order_relaxed);
+    for (auto& s : slots_) s.store(0, std::memory_order_relaxed);
+    total_.store(0, std::memory_order_relaxed);
+}
+
+} // namespace sip_processor
@@ -5,8 +5,12 @@
 #include "sip/sip_callback_handler.h"
 #include "sip/sip_event.h"
 #include "dispatch/dialog_dispatcher.h"
+#include "dispatch/overload_controller.h"
+#include "sip/sip_stack_manager.h"
 #include "common/logger.h"
 #include <sofia-sip/nua_tag.h>
+#include <sofia-sip/sip_tag.h>
+#include <cstdio>
 
 namespace sip_processor {
 
@@ -38,11 +42,15 @@ std::string SipCallbackHandler::extract_tenant_id(const sip_t* sip) {
 
 void SipCallbackHandler::nua_callback(
     nua_event_t event, int status, char const* phrase,
-    nua_t*, nua_magic_t*,
+    nua_t*, nua_magic_t* magic,
     nua_handle_t* nh, nua_hmagic_t*,
     sip_t const* sip, tagi_t[])
 {
     if (!should_process(event)) return;
+    // The stack registers itself as the NUA magic
+    if (event == nua_r_notify && status >= 200 && magic) {
+        static_cast<SipStackManager*>(magic)->on_notify_response(nh);
+    }
 
     if (!dispatcher_) {
         LOG_ERROR("NUA callback: dispatcher is null");
@@ -73,7 +81,16 @@ void SipCallbackHandler::nua_callback(
     }
 
     Result r = dispatcher_->dispatch(std::move(sip_event));
-    if (r != Result::kOk) {
+    if (r == Result::kOverloaded && event == nua_i_subscribe && nh) {
+        // Shed by the overload controller (counted there, so not logged):
+        // Retry-After spreads the phones' next attempts
+        char retry_after[16];
+        snprintf(retry_after, sizeof(retry_after), "%u", dispatcher_->overload()->retry_after_sec());
+        nua_respond(nh, 503, "Service Unavailable",
+                    SIPTAG_RETRY_AFTER_STR(retry_after),
+                    NUTAG_SUBSTATE(nua_substate_terminated), TAG_END());
+        nua_handle_unref(nh);
+    } else if (r != Result::kOk) {
         LOG_WARN("NUA callback: dispatch failed for %s: %s",
                  nua_event_name(event), result_to_string(r));
         if (event == nua_i_subscribe && nh) {
@@ -90,7 +90,10 @@ std::unique_ptr<SipEvent> SipEvent::create_from_sofia(
         }
 
         if (sip->sip_cseq) ev->cseq = sip->sip_cseq->cs_seq;
-        if (sip->sip_expires) ev->expires = sip->sip_expires->ex_delta;
+        if (sip->sip_expires) {
+            ev->expires = sip->sip_expires->ex_delta;
+            ev->has_expires = true;
+        }
 
         if (sip->sip_content_type && sip->sip_content_type->c_type)
             ev->content_type = safe_copy_n(sip->sip_content_type->c_type, 256);
@@ -125,7 +128,7 @@ std::unique_ptr<SipEvent> SipEvent::create_from_sofia(
 
 std::unique_ptr<SipEvent> SipEvent::create_presence_trigger(
     const std::string& dialog_id,
-    const std::string& tenant_id,
+    TenantId tenant_id,
     const std::string& presence_call_id,
     const std::string& caller_uri,
     const std::string& callee_uri,
@@ -136,7 +139,7 @@ std::unique_ptr<SipEvent> SipEvent::create_presence_trigger(
     auto ev = std::make_unique<SipEvent>();
     ev->id                 = next_id();
     ev->dialog_id          = dialog_id;
-    ev->tenant_id          = tenant_id;
+    ev->tenant_id          = tenant_id.str();
     ev->category           = SipEventCategory::kPresenceTrigger;
     ev->source             = SipEventSource::kPresenceFeed;
     ev->sub_type           = SubscriptionType::kBLF;
@@ -157,5 +160,24 @@ std::unique_ptr<SipEvent> SipEvent::create_presence_trigger(
     return ev;
 }
 
+std::unique_ptr<SipEvent> SipEvent::create_mwi_trigger(
+    const std::string& dialog_id,
+    TenantId tenant_id,
+    std::shared_ptr<const std::string> message_summary_body)
+{
+    auto ev = std::make_unique<SipEvent>();
+    ev->id           = next_id();
+    ev->dialog_id    = dialog_id;
+    ev->tenant_id    = tenant_id.str();
+    ev->category     = SipEventCategory::kPresenceTrigger;
+    ev->source       = SipEventSource::kMwiFeed;
+    ev->sub_type     = SubscriptionType::kMWI;
+    ev->direction    = SipDirection::kIncoming;
+    ev->content_type = "application/simple-message-summary";
+    ev->shared_body  = std::move(message_summary_body);
+    ev->created_at   = Clock::now();
+    return ev;
+}
+
 } // namespace sip_processor
 
@@ -5,6 +5,7 @@
 #include "sip/sip_stack_manager.h"
 #include "sip/sip_callback_handler.h"
 #include "common/logger.h"
+#include "common/thread_affinity.h"
 #include <sofia-sip/su.h>
 #include <sofia-sip/su_alloc.h>
 #include <sofia-sip/nua_tag.h>
@@ -31,7 +32,7 @@ Result SipStackManager::start() {
     if (!root_) { LOG_FATAL("Failed to create Sofia root"); return Result::kError; }
 
     nua_ = nua_create(root_,
-                      SipCallbackHandler::nua_callback, nullptr,
+                      SipCallbackHandler::nua_callback, this,
                       NUTAG_URL(config_.sip_bind_url.c_str()),
                       NUTAG_USER_AGENT(config_.sip_user_agent.c_str()),
                       NUTAG_ALLOW("SUBSCRIBE, NOTIFY, PUBLISH"),
@@ -65,6 +66,8 @@ void SipStackManager::stop() {
         nua_destroy(nua_); nua_ = nullptr;
     }
     if (root_) { su_root_destroy(root_); root_ = nullptr; }
+    // Whatever was still in flight died with the stack
+    notify_backlog_.clear();
 
     su_deinit();
     running_.store(false, std::memory_order_release);
@@ -72,9 +75,20 @@ void SipStackManager::stop() {
 }
 
 void SipStackManager::run_event_loop() {
+    ThreadPlacement::instance().place(ThreadRole::kSip, 0, "sip-sofia");
     LOG_INFO("Sofia event loop thread started");
+    TimePoint next_expiry = Clock::now() + Seconds(1);
     while (!stop_requested_.load(std::memory_order_acquire)) {
         su_root_step(root_, 100);
+        TimePoint now = Clock::now();
+        if (now >= next_expiry) {
+            int64_t expired = notify_backlog_.expire(now);
+            if (expired > 0) {
+                LOG_WARN("SIP: %ld NOTIFYs had no response after %lds; no longer counted as backlog",
+                         static_cast<long>(expired), static_cast<long>(kNotifyResponseTimeout.count()));
+            }
+            next_expiry = now + Seconds(1);
+        }
     }
     LOG_INFO("Sofia event loop thread exiting");
 }
@@ -107,6 +121,17 @@ void SipStackManager::respond_to_subscribe(nua_handle_t* nh, int status,
                 TAG_END());
 }
 
+void SipStackManager::respond_interval_too_brief(nua_handle_t* nh, uint32_t min_expires) {
+    if (!nh || !running_.load(std::memory_order_acquire)) return;
+
+    char min_expires_str[32];
+    snprintf(min_expires_str, sizeof(min_expires_str), "%u", min_expires);
+    nua_respond(nh, 423, "Interval Too Brief",
+                NUTAG_SUBSTATE(nua_substate_terminated),
+                SIPTAG_MIN_EXPIRES_STR(min_expires_str),
+                TAG_END());
+}
+
 void SipStackManager::send_notify(nua_handle_t* nh, const char* event_type,
                                    const char* content_type, const char* body,
                                    const char* subscription_state_str) {
@@ -132,6 +157,7 @@ void SipStackManager::send_notify(nua_handle_t* nh, const char* event_type,
               subscription_state_str ? subscription_state_str : "active",
               body ? strlen(body) : 0);
 
+    notify_backlog_.on_sent(nh);
     nua_notify(nh,
                NUTAG_SUBSTATE(substate),
                SIPTAG_EVENT_STR(event_type),
@@ -70,7 +70,7 @@ BlfProcessor::NotifyAction BlfProcessor::process_presence_trigger(
     action.subscription_state_header = "active";
 
     action.body = build_dialog_info_xml(
-        record.blf_monitored_uri,
+        record.blf_monitored_uri.str(),
         record.dialog_id,
         event.presence_call_id,
         event.presence_state,
@@ -141,7 +141,10 @@ Result BlfProcessor::handle_subscribe(const SipEvent& event, SubscriptionRecord&
               record.dialog_id.c_str(), event.from_uri.c_str(),
               event.to_uri.c_str(), event.expires);
 
-    if (!event.to_uri.empty()) record.blf_monitored_uri = event.to_uri;
+    // In-dialog To is fixed, so this interns only for an admitted dialog
+    if (!event.to_uri.empty() && record.blf_monitored_uri != event.to_uri) {
+        record.blf_monitored_uri = Symbol(event.to_uri);
+    }
 
     if (event.expires == 0) {
         record.lifecycle = SubLifecycle::kTerminating;
@@ -227,7 +230,9 @@ BlfProcessor::DialogState BlfProcessor::parse_dialog_info_xml(const std::string&
 void BlfProcessor::update_blf_state(SubscriptionRecord& record, const DialogState& state) {
     std::string prev = record.blf_last_state;
     record.blf_last_state = state.state;
-    if (!state.entity.empty()) record.blf_monitored_uri = state.entity;
+    // The entity comes from a peer's body: adopt it only if already known
+    Symbol entity;
+    if (!state.entity.empty() && Symbol::find(state.entity, entity)) record.blf_monitored_uri = entity;
 
     if (prev != state.state) {
         LOG_INFO("BLF: state change dialog=%s monitored=%s: %s -> %s",
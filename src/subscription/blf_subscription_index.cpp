@@ -9,11 +9,18 @@
 
 namespace sip_processor {
 
+// 4 MiB: under 2% false positives at 400k monitored URIs
+static constexpr size_t kDefaultPrefilterCounters = size_t(1) << 22;
+
 BlfSubscriptionIndex& BlfSubscriptionIndex::instance() {
     static BlfSubscriptionIndex index;
     return index;
 }
 
+BlfSubscriptionIndex::BlfSubscriptionIndex() {
+    configure_prefilter(kDefaultPrefilterCounters);
+}
+
 std::string BlfSubscriptionIndex::normalize_uri(const std::string& uri) {
     if (uri.empty()) return "";
 
@@ -59,128 +66,235 @@ std::string BlfSubscriptionIndex::normalize_uri(const std::string& uri) {
     return normalized;
 }
 
-void BlfSubscriptionIndex::add(const std::string& monitored_uri,
+static constexpr uint64_t kFnvOffset = 14695981039346656037ull;
+static constexpr uint64_t kFnvPrime  = 1099511628211ull;
+
+// Walks the same steps as normalize_uri over a view, hashing the characters
+// it would produce
+uint64_t BlfSubscriptionIndex::normalized_uri_hash(std::string_view uri) {
+    uint64_t h = kFnvOffset;
+    auto put = [&h](char c) { h ^= static_cast<unsigned char>(c); h *= kFnvPrime; };
+    if (uri.empty()) return h;
+
+    if (uri.front() == '<') uri.remove_prefix(1);
+    if (!uri.empty() && uri.back() == '>') uri.remove_suffix(1);
+    uri = uri.substr(0, uri.find(';'));
+
+    auto at_pos = uri.find('@');
+    if (at_pos != std::string_view::npos) {
+        auto colon = uri.find(':', at_pos);
+        if (colon != std::string_view::npos && uri.substr(colon + 1) == "5060") uri = uri.substr(0, colon);
+    }
+
+    auto scheme_end = uri.find(':');
+    auto at = [&](size_t i) {
+        bool lower = (scheme_end != std::string_view::npos && i <= scheme_end) ||
+                     (at_pos != std::string_view::npos && i > at_pos);
+        return lower ? static_cast<char>(std::tolower(uri[i])) : uri[i];
+    };
+    auto starts_with = [&](std::string_view prefix) {
+        if (uri.size() < prefix.size()) return false;
+        for (size_t i = 0; i < prefix.size(); ++i) if (at(i) != prefix[i]) return false;
+        return true;
+    };
+    if (!starts_with("sip:") && !starts_with("sips:")) for (char c : std::string_view("sip:")) put(c);
+    for (size_t i = 0; i < uri.size(); ++i) put(at(i));
+    return h;
+}
+
+static uint64_t hash_normalized(std::string_view normalized) {
+    uint64_t h = kFnvOffset;
+    for (char c : normalized) { h ^= static_cast<unsigned char>(c); h *= kFnvPrime; }
+    return h;
+}
+
+bool BlfSubscriptionIndex::may_be_watched(std::string_view uri) const {
+    if (uri.empty()) return false;
+    const CountingBloomFilter* f = prefilter_.load(std::memory_order_acquire);
+    return !f || f->may_contain(normalized_uri_hash(uri));
+}
+
+void BlfSubscriptionIndex::configure_prefilter(size_t counters) {
+    std::unique_lock<std::shared_mutex> lk(mu_);
+    const CountingBloomFilter* current = prefilter_.load(std::memory_order_relaxed);
+    if (current && counters > 0 && CountingBloomFilter::rounded_size(counters) == current->counters()) return;
+    if (counters == 0) {
+        prefilter_.store(nullptr, std::memory_order_release);
+        return;
+    }
+    auto f = std::make_unique<CountingBloomFilter>(counters);
+    for (const auto& entry : uri_tenants_) f->add(hash_normalized(entry.first.view()));
+    prefilter_.store(f.get(), std::memory_order_release);
+    prefilters_.push_back(std::move(f));
+}
+
+// Removes dialog_id from its partition, dropping the partition and the
+// URI -> tenant link once empty. Caller erases dialog_to_key_.
+void BlfSubscriptionIndex::unlink_locked(const std::string& dialog_id, const PartitionKey& key) {
+    auto pit = partitions_.find(key);
+    if (pit == partitions_.end()) return;
+
+    auto& watchers = pit->second;
+    auto wit = std::find(watchers.begin(), watchers.end(), dialog_id);
+    if (wit == watchers.end()) return;
+    *wit = std::move(watchers.back());
+    watchers.pop_back();
+    if (--tenant_watchers_[key.tenant] == 0) tenant_watchers_.erase(key.tenant);
+    total_watchers_--;
+    if (!watchers.empty()) return;
+
+    partitions_.erase(pit);
+    auto uit = uri_tenants_.find(key.uri);
+    if (uit != uri_tenants_.end()) {
+        auto& tenants = uit->second;
+        tenants.erase(std::remove(tenants.begin(), tenants.end(), key.tenant), tenants.end());
+        if (tenants.empty()) {
+            if (auto* f = prefilter_.load(std::memory_order_relaxed)) f->remove(hash_normalized(key.uri.view()));
+            uri_tenants_.erase(uit);
+            uri_set_version_.fetch_add(1, std::memory_order_release);
+        }
+    }
+}
+
+void BlfSubscriptionIndex::add(Symbol monitored_uri,
                                 const std::string& dialog_id,
-                                const std::string& tenant_id) {
+                                TenantId tenant_id) {
     if (monitored_uri.empty() || dialog_id.empty()) {
         LOG_WARN("BlfIndex::add: empty uri or dialog_id");
         return;
     }
 
-    std::string norm_uri = normalize_uri(monitored_uri);
+    PartitionKey key{tenant_id, Symbol(normalize_uri(monitored_uri.str()))};
 
     std::unique_lock<std::shared_mutex> lk(mu_);
 
     // Check for duplicate
-    auto it = dialog_to_uri_.find(dialog_id);
-    if (it != dialog_to_uri_.end()) {
-        // Already indexed — remove old mapping if URI changed
-        if (it->second != norm_uri) {
-            auto& old_watchers = uri_to_watchers_[it->second];
-            old_watchers.erase(
-                std::remove_if(old_watchers.begin(), old_watchers.end(),
-                    [&](const WatcherEntry& w) { return w.dialog_id == dialog_id; }),
-                old_watchers.end());
-            if (old_watchers.empty()) uri_to_watchers_.erase(it->second);
-        } else {
-            return; // Already indexed with same URI
-        }
+    auto it = dialog_to_key_.find(dialog_id);
+    if (it != dialog_to_key_.end()) {
+        if (it->second == key) return;  // Already indexed with same URI and tenant
+        // Already indexed — remove old mapping if URI or tenant changed
+        unlink_locked(dialog_id, it->second);
+        dialog_to_key_.erase(it);
     }
 
-    uri_to_watchers_[norm_uri].push_back({dialog_id, tenant_id});
-    dialog_to_uri_[dialog_id] = norm_uri;
+    std::function<void()> notify;
+    auto& watchers = partitions_[key];
+    if (watchers.empty()) {
+        auto& tenants = uri_tenants_[key.uri];
+        if (tenants.empty()) {
+            if (auto* f = prefilter_.load(std::memory_order_relaxed)) f->add(hash_normalized(key.uri.view()));
+            uri_set_version_.fetch_add(1, std::memory_order_release);
+            notify = uri_added_listener_;
+        }
+        tenants.push_back(key.tenant);
+    }
+    watchers.push_back(dialog_id);
+    tenant_watchers_[key.tenant]++;
+    total_watchers_++;
+    dialog_to_key_.emplace(dialog_id, key);
+
+    LOG_DEBUG("BlfIndex: added watcher dialog=%s for uri=%s tenant=%s (watchers in tenant: %zu)",
+              dialog_id.c_str(), key.uri.c_str(), tenant_id.c_str(), watchers.size());
+    lk.unlock();
+    if (notify) notify();
+}
 
-    LOG_DEBUG("BlfIndex: added watcher dialog=%s for uri=%s (total watchers for uri: %zu)",
-              dialog_id.c_str(), norm_uri.c_str(), uri_to_watchers_[norm_uri].size());
+void BlfSubscriptionIndex::set_uri_added_listener(std::function<void()> listener) {
+    std::unique_lock<std::shared_mutex> lk(mu_);
+    uri_added_listener_ = std::move(listener);
 }
 
-void BlfSubscriptionIndex::remove(const std::string& monitored_uri,
+void BlfSubscriptionIndex::remove(Symbol monitored_uri,
                                    const std::string& dialog_id) {
-    std::string norm_uri = normalize_uri(monitored_uri);
+    std::string norm_uri = normalize_uri(monitored_uri.str());
 
     std::unique_lock<std::shared_mutex> lk(mu_);
 
-    auto it = uri_to_watchers_.find(norm_uri);
-    if (it != uri_to_watchers_.end()) {
-        auto& watchers = it->second;
-        watchers.erase(
-            std::remove_if(watchers.begin(), watchers.end(),
-                [&](const WatcherEntry& w) { return w.dialog_id == dialog_id; }),
-            watchers.end());
-        if (watchers.empty()) uri_to_watchers_.erase(it);
+    // The dialog's own key names its tenant; only act if the URI matches
+    auto it = dialog_to_key_.find(dialog_id);
+    if (it != dialog_to_key_.end() && it->second.uri == norm_uri) {
+        unlink_locked(dialog_id, it->second);
+        dialog_to_key_.erase(it);
     }
 
-    dialog_to_uri_.erase(dialog_id);
-
     LOG_DEBUG("BlfIndex: removed watcher dialog=%s for uri=%s", dialog_id.c_str(), norm_uri.c_str());
 }
 
 void BlfSubscriptionIndex::remove_dialog(const std::string& dialog_id) {
     std::unique_lock<std::shared_mutex> lk(mu_);
 
-    auto it = dialog_to_uri_.find(dialog_id);
-    if (it == dialog_to_uri_.end()) return;
-
-    std::string norm_uri = it->second;
-    dialog_to_uri_.erase(it);
+    auto it = dialog_to_key_.find(dialog_id);
+    if (it == dialog_to_key_.end()) return;
 
-    auto wit = uri_to_watchers_.find(norm_uri);
-    if (wit != uri_to_watchers_.end()) {
-        auto& watchers = wit->second;
-        watchers.erase(
-            std::remove_if(watchers.begin(), watchers.end(),
-                [&](const WatcherEntry& w) { return w.dialog_id == dialog_id; }),
-            watchers.end());
-        if (watchers.empty()) uri_to_watchers_.erase(wit);
-    }
+    unlink_locked(dialog_id, it->second);
+    dialog_to_key_.erase(it);
 }
 
 std::vector<BlfSubscriptionIndex::BlfWatcher>
 BlfSubscriptionIndex::lookup(const std::string& monitored_uri) const {
-    std::string norm_uri = normalize_uri(monitored_uri);
+    // A URI nobody watches was never interned; don't intern feed input
+    Symbol uri;
+    if (!Symbol::find(normalize_uri(monitored_uri), uri)) return {};
 
     std::shared_lock<std::shared_mutex> lk(mu_);
 
-    auto it = uri_to_watchers_.find(norm_uri);
-    if (it == uri_to_watchers_.end()) return {};
+    auto uit = uri_tenants_.find(uri);
+    if (uit == uri_tenants_.end()) return {};
 
     std::vector<BlfWatcher> result;
-    result.reserve(it->second.size());
-    for (const auto& w : it->second) {
-        result.push_back({w.dialog_id, w.tenant_id});
+    for (TenantId tenant : uit->second) {
+        auto pit = partitions_.find(PartitionKey{tenant, uri});
+        if (pit == partitions_.end()) continue;
+        for (const auto& did : pit->second) result.push_back({did, tenant});
     }
     return result;
 }
 
 std::vector<BlfSubscriptionIndex::BlfWatcher>
-BlfSubscriptionIndex::lookup(const std::string& monitored_uri,
-                              const std::string& tenant_id) const {
-    std::string norm_uri = normalize_uri(monitored_uri);
+BlfSubscriptionIndex::lookup(const std::string& monitored_uri, TenantId tenant_id) const {
+    Symbol uri;
+    if (!Symbol::find(normalize_uri(monitored_uri), uri)) return {};
 
     std::shared_lock<std::shared_mutex> lk(mu_);
 
-    auto it = uri_to_watchers_.find(norm_uri);
-    if (it == uri_to_watchers_.end()) return {};
+    auto pit = partitions_.find(PartitionKey{tenant_id, uri});
+    if (pit == partitions_.end()) return {};
 
     std::vector<BlfWatcher> result;
-    for (const auto& w : it->second) {
-        if (w.tenant_id == tenant_id) {
-            result.push_back({w.dialog_id, w.tenant_id});
-        }
-    }
+    result.reserve(pit->second.size());
+    for (const auto& did : pit->second) result.push_back({did, tenant_id});
     return result;
 }
 
+std::vector<BlfSubscriptionIndex::BlfWatcher>
+BlfSubscriptionIndex::lookup(const std::string& monitored_uri, std::string_view tenant_id) const {
+    // Likewise a tenant with no watchers may never have been interned
+    TenantId tenant;
+    if (!Symbol::find(tenant_id, tenant)) return {};
+    return lookup(monitored_uri, tenant);
+}
+
 size_t BlfSubscriptionIndex::monitored_uri_count() const {
     std::shared_lock<std::shared_mutex> lk(mu_);
-    return uri_to_watchers_.size();
+    return uri_tenants_.size();
+}
+
+std::vector<std::string> BlfSubscriptionIndex::monitored_uris() const {
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    std::vector<std::string> uris;
+    uris.reserve(uri_tenants_.size());
+    for (const auto& entry : uri_tenants_) uris.push_back(entry.first.str());
+    return uris;
 }
 
 size_t BlfSubscriptionIndex::total_watcher_count() const {
     std::shared_lock<std::shared_mutex> lk(mu_);
-    size_t total = 0;
-    for (const auto& [uri, watchers] : uri_to_watchers_) total += watchers.size();
-    return total;
+    return total_watchers_;
+}
+
+std::vector<std::pair<TenantId, size_t>> BlfSubscriptionIndex::tenant_watcher_counts() const {
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    return {tenant_watchers_.begin(), tenant_watchers_.end()};
 }
 
 } // namespace sip_processor
@@ -0,0 +1,106 @@
+
+// =============================================================================
+// FILE: src/subscription/expires_policy.cpp
+// =============================================================================
+#include "subscription/expires_policy.h"
+#include "common/logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+
+namespace sip_processor {
+
+// Keeps min <= default <= max whatever the configuration says
+static ExpiresLimits normalized(ExpiresLimits l) {
+    if (l.max_sec > 0 && l.min_sec > l.max_sec) l.min_sec = l.max_sec;
+    if (l.default_sec < l.min_sec) l.default_sec = l.min_sec;
+    if (l.max_sec > 0 && l.default_sec > l.max_sec) l.default_sec = l.max_sec;
+    return l;
+}
+
+static bool parse_u32(const std::string& s, uint32_t& out) {
+    if (s.empty()) return false;
+    char* end = nullptr;
+    unsigned long v = std::strtoul(s.c_str(), &end, 10);
+    if (*end != '\0' || v > UINT32_MAX) return false;
+    out = static_cast<uint32_t>(v);
+    return true;
+}
+
+ExpiresPolicy::ExpiresPolicy(const Config& config) {
+    type_limits_[slot(SubscriptionType::kBLF)] = normalized(
+        {config.expires_blf_min_sec, config.expires_blf_max_sec, config.expires_blf_default_sec});
+    type_limits_[slot(SubscriptionType::kMWI)] = normalized(
+        {config.expires_mwi_min_sec, config.expires_mwi_max_sec, config.expires_mwi_default_sec});
+    if (!parse_overrides(config.expires_tenant_overrides, tenant_limits_, type_limits_)) {
+        LOG_WARN("Expires: malformed expires.tenant_overrides '%s', using what parsed",
+                 config.expires_tenant_overrides.c_str());
+    }
+}
+
+bool ExpiresPolicy::parse_overrides(const std::string& spec,
+                                    std::unordered_map<TenantId, std::array<ExpiresLimits, 2>>& out,
+                                    const std::array<ExpiresLimits, 2>& defaults) {
+    bool ok = true;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        item.erase(std::remove_if(item.begin(), item.end(), ::isspace), item.end());
+        if (item.empty()) continue;
+
+        // Tenants are domains and never contain ':', so split from the right
+        std::string fields[4];
+        size_t end = item.size();
+        bool parsed = true;
+        for (int i = 3; i > 0; --i) {
+            size_t colon = end > 0 ? item.rfind(':', end - 1) : std::string::npos;
+            if (colon == std::string::npos) { parsed = false; break; }
+            fields[i] = item.substr(colon + 1, end - colon - 1);
+            end = colon;
+        }
+        if (parsed) fields[0] = item.substr(0, end);
+
+        SubscriptionType type = subscription_type_from_string(fields[1]);
+        ExpiresLimits l;
+        if (!parsed || fields[0].empty() || type == SubscriptionType::kUnknown ||
+            !parse_u32(fields[2], l.min_sec) || !parse_u32(fields[3], l.max_sec)) {
+            ok = false;
+            continue;
+        }
+
+        TenantId tenant(fields[0]);
+        auto it = out.find(tenant);
+        if (it == out.end()) it = out.emplace(tenant, defaults).first;
+        l.default_sec = defaults[slot(type)].default_sec;
+        it->second[slot(type)] = normalized(l);
+    }
+    return ok;
+}
+
+const ExpiresLimits& ExpiresPolicy::limits(TenantId tenant, SubscriptionType type) const {
+    if (!tenant_limits_.empty()) {
+        auto it = tenant_limits_.find(tenant);
+        if (it != tenant_limits_.end()) return it->second[slot(type)];
+    }
+    return type_limits_[slot(type)];
+}
+
+ExpiresPolicy::Decision ExpiresPolicy::negotiate(TenantId tenant, SubscriptionType type,
+                                                 bool has_expires, uint32_t requested) const {
+    const ExpiresLimits& l = limits(tenant, type);
+    Decision d;
+    if (!has_expires) {
+        d.granted = l.default_sec;
+    } else if (requested < l.min_sec) {
+        // Too short to be worth the refresh traffic; the phone retries with
+        // at least Min-Expires
+        d.too_brief = true;
+        d.min_expires = l.min_sec;
+    } else {
+        d.granted = l.max_sec > 0 ? std::min(requested, l.max_sec) : requested;
+    }
+    return d;
+}
+
+} // namespace sip_processor
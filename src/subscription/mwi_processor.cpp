@@ -4,9 +4,9 @@
 // =============================================================================
 #include "subscription/mwi_processor.h"
 #include "common/logger.h"
-#include <sstream>
 #include <algorithm>
-#include <cctype>
+#include <climits>
+#include <cstdint>
 
 namespace sip_processor {
 
@@ -73,68 +73,182 @@ Result MwiProcessor::handle_publish(const SipEvent& event, SubscriptionRecord& r
     return Result::kOk;
 }
 
-MwiProcessor::MessageSummary MwiProcessor::parse_message_summary(const std::string& body) {
+// -----------------------------------------------------------------------------
+// Message-summary parsing (RFC 3842). Everything works on views into the
+// body: no line copies, no lowercasing, no sscanf.
+// -----------------------------------------------------------------------------
+
+namespace {
+
+enum class SummaryHeader : uint8_t { kMessagesWaiting, kMessageAccount, kCounts };
+
+struct HeaderName {
+    std::string_view name;   // Lowercase, without the colon
+    SummaryHeader kind;
+    MwiProcessor::MessageClass cls;
+};
+
+constexpr HeaderName kHeaders[] = {
+    {"messages-waiting",   SummaryHeader::kMessagesWaiting, MwiProcessor::kVoice},
+    {"message-account",    SummaryHeader::kMessageAccount,  MwiProcessor::kVoice},
+    {"voice-message",      SummaryHeader::kCounts,          MwiProcessor::kVoice},
+    {"fax-message",        SummaryHeader::kCounts,          MwiProcessor::kFax},
+    {"pager-message",      SummaryHeader::kCounts,          MwiProcessor::kPager},
+    {"multimedia-message", SummaryHeader::kCounts,          MwiProcessor::kMultimedia},
+    {"text-message",       SummaryHeader::kCounts,          MwiProcessor::kText},
+};
+
+inline char ascii_lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+inline bool is_ws(char c) { return c == ' ' || c == '\t'; }
+
+// `lower` must already be lowercase
+bool iequals_lower(std::string_view s, std::string_view lower) {
+    if (s.size() != lower.size()) return false;
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (ascii_lower(s[i]) != lower[i]) return false;
+    }
+    return true;
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && is_ws(s.front())) s.remove_prefix(1);
+    while (!s.empty() && is_ws(s.back())) s.remove_suffix(1);
+    return s;
+}
+
+void skip_ws(std::string_view& s) {
+    while (!s.empty() && is_ws(s.front())) s.remove_prefix(1);
+}
+
+bool consume(std::string_view& s, char c) {
+    skip_ws(s);
+    if (s.empty() || s.front() != c) return false;
+    s.remove_prefix(1);
+    return true;
+}
+
+// 1*DIGIT, saturating at INT_MAX
+bool parse_count(std::string_view& s, int& out) {
+    skip_ws(s);
+    if (s.empty() || s.front() < '0' || s.front() > '9') return false;
+    int64_t v = 0;
+    while (!s.empty() && s.front() >= '0' && s.front() <= '9') {
+        v = std::min<int64_t>(v * 10 + (s.front() - '0'), INT_MAX);
+        s.remove_prefix(1);
+    }
+    out = static_cast<int>(v);
+    return true;
+}
+
+// new/old [ "(" new-urgent/old-urgent ")" ]
+bool parse_counts(std::string_view s, MwiProcessor::MessageCounts& out) {
+    MwiProcessor::MessageCounts c;
+    if (!parse_count(s, c.new_messages) || !consume(s, '/') || !parse_count(s, c.old_messages)) {
+        return false;
+    }
+    // The urgent group is optional; a malformed one is ignored
+    bool urgent = consume(s, '(') && parse_count(s, c.new_urgent) && consume(s, '/') &&
+                  parse_count(s, c.old_urgent) && consume(s, ')');
+    if (!urgent) c.new_urgent = c.old_urgent = 0;
+    out = c;
+    return true;
+}
+
+// Host part of a SIP URI as written: after '@' (or the scheme), up to any
+// port, parameter or closing bracket
+std::string_view uri_host(std::string_view uri) {
+    auto at = uri.find('@');
+    if (at != std::string_view::npos) {
+        uri.remove_prefix(at + 1);
+    } else {
+        auto colon = uri.find(':');
+        if (colon != std::string_view::npos) uri.remove_prefix(colon + 1);
+    }
+    return uri.substr(0, uri.find_first_of(":;>"));
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (ascii_lower(a[i]) != ascii_lower(b[i])) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+MwiProcessor::MessageSummary MwiProcessor::parse_message_summary(std::string_view body) {
     MessageSummary summary;
-    std::istringstream stream(body);
-    std::string line;
-
-    while (std::getline(stream, line)) {
-        if (!line.empty() && line.back() == '\r') line.pop_back();
-        auto start = line.find_first_not_of(" \t");
-        if (start == std::string::npos) continue;
-        line = line.substr(start);
-
-        std::string lower = line;
-        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-
-        if (lower.find("messages-waiting:") == 0) {
-            auto vs = line.find(':');
-            if (vs != std::string::npos) {
-                std::string val = line.substr(vs + 1);
-                val.erase(0, val.find_first_not_of(" \t"));
-                val.erase(val.find_last_not_of(" \t") + 1);
-                std::transform(val.begin(), val.end(), val.begin(), ::tolower);
-                summary.messages_waiting = (val == "yes");
-                summary.valid = true;
-            }
-        } else if (lower.find("message-account:") == 0) {
-            auto vs = line.find(':');
-            if (vs != std::string::npos) {
-                summary.account = line.substr(vs + 1);
-                auto& a = summary.account;
-                a.erase(0, a.find_first_not_of(" \t"));
-                a.erase(a.find_last_not_of(" \t") + 1);
-            }
-        } else if (lower.find("voice-message:") == 0) {
-            auto vs = line.find(':');
-            if (vs != std::string::npos) {
-                std::string val = line.substr(vs + 1);
-                int n = 0, o = 0, nu = 0, ou = 0;
-                if (sscanf(val.c_str(), " %d/%d (%d/%d)", &n, &o, &nu, &ou) >= 2 ||
-                    sscanf(val.c_str(), " %d/%d", &n, &o) >= 2) {
-                    summary.new_messages = n;
-                    summary.old_messages = o;
-                    summary.new_urgent = nu;
-                    summary.old_urgent = ou;
+
+    while (!body.empty()) {
+        size_t eol = body.find('\n');
+        std::string_view line = body.substr(0, eol);
+        body.remove_prefix(eol == std::string_view::npos ? body.size() : eol + 1);
+
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) continue;
+        std::string_view name = trim(line.substr(0, colon));
+        std::string_view value = line.substr(colon + 1);
+        if (!value.empty() && value.back() == '\r') value.remove_suffix(1);
+
+        for (const auto& h : kHeaders) {
+            if (!iequals_lower(name, h.name)) continue;
+            switch (h.kind) {
+                case SummaryHeader::kMessagesWaiting:
+                    summary.messages_waiting = iequals_lower(trim(value), "yes");
                     summary.valid = true;
-                }
+                    break;
+                case SummaryHeader::kMessageAccount:
+                    summary.account = trim(value);
+                    break;
+                case SummaryHeader::kCounts:
+                    if (parse_counts(value, summary.counts[h.cls])) {
+                        summary.classes |= static_cast<uint8_t>(1u << h.cls);
+                        summary.valid = true;
+                    }
+                    break;
             }
+            break;
         }
     }
     return summary;
 }
 
+bool MwiProcessor::apply_feed_update(std::string_view body, SubscriptionRecord& record) {
+    MessageSummary summary = parse_message_summary(body);
+    if (!summary.valid) return false;
+    const MessageCounts& voice = summary.voice();
+    if (voice.new_messages == record.mwi_new_messages &&
+        voice.old_messages == record.mwi_old_messages) return false;
+    summary.account = {};   // Fan-out keeps each dialog's own account
+    update_mwi_state(record, summary);
+    return true;
+}
+
 void MwiProcessor::update_mwi_state(SubscriptionRecord& record,
                                      const MessageSummary& summary) {
+    const MessageCounts& voice = summary.voice();
     int pn = record.mwi_new_messages, po = record.mwi_old_messages;
-    record.mwi_new_messages = summary.new_messages;
-    record.mwi_old_messages = summary.old_messages;
-    if (!summary.account.empty()) record.mwi_account_uri = summary.account;
+    record.mwi_new_messages = voice.new_messages;
+    record.mwi_old_messages = voice.old_messages;
+    // The Message-Account comes from a peer's body and is interned once
+    // the dialog is indexed under it: adopt it only within the dialog's own
+    // tenant or domain, which bounds what a peer can make the index hold
+    if (!summary.account.empty() && summary.account != record.mwi_account_uri) {
+        std::string_view host = uri_host(summary.account);
+        if (!host.empty() && (iequals(host, record.tenant_id.view()) ||
+                              iequals(host, uri_host(record.mwi_account_uri)))) {
+            record.mwi_account_uri.assign(summary.account.data(), summary.account.size());
+        }
+    }
 
-    if (pn != summary.new_messages || po != summary.old_messages) {
+    if (pn != voice.new_messages || po != voice.old_messages) {
         LOG_INFO("MWI: change dialog=%s account=%s: new=%d->%d old=%d->%d",
                  record.dialog_id.c_str(), record.mwi_account_uri.c_str(),
-                 pn, summary.new_messages, po, summary.old_messages);
+                 pn, voice.new_messages, po, voice.old_messages);
     }
 }
 
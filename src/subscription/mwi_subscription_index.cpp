@@ -0,0 +1,117 @@
+
+// =============================================================================
+// FILE: src/subscription/mwi_subscription_index.cpp
+// =============================================================================
+#include "subscription/mwi_subscription_index.h"
+#include "subscription/blf_subscription_index.h"
+#include "common/logger.h"
+#include <algorithm>
+
+namespace sip_processor {
+
+MwiSubscriptionIndex& MwiSubscriptionIndex::instance() {
+    static MwiSubscriptionIndex index;
+    return index;
+}
+
+// Removes dialog_id from the account's watchers, dropping the account once
+// empty. Caller erases dialog_to_account_.
+void MwiSubscriptionIndex::unlink_locked(const std::string& dialog_id, Symbol account) {
+    auto ait = accounts_.find(account);
+    if (ait == accounts_.end()) return;
+
+    auto& watchers = ait->second;
+    auto wit = std::find_if(watchers.begin(), watchers.end(),
+                            [&](const MwiWatcher& w) { return w.dialog_id == dialog_id; });
+    if (wit == watchers.end()) return;
+    *wit = std::move(watchers.back());
+    watchers.pop_back();
+    total_watchers_--;
+    if (watchers.empty()) accounts_.erase(ait);
+}
+
+void MwiSubscriptionIndex::add(const std::string& account_uri,
+                                const std::string& dialog_id,
+                                TenantId tenant_id) {
+    if (account_uri.empty() || dialog_id.empty()) {
+        LOG_WARN("MwiIndex::add: empty account or dialog_id");
+        return;
+    }
+
+    Symbol account(BlfSubscriptionIndex::normalize_uri(account_uri));
+
+    std::unique_lock<std::shared_mutex> lk(mu_);
+
+    auto it = dialog_to_account_.find(dialog_id);
+    if (it != dialog_to_account_.end()) {
+        if (it->second == account) return;  // Already indexed under this account
+        unlink_locked(dialog_id, it->second);
+        dialog_to_account_.erase(it);
+    }
+
+    auto& watchers = accounts_[account];
+    watchers.push_back({dialog_id, tenant_id});
+    total_watchers_++;
+    dialog_to_account_.emplace(dialog_id, account);
+
+    LOG_DEBUG("MwiIndex: added watcher dialog=%s for account=%s (watchers: %zu)",
+              dialog_id.c_str(), account.c_str(), watchers.size());
+}
+
+void MwiSubscriptionIndex::remove_dialog(const std::string& dialog_id) {
+    std::unique_lock<std::shared_mutex> lk(mu_);
+
+    auto it = dialog_to_account_.find(dialog_id);
+    if (it == dialog_to_account_.end()) return;
+
+    unlink_locked(dialog_id, it->second);
+    dialog_to_account_.erase(it);
+}
+
+std::vector<MwiSubscriptionIndex::MwiWatcher>
+MwiSubscriptionIndex::lookup(const std::string& account_uri) const {
+    // A mailbox nobody watches was never interned; don't intern feed input
+    Symbol account;
+    if (!Symbol::find(BlfSubscriptionIndex::normalize_uri(account_uri), account)) return {};
+
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    auto ait = accounts_.find(account);
+    if (ait == accounts_.end()) return {};
+    return ait->second;
+}
+
+std::vector<MwiSubscriptionIndex::MwiWatcher>
+MwiSubscriptionIndex::lookup(const std::string& account_uri, TenantId tenant_id) const {
+    Symbol account;
+    if (!Symbol::find(BlfSubscriptionIndex::normalize_uri(account_uri), account)) return {};
+
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    auto ait = accounts_.find(account);
+    if (ait == accounts_.end()) return {};
+
+    std::vector<MwiWatcher> result;
+    for (const auto& w : ait->second) {
+        if (w.tenant_id == tenant_id) result.push_back(w);
+    }
+    return result;
+}
+
+std::vector<MwiSubscriptionIndex::MwiWatcher>
+MwiSubscriptionIndex::lookup(const std::string& account_uri, std::string_view tenant_id) const {
+    // A tenant never interned has no MWI dialogs
+    TenantId tenant;
+    if (!Symbol::find(tenant_id, tenant)) return {};
+    return lookup(account_uri, tenant);
+}
+
+size_t MwiSubscriptionIndex::account_count() const {
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    return accounts_.size();
+}
+
+size_t MwiSubscriptionIndex::total_watcher_count() const {
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    return total_watchers_;
+}
+
+} // namespace sip_processor
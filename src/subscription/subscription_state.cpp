@@ -4,6 +4,9 @@
 // =============================================================================
 #include "subscription/subscription_state.h"
 #include "common/logger.h"
+#include "common/metrics_registry.h"
+#include <algorithm>
+#include <iterator>
 
 namespace sip_processor {
 
@@ -12,70 +15,186 @@ SubscriptionRegistry& SubscriptionRegistry::instance() {
     return registry;
 }
 
+SubscriptionRegistry::SubscriptionRegistry() {
+    auto& m = MetricsRegistry::instance();
+    for (auto type : {SubscriptionType::kBLF, SubscriptionType::kMWI, SubscriptionType::kUnknown}) {
+        std::string labels;
+        MetricsWriter::add_label(labels, "type", subscription_type_to_string(type));
+        m.add_gauge(this, "sip_processor_subscriptions", "Live subscriptions",
+                    type_counts_[static_cast<size_t>(type)], std::move(labels));
+    }
+    // Tenants appear at runtime, so they are walked per scrape; a counter
+    // is never erased, so a tenant keeps its series once seen
+    m.add_collector(this, "sip_processor_tenant_subscriptions", MetricType::kGauge,
+        "Live subscriptions per tenant",
+        [this, labels = std::string()](MetricsWriter& w, const char* name) mutable {
+            for (const auto& ts : tenant_shards_) {
+                std::shared_lock<std::shared_mutex> lk(ts.mu);
+                for (const auto& [tenant, count] : ts.counts) {
+                    labels.clear();
+                    MetricsWriter::add_label(labels, "tenant", tenant.view());
+                    w.sample(name, "", labels, count->load(std::memory_order_relaxed));
+                }
+            }
+        });
+}
+
+SubscriptionRegistry::Shard& SubscriptionRegistry::shard_for(const std::string& dialog_id) {
+    return shards_[std::hash<std::string>{}(dialog_id) % kNumShards];
+}
+
+const SubscriptionRegistry::Shard& SubscriptionRegistry::shard_for(const std::string& dialog_id) const {
+    return shards_[std::hash<std::string>{}(dialog_id) % kNumShards];
+}
+
+SubscriptionRegistry::Counter& SubscriptionRegistry::tenant_counter(const TenantId& tenant) {
+    auto& ts = tenant_shards_[std::hash<TenantId>{}(tenant) % kNumTenantShards];
+    {
+        std::shared_lock<std::shared_mutex> lk(ts.mu);
+        auto it = ts.counts.find(tenant);
+        if (it != ts.counts.end()) return *it->second;
+    }
+    std::unique_lock<std::shared_mutex> lk(ts.mu);
+    auto& slot = ts.counts[tenant];
+    if (!slot) slot = std::make_unique<Counter>(0);
+    return *slot;
+}
+
+const SubscriptionRegistry::Counter*
+SubscriptionRegistry::find_tenant_counter(const TenantId& tenant) const {
+    const auto& ts = tenant_shards_[std::hash<TenantId>{}(tenant) % kNumTenantShards];
+    std::shared_lock<std::shared_mutex> lk(ts.mu);
+    auto it = ts.counts.find(tenant);
+    return (it != ts.counts.end()) ? it->second.get() : nullptr;
+}
+
+void SubscriptionRegistry::count_added(const SubscriptionInfo& info) {
+    total_.fetch_add(1, std::memory_order_relaxed);
+    type_counts_[static_cast<size_t>(info.type)].fetch_add(1, std::memory_order_relaxed);
+    tenant_counter(info.tenant_id).fetch_add(1, std::memory_order_relaxed);
+}
+
+void SubscriptionRegistry::count_removed(const SubscriptionInfo& info) {
+    total_.fetch_sub(1, std::memory_order_relaxed);
+    type_counts_[static_cast<size_t>(info.type)].fetch_sub(1, std::memory_order_relaxed);
+    tenant_counter(info.tenant_id).fetch_sub(1, std::memory_order_relaxed);
+}
+
 void SubscriptionRegistry::register_subscription(const std::string& dialog_id,
                                                    const SubscriptionInfo& info) {
-    std::lock_guard<std::mutex> lk(mu_);
-    auto [it, inserted] = subscriptions_.emplace(dialog_id, info);
-    if (inserted) tenant_counts_[info.tenant_id]++;
-    else it->second = info;
+    auto& sh = shard_for(dialog_id);
+    std::lock_guard<std::mutex> lk(sh.mu);
+    auto [it, inserted] = sh.subscriptions.emplace(dialog_id, info);
+    if (inserted) {
+        sh.ordered.emplace(it->first, &it->second);
+        count_added(info);
+    } else {
+        if (it->second.tenant_id != info.tenant_id || it->second.type != info.type) {
+            count_removed(it->second);
+            count_added(info);
+        }
+        it->second = info;
+    }
 }
 
 void SubscriptionRegistry::unregister_subscription(const std::string& dialog_id) {
-    std::lock_guard<std::mutex> lk(mu_);
-    auto it = subscriptions_.find(dialog_id);
-    if (it != subscriptions_.end()) {
-        auto tc = tenant_counts_.find(it->second.tenant_id);
-        if (tc != tenant_counts_.end()) {
-            if (tc->second > 0) tc->second--;
-            if (tc->second == 0) tenant_counts_.erase(tc);
-        }
-        subscriptions_.erase(it);
+    auto& sh = shard_for(dialog_id);
+    std::lock_guard<std::mutex> lk(sh.mu);
+    auto it = sh.subscriptions.find(dialog_id);
+    if (it != sh.subscriptions.end()) {
+        count_removed(it->second);
+        sh.ordered.erase(it->first);
+        sh.subscriptions.erase(it);
     }
 }
 
 bool SubscriptionRegistry::lookup(const std::string& dialog_id,
                                    SubscriptionInfo& out) const {
-    std::lock_guard<std::mutex> lk(mu_);
-    auto it = subscriptions_.find(dialog_id);
-    if (it != subscriptions_.end()) { out = it->second; return true; }
+    auto& sh = shard_for(dialog_id);
+    std::lock_guard<std::mutex> lk(sh.mu);
+    auto it = sh.subscriptions.find(dialog_id);
+    if (it != sh.subscriptions.end()) { out = it->second; return true; }
     return false;
 }
 
+void SubscriptionRegistry::for_each(const std::function<bool(const SubscriptionInfo&)>& fn) const {
+    std::vector<SubscriptionInfo> copy;
+    for (const auto& sh : shards_) {
+        copy.clear();
+        {
+            std::lock_guard<std::mutex> lk(sh.mu);
+            copy.reserve(sh.subscriptions.size());
+            for (const auto& [id, info] : sh.subscriptions) copy.push_back(info);
+        }
+        for (const auto& info : copy) {
+            if (!fn(info)) return;
+        }
+    }
+}
+
+void SubscriptionRegistry::scan(Cursor& cursor, size_t limit, const Filter& filter,
+                                std::vector<SubscriptionInfo>& out) const {
+    while (limit > 0 && !cursor.done()) {
+        const auto& sh = shards_[cursor.shard];
+        std::lock_guard<std::mutex> lk(sh.mu);
+        auto it = cursor.after.empty() ? sh.ordered.begin()
+                                       : sh.ordered.upper_bound(std::string_view(cursor.after));
+        for (size_t examined = 0; it != sh.ordered.end() && limit > 0 && examined < kScanStep;
+             ++it, ++examined) {
+            if (filter && !filter(*it->second)) continue;
+            out.push_back(*it->second);
+            --limit;
+        }
+        if (it == sh.ordered.end()) {
+            cursor.shard++;
+            cursor.after.clear();
+        } else {
+            // Resume after the last entry examined, matched or not
+            cursor.after.assign(std::prev(it)->first);
+        }
+    }
+}
+
 std::vector<SubscriptionRegistry::SubscriptionInfo>
 SubscriptionRegistry::get_tenant_subscriptions(const TenantId& tenant) const {
     std::vector<SubscriptionInfo> result;
-    std::lock_guard<std::mutex> lk(mu_);
-    for (const auto& [id, info] : subscriptions_)
+    for_each([&](const SubscriptionInfo& info) {
         if (info.tenant_id == tenant) result.push_back(info);
+        return true;
+    });
     return result;
 }
 
 std::vector<SubscriptionRegistry::SubscriptionInfo>
 SubscriptionRegistry::get_all() const {
     std::vector<SubscriptionInfo> result;
-    std::lock_guard<std::mutex> lk(mu_);
-    result.reserve(subscriptions_.size());
-    for (const auto& [id, info] : subscriptions_)
+    result.reserve(total_count());
+    for_each([&](const SubscriptionInfo& info) {
         result.push_back(info);
+        return true;
+    });
     return result;
 }
 
 size_t SubscriptionRegistry::total_count() const {
-    std::lock_guard<std::mutex> lk(mu_);
-    return subscriptions_.size();
+    auto n = total_.load(std::memory_order_relaxed);
+    return n > 0 ? static_cast<size_t>(n) : 0;
 }
 
 size_t SubscriptionRegistry::count_by_type(SubscriptionType type) const {
-    std::lock_guard<std::mutex> lk(mu_);
-    size_t c = 0;
-    for (const auto& [id, info] : subscriptions_) if (info.type == type) c++;
-    return c;
+    auto n = type_counts_[static_cast<size_t>(type)].load(std::memory_order_relaxed);
+    return n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+const std::atomic<int64_t>& SubscriptionRegistry::tenant_count_ref(const TenantId& tenant) {
+    return tenant_counter(tenant);
 }
 
 size_t SubscriptionRegistry::count_by_tenant(const TenantId& tenant) const {
-    std::lock_guard<std::mutex> lk(mu_);
-    auto it = tenant_counts_.find(tenant);
-    return (it != tenant_counts_.end()) ? it->second : 0;
+    const Counter* c = find_tenant_counter(tenant);
+    if (!c) return 0;
+    auto n = c->load(std::memory_order_relaxed);
+    return n > 0 ? static_cast<size_t>(n) : 0;
 }
 
 } // namespace sip_processor
@@ -0,0 +1,260 @@
+
+// =============================================================================
+// FILE: tests/perf/bench/bench_harness.cpp
+// =============================================================================
+#include "bench_harness.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace sip_processor {
+namespace bench {
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Workload
+// ─────────────────────────────────────────────────────────────────────────────
+
+uint64_t Rng::next() {
+    uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+ZipfSampler::ZipfSampler(size_t n, double exponent) : cdf_(std::max<size_t>(n, 1)) {
+    double sum = 0;
+    for (size_t i = 0; i < cdf_.size(); ++i) {
+        sum += 1.0 / std::pow(static_cast<double>(i + 1), exponent);
+        cdf_[i] = sum;
+    }
+    for (auto& c : cdf_) c /= sum;
+}
+
+size_t ZipfSampler::sample(Rng& rng) const {
+    auto it = std::lower_bound(cdf_.begin(), cdf_.end(), rng.unit());
+    return std::min(static_cast<size_t>(it - cdf_.begin()), cdf_.size() - 1);
+}
+
+static std::string hex_tag(Rng& rng) {
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(rng.next()));
+    return buf;
+}
+
+Workload::Workload(const WorkloadSpec& spec) : spec_(spec) {
+    spec_.tenants = std::max(1, spec_.tenants);
+    spec_.extensions_per_tenant = std::max(2, spec_.extensions_per_tenant);
+    spec_.concurrent_calls = std::max(1, spec_.concurrent_calls);
+    for (int t = 0; t < spec_.tenants; ++t) tenants_.push_back("tenant-" + std::to_string(t) + ".bench.example");
+
+    // Separate streams, so resizing one part leaves the others unchanged
+    ZipfSampler popularity(static_cast<size_t>(spec_.extensions_per_tenant), spec_.fanout_skew);
+    Rng dialog_rng(spec_.seed);
+    Rng call_rng(spec_.seed ^ 0xC0FFEE0DDF00DULL);
+    generate_dialogs(dialog_rng, popularity);
+    generate_calls(call_rng, popularity);
+}
+
+std::string Workload::extension_uri(size_t tenant, size_t ext) const {
+    return "sip:" + std::to_string(2000 + ext) + "@" + tenants_[tenant];
+}
+
+void Workload::generate_dialogs(Rng& rng, const ZipfSampler& popularity) {
+    std::unordered_map<std::string, size_t> fanout;
+    dialogs_.reserve(static_cast<size_t>(std::max(0, spec_.subscriptions)));
+    for (int i = 0; i < spec_.subscriptions; ++i) {
+        size_t t = rng.uniform(tenants_.size());
+        WatcherDialog d;
+        d.tenant = tenants_[t];
+        d.monitored_uri = extension_uri(t, popularity.sample(rng));
+        d.watcher_uri = extension_uri(t, rng.uniform(static_cast<size_t>(spec_.extensions_per_tenant)));
+        d.call_id = hex_tag(rng) + "@bench";
+        d.from_tag = hex_tag(rng).substr(0, 8);
+        d.dialog_id = d.call_id + ";ft=" + d.from_tag + ";tt=" + std::to_string(i);
+        max_fanout_ = std::max(max_fanout_, ++fanout[d.monitored_uri]);
+        dialogs_.push_back(std::move(d));
+    }
+}
+
+void Workload::generate_calls(Rng& rng, const ZipfSampler& popularity) {
+    static const CallState kAnswered[] = {CallState::kTrying, CallState::kRinging,
+                                          CallState::kConfirmed, CallState::kTerminated};
+    static const CallState kAbandoned[] = {CallState::kTrying, CallState::kRinging, CallState::kTerminated};
+    struct Active {
+        CallEvent call;
+        const CallState* states = nullptr;
+        size_t remaining = 0;
+    };
+
+    int started = 0;
+    auto start_call = [&](Active& a) {
+        size_t t = rng.uniform(tenants_.size());
+        a.call.call_id = "pcall-" + std::to_string(started) + "-" + hex_tag(rng).substr(0, 8);
+        a.call.tenant = tenants_[t];
+        a.call.callee_uri = extension_uri(t, popularity.sample(rng));
+        a.call.caller_uri = rng.chance(spec_.external_caller_pct)
+            ? "sip:+1555" + std::to_string(1000000 + rng.uniform(9000000)) + "@pstn.bench.example"
+            : extension_uri(t, rng.uniform(static_cast<size_t>(spec_.extensions_per_tenant)));
+        a.call.direction = rng.chance(50) ? "inbound" : "outbound";
+        bool abandoned = rng.chance(spec_.abandon_pct);
+        a.states = abandoned ? kAbandoned : kAnswered;
+        a.remaining = abandoned ? 3 : 4;
+        ++started;
+    };
+
+    std::vector<Active> slots(static_cast<size_t>(std::min(spec_.concurrent_calls, std::max(spec_.calls, 1))));
+    size_t live = 0;
+    for (auto& a : slots) {
+        if (started >= spec_.calls) break;
+        start_call(a);
+        ++live;
+    }
+    call_events_.reserve(static_cast<size_t>(std::max(0, spec_.calls)) * 4);
+    while (live > 0) {
+        auto& a = slots[rng.uniform(slots.size())];
+        if (a.remaining == 0) continue;
+        CallEvent ev = a.call;
+        ev.state = *a.states++;
+        call_events_.push_back(std::move(ev));
+        if (--a.remaining == 0) {
+            if (started < spec_.calls) start_call(a);
+            else --live;
+        }
+    }
+}
+
+std::string Workload::to_presence_xml(const CallEvent& ev) {
+    const char* state = "unknown";
+    switch (ev.state) {
+        case CallState::kTrying:     state = "trying"; break;
+        case CallState::kRinging:    state = "ringing"; break;
+        case CallState::kConfirmed:  state = "confirmed"; break;
+        case CallState::kTerminated: state = "terminated"; break;
+        case CallState::kHeld:       state = "held"; break;
+        case CallState::kResumed:    state = "resumed"; break;
+        default: break;
+    }
+    std::string xml;
+    xml.reserve(320);
+    xml += "<CallStateEvent><CallId>"; xml += ev.call_id;
+    xml += "</CallId><CallerUri>"; xml += ev.caller_uri;
+    xml += "</CallerUri><CalleeUri>"; xml += ev.callee_uri;
+    xml += "</CalleeUri><State>"; xml += state;
+    xml += "</State><Direction>"; xml += ev.direction;
+    xml += "</Direction><TenantId>"; xml += ev.tenant;
+    xml += "</TenantId><Timestamp>2026-01-01T00:00:00Z</Timestamp></CallStateEvent>\n";
+    return xml;
+}
+
+std::string Workload::presence_stream() const {
+    std::string out;
+    out.reserve(call_events_.size() * 300);
+    for (const auto& ev : call_events_) out += to_presence_xml(ev);
+    return out;
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Stub statistics
+// ─────────────────────────────────────────────────────────────────────────────
+
+StubSipStats& stub_sip_stats() {
+    static StubSipStats s;
+    return s;
+}
+
+nua_handle_t* fake_handle(uint64_t n) {
+    return reinterpret_cast<nua_handle_t*>(static_cast<uintptr_t>((n + 1) << 4));
+}
+
+StubMongoStats& stub_mongo_stats() {
+    static StubMongoStats s;
+    return s;
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Report
+// ─────────────────────────────────────────────────────────────────────────────
+
+static std::string json_string(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else out += c;
+    }
+    return out + "\"";
+}
+
+static std::string json_number(double v) {
+    if (!std::isfinite(v)) return "null";
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.6g", v);
+    return buf;
+}
+
+Report::Report(std::string name, int& argc, char** argv) : name_(std::move(name)) {
+    int out = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) { path_ = argv[++i]; continue; }
+        if (std::strncmp(argv[i], "--json=", 7) == 0) { path_ = argv[i] + 7; continue; }
+        argv[out++] = argv[i];
+    }
+    argc = out;
+    argv[argc] = nullptr;
+    if (path_.empty()) {
+        if (const char* dir = std::getenv("BENCH_JSON_DIR")) {
+            if (*dir) path_ = std::string(dir) + "/" + name_ + ".json";
+        }
+    }
+}
+
+void Report::param(const std::string& key, double value) {
+    params_.emplace_back(key, json_number(value));
+}
+
+void Report::param(const std::string& key, const std::string& value) {
+    params_.emplace_back(key, json_string(value));
+}
+
+void Report::metric(const std::string& key, double value, const char* unit) {
+    metrics_.emplace_back(key, "{\"value\":" + json_number(value) + ",\"unit\":" + json_string(unit) + "}");
+}
+
+bool Report::write() const {
+    if (path_.empty()) return true;
+    std::ostringstream j;
+    j << "{\"benchmark\":" << json_string(name_)
+      << ",\"unix_time\":" << static_cast<long long>(std::time(nullptr))
+      << ",\"cpus\":" << std::thread::hardware_concurrency();
+    auto object = [&](const char* key, const std::vector<std::pair<std::string, std::string>>& fields) {
+        j << ",\"" << key << "\":{";
+        for (size_t i = 0; i < fields.size(); ++i) {
+            j << (i ? "," : "") << json_string(fields[i].first) << ":" << fields[i].second;
+        }
+        j << "}";
+    };
+    object("params", params_);
+    object("metrics", metrics_);
+    j << "}\n";
+
+    std::ofstream f(path_, std::ios::trunc);
+    if (!(f << j.str())) {
+        fprintf(stderr, "bench: cannot write %s\n", path_.c_str());
+        return false;
+    }
+    fprintf(stderr, "bench: results in %s\n", path_.c_str());
+    return true;
+}
+
+} // namespace bench
+} // namespace sip_processor
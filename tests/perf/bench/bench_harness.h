@@ -0,0 +1,157 @@
+
+// =============================================================================
+// FILE: tests/perf/bench/bench_harness.h
+//
+// Shared pieces of the tests/perf benchmarks (cmake --build <dir> --target
+// bench):
+//   - Workload: a fixed-seed generator for tenants, extension URIs, BLF
+//     watcher dialogs with a skewed fan-out, and interleaved call-state
+//     sequences.  The same seed gives the same workload on any platform.
+//   - In-process stubs, linked instead of Sofia-SIP and the MongoPool
+//     library: SipStackManager counts what it would have sent, MongoPool
+//     counts operations and can add a fixed round trip.
+//   - Report: JSON results for regression tracking.
+// =============================================================================
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include "presence/call_state_event.h"
+#include <sofia-sip/nua.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sip_processor {
+namespace bench {
+
+// splitmix64.  Only raw engine output is used: the standard fixes engine
+// sequences but not what the <random> distributions make of them.
+class Rng {
+public:
+    explicit Rng(uint64_t seed) : state_(seed) {}
+    uint64_t next();
+    size_t uniform(size_t n) { return static_cast<size_t>(unit() * static_cast<double>(n)); }
+    double unit() { return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); }
+    bool chance(int pct) { return uniform(100) < static_cast<size_t>(pct); }
+private:
+    uint64_t state_;
+};
+
+// Zipf over [0, n): rank 0 is the most popular
+class ZipfSampler {
+public:
+    ZipfSampler(size_t n, double exponent);
+    size_t sample(Rng& rng) const;
+private:
+    std::vector<double> cdf_;
+};
+
+struct WorkloadSpec {
+    uint64_t seed                 = 42;
+    int      tenants              = 20;
+    int      extensions_per_tenant = 500;    // Monitored URIs per tenant
+    int      subscriptions        = 20000;   // BLF watcher dialogs
+    double   fanout_skew          = 1.0;     // Zipf exponent: receptionist keys watch the busy lines
+    int      calls                = 10000;
+    int      concurrent_calls     = 64;      // Calls in progress at once; their events interleave
+    int      abandon_pct          = 20;      // Calls that go early -> terminated unanswered
+    int      external_caller_pct  = 30;      // Callers from outside the tenant
+};
+
+struct WatcherDialog {
+    std::string dialog_id;
+    std::string tenant;
+    std::string watcher_uri;
+    std::string monitored_uri;
+    std::string call_id;
+    std::string from_tag;
+};
+
+struct CallEvent {
+    std::string call_id;
+    std::string tenant;
+    std::string caller_uri;
+    std::string callee_uri;
+    CallState   state = CallState::kUnknown;
+    const char* direction = "inbound";
+};
+
+class Workload {
+public:
+    explicit Workload(const WorkloadSpec& spec);
+
+    const WorkloadSpec& spec() const { return spec_; }
+    const std::vector<std::string>& tenants() const { return tenants_; }
+    std::string extension_uri(size_t tenant, size_t ext) const;
+    const std::vector<WatcherDialog>& dialogs() const { return dialogs_; }
+    const std::vector<CallEvent>& call_events() const { return call_events_; }
+    // Watchers of the most watched URI
+    size_t max_fanout() const { return max_fanout_; }
+
+    // Presence feed wire format, as the PresenceTcpClient receives it
+    static std::string to_presence_xml(const CallEvent& ev);
+    std::string presence_stream() const;
+
+private:
+    void generate_dialogs(Rng& rng, const ZipfSampler& popularity);
+    void generate_calls(Rng& rng, const ZipfSampler& popularity);
+
+    WorkloadSpec spec_;
+    std::vector<std::string> tenants_;
+    std::vector<WatcherDialog> dialogs_;
+    std::vector<CallEvent> call_events_;
+    size_t max_fanout_ = 0;
+};
+
+// What the stub SIP stack was asked to send
+struct StubSipStats {
+    std::atomic<uint64_t> notifies{0};
+    std::atomic<uint64_t> subscribe_responses{0};
+    std::atomic<uint64_t> interval_too_brief{0};
+    std::atomic<uint64_t> handles_released{0};
+};
+StubSipStats& stub_sip_stats();
+// A distinct non-null handle for event n; the stub stack never dereferences it
+nua_handle_t* fake_handle(uint64_t n);
+
+struct StubMongoStats {
+    std::atomic<uint64_t> inserts{0};
+    std::atomic<uint64_t> updates{0};
+    std::atomic<uint64_t> deletes{0};
+    std::atomic<uint64_t> finds{0};
+    std::atomic<uint64_t> counts{0};
+};
+StubMongoStats& stub_mongo_stats();
+// Round trip added to every stub MongoPool operation (default none)
+void set_stub_mongo_latency(std::chrono::microseconds rtt);
+
+// Benchmark results as one JSON object:
+//   {"benchmark":..., "unix_time":..., "cpus":..., "params":{...},
+//    "metrics":{"<name>":{"value":...,"unit":"..."}, ...}}
+// Written to the path after --json (taken out of argv, so positional
+// arguments keep their meaning) or to $BENCH_JSON_DIR/<name>.json.
+class Report {
+public:
+    Report(std::string name, int& argc, char** argv);
+
+    void param(const std::string& key, double value);
+    void param(const std::string& key, const std::string& value);
+    void metric(const std::string& key, double value, const char* unit);
+
+    // False if a destination was given but could not be written
+    bool write() const;
+    const std::string& path() const { return path_; }
+
+private:
+    std::string name_;
+    std::string path_;
+    std::vector<std::pair<std::string, std::string>> params_;   // Values already JSON
+    std::vector<std::pair<std::string, std::string>> metrics_;
+};
+
+} // namespace bench
+} // namespace sip_processor
+#endif // BENCH_HARNESS_H
@@ -0,0 +1,33 @@
+
+// =============================================================================
+// FILE: tests/perf/bench/stub/MongoPool.h
+//
+// Benchmark builds put this directory ahead of the MongoPool library's
+// headers, so SubscriptionStore and MongoClient compile against the
+// in-memory stub in stub_mongo_pool.cpp.  Only the calls they make exist.
+// =============================================================================
+#ifndef BENCH_STUB_MONGO_POOL_H
+#define BENCH_STUB_MONGO_POOL_H
+
+#include <mongoc/mongoc.h>
+#include <string>
+
+enum { MONGO_FIND_COUNT, MONGO_FIND, MONGO_INSERT, MONGO_UPDATE, MONGO_DELETE };
+
+class MongoPool {
+public:
+    static int init(const char* uri, int pool_size);
+
+    // Takes the documents it is given, except a count's query, which
+    // SubscriptionStore frees itself on the insert path
+    int Execute(bson_t* query, bson_t* update, int op,
+                const char* file, int line, const char* func,
+                const char* database, const char* collection);
+
+    long getDcount() { return 0; }          // Every upsert takes the insert path
+    bool NextRow() { return false; }        // Finds return nothing
+    std::string getString(const char*) { return std::string(); }
+    int getInt(const char*) { return 0; }
+};
+
+#endif // BENCH_STUB_MONGO_POOL_H
@@ -0,0 +1,43 @@
+
+// =============================================================================
+// FILE: tests/perf/bench/stub_mongo_pool.cpp
+// =============================================================================
+#include "MongoPool.h"
+#include "bench_harness.h"
+#include <thread>
+
+using namespace sip_processor::bench;
+
+static std::atomic<int64_t> g_rtt_us{0};
+
+namespace sip_processor {
+namespace bench {
+
+void set_stub_mongo_latency(std::chrono::microseconds rtt) {
+    g_rtt_us.store(rtt.count(), std::memory_order_relaxed);
+}
+
+} // namespace bench
+} // namespace sip_processor
+
+int MongoPool::init(const char*, int) { return 0; }
+
+int MongoPool::Execute(bson_t* query, bson_t* update, int op,
+                       const char*, int, const char*, const char*, const char*) {
+    auto& s = stub_mongo_stats();
+    switch (op) {
+        case MONGO_FIND_COUNT: s.counts.fetch_add(1, std::memory_order_relaxed); break;
+        case MONGO_FIND:       s.finds.fetch_add(1, std::memory_order_relaxed); break;
+        case MONGO_INSERT:     s.inserts.fetch_add(1, std::memory_order_relaxed); break;
+        case MONGO_UPDATE:     s.updates.fetch_add(1, std::memory_order_relaxed); break;
+        case MONGO_DELETE:     s.deletes.fetch_add(1, std::memory_order_relaxed); break;
+        default: return 0;
+    }
+    int64_t rtt = g_rtt_us.load(std::memory_order_relaxed);
+    if (rtt > 0) std::this_thread::sleep_for(std::chrono::microseconds(rtt));
+    if (op != MONGO_FIND_COUNT) {
+        if (query) bson_destroy(query);
+        if (update) bson_destroy(update);
+    }
+    return 1;
+}
@@ -0,0 +1,53 @@
+
+// =============================================================================
+// FILE: tests/perf/bench/stub_sip_stack.cpp
+//
+// Stands in for src/sip/sip_stack_manager.cpp and the Sofia-SIP library in
+// benchmark builds.  Nothing goes on the wire: responses and NOTIFYs are
+// counted, and a NOTIFY is answered at once, so the overload controller
+// sees no send backlog.
+// =============================================================================
+#include "sip/sip_stack_manager.h"
+#include "bench_harness.h"
+
+using sip_processor::bench::stub_sip_stats;
+
+// Handles come from bench::fake_handle and are never dereferenced
+extern "C" nua_handle_t* nua_handle_ref(nua_handle_t* nh) { return nh; }
+
+extern "C" int nua_handle_unref(nua_handle_t*) {
+    stub_sip_stats().handles_released.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+}
+
+namespace sip_processor {
+
+SipStackManager::SipStackManager(const Config& config) : config_(config) {}
+
+SipStackManager::~SipStackManager() { stop(); }
+
+Result SipStackManager::start() {
+    if (running_.load(std::memory_order_acquire)) return Result::kAlreadyExists;
+    running_.store(true, std::memory_order_release);
+    return Result::kOk;
+}
+
+void SipStackManager::stop() {
+    running_.store(false, std::memory_order_release);
+}
+
+void SipStackManager::run_event_loop() {}
+
+void SipStackManager::respond_to_subscribe(nua_handle_t*, int, const char*, uint32_t) {
+    stub_sip_stats().subscribe_responses.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SipStackManager::respond_interval_too_brief(nua_handle_t*, uint32_t) {
+    stub_sip_stats().interval_too_brief.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SipStackManager::send_notify(nua_handle_t*, const char*, const char*, const char*, const char*) {
+    stub_sip_stats().notifies.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace sip_processor
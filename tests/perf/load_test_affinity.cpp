@@ -0,0 +1,124 @@
+// =============================================================================
+// FILE: tests/perf/load_test_affinity.cpp
+//
+// Compares dispatcher throughput with workers floating against workers
+// pinned one per CPU ([affinity] workers = cpu list).  The same dialogs and
+// event mix are replayed in both runs.
+//
+// Run: ./load_test_affinity [num_events] [num_dialogs] [cpu_list] [--json FILE]
+//      cpu_list defaults to "0-<workers-1>"
+// =============================================================================
+#include "bench/bench_harness.h"
+#include "common/config.h"
+#include "common/logger.h"
+#include "common/slow_event_logger.h"
+#include "common/thread_affinity.h"
+#include "dispatch/dialog_dispatcher.h"
+#include "sip/sip_event.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+using namespace sip_processor;
+using namespace std::chrono;
+
+static std::unique_ptr<SipEvent> make_subscribe(const std::string& dialog_id,
+                                                const std::string& tenant_id) {
+    auto ev = std::make_unique<SipEvent>();
+    ev->id = SipEvent::next_id();
+    ev->dialog_id = dialog_id;
+    ev->tenant_id = tenant_id;
+    ev->category = SipEventCategory::kSubscribe;
+    ev->source = SipEventSource::kSipStack;
+    ev->sub_type = SubscriptionType::kBLF;
+    ev->direction = SipDirection::kIncoming;
+    ev->created_at = Clock::now();
+    ev->expires = 3600;
+    ev->subscription_state = "active";
+    ev->to_uri = "sip:monitored@" + tenant_id;
+    ev->from_uri = "sip:watcher@" + tenant_id;
+    return ev;
+}
+
+// Events processed per second over one full create + trigger run
+static double run(const Config& config, const std::vector<std::string>& dialogs, int num_events) {
+    ThreadPlacement::instance().configure(config);
+    DialogDispatcher dispatcher(config, std::make_shared<SlowEventLogger>(config), nullptr);
+    dispatcher.start();
+
+    const std::string tenant = "affinity.test.com";
+    auto start = steady_clock::now();
+    for (const auto& did : dialogs) dispatcher.dispatch(make_subscribe(did, tenant));
+    for (int i = 0; i < num_events; ++i) {
+        const std::string& did = dialogs[i % dialogs.size()];
+        dispatcher.dispatch(SipEvent::create_presence_trigger(
+            did, TenantId(tenant), "call-" + std::to_string(i & 1023), "sip:a@" + tenant,
+            "sip:b@" + tenant, (i & 1) ? "confirmed" : "terminated", "inbound", ""));
+    }
+
+    uint64_t expected = dialogs.size() + static_cast<uint64_t>(num_events);
+    uint64_t done = 0;
+    while ((done = dispatcher.aggregate_stats().total_events_processed +
+                   dispatcher.aggregate_stats().total_events_dropped) < expected &&
+           steady_clock::now() - start < seconds(120)) {
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    double secs = duration_cast<microseconds>(steady_clock::now() - start).count() / 1e6;
+    dispatcher.stop();
+    return done / secs;
+}
+
+int main(int argc, char* argv[]) {
+    bench::Report report("affinity", argc, argv);
+    int num_events  = (argc > 1) ? atoi(argv[1]) : 2000000;
+    int num_dialogs = (argc > 2) ? atoi(argv[2]) : 50000;
+
+    Logger::instance().set_level(LogLevel::kError);
+
+    Config config = Config::load_defaults();
+    config.mongo_enable_persistence = false;
+    config.max_incoming_queue_per_worker = 4000000;
+    config.max_subscriptions_per_tenant = 1000000;
+    config.max_dialogs_per_worker = 5000000;
+    std::string cpus = (argc > 3) ? argv[3] : "0-" + std::to_string(config.num_workers - 1);
+
+    std::vector<std::string> dialogs;
+    dialogs.reserve(num_dialogs);
+    for (int i = 0; i < num_dialogs; ++i) dialogs.push_back("aff-" + std::to_string(i) + ";ft=a;tt=b");
+
+    std::cout << "=== Worker Affinity Load Test ===" << std::endl;
+    std::cout << "Events:  " << num_events << std::endl;
+    std::cout << "Dialogs: " << num_dialogs << std::endl;
+    std::cout << "Workers: " << config.num_workers << " (pinned run: cpus " << cpus << ")" << std::endl;
+
+    config.affinity_enabled = false;
+    double floating = run(config, dialogs, num_events);
+
+    config.affinity_enabled = true;
+    config.affinity_workers = cpus;
+    std::vector<int> parsed;
+    if (!parse_cpu_list(cpus, parsed)) {
+        std::cerr << "Malformed cpu list: " << cpus << std::endl;
+        return 1;
+    }
+    double pinned = run(config, dialogs, num_events);
+
+    std::cout << std::fixed << std::setprecision(0);
+    std::cout << "Floating: " << floating << " events/sec" << std::endl;
+    std::cout << "Pinned:   " << pinned << " events/sec" << std::endl;
+    std::cout << "Speedup:  " << std::setprecision(2) << (pinned / floating) << "x" << std::endl;
+
+    report.param("events", num_events);
+    report.param("dialogs", num_dialogs);
+    report.param("workers", static_cast<double>(config.num_workers));
+    report.param("cpus", cpus);
+    report.metric("floating_rate", floating, "events/s");
+    report.metric("pinned_rate", pinned, "events/s");
+    report.metric("speedup", pinned / floating, "x");
+    return report.write() ? 0 : 1;
+}
@@ -4,8 +4,13 @@
 //
 // Benchmarks the BLF subscription index under concurrent reads/writes.
 //
-// Run: ./load_test_blf_index [num_uris] [num_watchers_per_uri] [num_readers]
+// With num_tenants > 1 every tenant watches the same URI set (the same
+// extensions provisioned in many tenants), and a final phase compares
+// unscoped lookups against tenant-scoped ones.
+//
+// Run: ./load_test_blf_index [num_uris] [num_watchers_per_uri] [num_readers] [num_tenants] [--json FILE]
 // =============================================================================
+#include "bench/bench_harness.h"
 #include "subscription/blf_subscription_index.h"
 #include "common/logger.h"
 #include <chrono>
@@ -21,9 +26,11 @@ using namespace sip_processor;
 using namespace std::chrono;
 
 int main(int argc, char* argv[]) {
+    bench::Report report("blf_index", argc, argv);
     int num_uris     = (argc > 1) ? atoi(argv[1]) : 10000;
     int watchers_per = (argc > 2) ? atoi(argv[2]) : 5;
     int num_readers  = (argc > 3) ? atoi(argv[3]) : 4;
+    int num_tenants  = (argc > 4) ? atoi(argv[4]) : 1;
     int read_ops     = 1000000;
 
     Logger::instance().set_level(LogLevel::kError);
@@ -32,19 +39,22 @@ int main(int argc, char* argv[]) {
 
     std::cout << "=== BLF Index Concurrent Load Test ===" << std::endl;
     std::cout << "URIs: " << num_uris << ", Watchers/URI: " << watchers_per
-              << ", Readers: " << num_readers << std::endl;
+              << ", Readers: " << num_readers << ", Tenants: " << num_tenants << std::endl;
+    auto tenant_name = [](int t) { return t == 0 ? std::string("test.com") : "tenant-" + std::to_string(t); };
 
     // Phase 1: Populate
     auto pop_start = steady_clock::now();
-    for (int u = 0; u < num_uris; ++u) {
-        std::string uri = "sip:" + std::to_string(u) + "@test.com";
-        for (int w = 0; w < watchers_per; ++w) {
-            std::string did = "dialog-" + std::to_string(u) + "-" + std::to_string(w);
-            idx.add(uri, did, "test.com");
+    for (int t = 0; t < num_tenants; ++t) {
+        for (int u = 0; u < num_uris; ++u) {
+            std::string uri = "sip:" + std::to_string(u) + "@test.com";
+            for (int w = 0; w < watchers_per; ++w) {
+                std::string did = "dialog-" + std::to_string(t) + "-" + std::to_string(u) + "-" + std::to_string(w);
+                idx.add(Symbol(uri), did, TenantId(tenant_name(t)));
+            }
         }
     }
     auto pop_dur = duration_cast<milliseconds>(steady_clock::now() - pop_start);
-    int total_entries = num_uris * watchers_per;
+    int total_entries = num_tenants * num_uris * watchers_per;
 
     std::cout << "Populated " << total_entries << " entries in " << pop_dur.count() << "ms"
               << " (" << (total_entries * 1000.0 / pop_dur.count()) << " ops/sec)" << std::endl;
@@ -65,8 +75,8 @@ int main(int argc, char* argv[]) {
             std::string uri = "sip:" + std::to_string(u) + "@test.com";
             std::string did = "dialog-" + std::to_string(u) + "-churn";
 
-            idx.add(uri, did, "test.com");
-            idx.remove(uri, did);
+            idx.add(Symbol(uri), did, TenantId("test.com"));
+            idx.remove(Symbol(uri), did);
             writes += 2;
         }
     });
@@ -112,16 +122,48 @@ int main(int argc, char* argv[]) {
     std::cout << "  Hit rate:   " << std::setprecision(1)
               << (hits * 100.0 / lookups) << "%" << std::endl;
 
+    // Phase 3: unscoped vs tenant-scoped lookups of the same URIs
+    if (num_tenants > 1) {
+        int ops = 200000;
+        auto run = [&](bool scoped) {
+            std::mt19937 rng(7);
+            std::uniform_int_distribution<int> udist(0, num_uris - 1), tdist(0, num_tenants - 1);
+            size_t found = 0;
+            auto t0 = steady_clock::now();
+            for (int i = 0; i < ops; ++i) {
+                std::string uri = "sip:" + std::to_string(udist(rng)) + "@test.com";
+                found += scoped ? idx.lookup(uri, tenant_name(tdist(rng))).size() : idx.lookup(uri).size();
+            }
+            double us = duration<double, std::micro>(steady_clock::now() - t0).count() / ops;
+            report.metric(scoped ? "scoped_lookup_us" : "unscoped_lookup_us", us, "us");
+            std::cout << "  " << (scoped ? "Tenant-scoped" : "Unscoped     ") << ": "
+                      << std::setprecision(2) << us << " us/lookup, "
+                      << std::setprecision(1) << (static_cast<double>(found) / ops) << " watchers/lookup" << std::endl;
+        };
+        std::cout << "\nMulti-tenant lookups (" << num_tenants << " tenants share each URI):" << std::endl;
+        run(false);
+        run(true);
+    }
+
     // Cleanup
-    for (int u = 0; u < num_uris; ++u) {
-        for (int w = 0; w < watchers_per; ++w) {
-            std::string did = "dialog-" + std::to_string(u) + "-" + std::to_string(w);
-            idx.remove_dialog(did);
+    for (int t = 0; t < num_tenants; ++t) {
+        for (int u = 0; u < num_uris; ++u) {
+            for (int w = 0; w < watchers_per; ++w) {
+                std::string did = "dialog-" + std::to_string(t) + "-" + std::to_string(u) + "-" + std::to_string(w);
+                idx.remove_dialog(did);
+            }
         }
     }
 
     std::cout << "\nFinal index: " << idx.monitored_uri_count() << " URIs, "
               << idx.total_watcher_count() << " watchers" << std::endl;
 
-    return 0;
+    report.param("uris", num_uris);
+    report.param("watchers_per_uri", watchers_per);
+    report.param("readers", num_readers);
+    report.param("tenants", num_tenants);
+    report.metric("populate_rate", total_entries * 1000.0 / std::max<int64_t>(pop_dur.count(), 1), "ops/s");
+    report.metric("lookup_rate", lookups * 1000.0 / std::max<int64_t>(read_dur.count(), 1), "lookups/s");
+    report.metric("hit_rate", hits * 100.0 / lookups, "%");
+    return report.write() ? 0 : 1;
 }
\ No newline at end of file
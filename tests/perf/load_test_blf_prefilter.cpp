@@ -0,0 +1,98 @@
+// =============================================================================
+// FILE: tests/perf/load_test_blf_prefilter.cpp
+//
+// Measures the counting Bloom filter in front of BlfSubscriptionIndex the
+// way PresenceEventRouter uses it: each call-state event checks callee and
+// caller, and only URIs the filter may hold go on to a lookup.  Reports the
+// false positive rate, the lookups saved and the time per event with and
+// without the pre-check.
+//
+// Run: ./load_test_blf_prefilter [watched_uris] [num_events] [watched_pct] [counters] [--json FILE]
+//      watched_pct = share of event URIs that have a watcher
+// =============================================================================
+#include "bench/bench_harness.h"
+#include "subscription/blf_subscription_index.h"
+#include "common/logger.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace sip_processor;
+using namespace std::chrono;
+
+int main(int argc, char* argv[]) {
+    bench::Report report("blf_prefilter", argc, argv);
+    int watched     = (argc > 1) ? atoi(argv[1]) : 400000;
+    int num_events  = (argc > 2) ? atoi(argv[2]) : 2000000;
+    int watched_pct = (argc > 3) ? atoi(argv[3]) : 10;
+    size_t counters = (argc > 4) ? strtoull(argv[4], nullptr, 10) : size_t(1) << 22;
+
+    Logger::instance().set_level(LogLevel::kError);
+    auto& idx = BlfSubscriptionIndex::instance();
+    idx.configure_prefilter(counters);
+
+    std::cout << "=== BLF Prefilter Load Test ===" << std::endl;
+    std::cout << "Watched URIs: " << watched << ", Events: " << num_events
+              << ", Watched share: " << watched_pct << "%, Counters: " << counters << std::endl;
+
+    for (int u = 0; u < watched; ++u) {
+        idx.add(Symbol("sip:" + std::to_string(u) + "@prefilter.com"), "dlg-" + std::to_string(u), TenantId("prefilter.com"));
+    }
+
+    // Feed URIs as they arrive: bracketed, with parameters, some watched
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> pct(0, 99), watched_ext(0, watched - 1), other_ext(0, 1 << 30);
+    std::vector<std::string> uris(static_cast<size_t>(num_events) * 2);
+    std::vector<bool> is_watched(uris.size());
+    for (size_t i = 0; i < uris.size(); ++i) {
+        is_watched[i] = pct(rng) < watched_pct;
+        int ext = is_watched[i] ? watched_ext(rng) : watched + other_ext(rng);
+        uris[i] = "<sip:" + std::to_string(ext) + "@prefilter.com;transport=tcp>";
+    }
+
+    // Baseline: two lookups per event
+    size_t found = 0;
+    auto start = steady_clock::now();
+    for (size_t i = 0; i < uris.size(); ++i) found += idx.lookup(uris[i], TenantId("prefilter.com")).size();
+    double base_ns = duration_cast<nanoseconds>(steady_clock::now() - start).count() / double(num_events);
+
+    // Pre-checked
+    size_t found_pre = 0, lookups = 0, false_positives = 0, unwatched = 0;
+    start = steady_clock::now();
+    for (size_t i = 0; i < uris.size(); ++i) {
+        if (!idx.may_be_watched(uris[i])) continue;
+        ++lookups;
+        found_pre += idx.lookup(uris[i], TenantId("prefilter.com")).size();
+    }
+    double pre_ns = duration_cast<nanoseconds>(steady_clock::now() - start).count() / double(num_events);
+
+    for (size_t i = 0; i < uris.size(); ++i) {
+        if (is_watched[i]) continue;
+        ++unwatched;
+        if (idx.may_be_watched(uris[i])) ++false_positives;
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Watchers found:     " << found << " / " << found_pre << " (must match)" << std::endl;
+    std::cout << "False positives:    " << (100.0 * false_positives / std::max<size_t>(1, unwatched)) << "%" << std::endl;
+    std::cout << "Lookups saved:      " << (uris.size() - lookups) << " of " << uris.size() << " ("
+              << std::setprecision(1) << (100.0 * (uris.size() - lookups) / uris.size()) << "%)" << std::endl;
+    std::cout << "Per event, lookup:  " << base_ns << " ns" << std::endl;
+    std::cout << "Per event, checked: " << pre_ns << " ns (" << std::setprecision(2)
+              << (base_ns / pre_ns) << "x)" << std::endl;
+
+    report.param("watched_uris", watched);
+    report.param("events", num_events);
+    report.param("watched_pct", watched_pct);
+    report.param("counters", static_cast<double>(counters));
+    report.metric("false_positive_pct", 100.0 * false_positives / std::max<size_t>(1, unwatched), "%");
+    report.metric("lookups_saved_pct", 100.0 * (uris.size() - lookups) / uris.size(), "%");
+    report.metric("lookup_ns_per_event", base_ns, "ns");
+    report.metric("checked_ns_per_event", pre_ns, "ns");
+    if (!report.write()) return 1;
+    return found == found_pre ? 0 : 1;
+}
@@ -5,21 +5,19 @@
 // and memory under high event rates without SIP stack dependency.
 //
 // Build:
-//   g++ -O2 -std=c++17 -pthread load_test_dispatcher.cpp \
-//       ../../src/dispatch/*.cpp ../../src/subscription/*.cpp \
-//       ../../src/common/*.cpp ../../src/sip/sip_event.cpp \
-//       ../../src/sip/sip_dialog_id.cpp \
-//       -I../../include -lmongocxx -lbsoncxx -o load_test_dispatcher
+//   cmake --build <dir> --target load_test_dispatcher   (<dir>/bench/)
 //
 // Run:
-//   ./load_test_dispatcher [num_events] [num_dialogs] [num_workers]
+//   ./load_test_dispatcher [num_events] [num_dialogs] [num_workers] [--json FILE]
 // =============================================================================
+#include "bench/bench_harness.h"
 #include "common/config.h"
 #include "common/logger.h"
 #include "common/slow_event_logger.h"
 #include "dispatch/dialog_dispatcher.h"
 #include "persistence/subscription_store.h"
 #include "sip/sip_event.h"
+#include "subscription/blf_subscription_index.h"
 #include "subscription/subscription_state.h"
 
 #include <chrono>
@@ -66,12 +64,13 @@ static std::unique_ptr<SipEvent> make_event(const std::string& dialog_id,
 static std::unique_ptr<SipEvent> make_presence_trigger(const std::string& dialog_id,
                                                          const std::string& tenant_id) {
     return SipEvent::create_presence_trigger(
-        dialog_id, tenant_id, "presence-call-" + dialog_id,
+        dialog_id, TenantId(tenant_id), "presence-call-" + dialog_id,
         "sip:caller@" + tenant_id, "sip:callee@" + tenant_id,
         "confirmed", "inbound", "<dialog-info/>");
 }
 
 int main(int argc, char* argv[]) {
+    bench::Report report("dispatcher", argc, argv);
     // Defaults
     int total_events  = (argc > 1) ? atoi(argv[1]) : 1000000;
     int num_dialogs   = (argc > 2) ? atoi(argv[2]) : 100000;
@@ -123,6 +122,7 @@ int main(int argc, char* argv[]) {
     std::this_thread::sleep_for(milliseconds(2000));
 
     auto phase1_dur = duration_cast<milliseconds>(steady_clock::now() - phase1_start);
+    report.metric("subscribe_rate", num_dialogs * 1000.0 / phase1_dur.count(), "subs/s");
     auto agg1 = dispatcher.aggregate_stats();
     std::cout << "  Created " << agg1.total_dialogs_active << " dialogs in "
               << phase1_dur.count() << "ms" << std::endl;
@@ -194,7 +194,7 @@ int main(int argc, char* argv[]) {
 
     int64_t sent = events_sent.load();
     int64_t failed = events_failed.load();
-    double avg_enqueue_us = (total_enqueue_ns.load() / 1000.0) / std::max(sent, 1LL);
+    double avg_enqueue_us = (total_enqueue_ns.load() / 1000.0) / std::max<int64_t>(sent, 1);
 
     std::cout << std::endl;
     std::cout << "=== Phase 2 Results ===" << std::endl;
@@ -261,6 +261,7 @@ int main(int argc, char* argv[]) {
                   << lk_dur.count() << " us ("
                   << (lk_dur.count() * 1.0 / lookup_count) << " us/lookup, "
                   << found << " hits)" << std::endl;
+        report.metric("index_lookup_us", lk_dur.count() * 1.0 / lookup_count, "us");
     }
 
     // Cleanup
@@ -271,8 +272,18 @@ int main(int argc, char* argv[]) {
     std::cout << "  Warn:     " << slow_logger->stats().warn_count.load() << std::endl;
     std::cout << "  Error:    " << slow_logger->stats().error_count.load() << std::endl;
     std::cout << "  Critical: " << slow_logger->stats().critical_count.load() << std::endl;
-    std::cout << "  Max ms:   " << slow_logger->stats().max_duration_ms.load() << std::endl;
+    std::cout << "  Max us:   " << slow_logger->stats().max_duration_us.load() << std::endl;
 
     std::cout << std::endl << "Load test complete." << std::endl;
-    return 0;
+
+    report.param("events", total_events);
+    report.param("dialogs", num_dialogs);
+    report.param("workers", static_cast<double>(config.num_workers));
+    report.param("producers", num_producers);
+    report.metric("event_rate", sent * 1000.0 / phase2_dur.count(), "events/s");
+    report.metric("enqueue_avg_us", avg_enqueue_us, "us");
+    report.metric("enqueue_max_us", max_enqueue_ns.load() / 1000.0, "us");
+    report.metric("events_failed", static_cast<double>(failed), "events");
+    report.metric("events_dropped", static_cast<double>(agg2.total_events_dropped), "events");
+    return report.write() ? 0 : 1;
 }
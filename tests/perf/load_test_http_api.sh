@@ -14,10 +14,27 @@ PORT="${2:-8080}"
 DURATION="${3:-30}"
 THREADS="${4:-4}"
 CONNECTIONS="${5:-100}"
+# The server's http.max_connections; connections past it are closed on
+# accept, so sweep steps above it would only measure rejections
+MAX_CONNECTIONS="${MAX_CONNECTIONS:-100}"
+
+# Drops sweep steps above $1 and says which ones were skipped
+cap_sweep() {
+    local limit=$1 kept="" skipped=""
+    for c in ${SWEEP:-1 10 50 100 200 500}; do
+        if [ "${c}" -le "${limit}" ]; then kept="${kept} ${c}"; else skipped="${skipped} ${c}"; fi
+    done
+    if [ -n "${skipped}" ]; then
+        echo "NOTE: skipping connections=${skipped# } (over the limit of ${limit});" \
+             "raise http.max_connections and set MAX_CONNECTIONS to sweep them" >&2
+    fi
+    echo "${kept# }"
+}
 
 echo "=== HTTP API Load Test ==="
 echo "Target: http://${HOST}:${PORT}"
 echo "Duration: ${DURATION}s, Threads: ${THREADS}, Connections: ${CONNECTIONS}"
+echo "Server http.max_connections: ${MAX_CONNECTIONS}"
 echo ""
 
 if command -v wrk &> /dev/null; then
@@ -37,6 +54,28 @@ if command -v wrk &> /dev/null; then
     wrk -t${THREADS} -c${CONNECTIONS} -d${DURATION}s http://${HOST}:${PORT}/subscriptions
     echo ""
 
+    # Concurrency sweep: keep-alive connections scale on the event loop,
+    # and /health latency must stay flat while /subscriptions saturates
+    # the handler pool.  Each step runs 4 extra /health connections, so it
+    # stays 4 under the server limit
+    SWEEP_DURATION="${SWEEP_DURATION:-10}"
+    echo "--- Concurrency sweep (${SWEEP_DURATION}s per step) ---"
+    for c in $(cap_sweep $(( MAX_CONNECTIONS - 4 ))); do
+        t=$(( c < THREADS ? c : THREADS ))
+        echo "## connections=${c}: /stats"
+        wrk -t${t} -c${c} -d${SWEEP_DURATION}s --latency http://${HOST}:${PORT}/stats \
+            | grep -E "Requests/sec|50%|99%|Socket errors"
+
+        echo "## connections=${c}: /health while /subscriptions is loaded"
+        wrk -t${t} -c${c} -d${SWEEP_DURATION}s http://${HOST}:${PORT}/subscriptions > /dev/null &
+        LOAD_PID=$!
+        sleep 1
+        wrk -t1 -c4 -d$(( SWEEP_DURATION - 2 ))s --latency http://${HOST}:${PORT}/health \
+            | grep -E "Requests/sec|50%|99%|Socket errors"
+        wait ${LOAD_PID}
+        echo ""
+    done
+
 elif command -v ab &> /dev/null; then
     REQUESTS=10000
 
@@ -48,6 +87,14 @@ elif command -v ab &> /dev/null; then
     ab -n ${REQUESTS} -c ${CONNECTIONS} http://${HOST}:${PORT}/stats
     echo ""
 
+    echo "--- Concurrency sweep, keep-alive (-k) ---"
+    for c in $(cap_sweep ${MAX_CONNECTIONS}); do
+        echo "## connections=${c}"
+        ab -k -n ${REQUESTS} -c ${c} http://${HOST}:${PORT}/health \
+            | grep -E "Requests per second|Keep-Alive requests|Failed requests|99%"
+    done
+    echo ""
+
 else
     echo "Install 'wrk' or 'ab' (apache2-utils) for HTTP load testing"
     echo "  Ubuntu: sudo apt install apache2-utils"
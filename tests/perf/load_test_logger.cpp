@@ -0,0 +1,187 @@
+// =============================================================================
+// FILE: tests/perf/load_test_logger.cpp
+//
+// Logging throughput and caller-side latency with N threads emitting a
+// per-NOTIFY style LOG_INFO line, comparing:
+//
+//   Mode 1: synchronous — format + sink mutex + write() on the caller
+//   Mode 2: async, eager — printf formatting on the caller (Logger::log)
+//   Mode 3: async, deferred — LOG_INFO captures raw args, the writer
+//           formats; overflow=count, batched writev()
+//   Mode 4: async, deferred, overflow=drop with a small ring
+//   Mode 5: disabled level — LOG_DEBUG at INFO (cost of the level check)
+//
+// Build:
+//   cmake --build <dir> --target load_test_logger   (<dir>/bench/)
+//
+// Run:
+//   ./load_test_logger [num_threads] [msgs_per_thread] [log_dir] [--json FILE]
+// =============================================================================
+#include "bench/bench_harness.h"
+#include "common/logger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+using namespace sip_processor;
+using namespace std::chrono;
+
+struct RunResult {
+    double secs = 0;
+    std::vector<uint64_t> lat_ns;
+};
+
+static RunResult run(size_t num_threads, size_t msgs_per_thread, bool eager = false) {
+    RunResult r;
+    std::vector<std::vector<uint64_t>> lat(num_threads);
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t] {
+            lat[t].reserve(msgs_per_thread);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            for (size_t i = 0; i < msgs_per_thread; ++i) {
+                auto t0 = steady_clock::now();
+                if (eager) {
+                    Logger::instance().log(LogLevel::kInfo, __FILE__, __LINE__,
+                        "Sent NOTIFY dialog=call-%zu@10.0.0.1 uri=sip:%zu@tenant-%zu.example.com "
+                        "state=confirmed version=%zu", i, 1000 + i % 500, t, i);
+                } else {
+                    LOG_INFO("Sent NOTIFY dialog=call-%zu@10.0.0.1 uri=sip:%zu@tenant-%zu.example.com "
+                             "state=confirmed version=%zu", i, 1000 + i % 500, t, i);
+                }
+                lat[t].push_back(static_cast<uint64_t>(
+                    duration_cast<nanoseconds>(steady_clock::now() - t0).count()));
+            }
+        });
+    }
+    auto t0 = steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& th : threads) th.join();
+    r.secs = duration<double>(steady_clock::now() - t0).count();
+    for (auto& v : lat) r.lat_ns.insert(r.lat_ns.end(), v.begin(), v.end());
+    std::sort(r.lat_ns.begin(), r.lat_ns.end());
+    return r;
+}
+
+static uint64_t pct(const std::vector<uint64_t>& v, double p) {
+    return v.empty() ? 0 : v[std::min(v.size() - 1, static_cast<size_t>(p * v.size()))];
+}
+
+// Logger stats are cumulative; each mode reports its delta
+struct StatsMark {
+    uint64_t written, dropped, writev_calls;
+    StatsMark() {
+        const auto& st = Logger::instance().stats();
+        written = st.written.load();
+        dropped = st.dropped.load();
+        writev_calls = st.writev_calls.load();
+    }
+};
+
+static void print_mode(const char* name, const char* key, const RunResult& r, size_t total,
+                       const StatsMark& before, bench::Report& report) {
+    StatsMark now;
+    report.metric(std::string(key) + "_rate", total / r.secs, "msgs/s");
+    report.metric(std::string(key) + "_p99", static_cast<double>(pct(r.lat_ns, 0.99)), "ns");
+    std::cout << "\n--- " << name << " ---" << std::endl;
+    std::cout << "Throughput:  " << (total / r.secs / 1e6) << " M msgs/sec" << std::endl;
+    std::cout << "Caller p50:  " << pct(r.lat_ns, 0.50) << " ns, p99: " << pct(r.lat_ns, 0.99)
+              << " ns, p99.9: " << pct(r.lat_ns, 0.999) << " ns, max: "
+              << (r.lat_ns.empty() ? 0 : r.lat_ns.back()) << " ns" << std::endl;
+    if (Logger::instance().async()) {
+        uint64_t written = now.written - before.written;
+        uint64_t calls = now.writev_calls - before.writev_calls;
+        std::cout << "Written:     " << written << ", dropped: " << (now.dropped - before.dropped)
+                  << ", writev calls: " << calls << " ("
+                  << (written / std::max<double>(1, calls)) << " lines/writev)" << std::endl;
+    }
+}
+
+static void cleanup(const std::string& dir) {
+    for (const char* suffix : {".log", "_debug.log", "_error.log", "_slow.log"}) {
+        std::remove((dir + "/bench" + suffix).c_str());
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bench::Report report("logger", argc, argv);
+    size_t num_threads     = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 8;
+    size_t msgs_per_thread = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 200000;
+    std::string dir        = (argc > 3) ? argv[3] : "/tmp/logger_bench";
+    if (num_threads == 0) num_threads = 1;
+    ::mkdir(dir.c_str(), 0755);
+
+    size_t total = num_threads * msgs_per_thread;
+    std::cout << "=== Logger Throughput Benchmark ===" << std::endl;
+    std::cout << "Threads: " << num_threads << ", Messages/thread: " << msgs_per_thread
+              << ", Dir: " << dir << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    auto& logger = Logger::instance();
+    logger.set_level(LogLevel::kInfo);
+    constexpr size_t kNoRotation = 0;
+
+    // Mode 1: synchronous
+    AsyncLogConfig sync_cfg;
+    sync_cfg.enabled = false;
+    logger.configure(dir, "bench", LogLevel::kFatal, kNoRotation, 1, sync_cfg);
+    print_mode("Synchronous", "sync", run(num_threads, msgs_per_thread), total, StatsMark(), report);
+    logger.shutdown();
+    cleanup(dir);
+
+    // Modes 2/3: async with large rings (drops only if the writer has no core)
+    AsyncLogConfig count_cfg;
+    count_cfg.thread_buffer_bytes = 4 * 1024 * 1024;
+    count_cfg.overflow = LogOverflowPolicy::kCount;
+    RunResult r;
+    for (bool eager : {true, false}) {
+        logger.configure(dir, "bench", LogLevel::kFatal, kNoRotation, 1, count_cfg);
+        StatsMark mark;
+        r = run(num_threads, msgs_per_thread, eager);
+        auto t0 = steady_clock::now();
+        logger.flush_all();
+        double drain_ms = duration<double, std::milli>(steady_clock::now() - t0).count();
+        print_mode(eager ? "Async, eager format" : "Async, deferred format (overflow=count, 4MB rings)",
+                   eager ? "async_eager" : "async_deferred", r, total, mark, report);
+        std::cout << "Drain tail:  " << drain_ms << " ms" << std::endl;
+        logger.shutdown();
+        cleanup(dir);
+    }
+
+    // Mode 4: async, small rings with drop — workers never wait on disk
+    AsyncLogConfig drop_cfg;
+    drop_cfg.thread_buffer_bytes = 64 * 1024;
+    drop_cfg.overflow = LogOverflowPolicy::kDrop;
+    logger.configure(dir, "bench", LogLevel::kFatal, kNoRotation, 1, drop_cfg);
+    StatsMark mark;
+    r = run(num_threads, msgs_per_thread);
+    logger.flush_all();
+    print_mode("Async, deferred format (overflow=drop, 64KB rings)", "async_drop", r, total, mark, report);
+    logger.shutdown();
+    cleanup(dir);
+
+    // Mode 5: disabled level; arguments must not be evaluated
+    constexpr size_t kDisabledCalls = 100000000;
+    size_t evaluated = 0;
+    auto t0 = steady_clock::now();
+    for (size_t i = 0; i < kDisabledCalls; ++i) {
+        LOG_DEBUG("never %zu %s", ++evaluated, std::to_string(i).c_str());
+    }
+    double ns = duration<double, std::nano>(steady_clock::now() - t0).count() / kDisabledCalls;
+    std::cout << "\n--- Disabled LOG_DEBUG ---" << std::endl;
+    std::cout << "Cost:        " << ns << " ns/call (args evaluated " << evaluated << " times)" << std::endl;
+
+    report.param("threads", static_cast<double>(num_threads));
+    report.param("msgs_per_thread", static_cast<double>(msgs_per_thread));
+    report.metric("disabled_ns_per_call", ns, "ns");
+    return report.write() ? 0 : 1;
+}
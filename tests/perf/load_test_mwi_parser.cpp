@@ -0,0 +1,73 @@
+
+// =============================================================================
+// FILE: tests/perf/load_test_mwi_parser.cpp
+//
+// Benchmarks message-summary parsing, the per-NOTIFY cost of an MWI
+// bulk refresh from a voicemail platform.
+//
+// Run: ./load_test_mwi_parser [num_bodies] [--json FILE]
+// =============================================================================
+#include "bench/bench_harness.h"
+#include "subscription/mwi_processor.h"
+#include "common/logger.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+using namespace sip_processor;
+using namespace std::chrono;
+
+int main(int argc, char* argv[]) {
+    bench::Report report("mwi_parser", argc, argv);
+    int num_bodies = (argc > 1) ? atoi(argv[1]) : 2000000;
+
+    Logger::instance().set_level(LogLevel::kError);
+
+    std::cout << "=== MWI Message-Summary Parser Load Test ===" << std::endl;
+    std::cout << "Bodies: " << num_bodies << std::endl;
+
+    // A spread of realistic bodies: voice only, voice + urgent, all classes
+    std::vector<std::string> bodies;
+    for (int i = 0; i < 64; ++i) {
+        std::string b = "Messages-Waiting: " + std::string(i % 3 ? "yes" : "no") + "\r\n"
+                        "Message-Account: sip:" + std::to_string(1000 + i) + "@voicemail.test.com\r\n"
+                        "Voice-Message: " + std::to_string(i % 10) + "/" + std::to_string(i) +
+                        (i % 2 ? " (1/0)" : "") + "\r\n";
+        if (i % 4 == 0) {
+            b += "Fax-Message: 1/2\r\nPager-Message: 0/0\r\nMultimedia-Message: 3/4 (0/1)\r\n";
+        }
+        bodies.push_back(std::move(b));
+    }
+
+    uint64_t checksum = 0;
+    size_t total_bytes = 0;
+    auto start = steady_clock::now();
+
+    for (int i = 0; i < num_bodies; ++i) {
+        const std::string& b = bodies[i & 63];
+        auto s = MwiProcessor::parse_message_summary(b);
+        checksum += static_cast<uint64_t>(s.voice().new_messages) + s.account.size() + s.classes;
+        total_bytes += b.size();
+    }
+
+    auto dur = duration_cast<microseconds>(steady_clock::now() - start);
+    double secs = dur.count() / 1e6;
+
+    std::cout << "Duration:   " << dur.count() / 1000 << " ms" << std::endl;
+    std::cout << "Throughput: " << std::fixed << std::setprecision(0)
+              << (num_bodies / secs) << " bodies/sec" << std::endl;
+    std::cout << "Per body:   " << std::setprecision(1)
+              << (dur.count() * 1000.0 / num_bodies) << " ns" << std::endl;
+    std::cout << "Bandwidth:  " << std::setprecision(1)
+              << (total_bytes / secs / 1048576.0) << " MB/s" << std::endl;
+    std::cout << "Checksum:   " << checksum << std::endl;
+
+    report.param("bodies", num_bodies);
+    report.metric("parse_rate", num_bodies / secs, "bodies/s");
+    report.metric("ns_per_body", dur.count() * 1000.0 / num_bodies, "ns");
+    report.metric("bandwidth", total_bytes / secs / 1048576.0, "MB/s");
+    return report.write() ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+// =============================================================================
+// FILE: tests/perf/load_test_pipeline.cpp
+//
+// Full pipeline on the in-process stubs: SUBSCRIBE -> 200 OK + initial
+// NOTIFY, presence feed bytes -> parser -> router -> workers -> NOTIFY, and
+// a refresh of every dialog.  The workload comes from the fixed-seed
+// generator, so two runs with the same arguments do the same work.
+//
+// Run: ./load_test_pipeline [subscriptions] [calls] [feed_rate] [workers] [seed] [--json FILE]
+//      feed_rate is presence events per second (0 = as fast as the router
+//      takes them; latency then measures queueing, not service time)
+//      cmake --build <dir> --target bench_pipeline   (builds, runs, writes
+//      <dir>/bench/pipeline.json)
+// =============================================================================
+#include "bench/bench_harness.h"
+#include "common/config.h"
+#include "common/latency_histogram.h"
+#include "common/logger.h"
+#include "common/slow_event_logger.h"
+#include "dispatch/dialog_dispatcher.h"
+#include "persistence/mongo_client.h"
+#include "persistence/subscription_store.h"
+#include "presence/presence_event_router.h"
+#include "presence/presence_xml_parser.h"
+#include "sip/sip_event.h"
+#include "sip/sip_stack_manager.h"
+#include "subscription/blf_subscription_index.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace sip_processor;
+using namespace std::chrono;
+
+static std::unique_ptr<SipEvent> make_subscribe(const bench::WatcherDialog& d, uint64_t n, uint32_t cseq) {
+    auto ev = std::make_unique<SipEvent>();
+    ev->id = SipEvent::next_id();
+    ev->dialog_id = d.dialog_id;
+    ev->tenant_id = d.tenant;
+    ev->category = SipEventCategory::kSubscribe;
+    ev->source = SipEventSource::kSipStack;
+    ev->sub_type = SubscriptionType::kBLF;
+    ev->direction = SipDirection::kIncoming;
+    ev->nua_event = nua_i_subscribe;
+    ev->event_header = "dialog";
+    ev->call_id = d.call_id;
+    ev->from_uri = d.watcher_uri;
+    ev->from_tag = d.from_tag;
+    ev->to_uri = d.monitored_uri;
+    ev->contact_uri = d.watcher_uri;
+    ev->cseq = cseq;
+    ev->expires = 3600;
+    ev->has_expires = true;
+    ev->subscription_state = "active";
+    ev->nua_handle = bench::fake_handle(n);
+    ev->created_at = Clock::now();
+    return ev;
+}
+
+// Retries while the owner's lane is full, as the SIP stack would
+static void dispatch_all(DialogDispatcher& dispatcher, const bench::Workload& w, uint32_t cseq) {
+    const auto& dialogs = w.dialogs();
+    for (size_t i = 0; i < dialogs.size(); ++i) {
+        while (dispatcher.dispatch(make_subscribe(dialogs[i], i, cseq)) == Result::kCapacityExceeded) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+template <typename Pred>
+static double wait_ms(steady_clock::time_point start, Pred done) {
+    while (!done() && steady_clock::now() - start < seconds(120)) std::this_thread::sleep_for(microseconds(200));
+    return duration_cast<microseconds>(steady_clock::now() - start).count() / 1000.0;
+}
+
+static uint64_t sum_workers(const DialogDispatcher& d, std::atomic<uint64_t> WorkerStats::*field) {
+    uint64_t n = 0;
+    for (size_t i = 0; i < d.num_workers(); ++i) n += (d.worker(i).stats().*field).load();
+    return n;
+}
+
+int main(int argc, char* argv[]) {
+    bench::Report report("pipeline", argc, argv);
+    bench::WorkloadSpec spec;
+    spec.subscriptions = (argc > 1) ? atoi(argv[1]) : 20000;
+    spec.calls         = (argc > 2) ? atoi(argv[2]) : 5000;
+    double feed_rate   = (argc > 3) ? atof(argv[3]) : 1000;
+    int workers        = (argc > 4) ? atoi(argv[4]) : 0;
+    if (argc > 5) spec.seed = strtoull(argv[5], nullptr, 10);
+
+    Logger::instance().set_level(LogLevel::kError);
+    Config config = Config::load_defaults();
+    if (workers > 0) config.num_workers = static_cast<size_t>(workers);
+    config.max_subscriptions_per_tenant = 1000000;
+    config.max_dialogs_per_worker = 5000000;
+    config.mongo_enable_persistence = true;   // Against the stub MongoPool
+
+    auto gen_start = steady_clock::now();
+    bench::Workload workload(spec);
+    std::string stream = workload.presence_stream();
+    double gen_ms = duration_cast<microseconds>(steady_clock::now() - gen_start).count() / 1000.0;
+
+    std::cout << "=== Pipeline Benchmark ===" << std::endl;
+    std::cout << "Seed " << spec.seed << ": " << spec.tenants << " tenants, "
+              << workload.dialogs().size() << " BLF dialogs (max fan-out " << workload.max_fanout() << "), "
+              << spec.calls << " calls / " << workload.call_events().size() << " presence events ("
+              << stream.size() / 1024 << " KiB), " << config.num_workers << " workers" << std::endl;
+
+    auto slow_logger = std::make_shared<SlowEventLogger>(config);
+    auto mongo = std::make_shared<MongoClient>(config);
+    if (mongo->connect() != Result::kOk) { std::cerr << "Stub MongoDB failed to connect" << std::endl; return 1; }
+    auto sub_store = std::make_shared<SubscriptionStore>(config, mongo);
+    sub_store->start();
+    SipStackManager stack(config);
+    stack.start();
+    BlfSubscriptionIndex::instance().configure_prefilter(config.presence_watcher_prefilter);
+    DialogDispatcher dispatcher(config, slow_logger, sub_store, &stack);
+    dispatcher.start();
+    PresenceEventRouter router(config, dispatcher, slow_logger);
+    router.start();
+    auto& sip = bench::stub_sip_stats();
+    const uint64_t dialogs = workload.dialogs().size();
+
+    // ─── SUBSCRIBE: 200 OK and the initial NOTIFY for every dialog ───
+    auto sub_start = steady_clock::now();
+    dispatch_all(dispatcher, workload, 1);
+    double sub_ms = wait_ms(sub_start, [&] { return sip.notifies.load() >= dialogs; });
+    uint64_t active = dispatcher.aggregate_stats().total_dialogs_active;
+
+    // ─── Presence feed: bytes in TCP-sized reads, parsed and routed ───
+    LatencyRecorder::instance().reset();
+    uint64_t notifies_before = sip.notifies.load();
+    PresenceXmlParser parser;
+    uint64_t fed = 0;
+    auto feed_start = steady_clock::now();
+    constexpr size_t kReadSize = 16 * 1024;
+    for (size_t off = 0; off < stream.size(); off += kReadSize) {
+        auto parsed = parser.feed(stream.data() + off, std::min(kReadSize, stream.size() - off));
+        for (auto& ev : parsed.events) {
+            if (feed_rate > 0) {
+                std::this_thread::sleep_until(feed_start + duration_cast<steady_clock::duration>(
+                    duration<double>(static_cast<double>(fed) / feed_rate)));
+                ev.received_at = Clock::now();
+            }
+            while (router.stats().queue_depth.load(std::memory_order_relaxed) > 50000) std::this_thread::yield();
+            router.on_call_state_event(std::move(ev));
+            ++fed;
+        }
+    }
+    double issue_ms = duration_cast<microseconds>(steady_clock::now() - feed_start).count() / 1000.0;
+    double feed_ms = wait_ms(feed_start, [&] {
+        if (router.stats().events_processed.load() < fed) return false;
+        uint64_t done = sum_workers(dispatcher, &WorkerStats::presence_triggers_processed) +
+                        sum_workers(dispatcher, &WorkerStats::presence_coalesced);
+        return done >= router.stats().notifications_generated.load();
+    });
+    uint64_t presence_notifies = sip.notifies.load() - notifies_before;
+    auto p2n = LatencyRecorder::instance().snapshot(LatencyStage::kPresenceToNotify);
+
+    // ─── Refresh: every dialog re-SUBSCRIBEs on the fast path ───
+    uint64_t responses_before = sip.subscribe_responses.load();
+    auto refresh_start = steady_clock::now();
+    dispatch_all(dispatcher, workload, 2);
+    double refresh_ms = wait_ms(refresh_start, [&] { return sip.subscribe_responses.load() - responses_before >= dialogs; });
+
+    router.stop();
+    dispatcher.stop();
+    sub_store->stop();
+    stack.stop();
+    auto& mongo_ops = bench::stub_mongo_stats();
+
+    auto per_sec = [](double n, double ms) { return ms > 0 ? n * 1000.0 / ms : 0.0; };
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Workload generated:  " << gen_ms << " ms" << std::endl;
+    std::cout << "SUBSCRIBE:           " << active << " active in " << sub_ms << " ms ("
+              << per_sec(dialogs, sub_ms) << " dialogs/s)" << std::endl;
+    std::cout << "Presence feed:       " << fed << " events in " << issue_ms << " ms" << std::endl;
+    std::cout << "Presence -> NOTIFY:  " << presence_notifies << " NOTIFYs in " << feed_ms << " ms ("
+              << per_sec(presence_notifies, feed_ms) << " NOTIFY/s)" << std::endl;
+    std::cout << "  latency us:        p50 " << p2n.percentile(50) / 1000.0 << "  p99 "
+              << p2n.percentile(99) / 1000.0 << "  max " << p2n.max / 1000.0 << std::endl;
+    std::cout << "Refresh:             " << dialogs << " in " << refresh_ms << " ms ("
+              << per_sec(dialogs, refresh_ms) << " refreshes/s)" << std::endl;
+    std::cout << "Stub MongoDB:        " << mongo_ops.inserts.load() << " inserts, "
+              << mongo_ops.deletes.load() << " deletes" << std::endl;
+
+    report.param("seed", static_cast<double>(spec.seed));
+    report.param("subscriptions", spec.subscriptions);
+    report.param("calls", spec.calls);
+    report.param("feed_rate", feed_rate);
+    report.param("workers", static_cast<double>(config.num_workers));
+    report.metric("subscribe_rate", per_sec(dialogs, sub_ms), "dialogs/s");
+    report.metric("dialogs_active", static_cast<double>(active), "dialogs");
+    report.metric("presence_events", static_cast<double>(fed), "events");
+    report.metric("presence_feed_ms", issue_ms, "ms");
+    report.metric("presence_notifies", static_cast<double>(presence_notifies), "notifies");
+    report.metric("notify_rate", per_sec(presence_notifies, feed_ms), "notifies/s");
+    report.metric("presence_to_notify_p50", p2n.percentile(50) / 1000.0, "us");
+    report.metric("presence_to_notify_p99", p2n.percentile(99) / 1000.0, "us");
+    report.metric("presence_to_notify_max", p2n.max / 1000.0, "us");
+    report.metric("refresh_rate", per_sec(dialogs, refresh_ms), "refreshes/s");
+    report.metric("mongo_inserts", static_cast<double>(mongo_ops.inserts.load()), "ops");
+    if (!report.write()) return 1;
+    return active == dialogs ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+// =============================================================================
+// FILE: tests/perf/load_test_presence_client.cpp
+//
+// Compares the presence feed receive paths ([presence] io_backend = poll
+// and io_uring).  A forked feeder streams the same CallStateEvents over
+// loopback in both runs, so the client process's rusage is the cost of
+// receiving, parsing and delivering them.  Reports read syscalls and CPU
+// microseconds per event.
+//
+// Run: ./load_test_presence_client [num_events] [burst] [--json FILE]
+//      burst = events per write (default 8)
+// =============================================================================
+#include "bench/bench_harness.h"
+#include "common/config.h"
+#include "common/logger.h"
+#include "presence/presence_tcp_client.h"
+#include "presence/presence_failover_manager.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace sip_processor;
+using namespace std::chrono;
+
+static std::string call_event(int i) {
+    return "<CallStateEvent><CallId>call-" + std::to_string(i) + "</CallId>"
+           "<CallerUri>sip:100@load.test.com</CallerUri><CalleeUri>sip:200@load.test.com</CalleeUri>"
+           "<State>" + std::string((i & 1) ? "confirmed" : "terminated") + "</State>"
+           "<Direction>inbound</Direction><TenantId>load.test.com</TenantId></CallStateEvent>\n";
+}
+
+// Child: accepts the client and writes the feed in bursts
+static void feed(int listener, int num_events, int burst) {
+    int conn = accept(listener, nullptr, nullptr);
+    if (conn < 0) _exit(1);
+    std::string chunk;
+    for (int i = 0; i < num_events; ++i) {
+        chunk += call_event(i);
+        if ((i + 1) % burst != 0 && i + 1 != num_events) continue;
+        size_t off = 0;
+        while (off < chunk.size()) {
+            ssize_t n = write(conn, chunk.data() + off, chunk.size() - off);
+            if (n <= 0) _exit(1);
+            off += static_cast<size_t>(n);
+        }
+        chunk.clear();
+    }
+    // Held open until the client has read everything
+    char c;
+    while (read(conn, &c, 1) > 0) {}
+    _exit(0);
+}
+
+static double cpu_us(const rusage& ru) {
+    return ru.ru_utime.tv_sec * 1e6 + ru.ru_utime.tv_usec + ru.ru_stime.tv_sec * 1e6 + ru.ru_stime.tv_usec;
+}
+
+struct RunResult {
+    uint64_t events = 0;
+    uint64_t syscalls = 0;
+    double cpu_us = 0;
+    double secs = 0;
+};
+
+static RunResult run(Config config, const std::string& backend, int num_events, int burst) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    listen(listener, 1);
+    socklen_t len = sizeof(addr);
+    getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len);
+
+    pid_t child = fork();
+    if (child == 0) feed(listener, num_events, burst);
+    close(listener);
+
+    config.presence_servers = {{"127.0.0.1", ntohs(addr.sin_port)}};
+    config.presence_io_backend = backend;
+    PresenceTcpClient client(config, std::make_shared<PresenceFailoverManager>(config));
+    std::atomic<uint64_t> delivered{0};
+    client.set_event_callback([&](CallStateEvent&&) { delivered.fetch_add(1, std::memory_order_relaxed); });
+
+    rusage before{}, after{};
+    getrusage(RUSAGE_SELF, &before);
+    auto start = steady_clock::now();
+    client.start();
+    while (delivered.load() < static_cast<uint64_t>(num_events) &&
+           steady_clock::now() - start < seconds(120)) {
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    RunResult r;
+    r.secs = duration_cast<microseconds>(steady_clock::now() - start).count() / 1e6;
+    getrusage(RUSAGE_SELF, &after);
+    r.events = delivered.load();
+    r.syscalls = client.stats().read_syscalls.load();
+    r.cpu_us = cpu_us(after) - cpu_us(before);
+
+    client.stop();
+    waitpid(child, nullptr, 0);
+    return r;
+}
+
+static void print_run(const std::string& name, const RunResult& r, bench::Report& report) {
+    double events = std::max<double>(static_cast<double>(r.events), 1.0);
+    report.metric(name + "_rate", r.events / r.secs, "events/s");
+    report.metric(name + "_syscalls_per_event", r.syscalls / events, "syscalls");
+    report.metric(name + "_cpu_us_per_event", r.cpu_us / events, "us");
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed
+              << std::setw(10) << r.events << " events  "
+              << std::setprecision(0) << std::setw(10) << (r.events / r.secs) << " events/sec  "
+              << std::setprecision(4) << std::setw(7) << (r.syscalls / events) << " syscalls/event  "
+              << std::setprecision(2) << std::setw(7) << (r.cpu_us / events) << " CPU us/event" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    bench::Report report("presence_client", argc, argv);
+    int num_events = (argc > 1) ? atoi(argv[1]) : 1000000;
+    int burst      = (argc > 2) ? std::max(1, atoi(argv[2])) : 8;
+
+    Logger::instance().set_level(LogLevel::kError);
+    Config config = Config::load_defaults();
+    config.presence_heartbeat_interval = Seconds(60);
+
+    std::cout << "=== Presence Client Receive Load Test ===" << std::endl;
+    std::cout << "Events: " << num_events << " (" << burst << " per write)" << std::endl;
+
+    print_run("poll", run(config, "poll", num_events, burst), report);
+    print_run("io_uring", run(config, "io_uring", num_events, burst), report);
+
+    report.param("events", num_events);
+    report.param("burst", burst);
+    return report.write() ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+// =============================================================================
+// FILE: tests/perf/load_test_presence_distribution.cpp
+//
+// Multi-process harness for the presence distributor.  Forks N node
+// processes, each a PresenceTcpClient connected to one distributor, and
+// replays the same call-state events twice: once with no node publishing
+// interest (every node parses the whole feed, as without a distributor)
+// and once with each node publishing a Bloom filter of its own watched
+// URIs.  Reports per-node events parsed and CPU for both runs.
+//
+// Run: ./load_test_presence_distribution [num_events] [nodes] [watched_pct] [--json FILE]
+//      watched_pct = share of the URI space with a watcher somewhere
+// =============================================================================
+#include "bench/bench_harness.h"
+#include "common/config.h"
+#include "common/logger.h"
+#include "presence/interest_filter.h"
+#include "presence/presence_distributor.h"
+#include "presence/presence_failover_manager.h"
+#include "presence/presence_tcp_client.h"
+#include "subscription/blf_subscription_index.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sip_processor;
+using namespace std::chrono;
+
+static const int kUriSpace = 100000;
+
+static std::string uri(int ext) { return "sip:" + std::to_string(ext) + "@dist.load.com"; }
+
+struct NodeResult {
+    uint64_t events = 0;
+    uint64_t bytes = 0;
+    double cpu_us = 0;
+};
+
+static double cpu_us() {
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec * 1e6 + ru.ru_utime.tv_usec + ru.ru_stime.tv_sec * 1e6 + ru.ru_stime.tv_usec;
+}
+
+// Child: waits for the distributor port, connects, optionally publishes
+// interest in the extensions it owns, and reports once told to
+static void node_main(int index, int nodes, int watched, bool publish, int control, int result) {
+    uint16_t port = 0;
+    if (read(control, &port, sizeof(port)) != sizeof(port)) _exit(1);
+
+    Config cfg;
+    cfg.presence_servers = {{"127.0.0.1", port}};
+    cfg.presence_heartbeat_interval = Seconds(60);
+    PresenceTcpClient client(cfg, std::make_shared<PresenceFailoverManager>(cfg));
+    client.set_event_callback([](CallStateEvent&&) {});
+    if (publish) {
+        std::vector<std::string> mine;
+        for (int ext = index; ext < watched; ext += nodes) mine.push_back(BlfSubscriptionIndex::normalize_uri(uri(ext)));
+        client.publish_interest(InterestFilter::for_uris(mine, 10).to_message());
+    }
+
+    double start = cpu_us();
+    client.start();
+    char go;
+    if (read(control, &go, 1) != 1) _exit(1);
+    NodeResult r;
+    r.cpu_us = cpu_us() - start;
+    r.events = client.stats().events_received.load();
+    r.bytes = client.stats().bytes_received.load();
+    if (write(result, &r, sizeof(r)) != sizeof(r)) _exit(1);
+    client.stop();
+    _exit(0);
+}
+
+static std::vector<NodeResult> run(int num_events, int nodes, int watched, bool publish) {
+    std::vector<int> control(nodes), results(nodes);
+    std::vector<pid_t> pids;
+    // Children are forked before this process starts any thread
+    for (int i = 0; i < nodes; ++i) {
+        int c[2], r[2];
+        if (pipe(c) != 0 || pipe(r) != 0) { perror("pipe"); exit(1); }
+        pid_t pid = fork();
+        if (pid == 0) node_main(i, nodes, watched, publish, c[0], r[1]);
+        close(c[0]); close(r[1]);
+        control[i] = c[1];
+        results[i] = r[0];
+        pids.push_back(pid);
+    }
+
+    Config cfg;
+    cfg.distributor_bind_address = "127.0.0.1";
+    cfg.distributor_listen_port = 0;
+    cfg.presence_heartbeat_interval = Seconds(60);
+    cfg.distributor_max_node_backlog = size_t(1) << 30;
+    PresenceDistributor dist(cfg);
+    if (dist.start() != Result::kOk) { std::cerr << "Distributor failed to start" << std::endl; exit(1); }
+    uint16_t port = dist.port();
+    for (int fd : control) if (write(fd, &port, sizeof(port)) != sizeof(port)) exit(1);
+
+    auto ready = steady_clock::now();
+    while ((dist.stats().nodes_connected.load() < static_cast<uint64_t>(nodes) ||
+            (publish && dist.stats().interest_updates.load() < static_cast<uint64_t>(nodes))) &&
+           steady_clock::now() - ready < seconds(30)) {
+        std::this_thread::sleep_for(milliseconds(5));
+    }
+
+    // Fixed seed: both runs see the same calls
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> ext(0, kUriSpace - 1);
+    for (int i = 0; i < num_events; ++i) {
+        CallStateEvent ev;
+        ev.presence_call_id = "call-" + std::to_string(i);
+        ev.caller_uri = uri(ext(rng));
+        ev.callee_uri = uri(ext(rng));
+        ev.state = (i & 1) ? CallState::kConfirmed : CallState::kTerminated;
+        ev.direction = "inbound";
+        ev.tenant_id = "dist.load.com";
+        ev.is_valid = true;
+        dist.on_call_state_event(ev);
+    }
+    std::this_thread::sleep_for(seconds(1));
+
+    std::vector<NodeResult> out(nodes);
+    for (int i = 0; i < nodes; ++i) {
+        char go = 1;
+        if (write(control[i], &go, 1) != 1 || read(results[i], &out[i], sizeof(NodeResult)) != sizeof(NodeResult)) {
+            std::cerr << "Node " << i << " did not report" << std::endl;
+        }
+        close(control[i]); close(results[i]);
+    }
+    for (pid_t pid : pids) waitpid(pid, nullptr, 0);
+    dist.stop();
+    return out;
+}
+
+static void print_run(const std::string& name, const std::vector<NodeResult>& rs, int num_events,
+                      bench::Report& report) {
+    uint64_t events = 0;
+    double cpu = 0;
+    for (const auto& r : rs) { events += r.events; cpu += r.cpu_us; }
+    double n = static_cast<double>(rs.size());
+    report.metric(name + "_feed_pct", 100.0 * events / n / num_events, "%");
+    report.metric(name + "_cpu_us_per_node", cpu / n, "us");
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << (events / n) << " events/node  "
+              << std::setw(6) << (100.0 * events / n / num_events) << "% of feed  "
+              << std::setprecision(0) << std::setw(9) << (cpu / n) << " CPU us/node" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    bench::Report report("presence_distribution", argc, argv);
+    int num_events  = (argc > 1) ? atoi(argv[1]) : 200000;
+    int nodes       = (argc > 2) ? std::max(1, atoi(argv[2])) : 4;
+    int watched_pct = (argc > 3) ? atoi(argv[3]) : 10;
+    int watched = kUriSpace * std::min(100, std::max(0, watched_pct)) / 100;
+
+    Logger::instance().set_level(LogLevel::kError);
+    std::cout << "=== Presence Distribution Load Test ===" << std::endl;
+    std::cout << "Events: " << num_events << "  Nodes: " << nodes
+              << "  Watched URIs: " << watched << " of " << kUriSpace << std::endl;
+
+    auto full = run(num_events, nodes, watched, false);
+    auto filtered = run(num_events, nodes, watched, true);
+    print_run("full", full, num_events, report);
+    print_run("filtered", filtered, num_events, report);
+
+    double full_cpu = 0, filtered_cpu = 0;
+    for (const auto& r : full) full_cpu += r.cpu_us;
+    for (const auto& r : filtered) filtered_cpu += r.cpu_us;
+    if (full_cpu > 0) {
+        std::cout << "Node CPU reduction: " << std::setprecision(1)
+                  << (100.0 * (1.0 - filtered_cpu / full_cpu)) << "%" << std::endl;
+        report.metric("node_cpu_reduction", 100.0 * (1.0 - filtered_cpu / full_cpu), "%");
+    }
+
+    report.param("events", num_events);
+    report.param("nodes", nodes);
+    report.param("watched_pct", watched_pct);
+    return report.write() ? 0 : 1;
+}
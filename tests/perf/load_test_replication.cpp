@@ -0,0 +1,172 @@
+// =============================================================================
+// FILE: tests/perf/load_test_replication.cpp
+//
+// Two-process harness for hot-standby replication on localhost.  The parent
+// is the primary (a ReplicationSender fed as SubscriptionStore would feed
+// it); a forked child is the standby (a DialogDispatcher plus
+// ReplicationReceiver).  Measures the initial full sync, the delta stream
+// and how long the standby takes to notice the primary is gone, and checks
+// the standby still holds every subscription at that point.
+//
+// Run: ./load_test_replication [num_subscriptions] [num_deltas] [workers] [--json FILE]
+// =============================================================================
+#include "bench/bench_harness.h"
+#include "persistence/subscription_replication.h"
+#include "dispatch/dialog_dispatcher.h"
+#include "common/slow_event_logger.h"
+#include "common/logger.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace sip_processor;
+using namespace std::chrono;
+
+struct StandbyResult {
+    double sync_ms = 0;
+    double deltas_ms = 0;
+    double detect_ms = 0;
+    uint64_t dialogs_after_loss = 0;
+};
+
+static SubscriptionRecord record(int i, uint32_t version) {
+    SubscriptionRecord rec;
+    rec.dialog_id = "repl-load-" + std::to_string(i);
+    rec.tenant_id = TenantId("repl.load.com");
+    rec.type = SubscriptionType::kBLF;
+    rec.lifecycle = SubLifecycle::kActive;
+    rec.blf_monitored_uri = Symbol("sip:" + std::to_string(i % 5000) + "@repl.load.com");
+    rec.blf_last_state = "confirmed";
+    rec.notify_cseq = version;
+    rec.blf_notify_version = version;
+    rec.expires_at = Clock::now() + Seconds(3600);
+    rec.from_uri = "sip:watcher" + std::to_string(i) + "@repl.load.com";
+    rec.call_id = "call-" + std::to_string(i);
+    return rec;
+}
+
+template <typename Pred>
+static double wait_ms(Pred pred) {
+    auto start = steady_clock::now();
+    while (!pred() && steady_clock::now() - start < seconds(60)) std::this_thread::sleep_for(microseconds(200));
+    return duration_cast<microseconds>(steady_clock::now() - start).count() / 1000.0;
+}
+
+static void standby_main(int subs, int deltas, size_t workers, int control, int result) {
+    uint16_t port = 0;
+    if (read(control, &port, sizeof(port)) != sizeof(port)) _exit(1);
+
+    Config cfg;
+    cfg.num_workers = workers;
+    cfg.mongo_enable_persistence = false;
+    cfg.max_subscriptions_per_tenant = subs + 1;
+    cfg.replication_role = ReplicationRole::kStandby;
+    cfg.replication_primary_port = port;
+    DialogDispatcher dispatcher(cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    dispatcher.start();
+    ReplicationReceiver receiver(cfg, dispatcher);
+    auto applied = [&] {
+        uint64_t n = 0;
+        for (size_t w = 0; w < dispatcher.num_workers(); ++w) n += dispatcher.worker(w).stats().replicated_applied.load();
+        return n;
+    };
+
+    StandbyResult r;
+    receiver.start();
+    r.sync_ms = wait_ms([&] { return dispatcher.aggregate_stats().total_dialogs_active >= static_cast<uint64_t>(subs); });
+
+    char go;
+    if (read(control, &go, 1) != 1) _exit(1);
+    r.deltas_ms = wait_ms([&] { return applied() >= static_cast<uint64_t>(subs + deltas); });
+    if (write(result, &go, 1) != 1) _exit(1);
+
+    if (read(control, &go, 1) != 1) _exit(1);
+    r.detect_ms = wait_ms([&] { return !receiver.is_connected(); });
+    r.dialogs_after_loss = dispatcher.aggregate_stats().total_dialogs_active;
+    if (write(result, &r, sizeof(r)) != sizeof(r)) _exit(1);
+
+    receiver.stop();
+    dispatcher.stop();
+    _exit(0);
+}
+
+int main(int argc, char* argv[]) {
+    bench::Report report("replication", argc, argv);
+    int subs       = (argc > 1) ? atoi(argv[1]) : 200000;
+    int deltas     = (argc > 2) ? atoi(argv[2]) : 500000;
+    size_t workers = (argc > 3) ? static_cast<size_t>(atoi(argv[3])) : 4;
+
+    Logger::instance().set_level(LogLevel::kError);
+    std::cout << "=== Replication Load Test ===" << std::endl;
+    std::cout << "Subscriptions: " << subs << "  Deltas: " << deltas << "  Standby workers: " << workers << std::endl;
+
+    // The standby is forked before this process starts any thread
+    int c[2], r[2];
+    if (pipe(c) != 0 || pipe(r) != 0) { perror("pipe"); return 1; }
+    pid_t pid = fork();
+    if (pid == 0) { close(c[1]); close(r[0]); standby_main(subs, deltas, workers, c[0], r[1]); }
+    close(c[0]); close(r[1]);
+
+    Config cfg;
+    cfg.replication_bind_address = "127.0.0.1";
+    cfg.replication_listen_port = 0;
+    cfg.replication_max_backlog = size_t(1) << 30;
+    auto primary = std::make_unique<ReplicationSender>(cfg);
+    if (primary->start() != Result::kOk) { std::cerr << "Primary failed to listen" << std::endl; return 1; }
+    for (int i = 0; i < subs; ++i) primary->on_upsert(record(i, 1));
+
+    uint16_t port = primary->port();
+    if (write(c[1], &port, sizeof(port)) != sizeof(port)) return 1;
+    while (primary->stats().full_syncs.load() == 0) std::this_thread::sleep_for(milliseconds(1));
+
+    // Deltas as workers would issue them: every NOTIFY bumps CSeq and version
+    char go = 1;
+    if (write(c[1], &go, 1) != 1) return 1;
+    auto start = steady_clock::now();
+    for (int i = 0; i < deltas; ++i) {
+        primary->on_upsert(record(i % subs, 2 + i / subs));
+        // Workers pause between cycles; a tight loop would starve the
+        // sender thread of the lock on a small machine
+        if (i % 256 == 255) std::this_thread::yield();
+    }
+    double issue_ms = duration_cast<microseconds>(steady_clock::now() - start).count() / 1000.0;
+    if (read(r[0], &go, 1) != 1) { std::cerr << "Standby did not apply the deltas" << std::endl; return 1; }
+
+    // Primary loss: the standby must notice and keep everything
+    if (write(c[1], &go, 1) != 1) return 1;
+    uint64_t sent = primary->stats().bytes_sent.load();
+    primary.reset();
+
+    StandbyResult res;
+    if (read(r[0], &res, sizeof(res)) != sizeof(res)) { std::cerr << "Standby did not report" << std::endl; return 1; }
+    waitpid(pid, nullptr, 0);
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Full sync:        " << res.sync_ms << " ms (" << (subs / std::max(0.001, res.sync_ms)) << " subs/ms)" << std::endl;
+    std::cout << "Deltas issued:    " << issue_ms << " ms on the primary ("
+              << (1000.0 * issue_ms / std::max(1, deltas)) << " us each)" << std::endl;
+    std::cout << "Deltas applied:   " << res.deltas_ms << " ms on the standby" << std::endl;
+    std::cout << "Bytes streamed:   " << sent << " (" << (static_cast<double>(sent) / std::max(1, subs + deltas))
+              << " per change)" << std::endl;
+    std::cout << "Loss detected:    " << res.detect_ms << " ms after the primary stopped" << std::endl;
+    std::cout << "Held for takeover: " << res.dialogs_after_loss << " of " << subs << std::endl;
+
+    report.param("subscriptions", subs);
+    report.param("deltas", deltas);
+    report.param("workers", static_cast<double>(workers));
+    report.metric("full_sync_ms", res.sync_ms, "ms");
+    report.metric("delta_issue_us", 1000.0 * issue_ms / std::max(1, deltas), "us");
+    report.metric("delta_apply_ms", res.deltas_ms, "ms");
+    report.metric("bytes_per_change", static_cast<double>(sent) / std::max(1, subs + deltas), "bytes");
+    report.metric("loss_detect_ms", res.detect_ms, "ms");
+    if (!report.write()) return 1;
+    return res.dialogs_after_loss == static_cast<uint64_t>(subs) ? 0 : 1;
+}
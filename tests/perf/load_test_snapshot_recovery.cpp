@@ -0,0 +1,201 @@
+// =============================================================================
+// FILE: tests/perf/load_test_snapshot_recovery.cpp
+//
+// Compares warm-restart recovery from the local snapshot + journal against a
+// cold load from MongoDB at large subscription counts.
+//
+//   Phase 1: generate N synthetic BLF/MWI records
+//   Phase 2: write them through the journal and compact into a snapshot
+//   Phase 3: snapshot recovery (mmap + parallel decode) at 1 and T threads
+//   Phase 4: journal-only recovery (10% of records changed since snapshot)
+//   Phase 5: cold MongoDB recovery via load_active_subscriptions (optional —
+//            only when a MongoDB URI is given; --seed inserts the records)
+//
+// Build:
+//   cmake --build <dir> --target load_test_snapshot_recovery   (<dir>/bench/)
+//   The bench build links the in-memory MongoPool stub, so Phase 5 times
+//   the SubscriptionStore path only; build against the real pool for a
+//   MongoDB comparison.
+//
+// Run:
+//   ./load_test_snapshot_recovery [num_subs] [threads] [dir] [mongo_uri] [--seed] [--json FILE]
+// =============================================================================
+#include "bench/bench_harness.h"
+#include "common/config.h"
+#include "common/logger.h"
+#include "persistence/local_snapshot_store.h"
+#include "persistence/mongo_client.h"
+#include "persistence/subscription_store.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <sys/stat.h>
+
+using namespace sip_processor;
+using namespace std::chrono;
+
+static SubscriptionRecord make_record(size_t i, std::mt19937& rng) {
+    SubscriptionRecord rec;
+    rec.dialog_id = "call-" + std::to_string(i) + "@10.0.0.1;ft=" +
+                    std::to_string(rng()) + ";tt=" + std::to_string(rng());
+    rec.tenant_id = TenantId("tenant-" + std::to_string(i % 500) + ".example.com");
+    rec.type = (i % 10 == 0) ? SubscriptionType::kMWI : SubscriptionType::kBLF;
+    rec.lifecycle = SubLifecycle::kActive;
+    rec.expires_at = Clock::now() + Seconds(3600);
+    rec.updated_at_ms = wall_clock_ms();
+    rec.from_uri = "sip:" + std::to_string(1000 + i % 5000) + "@" + rec.tenant_id.str();
+    rec.to_uri = "sip:" + std::to_string(2000 + i % 5000) + "@" + rec.tenant_id.str();
+    rec.call_id = "call-" + std::to_string(i) + "@10.0.0.1";
+    rec.from_tag = std::to_string(rng());
+    rec.to_tag = std::to_string(rng());
+    rec.contact_uri = "sip:" + std::to_string(1000 + i % 5000) + "@10.1.2.3:5060";
+    if (rec.type == SubscriptionType::kBLF) {
+        rec.blf_monitored_uri = Symbol(rec.to_uri);
+        rec.blf_last_state = "confirmed";
+        rec.blf_notify_version = static_cast<uint32_t>(i % 100);
+        rec.blf_last_notify_body =
+            "<?xml version=\"1.0\"?>\n<dialog-info xmlns=\"urn:ietf:params:xml:ns:dialog-info\" "
+            "version=\"" + std::to_string(rec.blf_notify_version) + "\" state=\"full\" entity=\"" +
+            rec.to_uri + "\"><dialog id=\"x\"><state>confirmed</state></dialog></dialog-info>\n";
+    } else {
+        rec.mwi_account_uri = rec.to_uri;
+        rec.mwi_new_messages = static_cast<int>(i % 7);
+    }
+    return rec;
+}
+
+static double load_snapshot(const Config& cfg, size_t threads, size_t& count) {
+    LocalSnapshotStore store(cfg);
+    std::vector<SubscriptionRecord> out;
+    auto t0 = steady_clock::now();
+    store.load(out, threads);
+    count = out.size();
+    return duration<double, std::milli>(steady_clock::now() - t0).count();
+}
+
+int main(int argc, char* argv[]) {
+    bench::Report report("snapshot_recovery", argc, argv);
+    size_t num_subs  = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t threads   = (argc > 2) ? strtoull(argv[2], nullptr, 10) : std::thread::hardware_concurrency();
+    std::string dir  = (argc > 3) ? argv[3] : "/tmp/snapshot_bench";
+    std::string mongo_uri = (argc > 4) ? argv[4] : "";
+    bool seed_mongo  = (argc > 5) && std::strcmp(argv[5], "--seed") == 0;
+    if (threads == 0) threads = 4;
+
+    Logger::instance().set_level(LogLevel::kError);
+    ::mkdir(dir.c_str(), 0755);
+
+    Config cfg;
+    cfg.service_id = "bench";
+    cfg.snapshot_enabled = true;
+    cfg.snapshot_directory = dir;
+    cfg.snapshot_interval = Seconds(3600);
+
+    std::cout << "=== Snapshot vs MongoDB Recovery Benchmark ===" << std::endl;
+    std::cout << "Subscriptions: " << num_subs << ", Load threads: " << threads << std::endl;
+
+    // Phase 1: generate
+    std::mt19937 rng(42);
+    std::vector<SubscriptionRecord> records;
+    records.reserve(num_subs);
+    for (size_t i = 0; i < num_subs; ++i) records.push_back(make_record(i, rng));
+
+    // Phase 2: journal + compaction
+    {
+        LocalSnapshotStore store(cfg);
+        store.start();
+        auto t0 = steady_clock::now();
+        for (const auto& r : records) store.on_upsert(r);
+        auto journal_ms = duration<double, std::milli>(steady_clock::now() - t0).count();
+        t0 = steady_clock::now();
+        store.compact();
+        auto compact_ms = duration<double, std::milli>(steady_clock::now() - t0).count();
+        store.stop();
+
+        struct stat st{};
+        ::stat(store.snapshot_path().c_str(), &st);
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "\n--- Write ---" << std::endl;
+        std::cout << "Journal append:  " << journal_ms << " ms ("
+                  << (num_subs * 1000.0 / journal_ms) << " records/sec)" << std::endl;
+        std::cout << "Compaction:      " << compact_ms << " ms" << std::endl;
+        report.metric("journal_rate", num_subs * 1000.0 / journal_ms, "records/s");
+        report.metric("compact_ms", compact_ms, "ms");
+        report.metric("snapshot_bytes_per_record", num_subs ? static_cast<double>(st.st_size) / num_subs : 0, "bytes");
+        std::cout << "Snapshot size:   " << (st.st_size / (1024.0 * 1024.0)) << " MB ("
+                  << (num_subs ? st.st_size / static_cast<long>(num_subs) : 0) << " B/record)" << std::endl;
+    }
+
+    // Phase 3: snapshot recovery
+    std::cout << "\n--- Snapshot recovery ---" << std::endl;
+    size_t n1 = 0, nt = 0;
+    double single_ms = load_snapshot(cfg, 1, n1);
+    double multi_ms  = load_snapshot(cfg, threads, nt);
+    std::cout << "1 thread:        " << single_ms << " ms (" << n1 << " records)" << std::endl;
+    std::cout << threads << " threads:       " << multi_ms << " ms (" << nt << " records, "
+              << (single_ms / multi_ms) << "x)" << std::endl;
+    report.metric("snapshot_load_ms_1", single_ms, "ms");
+    report.metric("snapshot_load_ms", multi_ms, "ms");
+
+    // Phase 4: snapshot + journal overlay (10% churn since last snapshot)
+    {
+        LocalSnapshotStore store(cfg);
+        store.start();
+        for (size_t i = 0; i < num_subs; i += 10) {
+            records[i].blf_notify_version++;
+            store.on_upsert(records[i]);
+        }
+        store.compact();  // Folds the churn; re-append so the journal holds it
+        for (size_t i = 0; i < num_subs; i += 10) store.on_upsert(records[i]);
+        std::this_thread::sleep_for(cfg.snapshot_journal_flush_interval * 3);
+        size_t n = 0;
+        double ms = load_snapshot(cfg, threads, n);
+        std::cout << "With journal:    " << ms << " ms (" << n << " records, "
+                  << num_subs / 10 << " journal entries)" << std::endl;
+        report.metric("snapshot_journal_load_ms", ms, "ms");
+        store.stop();
+    }
+
+    // Phase 5: cold MongoDB recovery
+    std::cout << "\n--- MongoDB recovery ---" << std::endl;
+    if (mongo_uri.empty()) {
+        std::cout << "Skipped (pass a MongoDB URI as the 4th argument)" << std::endl;
+    } else {
+        cfg.mongo_uri = mongo_uri;
+        cfg.mongo_enable_persistence = true;
+        auto mongo = std::make_shared<MongoClient>(cfg);
+        if (mongo->connect() != Result::kOk) {
+            std::cout << "MongoDB connection failed" << std::endl;
+            return 1;
+        }
+        SubscriptionStore store(cfg, mongo);
+        if (seed_mongo) {
+            auto t0 = steady_clock::now();
+            for (const auto& r : records) store.save_immediately(r);
+            std::cout << "Seeded:          " << duration<double>(steady_clock::now() - t0).count()
+                      << " s" << std::endl;
+        }
+        std::vector<SubscriptionStore::StoredSubscription> out;
+        auto t0 = steady_clock::now();
+        store.load_active_subscriptions(out);
+        double mongo_ms = duration<double, std::milli>(steady_clock::now() - t0).count();
+        std::cout << "Cold load:       " << mongo_ms << " ms (" << out.size() << " records)" << std::endl;
+        std::cout << "Snapshot speedup: " << (mongo_ms / multi_ms) << "x" << std::endl;
+        report.metric("mongo_load_ms", mongo_ms, "ms");
+        mongo->disconnect();
+    }
+
+    LocalSnapshotStore cleanup(cfg);
+    std::remove(cleanup.snapshot_path().c_str());
+    std::remove(cleanup.journal_path().c_str());
+
+    report.param("subscriptions", static_cast<double>(num_subs));
+    report.param("threads", static_cast<double>(threads));
+    return report.write() ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+
+// =============================================================================
+// FILE: tests/perf/load_test_string_interner.cpp
+//
+// Measures what interning tenant ids and monitored URIs buys at scale:
+//
+//   Phase 1: resident memory of N registry entries + BLF index watchers
+//            (tenant/URI fields are Symbols)
+//   Phase 2: the tenant/URI fields as std::string copies vs as Symbols
+//   Phase 3: concurrent intern() throughput on an existing symbol set
+//
+// Build:
+//   cmake --build <dir> --target load_test_string_interner   (<dir>/bench/)
+//
+// Run:
+//   ./load_test_string_interner [num_subs] [num_tenants] [num_threads] [--json FILE]
+// =============================================================================
+#include "bench/bench_harness.h"
+#include "common/logger.h"
+#include "common/string_interner.h"
+#include "subscription/blf_subscription_index.h"
+#include "subscription/subscription_state.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sip_processor;
+using namespace std::chrono;
+
+static long rss_kb() {
+    std::ifstream f("/proc/self/status");
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0) return std::atol(line.c_str() + 6);
+    }
+    return 0;
+}
+
+static std::string tenant_name(size_t t) { return "tenant-" + std::to_string(t) + ".example.com"; }
+static std::string uri_name(size_t i, size_t t) {
+    return "sip:" + std::to_string(1000 + i % 200) + "@" + tenant_name(t);
+}
+
+int main(int argc, char* argv[]) {
+    bench::Report report("string_interner", argc, argv);
+    size_t num_subs    = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t num_tenants = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 500;
+    size_t num_threads = (argc > 3) ? strtoull(argv[3], nullptr, 10) : 4;
+    if (num_tenants == 0) num_tenants = 1;
+
+    Logger::instance().set_level(LogLevel::kError);
+
+    std::cout << "=== String Interner Benchmark ===" << std::endl;
+    std::cout << "Subscriptions: " << num_subs << ", Tenants: " << num_tenants
+              << ", Threads: " << num_threads << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    // Phase 1: registry + BLF index with interned fields
+    long base = rss_kb();
+    auto t0 = steady_clock::now();
+    auto& reg = SubscriptionRegistry::instance();
+    auto& idx = BlfSubscriptionIndex::instance();
+    for (size_t i = 0; i < num_subs; ++i) {
+        size_t t = i % num_tenants;
+        std::string did = "call-" + std::to_string(i) + "@10.0.0.1;ft=1;tt=2";
+        Symbol tenant(tenant_name(t));
+        Symbol uri(uri_name(i, t));
+        reg.register_subscription(did, {did, tenant, SubscriptionType::kBLF,
+                                        SubLifecycle::kActive, Clock::now(), i % 8, uri});
+        idx.add(uri, did, tenant);
+    }
+    double build_ms = duration<double, std::milli>(steady_clock::now() - t0).count();
+    long interned_kb = rss_kb() - base;
+
+    std::cout << "\n--- Interned ---" << std::endl;
+    std::cout << "Build:     " << build_ms << " ms" << std::endl;
+    report.metric("build_ms", build_ms, "ms");
+    report.metric("interned_bytes_per_sub", interned_kb * 1024.0 / num_subs, "bytes");
+    std::cout << "RSS delta: " << interned_kb / 1024.0 << " MB ("
+              << (interned_kb * 1024.0 / num_subs) << " B/subscription)" << std::endl;
+    std::cout << "Symbols:   " << StringInterner::instance().size() << " ("
+              << StringInterner::instance().bytes() / 1024 << " KB)" << std::endl;
+
+    // Phase 2: the tenant/URI copies the registry + index used to hold as
+    // std::string (registry tenant + URI, index tenant + URI)
+    struct StringFields { std::string tenant_id, monitored_uri, idx_tenant_id, idx_uri; };
+    base = rss_kb();
+    {
+        std::vector<StringFields> copies;
+        copies.reserve(num_subs);
+        for (size_t i = 0; i < num_subs; ++i) {
+            size_t t = i % num_tenants;
+            copies.push_back({tenant_name(t), uri_name(i, t), tenant_name(t), uri_name(i, t)});
+        }
+        long string_kb = rss_kb() - base;
+        std::cout << "\n--- Tenant/URI fields ---" << std::endl;
+        std::cout << "As std::string: " << string_kb / 1024.0 << " MB ("
+                  << (string_kb * 1024.0 / num_subs) << " B/subscription)" << std::endl;
+        std::cout << "As Symbol:      " << (num_subs * 4 * sizeof(Symbol)) / (1024.0 * 1024.0) << " MB ("
+                  << 4 * sizeof(Symbol) << " B/subscription) + "
+                  << StringInterner::instance().bytes() / 1024 << " KB shared" << std::endl;
+        report.metric("string_bytes_per_sub", string_kb * 1024.0 / num_subs, "bytes");
+    }
+
+    // Phase 3: concurrent re-intern of known strings (the hot path on every event)
+    std::vector<std::string> keys;
+    for (size_t t = 0; t < num_tenants; ++t) keys.push_back(tenant_name(t));
+    std::atomic<uint64_t> checksum{0};
+    constexpr size_t kOpsPerThread = 2000000;
+    t0 = steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t n = 0; n < num_threads; ++n) {
+        threads.emplace_back([&, n] {
+            uint64_t sum = 0;
+            for (size_t i = 0; i < kOpsPerThread; ++i) sum += Symbol(keys[(i + n) % keys.size()]).id();
+            checksum.fetch_add(sum);
+        });
+    }
+    for (auto& th : threads) th.join();
+    double secs = duration<double>(steady_clock::now() - t0).count();
+    std::cout << "\n--- Concurrent intern (existing) ---" << std::endl;
+    std::cout << "Throughput: " << (num_threads * kOpsPerThread / secs / 1e6) << " M ops/sec"
+              << " (checksum " << checksum.load() << ")" << std::endl;
+
+    report.param("subscriptions", static_cast<double>(num_subs));
+    report.param("tenants", static_cast<double>(num_tenants));
+    report.param("threads", static_cast<double>(num_threads));
+    report.metric("intern_rate", num_threads * kOpsPerThread / secs, "ops/s");
+    return report.write() ? 0 : 1;
+}
@@ -1,66 +1,116 @@
-
-// =============================================================================
-// FILE: tests/perf/presence_flood.py
-//
-// Simulates a presence TCP server flooding call state events.
-// Used to test presence feed throughput.
-//
-// Run: python3 presence_flood.py [port] [rate] [duration_sec]
-// =============================================================================
-/*
 #!/usr/bin/env python3
+# =============================================================================
+# FILE: tests/perf/presence_flood.py
+#
+# Simulates a presence TCP server flooding call state events, for feed
+# throughput tests against a running sip_processor.  Calls follow the
+# lifecycles bench::Workload generates (trying -> ringing -> confirmed ->
+# terminated, or abandoned after ringing), callees are Zipf-popular, and
+# tenants/URIs use the generator's layout (sip:<2000+n>@tenant-<t>.bench.example),
+# so a load_test_pipeline subscription set watches them.  A given seed
+# replays the same feed on every connection.
+#
+# Run: python3 presence_flood.py [port] [rate] [duration_sec] [seed]
+# =============================================================================
 """Presence TCP server simulator for load testing."""
 
+import bisect
+import random
 import socket
-import time
 import sys
-import random
 import threading
+import time
 
 PORT = int(sys.argv[1]) if len(sys.argv) > 1 else 9000
 RATE = int(sys.argv[2]) if len(sys.argv) > 2 else 10000  # events/sec
 DURATION = int(sys.argv[3]) if len(sys.argv) > 3 else 60
+SEED = int(sys.argv[4]) if len(sys.argv) > 4 else 42
+
+TENANTS = [f"tenant-{i}.bench.example" for i in range(20)]
+EXTENSIONS = 500
+CONCURRENT_CALLS = 64
+ABANDON_PCT = 20
+EXTERNAL_CALLER_PCT = 30
+ANSWERED = ["trying", "ringing", "confirmed", "terminated"]
+ABANDONED = ["trying", "ringing", "terminated"]
+
+
+def zipf_cdf(n, exponent=1.0):
+    weights = [1.0 / (i + 1) ** exponent for i in range(n)]
+    total = sum(weights)
+    cdf, acc = [], 0.0
+    for w in weights:
+        acc += w
+        cdf.append(acc / total)
+    return cdf
+
+
+POPULARITY = zipf_cdf(EXTENSIONS)
 
-STATES = ["trying", "ringing", "confirmed", "terminated"]
-TENANTS = [f"tenant-{i}.com" for i in range(100)]
 
-def make_event(call_id, state):
-    tenant = random.choice(TENANTS)
-    caller = random.randint(1000, 9999)
-    callee = random.randint(1000, 9999)
+def extension_uri(tenant, ext):
+    return f"sip:{2000 + ext}@{tenant}"
+
+
+def make_event(call, state):
     return (
         f"<CallStateEvent>"
-        f"<CallId>{call_id}</CallId>"
-        f"<CallerUri>sip:{caller}@{tenant}</CallerUri>"
-        f"<CalleeUri>sip:{callee}@{tenant}</CalleeUri>"
+        f"<CallId>{call['id']}</CallId>"
+        f"<CallerUri>{call['caller']}</CallerUri>"
+        f"<CalleeUri>{call['callee']}</CalleeUri>"
         f"<State>{state}</State>"
-        f"<Direction>inbound</Direction>"
-        f"<TenantId>{tenant}</TenantId>"
-        f"<Timestamp>{time.strftime('%Y-%m-%dT%H:%M:%SZ')}</Timestamp>"
+        f"<Direction>{call['direction']}</Direction>"
+        f"<TenantId>{call['tenant']}</TenantId>"
+        f"<Timestamp>{time.strftime('%Y-%m-%dT%H:%M:%SZ', time.gmtime())}</Timestamp>"
         f"</CallStateEvent>\n"
     )
 
+
+def call_events(rng):
+    """Endless interleaved call-state events from CONCURRENT_CALLS calls."""
+    started = 0
+
+    def start_call():
+        nonlocal started
+        tenant = rng.choice(TENANTS)
+        callee = min(bisect.bisect_left(POPULARITY, rng.random()), EXTENSIONS - 1)
+        if rng.randrange(100) < EXTERNAL_CALLER_PCT:
+            caller = f"sip:+1555{1000000 + rng.randrange(9000000)}@pstn.bench.example"
+        else:
+            caller = extension_uri(tenant, rng.randrange(EXTENSIONS))
+        started += 1
+        return {
+            "id": f"pcall-{started - 1}-{rng.getrandbits(32):08x}",
+            "tenant": tenant,
+            "caller": caller,
+            "callee": extension_uri(tenant, callee),
+            "direction": "inbound" if rng.randrange(2) else "outbound",
+            "states": list(ABANDONED if rng.randrange(100) < ABANDON_PCT else ANSWERED),
+        }
+
+    slots = [start_call() for _ in range(CONCURRENT_CALLS)]
+    while True:
+        i = rng.randrange(len(slots))
+        call = slots[i]
+        yield make_event(call, call["states"].pop(0))
+        if not call["states"]:
+            slots[i] = start_call()
+
+
 def handle_client(conn, addr):
     print(f"Client connected: {addr}")
+    events = call_events(random.Random(SEED))
     total_sent = 0
-    call_counter = 0
     start = time.time()
-    interval = 1.0 / RATE
+    batch_size = max(1, min(RATE // 10, 1000))  # Send in batches
+    next_heartbeat = start + 15
 
     try:
         # Send heartbeat first
         conn.sendall(b"<Heartbeat><Timestamp>now</Timestamp></Heartbeat>\n")
 
         while time.time() - start < DURATION:
-            batch = []
-            batch_size = min(RATE // 10, 1000)  # Send in batches
-
-            for _ in range(batch_size):
-                call_counter += 1
-                state = random.choice(STATES)
-                batch.append(make_event(f"call-{call_counter}", state))
-
-            data = "".join(batch).encode()
+            data = "".join(next(events) for _ in range(batch_size)).encode()
             conn.sendall(data)
             total_sent += batch_size
 
@@ -71,29 +121,32 @@ def handle_client(conn, addr):
                 time.sleep(expected - elapsed)
 
             # Periodic heartbeat
-            if total_sent % (RATE * 15) == 0:
+            if time.time() >= next_heartbeat:
                 conn.sendall(b"<Heartbeat><Timestamp>now</Timestamp></Heartbeat>\n")
+                next_heartbeat += 15
 
         elapsed = time.time() - start
         print(f"Sent {total_sent} events in {elapsed:.1f}s "
-              f"({total_sent/elapsed:.0f} events/sec)")
+              f"({total_sent / elapsed:.0f} events/sec)")
 
-    except BrokenPipeError:
+    except (BrokenPipeError, ConnectionResetError):
         print(f"Client {addr} disconnected")
     finally:
         conn.close()
 
+
 def main():
     server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
     server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
     server.bind(("0.0.0.0", PORT))
     server.listen(5)
-    print(f"Presence flood server on port {PORT}, rate={RATE}/s, duration={DURATION}s")
+    print(f"Presence flood server on port {PORT}, rate={RATE}/s, "
+          f"duration={DURATION}s, seed={SEED}")
 
     while True:
         conn, addr = server.accept()
         threading.Thread(target=handle_client, args=(conn, addr), daemon=True).start()
 
+
 if __name__ == "__main__":
     main()
-*/
\ No newline at end of file
@@ -17,6 +17,8 @@ protected:
         idx.remove_dialog("test-dialog-1");
         idx.remove_dialog("test-dialog-2");
         idx.remove_dialog("test-dialog-3");
+        idx.remove_dialog("test-dialog-4");
+        idx.set_uri_added_listener(nullptr);
     }
 };
 
@@ -42,7 +44,7 @@ TEST_F(BlfIndexTest, NormalizeAddsScheme) {
 
 TEST_F(BlfIndexTest, AddAndLookup) {
     auto& idx = BlfSubscriptionIndex::instance();
-    idx.add("sip:200@test.com", "test-dialog-1", "test.com");
+    idx.add(Symbol("sip:200@test.com"), "test-dialog-1", TenantId("test.com"));
 
     auto watchers = idx.lookup("sip:200@test.com");
     ASSERT_EQ(watchers.size(), 1u);
@@ -52,7 +54,7 @@ TEST_F(BlfIndexTest, AddAndLookup) {
 
 TEST_F(BlfIndexTest, LookupNormalizes) {
     auto& idx = BlfSubscriptionIndex::instance();
-    idx.add("<sip:200@TEST.COM;transport=tcp>", "test-dialog-1", "test.com");
+    idx.add(Symbol("<sip:200@TEST.COM;transport=tcp>"), "test-dialog-1", TenantId("test.com"));
 
     auto watchers = idx.lookup("sip:200@test.com");
     ASSERT_EQ(watchers.size(), 1u);
@@ -60,8 +62,8 @@ TEST_F(BlfIndexTest, LookupNormalizes) {
 
 TEST_F(BlfIndexTest, MultipleWatchersSameUri) {
     auto& idx = BlfSubscriptionIndex::instance();
-    idx.add("sip:200@test.com", "test-dialog-1", "test.com");
-    idx.add("sip:200@test.com", "test-dialog-2", "test.com");
+    idx.add(Symbol("sip:200@test.com"), "test-dialog-1", TenantId("test.com"));
+    idx.add(Symbol("sip:200@test.com"), "test-dialog-2", TenantId("test.com"));
 
     auto watchers = idx.lookup("sip:200@test.com");
     ASSERT_EQ(watchers.size(), 2u);
@@ -69,18 +71,29 @@ TEST_F(BlfIndexTest, MultipleWatchersSameUri) {
 
 TEST_F(BlfIndexTest, LookupByTenant) {
     auto& idx = BlfSubscriptionIndex::instance();
-    idx.add("sip:200@a.com", "test-dialog-1", "tenant-a");
-    idx.add("sip:200@a.com", "test-dialog-2", "tenant-b");
+    idx.add(Symbol("sip:200@a.com"), "test-dialog-1", TenantId("tenant-a"));
+    idx.add(Symbol("sip:200@a.com"), "test-dialog-2", TenantId("tenant-b"));
 
     auto watchers = idx.lookup("sip:200@a.com", "tenant-a");
     ASSERT_EQ(watchers.size(), 1u);
     EXPECT_EQ(watchers[0].dialog_id, "test-dialog-1");
 }
 
+TEST_F(BlfIndexTest, LookupOfUnseenTextInternsNothing) {
+    auto& idx = BlfSubscriptionIndex::instance();
+    idx.add(Symbol("sip:200@a.com"), "test-dialog-1", TenantId("tenant-a"));
+    size_t before = StringInterner::instance().size();
+
+    EXPECT_TRUE(idx.lookup("sip:200@a.com", "tenant-never-seen").empty());
+    EXPECT_TRUE(idx.lookup("sip:never-seen@a.com", "tenant-a").empty());
+    EXPECT_TRUE(idx.lookup("sip:never-seen@a.com").empty());
+    EXPECT_EQ(StringInterner::instance().size(), before);
+}
+
 TEST_F(BlfIndexTest, RemoveDialog) {
     auto& idx = BlfSubscriptionIndex::instance();
-    idx.add("sip:200@test.com", "test-dialog-1", "test.com");
-    idx.add("sip:200@test.com", "test-dialog-2", "test.com");
+    idx.add(Symbol("sip:200@test.com"), "test-dialog-1", TenantId("test.com"));
+    idx.add(Symbol("sip:200@test.com"), "test-dialog-2", TenantId("test.com"));
 
     idx.remove_dialog("test-dialog-1");
 
@@ -97,9 +110,108 @@ TEST_F(BlfIndexTest, LookupEmptyReturnsEmpty) {
 
 TEST_F(BlfIndexTest, DuplicateAddIsIdempotent) {
     auto& idx = BlfSubscriptionIndex::instance();
-    idx.add("sip:200@test.com", "test-dialog-1", "test.com");
-    idx.add("sip:200@test.com", "test-dialog-1", "test.com");
+    idx.add(Symbol("sip:200@test.com"), "test-dialog-1", TenantId("test.com"));
+    idx.add(Symbol("sip:200@test.com"), "test-dialog-1", TenantId("test.com"));
 
     auto watchers = idx.lookup("sip:200@test.com");
     ASSERT_EQ(watchers.size(), 1u);
-}
\ No newline at end of file
+}
+TEST_F(BlfIndexTest, SameUriAcrossTenantsIsPartitioned) {
+    auto& idx = BlfSubscriptionIndex::instance();
+    idx.add(Symbol("sip:200@pbx.local"), "test-dialog-1", TenantId("tenant-a"));
+    idx.add(Symbol("sip:200@pbx.local"), "test-dialog-2", TenantId("tenant-b"));
+    idx.add(Symbol("sip:200@pbx.local"), "test-dialog-3", TenantId("tenant-b"));
+
+    EXPECT_EQ(idx.lookup("sip:200@pbx.local").size(), 3u);
+    EXPECT_EQ(idx.lookup("sip:200@pbx.local", "tenant-b").size(), 2u);
+    EXPECT_TRUE(idx.lookup("sip:200@pbx.local", "tenant-z").empty());
+
+    idx.remove_dialog("test-dialog-1");
+    EXPECT_TRUE(idx.lookup("sip:200@pbx.local", "tenant-a").empty());
+    EXPECT_EQ(idx.lookup("sip:200@pbx.local").size(), 2u);
+}
+
+TEST_F(BlfIndexTest, ReAddMovesTenantAndCounts) {
+    auto& idx = BlfSubscriptionIndex::instance();
+    auto count_for = [&](const std::string& tenant) {
+        for (const auto& [t, n] : idx.tenant_watcher_counts()) if (t == tenant) return n;
+        return size_t{0};
+    };
+    size_t total = idx.total_watcher_count();
+
+    idx.add(Symbol("sip:300@pbx.local"), "test-dialog-1", TenantId("tenant-move-a"));
+    EXPECT_EQ(count_for("tenant-move-a"), 1u);
+
+    idx.add(Symbol("sip:300@pbx.local"), "test-dialog-1", TenantId("tenant-move-b"));
+    EXPECT_EQ(count_for("tenant-move-a"), 0u);
+    EXPECT_EQ(count_for("tenant-move-b"), 1u);
+    EXPECT_EQ(idx.total_watcher_count(), total + 1);
+
+    auto watchers = idx.lookup("sip:300@pbx.local");
+    ASSERT_EQ(watchers.size(), 1u);
+    EXPECT_EQ(watchers[0].tenant_id, "tenant-move-b");
+
+    idx.remove(Symbol("sip:300@pbx.local"), "test-dialog-1");
+    EXPECT_EQ(idx.total_watcher_count(), total);
+    EXPECT_TRUE(idx.lookup("sip:300@pbx.local").empty());
+}
+
+TEST(BlfIndexPrefilter, HashMatchesNormalizeUri) {
+    auto fnv = [](const std::string& s) {
+        uint64_t h = 14695981039346656037ull;
+        for (unsigned char c : s) { h ^= c; h *= 1099511628211ull; }
+        return h;
+    };
+    const char* uris[] = {
+        "sip:200@test.com", "<sip:200@Test.COM:5060;transport=tcp>", "SIP:User@HOST.com",
+        "200@test.com", "sips:300@pbx.local:5061", "<>", "<sip:", "tel:+15551234", "sip:400@host:5060x",
+        "Sips:a@B", "user@host:5060", "s", "",
+    };
+    for (const char* u : uris) {
+        EXPECT_EQ(BlfSubscriptionIndex::normalized_uri_hash(u), fnv(BlfSubscriptionIndex::normalize_uri(u))) << u;
+    }
+}
+
+TEST_F(BlfIndexTest, PrefilterTracksWatchedUris) {
+    auto& idx = BlfSubscriptionIndex::instance();
+    EXPECT_FALSE(idx.may_be_watched("sip:prefilter@pbx.local"));
+    EXPECT_FALSE(idx.may_be_watched(""));
+
+    idx.add(Symbol("sip:prefilter@pbx.local"), "test-dialog-1", TenantId("tenant-a"));
+    idx.add(Symbol("sip:prefilter@pbx.local"), "test-dialog-2", TenantId("tenant-b"));
+    EXPECT_TRUE(idx.may_be_watched("<sip:prefilter@PBX.local:5060;transport=udp>"));
+
+    // Stays until the URI's last watcher goes
+    idx.remove_dialog("test-dialog-1");
+    EXPECT_TRUE(idx.may_be_watched("sip:prefilter@pbx.local"));
+    idx.remove_dialog("test-dialog-2");
+    EXPECT_FALSE(idx.may_be_watched("sip:prefilter@pbx.local"));
+
+    // Resizing refills from the index; 0 turns the pre-check off
+    idx.add(Symbol("sip:prefilter@pbx.local"), "test-dialog-3", TenantId("tenant-a"));
+    idx.configure_prefilter(1024);
+    EXPECT_TRUE(idx.may_be_watched("sip:prefilter@pbx.local"));
+    idx.configure_prefilter(0);
+    EXPECT_TRUE(idx.may_be_watched("sip:nobody@pbx.local"));
+    idx.configure_prefilter(size_t(1) << 22);
+    EXPECT_FALSE(idx.may_be_watched("sip:nobody@pbx.local"));
+}
+
+TEST_F(BlfIndexTest, ListenerFiresOnlyForNewUris) {
+    auto& idx = BlfSubscriptionIndex::instance();
+    int calls = 0;
+    idx.set_uri_added_listener([&calls] { ++calls; });
+
+    idx.add(Symbol("sip:listen@pbx.local"), "test-dialog-1", TenantId("tenant-a"));
+    EXPECT_EQ(calls, 1);
+    // Another watcher or tenant on the same URI needs no republish
+    idx.add(Symbol("sip:listen@pbx.local"), "test-dialog-2", TenantId("tenant-a"));
+    idx.add(Symbol("sip:listen@pbx.local"), "test-dialog-3", TenantId("tenant-b"));
+    EXPECT_EQ(calls, 1);
+    idx.remove_dialog("test-dialog-1");
+    EXPECT_EQ(calls, 1);
+
+    idx.set_uri_added_listener(nullptr);
+    idx.add(Symbol("sip:listen2@pbx.local"), "test-dialog-4", TenantId("tenant-a"));
+    EXPECT_EQ(calls, 1);
+}
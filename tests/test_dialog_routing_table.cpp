@@ -0,0 +1,273 @@
+
+// =============================================================================
+// FILE: tests/test_dialog_routing_table.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "dispatch/dialog_routing_table.h"
+#include "dispatch/dialog_dispatcher.h"
+#include "common/slow_event_logger.h"
+#include "common/logger.h"
+#include "test_helpers.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace sip_processor;
+using test::subscribe;
+using test::wait_for;
+
+namespace {
+
+Config dispatcher_config(size_t workers) {
+    Config c = test::worker_config(workers);
+    c.dispatcher_rebalance_threshold_pct = 10;
+    return c;
+}
+
+}  // namespace
+
+TEST(DialogRoutingTable, PlacementIsStickyAndCounted) {
+    DialogRoutingTable t(3);
+    int chosen = 0;
+    EXPECT_EQ(t.find_or_place("a", [&] { ++chosen; return 2; }), 2u);
+    EXPECT_EQ(t.find_or_place("a", [&] { ++chosen; return 0; }), 2u);
+    EXPECT_EQ(chosen, 1);
+    EXPECT_EQ(t.find("a"), 2u);
+    EXPECT_EQ(t.find("b"), DialogRoutingTable::kNoWorker);
+    EXPECT_EQ(t.owned(2), 1);
+
+    t.bind("b", 1);
+    t.bind("b", 0);                     // Rebinding moves the count
+    EXPECT_EQ(t.owned(0), 1);
+    EXPECT_EQ(t.owned(1), 0);
+    EXPECT_EQ(t.size(), 2u);
+}
+
+TEST(DialogRoutingTable, MoveAndReleaseRequireCurrentOwner) {
+    DialogRoutingTable t(2);
+    t.bind("d", 0);
+    EXPECT_EQ(t.move("d", 1, 0), DialogRoutingTable::Move::kNotOwner);
+    EXPECT_EQ(t.move("d", 0, 1), DialogRoutingTable::Move::kMoved);
+    EXPECT_EQ(t.find("d"), 1u);
+
+    t.release("d", 0);                  // Stale owner: no effect
+    EXPECT_EQ(t.find("d"), 1u);
+    t.release("d", 1);
+    EXPECT_EQ(t.find("d"), DialogRoutingTable::kNoWorker);
+    EXPECT_EQ(t.owned(0) + t.owned(1), 0);
+}
+
+TEST(DialogRoutingTable, GuardPinsOwnersAgainstMove) {
+    DialogRoutingTable t(2);
+    t.bind("a", 0);
+    std::string a = "a", b = "b";
+    {
+        DialogRoutingTable::Guard pin(t, std::vector<const std::string*>{&a, &b});
+        EXPECT_EQ(pin.find("a"), 0u);
+        EXPECT_EQ(pin.find_or_place("b", [] { return 1u; }), 1u);
+        // A handoff racing the enqueue backs off instead of repointing
+        std::thread mover([&] { EXPECT_EQ(t.move("a", 0, 1), DialogRoutingTable::Move::kBusy); });
+        mover.join();
+        pin.release("b", 1);
+    }
+    EXPECT_EQ(t.find("b"), DialogRoutingTable::kNoWorker);
+    EXPECT_EQ(t.move("a", 0, 1), DialogRoutingTable::Move::kMoved);
+    EXPECT_EQ(t.owned(1), 1);
+}
+
+TEST(DialogDispatcherRouting, SpreadsOneTenantAcrossWorkers) {
+    Logger::instance().set_level(LogLevel::kError);
+    Config cfg = dispatcher_config(4);
+    DialogDispatcher dispatcher(cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    ASSERT_EQ(dispatcher.start(), Result::kOk);
+
+    // One tenant's dialogs must not pile up on any worker beyond the
+    // placement bound (threshold_pct above the mean)
+    for (int i = 0; i < 400; ++i) {
+        ASSERT_EQ(dispatcher.dispatch(subscribe("spread-" + std::to_string(i), "hot.spread.com")), Result::kOk);
+    }
+    ASSERT_TRUE(wait_for([&] { return dispatcher.aggregate_stats().total_events_processed >= 400; }));
+    auto b = dispatcher.balance();
+    EXPECT_EQ(dispatcher.routing().size(), 400u);
+    EXPECT_LE(b.imbalance(), 1.15);
+    dispatcher.stop();
+}
+
+TEST(DialogDispatcherRouting, FeedEventForUnknownDialogIsNotRouted) {
+    Config cfg = dispatcher_config(2);
+    DialogDispatcher dispatcher(cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    ASSERT_EQ(dispatcher.start(), Result::kOk);
+    auto trigger = SipEvent::create_presence_trigger("nobody", TenantId("t.com"), "c1", "sip:a@t.com",
+                                                     "sip:b@t.com", "confirmed", "inbound", "");
+    EXPECT_EQ(dispatcher.dispatch(std::move(trigger)), Result::kNotFound);
+    EXPECT_EQ(dispatcher.routing().size(), 0u);
+
+    // Batched, the same events are counted rather than silently dropped
+    std::vector<std::unique_ptr<SipEvent>> batch;
+    batch.push_back(SipEvent::create_presence_trigger("nobody", TenantId("t.com"), "c2", "sip:a@t.com",
+                                                      "sip:b@t.com", "confirmed", "inbound", ""));
+    batch.push_back(SipEvent::create_presence_trigger("nobody-else", TenantId("t.com"), "c3", "sip:a@t.com",
+                                                      "sip:b@t.com", "confirmed", "inbound", ""));
+    EXPECT_EQ(dispatcher.dispatch_batch(std::move(batch)), 0u);
+    EXPECT_EQ(dispatcher.aggregate_stats().total_events_unroutable, 3u);
+    EXPECT_EQ(dispatcher.routing().size(), 0u);
+    dispatcher.stop();
+}
+
+TEST(DialogDispatcherRouting, BatchRollsBackPlacementsItCouldNotQueue) {
+    Config cfg = dispatcher_config(2);
+    cfg.max_incoming_queue_per_worker = 2;
+    DialogDispatcher dispatcher(cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    ASSERT_EQ(dispatcher.start(), Result::kOk);
+
+    std::vector<std::unique_ptr<SipEvent>> batch;
+    for (int i = 0; i < 20; ++i) batch.push_back(subscribe("batch-" + std::to_string(i), "batch.com"));
+    size_t accepted = dispatcher.dispatch_batch(std::move(batch));
+    EXPECT_LE(accepted, 4u);
+    EXPECT_EQ(dispatcher.routing().size(), accepted);
+    dispatcher.stop();
+}
+
+TEST(DialogDispatcherRouting, RebalanceHandsIdleDialogsToIdlestWorker) {
+    Config cfg = dispatcher_config(2);
+    DialogDispatcher dispatcher(cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+
+    // Recovered state lands wherever it is loaded; pile it all on worker 0
+    for (int i = 0; i < 100; ++i) {
+        SubscriptionRecord rec;
+        rec.dialog_id = "skew-" + std::to_string(i);
+        rec.tenant_id = TenantId("skew.com");
+        rec.type = SubscriptionType::kBLF;
+        rec.lifecycle = SubLifecycle::kActive;
+        dispatcher.worker(0).load_recovered_subscription(std::move(rec));
+    }
+    ASSERT_EQ(dispatcher.routing().owned(0), 100);
+    ASSERT_EQ(dispatcher.start(), Result::kOk);
+
+    EXPECT_EQ(dispatcher.rebalance(), 50u);
+    ASSERT_TRUE(wait_for([&] { return dispatcher.worker(1).stats().migrations_in.load() == 50; }));
+    EXPECT_EQ(dispatcher.routing().owned(0), 50);
+    EXPECT_EQ(dispatcher.routing().owned(1), 50);
+    EXPECT_EQ(dispatcher.worker(0).stats().dialogs_active.load(), 50u);
+    EXPECT_EQ(dispatcher.rebalance(), 0u);
+
+    // Events for every dialog still reach the worker that now owns it
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(dispatcher.dispatch(subscribe("skew-" + std::to_string(i), "skew.com")), Result::kOk);
+    }
+    ASSERT_TRUE(wait_for([&] { return dispatcher.aggregate_stats().total_events_processed >= 100; }));
+    EXPECT_EQ(dispatcher.worker(0).stats().events_processed.load(), 50u);
+    EXPECT_EQ(dispatcher.worker(1).stats().events_processed.load(), 50u);
+    EXPECT_EQ(dispatcher.aggregate_stats().total_dialogs_active, 100u);
+    dispatcher.stop();
+}
+
+TEST(DialogDispatcherRouting, ShrinkUnderLoadDropsNoEvents) {
+    Config cfg = dispatcher_config(4);
+    cfg.dispatcher_max_workers = 4;
+    cfg.max_subscriptions_per_tenant = 100000;
+    DialogDispatcher dispatcher(cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    ASSERT_EQ(dispatcher.start(), Result::kOk);
+    constexpr int kDialogs = 200;
+    for (int i = 0; i < kDialogs; ++i) {
+        ASSERT_EQ(dispatcher.dispatch(subscribe("shrink-" + std::to_string(i), "shrink.com")), Result::kOk);
+    }
+    ASSERT_TRUE(wait_for([&] { return dispatcher.aggregate_stats().total_dialogs_active == kDialogs; }));
+
+    // Refreshes keep arriving while workers 2 and 3 drain and stop
+    std::atomic<bool> done{false};
+    std::atomic<int> refused{0};
+    std::thread load([&] {
+        for (int i = 0; !done.load(); i = (i + 1) % kDialogs) {
+            if (dispatcher.dispatch(subscribe("shrink-" + std::to_string(i), "shrink.com")) != Result::kOk) refused++;
+            if (i % 64 == 0) std::this_thread::sleep_for(std::chrono::microseconds(50));   // Stay under queue caps
+        }
+    });
+    ASSERT_EQ(dispatcher.resize(2), Result::kOk);
+    bool stopped = wait_for([&] { dispatcher.finish_resize(); return dispatcher.num_workers() == 2; });
+    done.store(true);
+    load.join();
+    ASSERT_TRUE(stopped);
+    EXPECT_EQ(refused.load(), 0);
+    EXPECT_EQ(dispatcher.aggregate_stats().total_events_dropped, 0u);
+    EXPECT_EQ(dispatcher.routing().owned(0) + dispatcher.routing().owned(1), kDialogs);
+    dispatcher.stop();
+}
+
+TEST(DialogDispatcherRouting, ResizeHandsOffOnlyAffectedDialogs) {
+    Config cfg = dispatcher_config(2);
+    cfg.dispatcher_max_workers = 4;
+    cfg.max_subscriptions_per_tenant = 100000;
+    DialogDispatcher dispatcher(cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    ASSERT_EQ(dispatcher.start(), Result::kOk);
+    for (int i = 0; i < 200; ++i) {
+        ASSERT_EQ(dispatcher.dispatch(subscribe("resize-" + std::to_string(i), "resize.com")), Result::kOk);
+    }
+    ASSERT_TRUE(wait_for([&] { return dispatcher.aggregate_stats().total_dialogs_active == 200; }));
+    EXPECT_EQ(dispatcher.resize(5), Result::kInvalidArgument);
+
+    // Grow: only dialogs whose ring home is now worker 2 or 3 move
+    ASSERT_EQ(dispatcher.resize(4), Result::kOk);
+    EXPECT_EQ(dispatcher.num_workers(), 4u);
+    HashRing ring(4, cfg.dispatcher_ring_vnodes);
+    uint64_t expected = 0;
+    for (int i = 0; i < 200; ++i) expected += ring.owner("resize-" + std::to_string(i)) >= 2;
+    ASSERT_TRUE(wait_for([&] {
+        return dispatcher.worker(2).stats().migrations_in.load() +
+               dispatcher.worker(3).stats().migrations_in.load() == expected;
+    }));
+    EXPECT_EQ(dispatcher.worker(0).stats().migrations_in.load() +
+              dispatcher.worker(1).stats().migrations_in.load(), 0u);
+    EXPECT_EQ(dispatcher.routing().size(), 200u);
+
+    // Shrink: workers 2 and 3 drain back and stop
+    ASSERT_EQ(dispatcher.resize(2), Result::kOk);
+    EXPECT_EQ(dispatcher.active_workers(), 2u);
+    ASSERT_TRUE(wait_for([&] { dispatcher.finish_resize(); return dispatcher.num_workers() == 2; }));
+    EXPECT_EQ(dispatcher.routing().owned(0) + dispatcher.routing().owned(1), 200);
+    ASSERT_TRUE(wait_for([&] { return dispatcher.aggregate_stats().total_dialogs_active == 200; }));
+
+    // Every dialog still answers on its new owner
+    uint64_t before = dispatcher.aggregate_stats().total_events_processed;
+    for (int i = 0; i < 200; ++i) {
+        ASSERT_EQ(dispatcher.dispatch(subscribe("resize-" + std::to_string(i), "resize.com")), Result::kOk);
+    }
+    ASSERT_TRUE(wait_for([&] { return dispatcher.aggregate_stats().total_events_processed >= before + 200; }));
+    EXPECT_EQ(dispatcher.aggregate_stats().total_events_dropped, 0u);
+    dispatcher.stop();
+}
+
+TEST(DialogDispatcherRouting, GrowRightAfterShrinkFollowsNewRing) {
+    Config cfg = dispatcher_config(4);
+    cfg.dispatcher_max_workers = 4;
+    cfg.max_subscriptions_per_tenant = 100000;
+    DialogDispatcher dispatcher(cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    ASSERT_EQ(dispatcher.start(), Result::kOk);
+    constexpr int kDialogs = 400;
+    for (int i = 0; i < kDialogs; ++i) {
+        ASSERT_EQ(dispatcher.dispatch(subscribe("regrow-" + std::to_string(i), "regrow.com")), Result::kOk);
+    }
+    ASSERT_TRUE(wait_for([&] { return dispatcher.aggregate_stats().total_dialogs_active == kDialogs; }));
+
+    // Workers 2 and 3 rejoin before draining; the shrink's queued handoffs
+    // must not pull their dialogs off afterwards
+    ASSERT_EQ(dispatcher.resize(2), Result::kOk);
+    ASSERT_EQ(dispatcher.resize(4), Result::kOk);
+    EXPECT_EQ(dispatcher.num_workers(), 4u);
+
+    // Every dialog the ring homes on a rejoined worker ends up there
+    HashRing ring(4, cfg.dispatcher_ring_vnodes);
+    auto placed = [&] {
+        for (int i = 0; i < kDialogs; ++i) {
+            std::string did = "regrow-" + std::to_string(i);
+            uint32_t home = ring.owner(did);
+            if (home >= 2 && dispatcher.routing().find(did) != home) return false;
+        }
+        return true;
+    };
+    ASSERT_TRUE(wait_for(placed));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));   // Late handoffs would land here
+    EXPECT_TRUE(placed());
+    EXPECT_EQ(dispatcher.routing().size(), static_cast<size_t>(kDialogs));
+    dispatcher.stop();
+}
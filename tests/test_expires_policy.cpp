@@ -0,0 +1,156 @@
+
+// =============================================================================
+// FILE: tests/test_expires_policy.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "subscription/expires_policy.h"
+#include "dispatch/dialog_dispatcher.h"
+#include "dispatch/subscription_recovery.h"
+#include "persistence/local_snapshot_store.h"
+#include "persistence/subscription_store.h"
+#include "common/slow_event_logger.h"
+#include "common/logger.h"
+#include "test_helpers.h"
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <unistd.h>
+
+using namespace sip_processor;
+using test::wait_for;
+
+namespace {
+
+Config expires_config() {
+    Config c = test::worker_config();
+    c.expires_blf_min_sec = 60;
+    c.expires_blf_max_sec = 3600;
+    c.expires_blf_default_sec = 1800;
+    c.expires_mwi_min_sec = 120;
+    c.expires_mwi_max_sec = 0;
+    c.expires_mwi_default_sec = 3600;
+    return c;
+}
+
+std::unique_ptr<SipEvent> subscribe(const std::string& did, uint32_t expires) {
+    return test::subscribe(did, "expires.com", expires);
+}
+
+}  // namespace
+
+TEST(ExpiresPolicy, ClampsRejectsAndDefaults) {
+    ExpiresPolicy policy(expires_config());
+    TenantId tenant("expires.com");
+
+    auto d = policy.negotiate(tenant, SubscriptionType::kBLF, true, 600);
+    EXPECT_FALSE(d.too_brief);
+    EXPECT_EQ(d.granted, 600u);
+    EXPECT_EQ(policy.negotiate(tenant, SubscriptionType::kBLF, true, 86400).granted, 3600u);
+    EXPECT_EQ(policy.negotiate(tenant, SubscriptionType::kBLF, false, 0).granted, 1800u);
+    EXPECT_EQ(policy.negotiate(tenant, SubscriptionType::kMWI, true, 86400).granted, 86400u);  // No maximum
+
+    d = policy.negotiate(tenant, SubscriptionType::kMWI, true, 60);
+    EXPECT_TRUE(d.too_brief);
+    EXPECT_EQ(d.min_expires, 120u);
+}
+
+TEST(ExpiresPolicy, TenantOverridesReplaceTypeLimits) {
+    Config cfg = expires_config();
+    cfg.expires_tenant_overrides = "busy.com:BLF:300:1200, quiet.com:MWI:30:600";
+    ExpiresPolicy policy(cfg);
+    EXPECT_EQ(policy.tenant_overrides(), 2u);
+
+    EXPECT_TRUE(policy.negotiate(TenantId("busy.com"), SubscriptionType::kBLF, true, 120).too_brief);
+    EXPECT_EQ(policy.negotiate(TenantId("busy.com"), SubscriptionType::kBLF, true, 3600).granted, 1200u);
+    EXPECT_EQ(policy.negotiate(TenantId("busy.com"), SubscriptionType::kBLF, false, 0).granted, 1200u);  // Default clamped
+    EXPECT_EQ(policy.negotiate(TenantId("busy.com"), SubscriptionType::kMWI, true, 60).min_expires, 120u);  // Type limits
+    EXPECT_EQ(policy.negotiate(TenantId("quiet.com"), SubscriptionType::kMWI, true, 30).granted, 30u);
+    EXPECT_TRUE(policy.negotiate(TenantId("other.com"), SubscriptionType::kBLF, true, 30).too_brief);
+
+    std::unordered_map<TenantId, std::array<ExpiresLimits, 2>> out;
+    std::array<ExpiresLimits, 2> defaults{};
+    EXPECT_FALSE(ExpiresPolicy::parse_overrides("a.com:BLF:60", out, defaults));
+    EXPECT_FALSE(ExpiresPolicy::parse_overrides("a.com:XYZ:60:600", out, defaults));
+    EXPECT_FALSE(ExpiresPolicy::parse_overrides(":BLF:60:600", out, defaults));
+    EXPECT_TRUE(out.empty());
+}
+
+TEST(ExpiresPolicy, WorkerRejectsTooBriefAndFastPathsRefreshes) {
+    Logger::instance().set_level(LogLevel::kError);
+    Config cfg = expires_config();
+    cfg.expires_checkpoint = Seconds(300);
+    DialogDispatcher dispatcher(cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    ASSERT_EQ(dispatcher.start(), Result::kOk);
+    const auto& ws = dispatcher.worker(0).stats();
+
+    ASSERT_EQ(dispatcher.dispatch(subscribe("brief", 10)), Result::kOk);
+    ASSERT_TRUE(wait_for([&] { return ws.subscribes_too_brief.load() == 1; }));
+    EXPECT_EQ(dispatcher.routing().size(), 0u);
+
+    ASSERT_EQ(dispatcher.dispatch(subscribe("refresh", 600)), Result::kOk);
+    ASSERT_TRUE(wait_for([&] { return ws.dialogs_active.load() == 1; }));
+
+    // Back-to-back refreshes move the expiry by less than the checkpoint,
+    // so none of them is stored
+    for (int i = 0; i < 5; ++i) ASSERT_EQ(dispatcher.dispatch(subscribe("refresh", 600)), Result::kOk);
+    ASSERT_TRUE(wait_for([&] { return ws.refresh_fast_path.load() == 5; }));
+    EXPECT_EQ(ws.refresh_checkpoints.load(), 0u);
+
+    // An unsubscribe still ends the dialog; events without Expires do not
+    auto trigger = SipEvent::create_presence_trigger("refresh", TenantId("expires.com"), "c1", "sip:a@expires.com",
+                                                     "sip:monitored@expires.com", "confirmed", "inbound", "");
+    ASSERT_EQ(dispatcher.dispatch(std::move(trigger)), Result::kOk);
+    ASSERT_TRUE(wait_for([&] { return ws.presence_triggers_processed.load() == 1; }));
+    ASSERT_EQ(dispatcher.dispatch(subscribe("refresh", 600)), Result::kOk);
+    ASSERT_TRUE(wait_for([&] { return ws.refresh_fast_path.load() == 6; }));
+
+    ASSERT_EQ(dispatcher.dispatch(subscribe("refresh", 0)), Result::kOk);
+    ASSERT_TRUE(wait_for([&] { return ws.events_processed.load() == 9; }));
+    EXPECT_EQ(ws.refresh_fast_path.load(), 6u);
+    dispatcher.stop();
+}
+
+TEST(ExpiresPolicy, ShortExpiresRefreshSurvivesRestart) {
+    Logger::instance().set_level(LogLevel::kError);
+    char tmpl[] = "/tmp/expires_ckpt_XXXXXX";
+    ASSERT_NE(mkdtemp(tmpl), nullptr);
+    Config cfg = expires_config();
+    cfg.expires_blf_min_sec = 1;
+    cfg.expires_checkpoint = Seconds(300);   // Far above the granted Expires
+    cfg.snapshot_enabled = true;
+    cfg.snapshot_directory = tmpl;
+    cfg.service_id = "ckpt";
+    cfg.snapshot_journal_flush_interval = Millisecs(10);
+    {
+        auto store = std::make_shared<SubscriptionStore>(cfg, nullptr);
+        auto snapshot = std::make_shared<LocalSnapshotStore>(cfg);
+        store->add_change_listener(snapshot);
+        ASSERT_EQ(snapshot->start(), Result::kOk);
+        DialogDispatcher dispatcher(cfg, std::make_shared<SlowEventLogger>(cfg), store);
+        ASSERT_EQ(dispatcher.start(), Result::kOk);
+        const auto& ws = dispatcher.worker(0).stats();
+
+        ASSERT_EQ(dispatcher.dispatch(subscribe("short", 2)), Result::kOk);
+        ASSERT_TRUE(wait_for([&] { return ws.dialogs_active.load() == 1; }));
+        std::this_thread::sleep_for(Millisecs(1200));
+        ASSERT_EQ(dispatcher.dispatch(subscribe("short", 2)), Result::kOk);
+        ASSERT_TRUE(wait_for([&] { return ws.refresh_fast_path.load() == 1; }));
+        EXPECT_EQ(ws.refresh_checkpoints.load(), 1u);
+
+        // Restart once the admitted expiry has passed but the refreshed one has not
+        std::this_thread::sleep_for(Millisecs(1000));
+        dispatcher.stop();
+        snapshot->stop();
+    }
+
+    DialogDispatcher restarted(cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    auto snapshot = std::make_shared<LocalSnapshotStore>(cfg);
+    SubscriptionRecovery recovery(cfg, restarted, nullptr, snapshot);
+    ASSERT_EQ(recovery.recover(), Result::kOk);
+    EXPECT_EQ(recovery.stats().records_loaded.load(), 1u);
+    EXPECT_EQ(restarted.routing().find("short"), 0u);
+
+    std::remove(snapshot->snapshot_path().c_str());
+    std::remove(snapshot->journal_path().c_str());
+    rmdir(tmpl);
+}
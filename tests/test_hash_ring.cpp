@@ -0,0 +1,43 @@
+
+// =============================================================================
+// FILE: tests/test_hash_ring.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "dispatch/hash_ring.h"
+#include <string>
+#include <vector>
+
+using namespace sip_processor;
+
+TEST(HashRing, SpreadsKeysEvenly) {
+    HashRing ring(8, 128);
+    std::vector<int> counts(8, 0);
+    for (int i = 0; i < 80000; ++i) counts[ring.owner("call-" + std::to_string(i) + ";ft=a;tt=b")]++;
+    for (int c : counts) {
+        EXPECT_GT(c, 8000);
+        EXPECT_LT(c, 12000);
+    }
+}
+
+TEST(HashRing, GrowingMovesKeysOnlyToNewWorkers) {
+    HashRing before(4, 128), after(6, 128);
+    int moved = 0;
+    for (int i = 0; i < 60000; ++i) {
+        std::string key = "dlg-" + std::to_string(i);
+        uint32_t a = before.owner(key), b = after.owner(key);
+        if (a != b) {
+            ++moved;
+            ASSERT_GE(b, 4u);   // Never reshuffled between surviving workers
+        }
+    }
+    // About 2/6 of the keys belong to the two new workers
+    EXPECT_GT(moved, 16000);
+    EXPECT_LT(moved, 24000);
+}
+
+TEST(HashRing, KeyHashIsStable) {
+    EXPECT_EQ(HashRing::key_hash("abc"), HashRing::key_hash(std::string("abc")));
+    EXPECT_NE(HashRing::key_hash("abc"), HashRing::key_hash("abd"));
+    HashRing a(3, 16), b(3, 16);
+    EXPECT_EQ(a.owner("x"), b.owner("x"));
+}
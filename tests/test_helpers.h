@@ -0,0 +1,55 @@
+
+// =============================================================================
+// FILE: tests/test_helpers.h
+//
+// Event and config factories and polling shared by the unit tests.
+// =============================================================================
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include "common/config.h"
+#include "sip/sip_event.h"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace sip_processor::test {
+
+// In-memory workers: no Mongo, and a tenant cap no test reaches
+inline Config worker_config(size_t workers = 1) {
+    Config c;
+    c.num_workers = workers;
+    c.mongo_enable_persistence = false;
+    c.max_subscriptions_per_tenant = 100000;
+    return c;
+}
+
+// An incoming BLF SUBSCRIBE for sip:monitored@<tenant>; expires 0 unsubscribes
+inline std::unique_ptr<SipEvent> subscribe(const std::string& did, const std::string& tenant,
+                                           uint32_t expires = 3600) {
+    auto ev = std::make_unique<SipEvent>();
+    ev->dialog_id = did;
+    ev->tenant_id = tenant;
+    ev->category = SipEventCategory::kSubscribe;
+    ev->source = SipEventSource::kSipStack;
+    ev->sub_type = SubscriptionType::kBLF;
+    ev->direction = SipDirection::kIncoming;
+    ev->created_at = ev->enqueued_at = Clock::now();
+    ev->expires = expires;
+    ev->has_expires = true;
+    ev->subscription_state = "active";
+    ev->to_uri = "sip:monitored@" + tenant;
+    return ev;
+}
+
+// Polls for up to 3s
+template <typename Pred>
+bool wait_for(Pred pred) {
+    for (int i = 0; i < 300 && !pred(); ++i) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return pred();
+}
+
+}  // namespace sip_processor::test
+
+#endif  // TEST_HELPERS_H
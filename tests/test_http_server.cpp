@@ -0,0 +1,259 @@
+
+// =============================================================================
+// FILE: tests/test_http_server.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "http/http_server.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace sip_processor;
+
+namespace {
+
+Config test_config() {
+    Config c;
+    c.http_bind_address = "127.0.0.1";
+    c.http_port = 0;   // Ephemeral
+    c.http_handler_threads = 1;
+    return c;
+}
+
+int connect_to(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    struct timeval tv{5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void send_str(int fd, const std::string& s) {
+    ASSERT_EQ(send(fd, s.data(), s.size(), MSG_NOSIGNAL), static_cast<ssize_t>(s.size()));
+}
+
+// Reads one response: headers plus Content-Length body, or a full chunked body
+std::string read_response(int fd) {
+    std::string in;
+    char buf[4096];
+    while (true) {
+        size_t head_end = in.find("\r\n\r\n");
+        if (head_end != std::string::npos) {
+            auto cl = in.find("Content-Length: ");
+            if (cl != std::string::npos && cl < head_end) {
+                size_t len = std::stoul(in.substr(cl + 16));
+                if (in.size() >= head_end + 4 + len) return in.substr(0, head_end + 4 + len);
+            } else if (in.find("0\r\n\r\n", head_end + 4) != std::string::npos) {
+                return in;
+            }
+        }
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) return in;
+        in.append(buf, static_cast<size_t>(n));
+    }
+}
+
+std::string body_of(const std::string& resp) {
+    auto p = resp.find("\r\n\r\n");
+    return p == std::string::npos ? std::string() : resp.substr(p + 4);
+}
+
+HttpServer::Response text(std::string body) {
+    HttpServer::Response r;
+    r.content_type = "text/plain";
+    r.body = std::move(body);
+    return r;
+}
+
+}  // namespace
+
+TEST(HttpServerTest, KeepAliveServesSeveralRequestsOnOneConnection) {
+    HttpServer server(test_config());
+    server.route("GET", "/ping", [](const HttpServer::Request&) { return text("pong"); });
+    ASSERT_EQ(server.start(), Result::kOk);
+
+    int fd = connect_to(server.port());
+    ASSERT_GE(fd, 0);
+    for (int i = 0; i < 3; ++i) {
+        send_str(fd, "GET /ping HTTP/1.1\r\nHost: x\r\n\r\n");
+        std::string resp = read_response(fd);
+        EXPECT_EQ(resp.rfind("HTTP/1.1 200 OK", 0), 0u);
+        EXPECT_NE(resp.find("Connection: keep-alive"), std::string::npos);
+        EXPECT_EQ(body_of(resp), "pong");
+    }
+    close(fd);
+
+    EXPECT_EQ(server.stats().requests_total.load(), 3u);
+    EXPECT_EQ(server.stats().keepalive_reuses.load(), 2u);
+    EXPECT_EQ(server.stats().connections_accepted.load(), 1u);
+    server.stop();
+}
+
+TEST(HttpServerTest, ParsesBodyArrivingInPieces) {
+    HttpServer server(test_config());
+    server.route("POST", "/echo", [](const HttpServer::Request& r) {
+        return text(std::to_string(r.body.size()) + ":" + r.body.substr(r.body.size() - 3));
+    });
+    ASSERT_EQ(server.start(), Result::kOk);
+
+    std::string body(40000, 'a');
+    body.replace(body.size() - 3, 3, "xyz");
+    int fd = connect_to(server.port());
+    ASSERT_GE(fd, 0);
+    send_str(fd, "POST /echo HTTP/1.1\r\nHost: x\r\ncontent-length: " + std::to_string(body.size()) + "\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    send_str(fd, "\r\n" + body.substr(0, 9000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    send_str(fd, body.substr(9000));
+
+    std::string resp = read_response(fd);
+    EXPECT_EQ(body_of(resp), "40000:xyz");
+    close(fd);
+    server.stop();
+}
+
+TEST(HttpServerTest, RejectsBodyOverLimit) {
+    Config cfg = test_config();
+    cfg.http_max_request_bytes = 1024;
+    HttpServer server(cfg);
+    server.route("POST", "/echo", [](const HttpServer::Request&) { return text("unexpected"); });
+    ASSERT_EQ(server.start(), Result::kOk);
+
+    int fd = connect_to(server.port());
+    ASSERT_GE(fd, 0);
+    send_str(fd, "POST /echo HTTP/1.1\r\nContent-Length: 4096\r\n\r\n");
+    std::string resp = read_response(fd);
+    EXPECT_EQ(resp.rfind("HTTP/1.1 413", 0), 0u);
+    EXPECT_NE(resp.find("Connection: close"), std::string::npos);
+    close(fd);
+    server.stop();
+}
+
+TEST(HttpServerTest, InlineRouteIsNotDelayedBySlowPooledHandler) {
+    HttpServer server(test_config());
+    server.route("GET", "/slow", [](const HttpServer::Request&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        return text("done");
+    });
+    server.route("GET", "/health", [](const HttpServer::Request&) { return text("ok"); },
+                 HttpServer::Dispatch::kInline);
+    ASSERT_EQ(server.start(), Result::kOk);
+
+    int slow = connect_to(server.port());
+    ASSERT_GE(slow, 0);
+    send_str(slow, "GET /slow HTTP/1.1\r\n\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));   // Let the pool pick it up
+
+    auto start = std::chrono::steady_clock::now();
+    int fd = connect_to(server.port());
+    ASSERT_GE(fd, 0);
+    send_str(fd, "GET /health HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(body_of(read_response(fd)), "ok");
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(250));
+    close(fd);
+
+    EXPECT_EQ(body_of(read_response(slow)), "done");
+    close(slow);
+    server.stop();
+}
+
+TEST(HttpServerTest, MatchesLongestRoutePrefixBySegment) {
+    HttpServer server(test_config());
+    server.route("GET", "/subscriptions", [](const HttpServer::Request& r) { return text("list " + r.path); });
+    server.route("GET", "/stats", [](const HttpServer::Request&) { return text("stats"); });
+    server.route("GET", "/stats/workers", [](const HttpServer::Request&) { return text("workers"); });
+    ASSERT_EQ(server.start(), Result::kOk);
+
+    int fd = connect_to(server.port());
+    ASSERT_GE(fd, 0);
+    send_str(fd, "GET /subscriptions/abc%3Bdef HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(body_of(read_response(fd)), "list /subscriptions/abc%3Bdef");
+    send_str(fd, "GET /stats/workers?x=1 HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(body_of(read_response(fd)), "workers");
+    send_str(fd, "GET /stats/mongo HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(body_of(read_response(fd)), "stats");
+    send_str(fd, "GET /statsx HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(read_response(fd).rfind("HTTP/1.1 404", 0), 0u);
+    send_str(fd, "POST /stats HTTP/1.1\r\nContent-Length: 0\r\n\r\n");
+    EXPECT_EQ(read_response(fd).rfind("HTTP/1.1 404", 0), 0u);
+    close(fd);
+    server.stop();
+}
+
+TEST(HttpServerTest, StreamsChunksAndKeepsConnectionOpen) {
+    HttpServer server(test_config());
+    server.route("GET", "/stream", [](const HttpServer::Request&) {
+        HttpServer::Response r;
+        auto n = std::make_shared<int>(0);
+        r.stream = [n](std::string& chunk) {
+            chunk = "part" + std::to_string((*n)++);
+            return *n < 3;
+        };
+        return r;
+    });
+    server.route("GET", "/ping", [](const HttpServer::Request&) { return text("pong"); });
+    ASSERT_EQ(server.start(), Result::kOk);
+
+    int fd = connect_to(server.port());
+    ASSERT_GE(fd, 0);
+    send_str(fd, "GET /stream HTTP/1.1\r\n\r\n");
+    std::string resp = read_response(fd);
+    EXPECT_NE(resp.find("Transfer-Encoding: chunked"), std::string::npos);
+    EXPECT_EQ(body_of(resp), "5\r\npart0\r\n5\r\npart1\r\n5\r\npart2\r\n0\r\n\r\n");
+
+    send_str(fd, "GET /ping HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(body_of(read_response(fd)), "pong");
+    close(fd);
+    server.stop();
+}
+
+TEST(HttpServerTest, Http10ClosesUnlessKeepAliveRequested) {
+    HttpServer server(test_config());
+    server.route("GET", "/ping", [](const HttpServer::Request&) { return text("pong"); });
+    ASSERT_EQ(server.start(), Result::kOk);
+
+    int fd = connect_to(server.port());
+    ASSERT_GE(fd, 0);
+    send_str(fd, "GET /ping HTTP/1.0\r\n\r\n");
+    std::string resp = read_response(fd);
+    EXPECT_NE(resp.find("Connection: close"), std::string::npos);
+    char c;
+    EXPECT_EQ(recv(fd, &c, 1, 0), 0);   // Server closed
+    close(fd);
+    server.stop();
+}
+
+TEST(HttpServerTest, Http10StreamIsCloseDelimited) {
+    HttpServer server(test_config());
+    server.route("GET", "/stream", [](const HttpServer::Request&) {
+        HttpServer::Response r;
+        auto n = std::make_shared<int>(0);
+        r.stream = [n](std::string& chunk) {
+            chunk = "part" + std::to_string((*n)++);
+            return *n < 3;
+        };
+        return r;
+    });
+    ASSERT_EQ(server.start(), Result::kOk);
+
+    int fd = connect_to(server.port());
+    ASSERT_GE(fd, 0);
+    send_str(fd, "GET /stream HTTP/1.0\r\nConnection: keep-alive\r\n\r\n");
+    std::string resp = read_response(fd);   // No framing: reads to EOF
+    EXPECT_EQ(resp.find("Transfer-Encoding"), std::string::npos);
+    EXPECT_NE(resp.find("Connection: close"), std::string::npos);
+    EXPECT_EQ(body_of(resp), "part0part1part2");
+    close(fd);
+    server.stop();
+}
@@ -0,0 +1,86 @@
+
+// =============================================================================
+// FILE: tests/test_latency_histogram.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "common/latency_histogram.h"
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace sip_processor;
+
+TEST(LatencyHistogramTest, BucketsAreMonotonicWithBoundedError) {
+    size_t prev = 0;
+    for (uint64_t v = 0; v < 5000000; v = v < 100 ? v + 1 : v + v / 7) {
+        size_t idx = LatencyHistogram::bucket_index(v);
+        ASSERT_LT(idx, LatencyHistogram::kBuckets);
+        EXPECT_GE(idx, prev);
+        prev = idx;
+
+        uint64_t upper = LatencyHistogram::bucket_upper(idx);
+        EXPECT_GE(upper, v);
+        EXPECT_LE(upper - v, v / 32 + 1) << "v=" << v;
+        EXPECT_EQ(LatencyHistogram::bucket_index(upper), idx);
+    }
+    EXPECT_EQ(LatencyHistogram::bucket_index(~uint64_t{0}), LatencyHistogram::kBuckets - 1);
+}
+
+TEST(LatencyHistogramTest, PercentilesOfUniformDistribution) {
+    LatencyHistogram h;
+    for (uint64_t v = 1; v <= 100000; ++v) h.record(v * 10);   // 10ns .. 1ms
+
+    LatencyHistogram::Snapshot s;
+    h.add_to(s);
+    EXPECT_EQ(s.count, 100000u);
+    EXPECT_EQ(s.max, 1000000u);
+    EXPECT_NEAR(static_cast<double>(s.percentile(50)), 500000.0, 500000.0 * 0.035);
+    EXPECT_NEAR(static_cast<double>(s.percentile(99)), 990000.0, 990000.0 * 0.035);
+    EXPECT_NEAR(static_cast<double>(s.percentile(99.9)), 999000.0, 999000.0 * 0.035);
+    EXPECT_EQ(s.percentile(100), 1000000u);
+    EXPECT_NEAR(s.mean(), 500005.0, 1.0);
+}
+
+TEST(LatencyRecorderTest, MergesLiveAndExitedThreads) {
+    auto& rec = LatencyRecorder::instance();
+    rec.reset();
+
+    constexpr int kThreads = 4;
+    constexpr int kPerThread = 10000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&rec, t] {
+            for (int i = 0; i < kPerThread; ++i) {
+                rec.record(LatencyStage::kQueueWait, static_cast<uint64_t>(1000 * (t + 1)));
+            }
+        });
+    }
+    for (auto& th : threads) th.join();   // All four have exited (retired)
+    rec.record(LatencyStage::kQueueWait, 5000);   // Live on this thread
+
+    auto s = rec.snapshot(LatencyStage::kQueueWait);
+    EXPECT_EQ(s.count, static_cast<uint64_t>(kThreads * kPerThread + 1));
+    EXPECT_NEAR(static_cast<double>(s.percentile(25)), 2000.0, 2000.0 * 0.035);
+    EXPECT_NEAR(static_cast<double>(s.percentile(99)), 4000.0, 4000.0 * 0.035);
+    EXPECT_EQ(rec.snapshot(LatencyStage::kMongoFlush).count, 0u);
+
+    rec.reset();
+    EXPECT_EQ(rec.snapshot(LatencyStage::kQueueWait).count, 0u);
+    rec.record(LatencyStage::kQueueWait, 700);
+    s = rec.snapshot(LatencyStage::kQueueWait);
+    EXPECT_EQ(s.count, 1u);
+    EXPECT_LE(s.max, LatencyHistogram::bucket_upper(LatencyHistogram::bucket_index(700)));
+}
+
+TEST(LatencyRecorderTest, IgnoresUnsetOrReversedTimestamps) {
+    auto& rec = LatencyRecorder::instance();
+    rec.reset();
+    auto now = Clock::now();
+    rec.record(LatencyStage::kPresenceToNotify, TimePoint{}, now);
+    rec.record(LatencyStage::kPresenceToNotify, now, now - Millisecs(1));
+    EXPECT_EQ(rec.snapshot(LatencyStage::kPresenceToNotify).count, 0u);
+    rec.record(LatencyStage::kPresenceToNotify, now - Millisecs(2), now);
+    auto s = rec.snapshot(LatencyStage::kPresenceToNotify);
+    EXPECT_EQ(s.count, 1u);
+    EXPECT_NEAR(static_cast<double>(s.max), 2e6, 2e6 * 0.035);
+}
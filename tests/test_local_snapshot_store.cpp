@@ -0,0 +1,192 @@
+
+// =============================================================================
+// FILE: tests/test_local_snapshot_store.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "persistence/local_snapshot_store.h"
+#include "persistence/subscription_codec.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace sip_processor;
+
+namespace {
+
+SubscriptionRecord make_record(const std::string& did, const std::string& uri) {
+    SubscriptionRecord rec;
+    rec.dialog_id = did;
+    rec.tenant_id = TenantId("test.com");
+    rec.type = SubscriptionType::kBLF;
+    rec.lifecycle = SubLifecycle::kActive;
+    rec.expires_at = Clock::now() + Seconds(3600);
+    rec.blf_monitored_uri = Symbol(uri);
+    rec.blf_notify_version = 7;
+    rec.call_id = "call-" + did;
+    rec.updated_at_ms = 1700000000000;
+    return rec;
+}
+
+} // namespace
+
+class LocalSnapshotTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char tmpl[] = "/tmp/snapshot_test_XXXXXX";
+        dir_ = mkdtemp(tmpl);
+        config_.snapshot_enabled = true;
+        config_.snapshot_directory = dir_;
+        config_.service_id = "unit";
+        config_.snapshot_journal_flush_interval = Millisecs(10);
+    }
+    void TearDown() override {
+        LocalSnapshotStore store(config_);
+        std::remove(store.snapshot_path().c_str());
+        std::remove(store.journal_path().c_str());
+        std::remove((store.journal_path() + ".compacting").c_str());
+        rmdir(dir_.c_str());
+    }
+
+    // Run `body` against a started store, then put back the files as they
+    // stood before stop() compacted them: exactly what a crash leaves.
+    template <typename Fn>
+    void run_and_crash(Fn body) {
+        std::vector<std::pair<std::string, std::string>> files;
+        {
+            LocalSnapshotStore store(config_);
+            ASSERT_EQ(store.start(), Result::kOk);
+            body(store);
+            std::this_thread::sleep_for(config_.snapshot_journal_flush_interval * 5);
+            for (const std::string& path : {store.snapshot_path(), store.journal_path()}) {
+                std::ifstream in(path, std::ios::binary);
+                files.emplace_back(path, std::string(std::istreambuf_iterator<char>(in), {}));
+            }
+        }
+        for (const auto& [path, data] : files) {
+            std::ofstream(path, std::ios::binary | std::ios::trunc) << data;
+        }
+    }
+
+    std::vector<SubscriptionRecord> load_sorted() {
+        LocalSnapshotStore store(config_);
+        std::vector<SubscriptionRecord> out;
+        EXPECT_EQ(store.load(out, 4), Result::kOk);
+        std::sort(out.begin(), out.end(), [](const auto& a, const auto& b) {
+            return a.dialog_id < b.dialog_id;
+        });
+        return out;
+    }
+
+    std::string dir_;
+    Config config_;
+};
+
+TEST(SubscriptionCodecTest, RoundTrip) {
+    auto rec = make_record("d1", "sip:200@test.com");
+    rec.mwi_new_messages = 3;
+    rec.notify_cseq = 42;
+
+    std::string buf;
+    SubscriptionCodec::encode(rec, buf);
+
+    SubscriptionRecord out;
+    ASSERT_TRUE(SubscriptionCodec::decode(buf.data(), buf.size(), out));
+    EXPECT_EQ(out.dialog_id, "d1");
+    EXPECT_EQ(out.tenant_id, "test.com");
+    EXPECT_EQ(out.type, SubscriptionType::kBLF);
+    EXPECT_EQ(out.lifecycle, SubLifecycle::kActive);
+    EXPECT_EQ(out.blf_monitored_uri, "sip:200@test.com");
+    EXPECT_EQ(out.blf_notify_version, 7u);
+    EXPECT_EQ(out.notify_cseq, 42u);
+    EXPECT_EQ(out.mwi_new_messages, 3);
+    EXPECT_EQ(out.updated_at_ms, 1700000000000);
+    EXPECT_FALSE(out.is_expired());
+
+    SubscriptionCodec::Summary sum;
+    ASSERT_TRUE(SubscriptionCodec::peek(buf.data(), buf.size(), sum));
+    EXPECT_EQ(sum.dialog_id, "d1");
+}
+
+TEST(SubscriptionCodecTest, RejectsTruncated) {
+    std::string buf;
+    SubscriptionCodec::encode(make_record("d1", "sip:200@test.com"), buf);
+    SubscriptionRecord out;
+    for (size_t len = 0; len < buf.size(); len += 7) {
+        EXPECT_FALSE(SubscriptionCodec::decode(buf.data(), len, out));
+    }
+}
+
+TEST_F(LocalSnapshotTest, JournalOnlyRecovery) {
+    run_and_crash([](LocalSnapshotStore& store) {
+        store.on_upsert(make_record("d1", "sip:200@test.com"));
+        store.on_upsert(make_record("d2", "sip:201@test.com"));
+        store.on_delete("d1");
+        store.on_upsert(make_record("d3", "sip:202@test.com"));
+    });
+
+    auto recs = load_sorted();
+    ASSERT_EQ(recs.size(), 2u);
+    EXPECT_EQ(recs[0].dialog_id, "d2");
+    EXPECT_EQ(recs[1].dialog_id, "d3");
+}
+
+TEST_F(LocalSnapshotTest, JournalOverridesSnapshot) {
+    LocalSnapshotStore store(config_);
+    ASSERT_EQ(store.start(), Result::kOk);
+    store.on_upsert(make_record("d1", "sip:200@test.com"));
+    store.compact();
+
+    auto updated = make_record("d1", "sip:200@test.com");
+    updated.blf_notify_version = 99;
+    store.on_upsert(updated);
+    store.stop();
+
+    auto recs = load_sorted();
+    ASSERT_EQ(recs.size(), 1u);
+    EXPECT_EQ(recs[0].blf_notify_version, 99u);
+}
+
+TEST_F(LocalSnapshotTest, DropsTerminatedAndExpired) {
+    LocalSnapshotStore store(config_);
+    ASSERT_EQ(store.start(), Result::kOk);
+    auto terminated = make_record("d1", "sip:200@test.com");
+    terminated.lifecycle = SubLifecycle::kTerminated;
+    auto expired = make_record("d2", "sip:201@test.com");
+    expired.expires_at = Clock::now() - Seconds(5);
+    store.on_upsert(terminated);
+    store.on_upsert(expired);
+    store.on_upsert(make_record("d3", "sip:202@test.com"));
+    store.stop();
+
+    auto recs = load_sorted();
+    ASSERT_EQ(recs.size(), 1u);
+    EXPECT_EQ(recs[0].dialog_id, "d3");
+}
+
+TEST_F(LocalSnapshotTest, TornJournalTailIgnored) {
+    run_and_crash([](LocalSnapshotStore& store) {
+        store.on_upsert(make_record("d1", "sip:200@test.com"));
+        store.on_upsert(make_record("d2", "sip:201@test.com"));
+        store.compact();  // Both into the snapshot; journal is empty
+        store.on_upsert(make_record("d3", "sip:202@test.com"));
+        store.on_upsert(make_record("d4", "sip:203@test.com"));
+    });
+    // Tear the last journal frame as a crash mid-write would
+    LocalSnapshotStore probe(config_);
+    FILE* f = std::fopen(probe.journal_path().c_str(), "r+");
+    ASSERT_NE(f, nullptr);
+    std::fseek(f, 0, SEEK_END);
+    long size = std::ftell(f);
+    std::fclose(f);
+    ASSERT_EQ(truncate(probe.journal_path().c_str(), size - 5), 0);
+
+    auto recs = load_sorted();
+    ASSERT_EQ(recs.size(), 3u);
+    EXPECT_EQ(recs[2].dialog_id, "d3");
+}
@@ -0,0 +1,201 @@
+
+// =============================================================================
+// FILE: tests/test_logger.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "common/logger.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace sip_processor;
+
+class AsyncLoggerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char tmpl[] = "/tmp/logger_test_XXXXXX";
+        dir_ = mkdtemp(tmpl);
+        saved_level_ = Logger::instance().level();
+        Logger::instance().set_level(LogLevel::kInfo);
+    }
+    void TearDown() override {
+        Logger::instance().shutdown();
+        Logger::instance().set_level(saved_level_);
+        for (const char* suffix : {".log", "_debug.log", "_error.log", "_slow.log"}) {
+            std::remove((dir_ + "/test" + suffix).c_str());
+        }
+        rmdir(dir_.c_str());
+    }
+
+    void configure(const AsyncLogConfig& async) {
+        Logger::instance().configure(dir_, "test", LogLevel::kFatal, 0, 1, async);
+    }
+
+    std::vector<std::string> read_lines(const std::string& suffix) {
+        std::ifstream f(dir_ + "/test" + suffix);
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(f, line);) lines.push_back(line);
+        return lines;
+    }
+
+    std::string dir_;
+    LogLevel saved_level_ = LogLevel::kInfo;
+};
+
+TEST_F(AsyncLoggerTest, WritesEveryLineInPerThreadOrder) {
+    AsyncLogConfig async;
+    async.thread_buffer_bytes = 1 << 20;   // Large enough that nothing drops
+    configure(async);
+    ASSERT_TRUE(Logger::instance().async());
+
+    constexpr int kThreads = 4;
+    constexpr int kPerThread = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < kPerThread; ++i) LOG_INFO("writer=%d seq=%d", t, i);
+        });
+    }
+    for (auto& th : threads) th.join();
+    LOG_SLOW("slow marker");
+    Logger::instance().flush_all();
+
+    std::map<int, int> next;
+    size_t count = 0;
+    for (const auto& line : read_lines(".log")) {
+        int t = -1, i = -1;
+        auto pos = line.find("writer=");
+        if (pos == std::string::npos) continue;
+        ASSERT_EQ(std::sscanf(line.c_str() + pos, "writer=%d seq=%d", &t, &i), 2);
+        EXPECT_EQ(i, next[t]++) << line;
+        ++count;
+    }
+    EXPECT_EQ(count, static_cast<size_t>(kThreads * kPerThread));
+
+    auto slow = read_lines("_slow.log");
+    ASSERT_EQ(slow.size(), 1u);
+    EXPECT_NE(slow[0].find("[WARN]"), std::string::npos);
+    EXPECT_NE(slow[0].find("slow marker"), std::string::npos);
+}
+
+TEST_F(AsyncLoggerTest, FullRingDropsWithoutBlocking) {
+    AsyncLogConfig async;
+    async.thread_buffer_bytes = 16 * 1024;
+    async.overflow = LogOverflowPolicy::kCount;
+    configure(async);
+
+    const auto& st = Logger::instance().stats();
+    uint64_t written0 = st.written.load();
+    uint64_t dropped0 = st.dropped.load();
+
+    // Each message takes ~1/5 of the ring; the burst cannot fit
+    constexpr int kMessages = 500;
+    std::string payload(3000, 'x');
+    std::thread producer([&] {
+        for (int i = 0; i < kMessages; ++i) LOG_INFO("%s", payload.c_str());
+    });
+    producer.join();
+    Logger::instance().flush_all();
+
+    uint64_t written = st.written.load() - written0;
+    uint64_t dropped = st.dropped.load() - dropped0;
+    size_t payload_lines = 0, notices = 0;
+    for (const auto& line : read_lines(".log")) {
+        if (line.find(payload) != std::string::npos) ++payload_lines;
+        if (line.find("messages dropped") != std::string::npos) ++notices;
+    }
+    EXPECT_EQ(payload_lines + dropped, static_cast<size_t>(kMessages));
+    EXPECT_EQ(written, payload_lines + notices);
+    EXPECT_EQ(notices > 0, dropped > 0);
+}
+
+TEST_F(AsyncLoggerTest, SynchronousModeWritesImmediately) {
+    AsyncLogConfig async;
+    async.enabled = false;
+    configure(async);
+    EXPECT_FALSE(Logger::instance().async());
+
+    LOG_ERROR("sync error %d", 7);
+    auto main_lines = read_lines(".log");
+    auto error_lines = read_lines("_error.log");
+    ASSERT_EQ(main_lines.size(), 1u);
+    ASSERT_EQ(error_lines.size(), 1u);
+    EXPECT_NE(error_lines[0].find("[ERROR]"), std::string::npos);
+    EXPECT_NE(error_lines[0].find("sync error 7"), std::string::npos);
+}
+
+TEST_F(AsyncLoggerTest, DeferredFormattingMatchesPrintf) {
+    for (bool async_enabled : {false, true}) {
+        AsyncLogConfig async;
+        async.enabled = async_enabled;
+        configure(async);
+
+        char expected[512];
+        std::string name = "alice";
+        char arr[16] = "arr";
+        const char* null_str = nullptr;
+        snprintf(expected, sizeof(expected),
+                 "%d|%5u|%-6s|%08.3f|%x|%lu|%zu|%c|%%|%.*s|%lld|%s|%+.2e|%s",
+                 -42, 7u, name.c_str(), 3.14159, 255u, 123456789UL, size_t{99}, 'z', 3, "abcdef",
+                 -9000000000LL, arr, 12345.678, "(null)");
+        LOG_INFO("%d|%5u|%-6s|%08.3f|%x|%lu|%zu|%c|%%|%.*s|%lld|%s|%+.2e|%s",
+                 -42, 7u, name.c_str(), 3.14159, 255u, 123456789UL, size_t{99}, 'z', 3, "abcdef",
+                 -9000000000LL, arr, 12345.678, null_str);
+        Logger::instance().flush_all();
+
+        auto lines = read_lines(".log");
+        ASSERT_FALSE(lines.empty());
+        const std::string& line = lines.back();
+        EXPECT_NE(line.find("[INFO]"), std::string::npos);
+        EXPECT_NE(line.find("[test_logger.cpp:"), std::string::npos);
+        ASSERT_GE(line.size(), strlen(expected));
+        EXPECT_EQ(line.substr(line.size() - strlen(expected)), expected) << line;
+
+        Logger::instance().shutdown();
+        std::remove((dir_ + "/test.log").c_str());
+    }
+}
+
+TEST_F(AsyncLoggerTest, DisabledLevelSkipsArgumentEvaluation) {
+    int evaluated = 0;
+    auto touch = [&] { return ++evaluated; };
+    Logger::instance().set_level(LogLevel::kWarn);
+    LOG_DEBUG("value=%d", touch());
+    LOG_INFO("value=%d", touch());
+    EXPECT_EQ(evaluated, 0);
+    EXPECT_FALSE(Logger::enabled(LogLevel::kInfo));
+    EXPECT_TRUE(Logger::enabled(LogLevel::kError));
+}
+
+static_assert(log_bounded_string_args("%d %.*s %s") == 0b100, "string after its precision");
+static_assert(log_bounded_string_args("%*d|%.*s|%.3s|%%|%-*.*s") == 0b10001000, "widths take arguments too");
+static_assert(log_bounded_string_args("%s %.*d %lu%") == 0, "only strings are bounded");
+
+TEST_F(AsyncLoggerTest, StarPrecisionReadsOnlyThatManyBytes) {
+    for (bool async_enabled : {false, true}) {
+        AsyncLogConfig async;
+        async.enabled = async_enabled;
+        configure(async);
+
+        // Not NUL-terminated: a strlen would run into the guard bytes
+        char buf[8];
+        memset(buf, 'x', sizeof(buf));
+        memcpy(buf, "abc", 3);
+        std::string field = "hello world";
+        LOG_INFO("bounded=[%.*s] view=[%.*s] tail=%s", 3, buf, 5, field.c_str(), "ok");
+        Logger::instance().flush_all();
+
+        auto lines = read_lines(".log");
+        ASSERT_FALSE(lines.empty());
+        EXPECT_NE(lines.back().find("bounded=[abc] view=[hello] tail=ok"), std::string::npos) << lines.back();
+
+        Logger::instance().shutdown();
+        std::remove((dir_ + "/test.log").c_str());
+    }
+}
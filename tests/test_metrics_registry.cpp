@@ -0,0 +1,122 @@
+
+// =============================================================================
+// FILE: tests/test_metrics_registry.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "common/metrics_registry.h"
+#include "common/latency_histogram.h"
+#include "subscription/subscription_state.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sip_processor;
+
+namespace {
+struct FakeStats {
+    std::atomic<uint64_t> handled{0};
+    std::atomic<uint64_t> depth{0};
+};
+const MetricField<FakeStats> kFakeMetrics[] = {
+    {"test_fake_handled", MetricType::kCounter, "Handled items", &FakeStats::handled},
+    {"test_fake_depth", MetricType::kGauge, "Queue depth", &FakeStats::depth},
+};
+}  // namespace
+
+TEST(MetricsRegistryTest, RendersRegisteredFieldsInPlace) {
+    auto& reg = MetricsRegistry::instance();
+    FakeStats a, b;
+    std::string la, lb;
+    MetricsWriter::add_label(la, "worker", "0");
+    MetricsWriter::add_label(lb, "worker", "1");
+    reg.add_fields(&a, a, kFakeMetrics, la);
+    reg.add_fields(&b, b, kFakeMetrics, lb);
+    a.handled = 5;
+    b.handled = 7;
+    b.depth = 3;
+
+    std::string out;
+    reg.render(out);
+    EXPECT_NE(out.find("# TYPE test_fake_handled counter\n# HELP test_fake_handled Handled items\n"
+                       "test_fake_handled_total{worker=\"0\"} 5\n"
+                       "test_fake_handled_total{worker=\"1\"} 7\n"), std::string::npos) << out;
+    EXPECT_NE(out.find("test_fake_depth{worker=\"1\"} 3\n"), std::string::npos);
+    EXPECT_EQ(out.substr(out.size() - 6), "# EOF\n");
+
+    // Values are read at scrape time, and the buffer is reused
+    a.handled = 6;
+    const char* data = out.data();
+    size_t cap = out.capacity();
+    reg.render(out);
+    EXPECT_NE(out.find("test_fake_handled_total{worker=\"0\"} 6\n"), std::string::npos);
+    EXPECT_EQ(out.capacity(), cap);
+    EXPECT_EQ(out.data(), data);
+
+    reg.unregister(&a);
+    reg.unregister(&b);
+    reg.render(out);
+    EXPECT_EQ(out.find("test_fake_"), std::string::npos);
+}
+
+TEST(MetricsRegistryTest, EscapesLabelValues) {
+    std::string labels;
+    MetricsWriter::add_label(labels, "tenant", "a\"b\\c\nd");
+    MetricsWriter::add_label(labels, "type", "BLF");
+    EXPECT_EQ(labels, "tenant=\"a\\\"b\\\\c\\nd\",type=\"BLF\"");
+}
+
+TEST(MetricsRegistryTest, ExposesLatencyHistogramsAndTenants) {
+    auto& rec = LatencyRecorder::instance();
+    std::thread worker([&rec] {
+        rec.set_thread_worker(3);
+        rec.record(LatencyStage::kProcessEvent, 20000);     // 20us
+        rec.record(LatencyStage::kProcessEvent, 3000000);   // 3ms
+    });
+    worker.join();
+    std::thread other([&rec] { rec.record(LatencyStage::kMongoFlush, 1000); });
+    other.join();
+
+    auto& subs = SubscriptionRegistry::instance();
+    subs.register_subscription("metrics-1", {"metrics-1", TenantId("t-metrics"), SubscriptionType::kBLF,
+                                             SubLifecycle::kActive, Clock::now(), 0});
+
+    std::string out;
+    MetricsRegistry::instance().render(out);
+    EXPECT_NE(out.find("# TYPE sip_processor_stage_latency_seconds histogram\n"), std::string::npos);
+    // Exited threads fold into the unlabelled series
+    const std::string series = "sip_processor_stage_latency_seconds_bucket{stage=\"process_event\"";
+    EXPECT_NE(out.find(series + ",le=\"2.5e-05\"}"), std::string::npos) << out;
+    EXPECT_NE(out.find("sip_processor_stage_latency_seconds_bucket{stage=\"mongo_flush\",le=\"+Inf\"}"),
+              std::string::npos);
+    EXPECT_NE(out.find("sip_processor_tenant_subscriptions{tenant=\"t-metrics\"} 1\n"), std::string::npos);
+    EXPECT_NE(out.find("sip_processor_subscriptions{type=\"BLF\"}"), std::string::npos);
+
+    subs.unregister_subscription("metrics-1");
+}
+
+TEST(MetricsRegistryTest, GroupsLiveThreadsByWorker) {
+    auto& rec = LatencyRecorder::instance();
+    std::atomic<bool> recorded{false}, done{false};
+    std::thread worker([&] {
+        rec.set_thread_worker(5);
+        rec.record(LatencyStage::kQueueWait, 4000);
+        recorded = true;
+        while (!done) std::this_thread::yield();
+    });
+    while (!recorded) std::this_thread::yield();
+
+    std::vector<LatencyRecorder::WorkerSnapshot> groups;
+    rec.snapshot_by_worker(LatencyStage::kQueueWait, groups);
+    bool found = false;
+    for (const auto& g : groups) {
+        if (g.worker == 5) { found = true; EXPECT_EQ(g.snap.count, 1u); }
+    }
+    EXPECT_TRUE(found);
+
+    std::string out;
+    MetricsRegistry::instance().render(out);
+    EXPECT_NE(out.find("sip_processor_stage_latency_seconds_count{stage=\"queue_wait\",worker=\"5\"} 1\n"),
+              std::string::npos) << out;
+    done = true;
+    worker.join();
+}
@@ -4,17 +4,164 @@
 // =============================================================================
 #include <gtest/gtest.h>
 #include "subscription/mwi_processor.h"
+#include <climits>
+#include <random>
+#include <string>
+
+using namespace sip_processor;
+using Summary = MwiProcessor::MessageSummary;
 
-// Since parse_message_summary is private, we test via the public process() path
-// or make a test-accessible subclass. Here's a simple body parse test:
 TEST(MwiParser, ParsesVoiceMessage) {
-    // Test the format parsing through a mock event
     std::string body =
         "Messages-Waiting: yes\r\n"
         "Message-Account: sip:user@test.com\r\n"
         "Voice-Message: 3/7 (1/2)\r\n";
 
-    // Verify format is parseable (the actual parsing happens in MwiProcessor)
-    EXPECT_NE(body.find("Messages-Waiting: yes"), std::string::npos);
-    EXPECT_NE(body.find("Voice-Message:"), std::string::npos);
-}
\ No newline at end of file
+    Summary s = MwiProcessor::parse_message_summary(body);
+    ASSERT_TRUE(s.valid);
+    EXPECT_TRUE(s.messages_waiting);
+    EXPECT_EQ(s.account, "sip:user@test.com");
+    EXPECT_TRUE(s.has(MwiProcessor::kVoice));
+    EXPECT_EQ(s.voice().new_messages, 3);
+    EXPECT_EQ(s.voice().old_messages, 7);
+    EXPECT_EQ(s.voice().new_urgent, 1);
+    EXPECT_EQ(s.voice().old_urgent, 2);
+}
+
+TEST(MwiParser, ParsesOptionalClassesCaseInsensitively) {
+    std::string body =
+        "MESSAGES-WAITING:No\n"
+        "  fax-message :2/0\n"
+        "Pager-Message: 0/4(0/1)\n"
+        "multimedia-MESSAGE:   12 / 30 ( 2 / 3 )\n"
+        "Text-Message: 1/1\n";
+
+    Summary s = MwiProcessor::parse_message_summary(body);
+    ASSERT_TRUE(s.valid);
+    EXPECT_FALSE(s.messages_waiting);
+    EXPECT_FALSE(s.has(MwiProcessor::kVoice));
+    EXPECT_EQ(s.counts[MwiProcessor::kFax].new_messages, 2);
+    EXPECT_EQ(s.counts[MwiProcessor::kPager].old_messages, 4);
+    EXPECT_EQ(s.counts[MwiProcessor::kPager].old_urgent, 1);
+    EXPECT_EQ(s.counts[MwiProcessor::kMultimedia].new_messages, 12);
+    EXPECT_EQ(s.counts[MwiProcessor::kMultimedia].old_messages, 30);
+    EXPECT_EQ(s.counts[MwiProcessor::kMultimedia].new_urgent, 2);
+    EXPECT_EQ(s.counts[MwiProcessor::kMultimedia].old_urgent, 3);
+    EXPECT_TRUE(s.has(MwiProcessor::kText));
+}
+
+TEST(MwiParser, SkipsMalformedLines) {
+    std::string body =
+        "Voice-Message: three/7\r\n"
+        "Voice-Messages: 1/1\r\n"
+        "Fax-Message: 5/\r\n"
+        "Pager-Message: 4/2 (1/\r\n"
+        "garbage without colon\r\n"
+        "Voice-Message: 99999999999999999999/1\r\n";
+
+    Summary s = MwiProcessor::parse_message_summary(body);
+    ASSERT_TRUE(s.valid);
+    EXPECT_FALSE(s.has(MwiProcessor::kFax));
+    EXPECT_EQ(s.voice().new_messages, INT_MAX);   // Saturated
+    EXPECT_EQ(s.voice().old_messages, 1);
+    EXPECT_EQ(s.counts[MwiProcessor::kPager].new_messages, 4);
+    EXPECT_EQ(s.counts[MwiProcessor::kPager].new_urgent, 0);   // Urgent group dropped
+    EXPECT_FALSE(MwiProcessor::parse_message_summary("Message-Account: sip:a@b\r\n").valid);
+    EXPECT_FALSE(MwiProcessor::parse_message_summary("").valid);
+}
+
+TEST(MwiParser, UpdatesRecordThroughNotify) {
+    MwiProcessor proc;
+    SubscriptionRecord rec;
+    rec.tenant_id = TenantId("test.com");
+    SipEvent ev;
+    ev.category = SipEventCategory::kNotify;
+    ev.body = "Messages-Waiting: yes\r\nMessage-Account: sip:vm@test.com\r\nVoice-Message: 2/5\r\n";
+    ASSERT_EQ(proc.process(ev, rec), Result::kOk);
+    EXPECT_EQ(rec.mwi_new_messages, 2);
+    EXPECT_EQ(rec.mwi_old_messages, 5);
+    EXPECT_EQ(rec.mwi_account_uri, "sip:vm@test.com");
+}
+
+TEST(MwiParser, AdoptsUnseenMailboxInOwnDomain) {
+    MwiProcessor proc;
+    SubscriptionRecord rec;
+    rec.mwi_account_uri = "sip:100@Test.com:5060";
+    SipEvent ev;
+    ev.category = SipEventCategory::kNotify;
+    ev.body = "Messages-Waiting: yes\r\nMessage-Account: <sip:vm-100@test.com>\r\nVoice-Message: 1/0\r\n";
+    ASSERT_EQ(proc.process(ev, rec), Result::kOk);
+    EXPECT_EQ(rec.mwi_account_uri, "<sip:vm-100@test.com>");
+}
+
+TEST(MwiParser, IgnoresForeignAccountFromPeerBody) {
+    MwiProcessor proc;
+    SubscriptionRecord rec;
+    rec.tenant_id = TenantId("test.com");
+    rec.mwi_account_uri = "sip:100@test.com";
+    SipEvent ev;
+    ev.category = SipEventCategory::kNotify;
+    ev.body = "Messages-Waiting: yes\r\nMessage-Account: sip:never-subscribed@elsewhere.com\r\nVoice-Message: 1/0\r\n";
+
+    size_t interned = StringInterner::instance().size();
+    ASSERT_EQ(proc.process(ev, rec), Result::kOk);
+    EXPECT_EQ(rec.mwi_new_messages, 1);
+    EXPECT_EQ(rec.mwi_account_uri, "sip:100@test.com");
+    EXPECT_EQ(StringInterner::instance().size(), interned);
+}
+
+// Mutates valid bodies and throws random bytes at the parser. Every view it
+// returns must stay inside the input and every count must be non-negative.
+TEST(MwiParser, FuzzNeverReadsOutsideBody) {
+    const std::string seeds[] = {
+        "Messages-Waiting: yes\r\nMessage-Account: sip:u@t.com\r\nVoice-Message: 3/7 (1/2)\r\n",
+        "messages-waiting:no\nfax-message:0/0\npager-message: 10/20 (3/4)\n",
+        "Multimedia-Message: 1/2\r\nText-Message: 4/5 (0/0)",
+    };
+    const char alphabet[] = "0123456789/() :\r\n\t-abcMVyYe\xff";
+    std::mt19937 rng(0x3842);
+
+    for (int iter = 0; iter < 20000; ++iter) {
+        std::string body = seeds[iter % 3];
+        int edits = 1 + static_cast<int>(rng() % 8);
+        for (int e = 0; e < edits && !body.empty(); ++e) {
+            size_t pos = rng() % body.size();
+            switch (rng() % 4) {
+                case 0: body[pos] = alphabet[rng() % (sizeof(alphabet) - 1)]; break;
+                case 1: body.erase(pos, 1 + rng() % 4); break;
+                case 2: body.insert(pos, 1, alphabet[rng() % (sizeof(alphabet) - 1)]); break;
+                case 3: body.resize(pos); break;
+            }
+        }
+        if (iter % 10 == 0) {
+            body.resize(rng() % 256);
+            for (auto& c : body) c = static_cast<char>(rng());
+        }
+
+        std::string_view view(body);
+        Summary s = MwiProcessor::parse_message_summary(view);
+        if (!s.account.empty()) {
+            ASSERT_GE(s.account.data(), view.data());
+            ASSERT_LE(s.account.data() + s.account.size(), view.data() + view.size());
+        }
+        for (const auto& c : s.counts) {
+            ASSERT_GE(c.new_messages, 0);
+            ASSERT_GE(c.old_messages, 0);
+            ASSERT_GE(c.new_urgent, 0);
+            ASSERT_GE(c.old_urgent, 0);
+        }
+        ASSERT_TRUE(s.classes == 0 || s.valid);
+    }
+}
+
+TEST(MwiParser, FeedUpdateKeepsAccountAndReportsChange) {
+    MwiProcessor proc;
+    SubscriptionRecord rec;
+    rec.mwi_account_uri = "sip:100@test.com";
+    std::string body = "Messages-Waiting: yes\r\nMessage-Account: sip:vm@test.com\r\nVoice-Message: 1/0\r\n";
+    EXPECT_TRUE(proc.apply_feed_update(body, rec));
+    EXPECT_EQ(rec.mwi_new_messages, 1);
+    EXPECT_EQ(rec.mwi_account_uri, "sip:100@test.com");
+    EXPECT_FALSE(proc.apply_feed_update(body, rec));   // Unchanged
+    EXPECT_FALSE(proc.apply_feed_update("Voice-Message: x\r\n", rec));
+}
@@ -0,0 +1,66 @@
+
+// =============================================================================
+// FILE: tests/test_mwi_subscription_index.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "subscription/mwi_subscription_index.h"
+
+using namespace sip_processor;
+
+class MwiIndexTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        auto& idx = MwiSubscriptionIndex::instance();
+        idx.remove_dialog("mwi-dialog-1");
+        idx.remove_dialog("mwi-dialog-2");
+        idx.remove_dialog("mwi-dialog-3");
+    }
+};
+
+TEST_F(MwiIndexTest, LooksUpAllWatchersOfAMailbox) {
+    auto& idx = MwiSubscriptionIndex::instance();
+    idx.add("sip:vm100@Voicemail.test.com", "mwi-dialog-1", TenantId("tenant-a"));
+    idx.add("<sip:vm100@voicemail.test.com:5060>", "mwi-dialog-2", TenantId("tenant-a"));
+    idx.add("sip:vm200@voicemail.test.com", "mwi-dialog-3", TenantId("tenant-a"));
+
+    auto watchers = idx.lookup("sip:vm100@VOICEMAIL.test.com;transport=tcp");
+    ASSERT_EQ(watchers.size(), 2u);
+    EXPECT_EQ(idx.lookup("sip:vm200@voicemail.test.com").size(), 1u);
+    EXPECT_TRUE(idx.lookup("sip:vm300@voicemail.test.com").empty());
+}
+
+TEST_F(MwiIndexTest, TenantScopedLookupFiltersOtherTenants) {
+    auto& idx = MwiSubscriptionIndex::instance();
+    idx.add("sip:vm100@test.com", "mwi-dialog-1", TenantId("tenant-a"));
+    idx.add("sip:vm100@test.com", "mwi-dialog-2", TenantId("tenant-b"));
+
+    auto a = idx.lookup("sip:vm100@test.com", TenantId("tenant-a"));
+    ASSERT_EQ(a.size(), 1u);
+    EXPECT_EQ(a[0].dialog_id, "mwi-dialog-1");
+    EXPECT_EQ(idx.lookup("sip:vm100@test.com").size(), 2u);
+
+    // Feed text for a tenant nobody subscribed from is not interned
+    size_t interned = StringInterner::instance().size();
+    EXPECT_TRUE(idx.lookup("sip:vm100@test.com", "tenant-never-seen").empty());
+    EXPECT_EQ(idx.lookup("sip:vm100@test.com", "tenant-b").size(), 1u);
+    EXPECT_EQ(StringInterner::instance().size(), interned);
+}
+
+TEST_F(MwiIndexTest, ReAddMovesDialogAndRemoveDropsAccount) {
+    auto& idx = MwiSubscriptionIndex::instance();
+    size_t accounts = idx.account_count();
+    size_t watchers = idx.total_watcher_count();
+
+    idx.add("sip:vm100@test.com", "mwi-dialog-1", TenantId("tenant-a"));
+    idx.add("sip:vm100@test.com", "mwi-dialog-1", TenantId("tenant-a"));   // Duplicate
+    EXPECT_EQ(idx.total_watcher_count(), watchers + 1);
+
+    idx.add("sip:vm101@test.com", "mwi-dialog-1", TenantId("tenant-a"));   // Account changed
+    EXPECT_TRUE(idx.lookup("sip:vm100@test.com").empty());
+    EXPECT_EQ(idx.lookup("sip:vm101@test.com").size(), 1u);
+    EXPECT_EQ(idx.account_count(), accounts + 1);
+
+    idx.remove_dialog("mwi-dialog-1");
+    EXPECT_EQ(idx.account_count(), accounts);
+    EXPECT_EQ(idx.total_watcher_count(), watchers);
+}
@@ -0,0 +1,73 @@
+// =============================================================================
+// FILE: tests/test_notify_backlog.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "sip/notify_backlog.h"
+#include <thread>
+#include <vector>
+
+using namespace sip_processor;
+
+namespace {
+// Distinct, never dereferenced
+const void* handle(uintptr_t i) { return reinterpret_cast<const void*>(0x10000 + i * 64); }
+}
+
+TEST(NotifyBacklog, ResponsesAndReleasesDrainIt) {
+    TimePoint t0 = Clock::now();
+    NotifyBacklog backlog(Seconds(64), t0);
+    backlog.on_sent(handle(1), t0);
+    backlog.on_sent(handle(1), t0);
+    backlog.on_sent(handle(2), t0 + Seconds(1));
+    EXPECT_EQ(backlog.outstanding(), 3);
+
+    backlog.on_response(handle(1));
+    EXPECT_EQ(backlog.outstanding(), 2);
+    backlog.forget(handle(1));
+    EXPECT_EQ(backlog.outstanding(), 1);
+    // Nothing left on handle 1: a late response does not count twice
+    backlog.on_response(handle(1));
+    EXPECT_EQ(backlog.outstanding(), 1);
+    backlog.on_response(handle(2));
+    EXPECT_EQ(backlog.outstanding(), 0);
+    EXPECT_EQ(backlog.expire(t0 + Seconds(200)), 0);
+}
+
+TEST(NotifyBacklog, UnansweredNotifiesExpireAfterTimeout) {
+    TimePoint t0 = Clock::now();
+    NotifyBacklog backlog(Seconds(64), t0);
+    backlog.on_sent(handle(1), t0);
+    backlog.on_sent(handle(2), t0 + Seconds(10));
+    EXPECT_EQ(backlog.expire(t0 + Seconds(63)), 0);
+    EXPECT_EQ(backlog.expire(t0 + Seconds(65)), 1);
+    EXPECT_EQ(backlog.outstanding(), 1);
+
+    // A response takes the oldest still counted
+    backlog.on_response(handle(2));
+    EXPECT_EQ(backlog.outstanding(), 0);
+    EXPECT_EQ(backlog.expire(t0 + Seconds(80)), 0);
+}
+
+TEST(NotifyBacklog, LongStallExpiresEverything) {
+    TimePoint t0 = Clock::now();
+    NotifyBacklog backlog(Seconds(64), t0);
+    for (int s = 0; s < 100; ++s) backlog.on_sent(handle(s), t0 + Seconds(s));
+    EXPECT_EQ(backlog.expire(t0 + Seconds(1000)), 100);
+    EXPECT_EQ(backlog.outstanding(), 0);
+}
+
+TEST(NotifyBacklog, ConcurrentSendersBalance) {
+    NotifyBacklog backlog(Seconds(64));
+    std::vector<std::thread> threads;
+    for (uintptr_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&backlog, t] {
+            for (uintptr_t i = 0; i < 10000; ++i) {
+                const void* h = handle(t * 100000 + i % 50);
+                backlog.on_sent(h);
+                backlog.on_response(h);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    EXPECT_EQ(backlog.outstanding(), 0);
+}
@@ -0,0 +1,136 @@
+
+// =============================================================================
+// FILE: tests/test_overload_controller.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "dispatch/overload_controller.h"
+#include "dispatch/dialog_dispatcher.h"
+#include "common/slow_event_logger.h"
+#include "common/logger.h"
+#include "test_helpers.h"
+#include <chrono>
+#include <thread>
+
+using namespace sip_processor;
+
+namespace {
+
+Config overload_config() {
+    Config c = test::worker_config();
+    c.overload_queue_fill_pct = 80;
+    c.overload_elevated_pct = 50;
+    c.overload_shed_pct = 75;
+    return c;
+}
+
+OverloadController::Signals fill(double f) {
+    OverloadController::Signals s;
+    s.queue_fill = f;
+    return s;
+}
+
+std::unique_ptr<SipEvent> subscribe(const std::string& did) {
+    return test::subscribe(did, "overload.com", 600);
+}
+
+}  // namespace
+
+TEST(OverloadController, LevelFollowsPressureWithHysteresis) {
+    Logger::instance().set_level(LogLevel::kError);
+    Config cfg = overload_config();
+    DialogDispatcher dispatcher(cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    OverloadController ov(cfg, dispatcher);
+
+    EXPECT_DOUBLE_EQ(ov.pressure(fill(0.4)), 0.5);
+    ov.update(fill(0.45));
+    EXPECT_EQ(ov.level(), OverloadLevel::kElevated);
+    ov.update(fill(0.85));                       // Jumps straight to critical
+    EXPECT_EQ(ov.level(), OverloadLevel::kCritical);
+    ov.update(fill(0.76));                       // 95%: inside the hysteresis margin
+    EXPECT_EQ(ov.level(), OverloadLevel::kCritical);
+    ov.update(fill(0.7));                        // 87.5%: one step down
+    EXPECT_EQ(ov.level(), OverloadLevel::kShedding);
+    ov.update(fill(0.0));
+    EXPECT_EQ(ov.level(), OverloadLevel::kElevated);
+    ov.update(fill(0.0));
+    EXPECT_EQ(ov.level(), OverloadLevel::kNormal);
+    EXPECT_EQ(ov.stats().level_changes.load(), 5u);
+
+    // Any signal can carry the pressure
+    OverloadController::Signals wait;
+    wait.queue_wait_p99_us = 250000;
+    EXPECT_DOUBLE_EQ(ov.pressure(wait), 1.25);
+}
+
+TEST(OverloadController, ShedsAGrowingShareOfNewSubscriptions) {
+    Config cfg = overload_config();
+    DialogDispatcher dispatcher(cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    OverloadController ov(cfg, dispatcher);
+
+    auto shed_of_1000 = [&] {
+        int shed = 0;
+        for (int i = 0; i < 1000; ++i) shed += !ov.admit_new_subscription();
+        return shed;
+    };
+    EXPECT_EQ(shed_of_1000(), 0);
+    ov.update(fill(0.7));                        // 87.5%: halfway through the band
+    EXPECT_EQ(ov.level(), OverloadLevel::kShedding);
+    EXPECT_EQ(shed_of_1000(), 500);
+    ov.update(fill(0.9));
+    EXPECT_EQ(shed_of_1000(), 1000);
+    EXPECT_EQ(ov.stats().subscribes_shed.load(), 1500u);
+
+    uint32_t retry = ov.retry_after_sec();
+    EXPECT_GE(retry, cfg.overload_retry_after_sec);
+    EXPECT_LT(retry, 2 * cfg.overload_retry_after_sec);
+}
+
+TEST(OverloadController, LengthensRefreshExpiresUpToReaperTtl) {
+    Config cfg = overload_config();
+    cfg.overload_refresh_expires_sec = 7200;
+    cfg.blf_subscription_ttl = Seconds(3600);
+    DialogDispatcher dispatcher(cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    OverloadController ov(cfg, dispatcher);
+
+    EXPECT_EQ(ov.refresh_expires(600, SubscriptionType::kBLF), 600u);
+    ov.update(fill(0.45));
+    EXPECT_EQ(ov.refresh_expires(600, SubscriptionType::kBLF), 3600u);
+    EXPECT_EQ(ov.refresh_expires(600, SubscriptionType::kMWI), 7200u);
+    EXPECT_EQ(ov.refresh_expires(5000, SubscriptionType::kBLF), 5000u);   // Never shortened
+    EXPECT_EQ(ov.stats().refreshes_extended.load(), 2u);
+}
+
+TEST(OverloadController, DispatcherShedsOnlyNewDialogsAndCoalescesPresence) {
+    Config cfg = overload_config();
+    cfg.max_subscriptions_per_tenant = 1000;
+    DialogDispatcher dispatcher(cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    OverloadController ov(cfg, dispatcher);
+    dispatcher.set_overload_controller(&ov);
+
+    SubscriptionRecord rec;
+    rec.dialog_id = "known";
+    rec.tenant_id = TenantId("overload.com");
+    rec.type = SubscriptionType::kBLF;
+    rec.lifecycle = SubLifecycle::kActive;
+    dispatcher.worker(0).load_recovered_subscription(std::move(rec));
+
+    // Triggers that pile up for one dialog collapse to the newest
+    ov.update(fill(0.45));
+    for (int i = 0; i < 5; ++i) {
+        auto ev = SipEvent::create_presence_trigger("known", TenantId("overload.com"), "c" + std::to_string(i),
+                                                    "sip:a@overload.com", "sip:b@overload.com",
+                                                    "confirmed", "inbound", "");
+        ASSERT_EQ(dispatcher.worker(0).enqueue(std::move(ev)), Result::kOk);
+    }
+    ASSERT_EQ(dispatcher.start(), Result::kOk);
+    for (int i = 0; i < 300 && dispatcher.worker(0).stats().events_processed.load() < 1; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(dispatcher.worker(0).stats().presence_coalesced.load(), 4u);
+
+    ov.update(fill(0.9));
+    EXPECT_EQ(dispatcher.dispatch(subscribe("brand-new")), Result::kOverloaded);
+    EXPECT_EQ(dispatcher.routing().find("brand-new"), DialogRoutingTable::kNoWorker);
+    EXPECT_EQ(dispatcher.dispatch(subscribe("known")), Result::kOk);   // Refresh passes
+    dispatcher.stop();
+}
@@ -0,0 +1,181 @@
+
+// =============================================================================
+// FILE: tests/test_presence_distributor.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "presence/interest_filter.h"
+#include "presence/interest_publisher.h"
+#include "presence/presence_distributor.h"
+#include "presence/presence_tcp_client.h"
+#include "presence/presence_failover_manager.h"
+#include "presence/presence_xml_parser.h"
+#include "subscription/blf_subscription_index.h"
+#include "common/logger.h"
+#include "test_helpers.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <poll.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sip_processor;
+using test::wait_for;
+
+namespace {
+
+CallStateEvent call(const std::string& id, const std::string& caller, const std::string& callee) {
+    CallStateEvent ev;
+    ev.presence_call_id = id;
+    ev.caller_uri = caller;
+    ev.callee_uri = callee;
+    ev.state = CallState::kRinging;
+    ev.direction = "inbound";
+    ev.tenant_id = "dist.com";
+    ev.is_valid = true;
+    return ev;
+}
+
+int connect_to(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) { close(fd); return -1; }
+    return fd;
+}
+
+// Parses whatever arrives on fd within `ms`
+std::vector<CallStateEvent> read_events(int fd, int ms) {
+    PresenceXmlParser parser;
+    std::vector<CallStateEvent> out;
+    char buf[4096];
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (std::chrono::steady_clock::now() < deadline) {
+        struct pollfd pfd{fd, POLLIN, 0};
+        if (poll(&pfd, 1, 20) <= 0) continue;
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        auto r = parser.feed(buf, static_cast<size_t>(n));
+        for (auto& ev : r.events) out.push_back(std::move(ev));
+    }
+    return out;
+}
+
+}  // namespace
+
+TEST(InterestFilter, NoFalseNegativesAndRoundTrips) {
+    std::vector<std::string> uris;
+    for (int i = 0; i < 1000; ++i) uris.push_back("sip:" + std::to_string(1000 + i) + "@member.com");
+    auto f = InterestFilter::for_uris(uris, 10);
+    EXPECT_EQ(f.hashes(), 7u);
+    for (const auto& u : uris) EXPECT_TRUE(f.may_contain(u));
+
+    int false_positives = 0;
+    for (int i = 0; i < 10000; ++i) false_positives += f.may_contain("sip:" + std::to_string(i) + "@other.com");
+    EXPECT_LT(false_positives, 300);   // ~1% expected; power-of-two rounding only lowers it
+
+    InterestFilter parsed;
+    ASSERT_TRUE(InterestFilter::parse_message(f.to_message(), parsed));
+    EXPECT_EQ(parsed.bits(), f.bits());
+    EXPECT_EQ(parsed.hashes(), f.hashes());
+    EXPECT_EQ(parsed.to_message(), f.to_message());
+
+    EXPECT_FALSE(InterestFilter::parse_message("<Interest bits=\"100\" hashes=\"3\">00</Interest>", parsed));
+    EXPECT_FALSE(InterestFilter::parse_message("<Interest bits=\"64\" hashes=\"3\">0123</Interest>", parsed));
+    EXPECT_FALSE(InterestFilter::parse_message("<Interest bits=\"64\" hashes=\"3\">000000000000000g</Interest>", parsed));
+    EXPECT_TRUE(InterestFilter::parse_message("<Interest bits=\"64\" hashes=\"3\">0000000000000000</Interest>", parsed));
+    EXPECT_FALSE(parsed.may_contain("sip:1000@member.com"));
+}
+
+TEST(PresenceDistributor, ForwardsOnlyToInterestedNodes) {
+    Logger::instance().set_level(LogLevel::kError);
+    Config cfg;
+    cfg.distributor_bind_address = "127.0.0.1";
+    cfg.distributor_listen_port = 0;
+    cfg.presence_heartbeat_interval = Seconds(60);
+    PresenceDistributor dist(cfg);
+    ASSERT_EQ(dist.start(), Result::kOk);
+
+    // Node A: a processor publishing interest in one URI
+    Config node_cfg;
+    node_cfg.presence_servers = {{"127.0.0.1", dist.port()}};
+    node_cfg.presence_heartbeat_interval = Seconds(60);
+    InterestFilter interest(1024, 7);
+    interest.add(BlfSubscriptionIndex::normalize_uri("<sip:100@Dist.com:5060>"));
+    PresenceTcpClient node_a(node_cfg, std::make_shared<PresenceFailoverManager>(node_cfg));
+    std::atomic<int> a_events{0};
+    node_a.set_event_callback([&](CallStateEvent&& ev) {
+        if (ev.presence_call_id == "c1" || ev.presence_call_id == "c3") a_events.fetch_add(1);
+        else a_events.fetch_add(100);
+    });
+    node_a.publish_interest(interest.to_message());
+    ASSERT_EQ(node_a.start(), Result::kOk);
+
+    // Node B: has not published, so gets the whole feed
+    int node_b = connect_to(dist.port());
+    ASSERT_GE(node_b, 0);
+    ASSERT_TRUE(wait_for([&] {
+        return dist.stats().nodes_connected.load() == 2 && dist.stats().interest_updates.load() == 1;
+    }));
+
+    dist.on_call_state_event(call("c1", "sip:900@dist.com", "sip:100@dist.com"));   // Callee watched
+    dist.on_call_state_event(call("c2", "sip:901@dist.com", "sip:200@dist.com"));
+    dist.on_call_state_event(call("c3", "sip:100@dist.com", "sip:300@dist.com"));   // Caller watched
+
+    auto b_events = read_events(node_b, 300);
+    ASSERT_EQ(b_events.size(), 3u);
+    EXPECT_EQ(b_events[1].presence_call_id, "c2");
+    EXPECT_EQ(b_events[1].callee_uri, "sip:200@dist.com");
+    EXPECT_EQ(b_events[1].state, CallState::kRinging);
+    EXPECT_EQ(b_events[1].tenant_id, "dist.com");
+    EXPECT_TRUE(wait_for([&] { return a_events.load() == 2; }));
+    EXPECT_EQ(dist.stats().events_forwarded.load(), 5u);
+
+    // Once B publishes an empty interest, c2-like events reach nobody
+    std::string empty = InterestFilter(64, 7).to_message();
+    ASSERT_EQ(send(node_b, empty.data(), empty.size(), 0), static_cast<ssize_t>(empty.size()));
+    ASSERT_TRUE(wait_for([&] { return dist.stats().interest_updates.load() == 2; }));
+    dist.on_call_state_event(call("c4", "sip:902@dist.com", "sip:200@dist.com"));
+    EXPECT_EQ(dist.stats().events_unwanted.load(), 1u);
+    EXPECT_TRUE(read_events(node_b, 100).empty());
+
+    node_a.stop();
+    close(node_b);
+    dist.stop();
+}
+
+TEST(InterestPublisher, PublishesNewUrisBeforeTheInterval) {
+    Config cfg;
+    cfg.presence_publish_interest = true;
+    cfg.presence_interest_interval = Seconds(60);
+    std::mutex mu;
+    std::vector<std::string> published;
+    InterestPublisher publisher(cfg, [&](std::string message) {
+        std::lock_guard<std::mutex> lk(mu);
+        published.push_back(std::move(message));
+    });
+    auto count = [&] { std::lock_guard<std::mutex> lk(mu); return published.size(); };
+    publisher.start();
+    ASSERT_TRUE(wait_for([&] { return count() == 1; }));   // Initial filter
+
+    auto& idx = BlfSubscriptionIndex::instance();
+    std::string uri = BlfSubscriptionIndex::normalize_uri("sip:700@publisher.com");
+    idx.add(Symbol(uri), "publisher-dialog-1", TenantId("publisher.com"));
+    ASSERT_TRUE(wait_for([&] { return count() == 2; }));
+    {
+        std::lock_guard<std::mutex> lk(mu);
+        InterestFilter filter;
+        ASSERT_TRUE(InterestFilter::parse_message(published.back(), filter));
+        EXPECT_TRUE(filter.may_contain(uri));
+    }
+
+    publisher.stop();
+    idx.remove_dialog("publisher-dialog-1");
+}
@@ -0,0 +1,131 @@
+
+// =============================================================================
+// FILE: tests/test_recovery_notify_scheduler.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "dispatch/recovery_notify_scheduler.h"
+#include "dispatch/dialog_worker.h"
+#include "common/slow_event_logger.h"
+#include "common/logger.h"
+#include "test_helpers.h"
+#include <string>
+#include <vector>
+
+using namespace sip_processor;
+
+TEST(RecoveryNotifyScheduler, SendsNearestExpiryFirst) {
+    RecoveryNotifyScheduler s;
+    s.configure(0, 1);
+    TimePoint now = Clock::now();
+    s.schedule("late", now + Seconds(3000));
+    s.schedule("none", TimePoint{});
+    s.schedule("soon", now + Seconds(30));
+    s.schedule("mid", now + Seconds(600));
+
+    std::vector<std::string> order;
+    EXPECT_EQ(s.drain(now, [&](const std::string& did) { order.push_back(did); return true; }), 4u);
+    EXPECT_EQ(order, (std::vector<std::string>{"soon", "mid", "late", "none"}));
+    EXPECT_EQ(s.queued(), 0u);
+}
+
+TEST(RecoveryNotifyScheduler, PacesToRateAfterBurst) {
+    RecoveryNotifyScheduler s;
+    s.configure(100, 10);
+    TimePoint now = Clock::now();
+    for (int i = 0; i < 1000; ++i) s.schedule("d" + std::to_string(i), now + Seconds(i));
+    auto send = [](const std::string&) { return true; };
+
+    EXPECT_EQ(s.drain(now, send), 10u);   // The burst
+    EXPECT_EQ(s.drain(now, send), 0u);
+    EXPECT_EQ(s.drain(now + Millisecs(500), send), 10u);   // Refill is capped at the burst
+    size_t sent = 0;
+    for (int ms = 510; ms <= 1500; ms += 10) sent += s.drain(now + Millisecs(ms), send);
+    EXPECT_NEAR(static_cast<double>(sent), 100.0, 2.0);
+    EXPECT_EQ(s.queued(), 1000u - 20u - sent);
+}
+
+TEST(RecoveryNotifyScheduler, RepacingKeepsEarnedTokensOnly) {
+    RecoveryNotifyScheduler s;
+    s.configure(10, 2);
+    TimePoint now = Clock::now();
+    for (int i = 0; i < 100; ++i) s.schedule("d" + std::to_string(i), now + Seconds(i));
+    auto send = [](const std::string&) { return true; };
+    EXPECT_EQ(s.drain(now, send), 2u);
+
+    // A faster pace does not hand out a fresh burst
+    s.set_rate(100, 10);
+    EXPECT_DOUBLE_EQ(s.rate(), 100.0);
+    EXPECT_EQ(s.drain(now, send), 0u);
+    EXPECT_EQ(s.drain(now + Millisecs(1000), send), 10u);
+}
+
+TEST(RecoveryNotifyScheduler, SkippedDialogsCostNoToken) {
+    RecoveryNotifyScheduler s;
+    s.configure(1, 2);
+    TimePoint now = Clock::now();
+    for (int i = 0; i < 6; ++i) s.schedule("d" + std::to_string(i), now + Seconds(i));
+    std::vector<std::string> sent;
+    // Only odd dialogs are still owed
+    size_t n = s.drain(now, [&](const std::string& did) {
+        if ((did.back() - '0') % 2 == 0) return false;
+        sent.push_back(did);
+        return true;
+    });
+    EXPECT_EQ(n, 2u);
+    EXPECT_EQ(sent, (std::vector<std::string>{"d1", "d3"}));
+    EXPECT_EQ(s.queued(), 2u);   // d4 was skipped for free, d5 waits
+}
+
+TEST(RecoveryNotifyScheduler, WorkerCountsRecoveredDialogsOwed) {
+    Logger::instance().set_level(LogLevel::kError);
+    Config cfg;
+    cfg.mongo_enable_persistence = false;
+    cfg.max_subscriptions_per_tenant = 100000;
+    DialogWorker worker(0, cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    for (int i = 0; i < 5; ++i) {
+        SubscriptionRecord rec;
+        rec.dialog_id = "owed-" + std::to_string(i);
+        rec.tenant_id = TenantId("owed.com");
+        rec.type = SubscriptionType::kMWI;
+        rec.lifecycle = SubLifecycle::kActive;
+        rec.mwi_account_uri = "sip:vm" + std::to_string(i) + "@owed.com";
+        rec.expires_at = Clock::now() + Seconds(3600);
+        ASSERT_EQ(worker.load_recovered_subscription(std::move(rec)), Result::kOk);
+    }
+    EXPECT_EQ(worker.stats().recovery_notify_owed.load(), 5u);
+    // Without a handle nothing can be sent; the debt waits for the refresh
+    ASSERT_EQ(worker.start(), Result::kOk);
+    EXPECT_EQ(worker.stats().recovery_notify_queued.load(), 0u);
+    EXPECT_EQ(worker.stats().recovery_notify_sent.load(), 0u);
+    worker.stop();
+    EXPECT_EQ(worker.stats().recovery_notify_owed.load(), 0u);
+}
+
+TEST(RecoveryNotifyScheduler, WorkerRepacesWhenReconcileAddsDebt) {
+    Logger::instance().set_level(LogLevel::kError);
+    Config cfg = test::worker_config();
+    cfg.recovery_notify_window = Seconds(10);
+    cfg.recovery_notify_min_rate = 1;
+    DialogWorker worker(0, cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    auto owed = [](int i) {
+        SubscriptionRecord rec;
+        rec.dialog_id = "repace-" + std::to_string(i);
+        rec.tenant_id = TenantId("repace.com");
+        rec.type = SubscriptionType::kMWI;
+        rec.lifecycle = SubLifecycle::kActive;
+        rec.mwi_account_uri = "sip:vm" + std::to_string(i) + "@repace.com";
+        rec.expires_at = Clock::now() + Seconds(3600);
+        return rec;
+    };
+    for (int i = 0; i < 5; ++i) ASSERT_EQ(worker.load_recovered_subscription(owed(i)), Result::kOk);
+    ASSERT_EQ(worker.start(), Result::kOk);
+    EXPECT_EQ(worker.stats().recovery_notify_rate.load(), 1u);   // The floor
+
+    // The background reconcile finds far more; the pace follows the debt
+    std::vector<SubscriptionRecord> late;
+    for (int i = 5; i < 205; ++i) late.push_back(owed(i));
+    ASSERT_EQ(worker.reconcile_subscriptions(std::move(late)), Result::kOk);
+    EXPECT_TRUE(test::wait_for([&] { return worker.stats().recovery_notify_rate.load() == 20u; }));
+    EXPECT_EQ(worker.stats().recovery_notify_owed.load(), 205u);
+    worker.stop();
+}
@@ -4,6 +4,8 @@
 // =============================================================================
 #include <gtest/gtest.h>
 #include "common/slow_event_logger.h"
+#include <cstring>
+#include <set>
 #include <thread>
 
 using namespace sip_processor;
@@ -70,7 +72,7 @@ protected:
 TEST_F(RegistryTest, RegisterAndLookup) {
     auto& reg = SubscriptionRegistry::instance();
     SubscriptionRegistry::SubscriptionInfo info{
-        "test-1", "tenant-a", SubscriptionType::kBLF,
+        "test-1", TenantId("tenant-a"), SubscriptionType::kBLF,
         SubLifecycle::kActive, Clock::now(), 0};
     reg.register_subscription("test-1", info);
 
@@ -82,7 +84,7 @@ TEST_F(RegistryTest, RegisterAndLookup) {
 
 TEST_F(RegistryTest, UnregisterRemoves) {
     auto& reg = SubscriptionRegistry::instance();
-    SubscriptionRegistry::SubscriptionInfo info{"test-1", "t", SubscriptionType::kBLF, SubLifecycle::kActive, Clock::now(), 0};
+    SubscriptionRegistry::SubscriptionInfo info{"test-1", TenantId("t"), SubscriptionType::kBLF, SubLifecycle::kActive, Clock::now(), 0};
     reg.register_subscription("test-1", info);
     reg.unregister_subscription("test-1");
 
@@ -92,20 +94,192 @@ TEST_F(RegistryTest, UnregisterRemoves) {
 
 TEST_F(RegistryTest, CountByTenant) {
     auto& reg = SubscriptionRegistry::instance();
-    reg.register_subscription("test-1", {"test-1", "t-a", SubscriptionType::kBLF, SubLifecycle::kActive, Clock::now(), 0});
-    reg.register_subscription("test-2", {"test-2", "t-a", SubscriptionType::kMWI, SubLifecycle::kActive, Clock::now(), 0});
-    reg.register_subscription("test-3", {"test-3", "t-b", SubscriptionType::kBLF, SubLifecycle::kActive, Clock::now(), 0});
+    reg.register_subscription("test-1", {"test-1", TenantId("t-a"), SubscriptionType::kBLF, SubLifecycle::kActive, Clock::now(), 0});
+    reg.register_subscription("test-2", {"test-2", TenantId("t-a"), SubscriptionType::kMWI, SubLifecycle::kActive, Clock::now(), 0});
+    reg.register_subscription("test-3", {"test-3", TenantId("t-b"), SubscriptionType::kBLF, SubLifecycle::kActive, Clock::now(), 0});
 
-    EXPECT_EQ(reg.count_by_tenant("t-a"), 2u);
-    EXPECT_EQ(reg.count_by_tenant("t-b"), 1u);
-    EXPECT_EQ(reg.count_by_tenant("t-c"), 0u);
+    EXPECT_EQ(reg.count_by_tenant(TenantId("t-a")), 2u);
+    EXPECT_EQ(reg.count_by_tenant(TenantId("t-b")), 1u);
+    EXPECT_EQ(reg.count_by_tenant(TenantId("t-c")), 0u);
 }
 
 TEST_F(RegistryTest, CountByType) {
     auto& reg = SubscriptionRegistry::instance();
-    reg.register_subscription("test-1", {"test-1", "t", SubscriptionType::kBLF, SubLifecycle::kActive, Clock::now(), 0});
-    reg.register_subscription("test-2", {"test-2", "t", SubscriptionType::kMWI, SubLifecycle::kActive, Clock::now(), 0});
+    reg.register_subscription("test-1", {"test-1", TenantId("t"), SubscriptionType::kBLF, SubLifecycle::kActive, Clock::now(), 0});
+    reg.register_subscription("test-2", {"test-2", TenantId("t"), SubscriptionType::kMWI, SubLifecycle::kActive, Clock::now(), 0});
 
     EXPECT_GE(reg.count_by_type(SubscriptionType::kBLF), 1u);
     EXPECT_GE(reg.count_by_type(SubscriptionType::kMWI), 1u);
 }
+
+TEST_F(RegistryTest, ReRegisterMovesTenantCount) {
+    auto& reg = SubscriptionRegistry::instance();
+    reg.register_subscription("test-1", {"test-1", TenantId("t-move-a"), SubscriptionType::kBLF, SubLifecycle::kPending, Clock::now(), 0});
+    reg.register_subscription("test-1", {"test-1", TenantId("t-move-a"), SubscriptionType::kBLF, SubLifecycle::kActive, Clock::now(), 0});
+    EXPECT_EQ(reg.count_by_tenant(TenantId("t-move-a")), 1u);
+
+    reg.register_subscription("test-1", {"test-1", TenantId("t-move-b"), SubscriptionType::kBLF, SubLifecycle::kActive, Clock::now(), 0});
+    EXPECT_EQ(reg.count_by_tenant(TenantId("t-move-a")), 0u);
+    EXPECT_EQ(reg.count_by_tenant(TenantId("t-move-b")), 1u);
+    EXPECT_EQ(reg.tenant_count_ref(TenantId("t-move-b")).load(), 1);
+}
+
+TEST_F(RegistryTest, ForEachSeesAllShardsAndStopsEarly) {
+    auto& reg = SubscriptionRegistry::instance();
+    size_t before = reg.total_count();
+    reg.register_subscription("test-1", {"test-1", TenantId("t-iter"), SubscriptionType::kBLF, SubLifecycle::kActive, Clock::now(), 0});
+    reg.register_subscription("test-2", {"test-2", TenantId("t-iter"), SubscriptionType::kMWI, SubLifecycle::kActive, Clock::now(), 0});
+    reg.register_subscription("test-3", {"test-3", TenantId("t-iter"), SubscriptionType::kBLF, SubLifecycle::kActive, Clock::now(), 0});
+    EXPECT_EQ(reg.total_count(), before + 3);
+
+    size_t seen = 0;
+    reg.for_each([&](const SubscriptionRegistry::SubscriptionInfo& info) {
+        if (info.tenant_id == "t-iter") seen++;
+        return true;
+    });
+    EXPECT_EQ(seen, 3u);
+    EXPECT_EQ(reg.get_tenant_subscriptions(TenantId("t-iter")).size(), 3u);
+
+    size_t visited = 0;
+    reg.for_each([&](const SubscriptionRegistry::SubscriptionInfo&) { return ++visited < 2; });
+    EXPECT_EQ(visited, 2u);
+}
+
+TEST_F(RegistryTest, ConcurrentWritersKeepCountsExact) {
+    auto& reg = SubscriptionRegistry::instance();
+    constexpr int kThreads = 4, kPerThread = 500;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&reg, t] {
+            for (int i = 0; i < kPerThread; ++i) {
+                std::string did = "conc-" + std::to_string(t) + "-" + std::to_string(i);
+                reg.register_subscription(did, {did, TenantId("t-conc"), SubscriptionType::kBLF, SubLifecycle::kActive, Clock::now(), 0});
+                if (i % 2) reg.unregister_subscription(did);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    EXPECT_EQ(reg.count_by_tenant(TenantId("t-conc")), static_cast<size_t>(kThreads * kPerThread / 2));
+
+    for (int t = 0; t < kThreads; ++t)
+        for (int i = 0; i < kPerThread; i += 2)
+            reg.unregister_subscription("conc-" + std::to_string(t) + "-" + std::to_string(i));
+    EXPECT_EQ(reg.count_by_tenant(TenantId("t-conc")), 0u);
+}
+
+TEST_F(RegistryTest, PagedScanVisitsEachEntryOnce) {
+    auto& reg = SubscriptionRegistry::instance();
+    constexpr int kEntries = 300;
+    for (int i = 0; i < kEntries; ++i) {
+        std::string did = "page-" + std::to_string(i);
+        reg.register_subscription(did, {did, TenantId("t-page"), i % 3 ? SubscriptionType::kBLF : SubscriptionType::kMWI,
+                                        SubLifecycle::kActive, Clock::now(), 0, Symbol("sip:" + std::to_string(i) + "@x")});
+    }
+    auto in_tenant = [](const SubscriptionRegistry::SubscriptionInfo& s) { return s.tenant_id == "t-page"; };
+
+    std::set<std::string> seen;
+    SubscriptionRegistry::Cursor cursor;
+    size_t pages = 0;
+    while (!cursor.done()) {
+        std::vector<SubscriptionRegistry::SubscriptionInfo> page;
+        reg.scan(cursor, 7, in_tenant, page);
+        EXPECT_LE(page.size(), 7u);
+        for (const auto& s : page) EXPECT_TRUE(seen.insert(s.dialog_id).second) << s.dialog_id;
+        pages++;
+    }
+    EXPECT_EQ(seen.size(), static_cast<size_t>(kEntries));
+    EXPECT_GE(pages, static_cast<size_t>(kEntries / 7));
+
+    std::vector<SubscriptionRegistry::SubscriptionInfo> mwi;
+    SubscriptionRegistry::Cursor all;
+    reg.scan(all, kEntries, [](const SubscriptionRegistry::SubscriptionInfo& s) {
+        return s.tenant_id == "t-page" && s.type == SubscriptionType::kMWI &&
+               s.monitored_uri.view().compare(0, 5, "sip:1") == 0;
+    }, mwi);
+    for (const auto& s : mwi) EXPECT_EQ(s.monitored_uri.view().substr(0, 5), "sip:1");
+    EXPECT_FALSE(mwi.empty());
+
+    for (int i = 0; i < kEntries; ++i) reg.unregister_subscription("page-" + std::to_string(i));
+}
+
+TEST_F(RegistryTest, PagedScanResumesAfterCursorEntryIsRemoved) {
+    auto& reg = SubscriptionRegistry::instance();
+    constexpr int kEntries = 200;
+    for (int i = 0; i < kEntries; ++i) {
+        std::string did = "resume-" + std::to_string(i);
+        reg.register_subscription(did, {did, TenantId("t-resume"), SubscriptionType::kBLF,
+                                        SubLifecycle::kActive, Clock::now(), 0, Symbol("sip:r@x")});
+    }
+    auto in_tenant = [](const SubscriptionRegistry::SubscriptionInfo& s) { return s.tenant_id == "t-resume"; };
+
+    std::set<std::string> seen;
+    SubscriptionRegistry::Cursor cursor;
+    size_t removed = 0;
+    while (!cursor.done()) {
+        std::vector<SubscriptionRegistry::SubscriptionInfo> page;
+        reg.scan(cursor, 5, in_tenant, page);
+        for (size_t i = 1; i < page.size(); ++i) {
+            // Within a shard pages come back in dialog_id order
+            if (std::hash<std::string>{}(page[i - 1].dialog_id) % SubscriptionRegistry::kNumShards ==
+                std::hash<std::string>{}(page[i].dialog_id) % SubscriptionRegistry::kNumShards) {
+                EXPECT_LT(page[i - 1].dialog_id, page[i].dialog_id);
+            }
+        }
+        for (const auto& s : page) EXPECT_TRUE(seen.insert(s.dialog_id).second) << s.dialog_id;
+        // The entry the cursor points past disappears between pages
+        if (!cursor.after.empty()) {
+            reg.unregister_subscription(cursor.after);
+            ++removed;
+        }
+    }
+    EXPECT_EQ(seen.size(), static_cast<size_t>(kEntries));
+    EXPECT_EQ(reg.count_by_tenant(TenantId("t-resume")), kEntries - removed);
+
+    for (int i = 0; i < kEntries; ++i) reg.unregister_subscription("resume-" + std::to_string(i));
+}
+
+TEST(SlowEventLogger, MeasuresBelowOneMillisecond) {
+    Config c;
+    SlowEventLogger logger(c);
+    SlowEventLogger::Timer timer(logger, "TEST", "dialog-1");
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    timer.finish();
+
+    EXPECT_GE(timer.elapsed(), std::chrono::microseconds(200));
+    EXPECT_LT(timer.elapsed(), Millisecs(50));
+    EXPECT_GE(logger.stats().max_duration_us.load(), 200u);
+    EXPECT_EQ(logger.stats().warn_count.load(), 0u);
+}
+
+TEST(SlowEventLogger, KeepsSlowestEventsWithStages) {
+    Config c;
+    c.slow_event_top_n = 3;
+    SlowEventLogger logger(c);
+
+    std::vector<std::string> ids;
+    for (int i = 0; i < 10; ++i) ids.push_back("dialog-" + std::to_string(i));
+    for (int i = 0; i < 10; ++i) {
+        SlowEventLogger::Timer timer(logger, "SUBSCRIBE BLF", ids[i], "tenant-a");
+        timer.add_stage("queue_wait", std::chrono::microseconds(i));
+        // Event i runs for roughly i * 2ms; the last three are slowest
+        std::this_thread::sleep_for(Millisecs(2 * i));
+    }
+
+    auto top = logger.slowest(10);
+    ASSERT_EQ(top.size(), 3u);
+    EXPECT_STREQ(top[0].dialog_id, "dialog-9");
+    EXPECT_STREQ(top[1].dialog_id, "dialog-8");
+    EXPECT_STREQ(top[2].dialog_id, "dialog-7");
+    EXPECT_GE(top[0].total_ns, top[1].total_ns);
+    EXPECT_STREQ(top[0].operation, "SUBSCRIBE BLF");
+    EXPECT_STREQ(top[0].context, "tenant-a");
+    ASSERT_EQ(top[0].num_stages, 1u);
+    EXPECT_STREQ(top[0].stages[0].name, "queue_wait");
+    EXPECT_EQ(top[0].stages[0].ns, 9000u);
+    EXPECT_EQ(logger.slowest(1).size(), 1u);
+
+    // Long dialog ids are truncated, never overrun
+    std::string long_id(500, 'x');
+    { SlowEventLogger::Timer timer(logger, "TEST", long_id); std::this_thread::sleep_for(Millisecs(40)); }
+    EXPECT_EQ(strlen(logger.slowest(1)[0].dialog_id), SlowEventLogger::kMaxDialogId - 1);
+}
@@ -0,0 +1,100 @@
+
+// =============================================================================
+// FILE: tests/test_string_interner.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "common/string_interner.h"
+#include <set>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace sip_processor;
+
+TEST(StringInternerTest, SameTextSameId) {
+    Symbol a("tenant-42.com");
+    Symbol b(std::string("tenant-42.com"));
+    Symbol c("tenant-43.com");
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a.id(), b.id());
+    EXPECT_NE(a, c);
+    EXPECT_EQ(a.view(), "tenant-42.com");
+    EXPECT_STREQ(a.c_str(), "tenant-42.com");
+    EXPECT_EQ(a.size(), 13u);
+}
+
+TEST(StringInternerTest, EmptyIsIdZero) {
+    Symbol empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(empty.id(), 0u);
+    EXPECT_EQ(Symbol("").id(), 0u);
+    EXPECT_STREQ(empty.c_str(), "");
+}
+
+TEST(StringInternerTest, TextComparisonDoesNotIntern) {
+    size_t before = StringInterner::instance().size();
+    Symbol s("sip:200@intern.test");
+    EXPECT_EQ(StringInterner::instance().size(), before + 1);
+
+    EXPECT_TRUE(s == "sip:200@intern.test");
+    EXPECT_TRUE(s != std::string("sip:201@intern.test"));
+    EXPECT_EQ(StringInterner::instance().size(), before + 1);
+
+    Symbol found;
+    EXPECT_TRUE(Symbol::find("sip:200@intern.test", found));
+    EXPECT_EQ(found, s);
+    EXPECT_FALSE(Symbol::find("sip:never-interned@intern.test", found));
+    EXPECT_EQ(StringInterner::instance().size(), before + 1);
+}
+
+TEST(StringInternerTest, UsableAsHashKey) {
+    std::unordered_set<Symbol> set{Symbol("a.test"), Symbol("b.test"), Symbol("a.test")};
+    EXPECT_EQ(set.size(), 2u);
+    EXPECT_EQ(set.count(Symbol("b.test")), 1u);
+}
+
+TEST(StringInternerTest, ConcurrentInternAgrees) {
+    constexpr int kThreads = 4, kStrings = 2000;
+    std::vector<std::vector<uint32_t>> ids(kThreads, std::vector<uint32_t>(kStrings));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&ids, t] {
+            // Each thread starts at a different offset
+            for (int i = 0; i < kStrings; ++i) {
+                int k = (i + t * kStrings / kThreads) % kStrings;
+                ids[t][k] = Symbol("conc-" + std::to_string(k) + ".test").id();
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    std::set<uint32_t> distinct;
+    for (int k = 0; k < kStrings; ++k) {
+        for (int t = 1; t < kThreads; ++t) EXPECT_EQ(ids[t][k], ids[0][k]);
+        distinct.insert(ids[0][k]);
+        EXPECT_EQ(StringInterner::instance().view(ids[0][k]), "conc-" + std::to_string(k) + ".test");
+    }
+    EXPECT_EQ(distinct.size(), static_cast<size_t>(kStrings));
+}
+
+TEST(StringInternerTest, FullInternerRefusesNewText) {
+    auto& interner = StringInterner::instance();
+    Symbol known("known.full.test");
+    interner.set_capacity(interner.size() + 1);
+    uint64_t rejected = interner.rejected();
+
+    Symbol last("last.full.test");
+    EXPECT_FALSE(last.empty());
+    Symbol refused("refused.full.test");
+    EXPECT_TRUE(refused.empty());
+    EXPECT_EQ(interner.rejected(), rejected + 1);
+    Symbol found;
+    EXPECT_FALSE(Symbol::find("refused.full.test", found));
+
+    // Text already interned still resolves
+    EXPECT_EQ(Symbol("known.full.test"), known);
+    EXPECT_EQ(Symbol("last.full.test"), last);
+
+    interner.set_capacity(StringInterner::kMaxSymbols);
+    EXPECT_FALSE(Symbol("refused.full.test").empty());
+}
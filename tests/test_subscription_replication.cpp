@@ -0,0 +1,223 @@
+
+// =============================================================================
+// FILE: tests/test_subscription_replication.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "persistence/subscription_replication.h"
+#include "persistence/subscription_codec.h"
+#include "persistence/subscription_store.h"
+#include "dispatch/dialog_dispatcher.h"
+#include "subscription/blf_subscription_index.h"
+#include "common/slow_event_logger.h"
+#include "common/logger.h"
+#include "test_helpers.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <poll.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sip_processor;
+using test::wait_for;
+
+namespace {
+
+SubscriptionRecord blf(const std::string& did, const std::string& uri, uint32_t notify_cseq) {
+    SubscriptionRecord rec;
+    rec.dialog_id = did;
+    rec.tenant_id = TenantId("repl.com");
+    rec.type = SubscriptionType::kBLF;
+    rec.lifecycle = SubLifecycle::kActive;
+    rec.blf_monitored_uri = Symbol(uri);
+    rec.notify_cseq = notify_cseq;
+    rec.blf_notify_version = notify_cseq;
+    rec.expires_at = Clock::now() + Seconds(3600);
+    return rec;
+}
+
+bool watched_by(const std::string& uri, const std::string& did) {
+    for (const auto& w : BlfSubscriptionIndex::instance().lookup(uri, TenantId("repl.com"))) {
+        if (w.dialog_id == did) return true;
+    }
+    return false;
+}
+
+Config standby_config(uint16_t port) {
+    Config c;
+    c.num_workers = 2;
+    c.mongo_enable_persistence = false;
+    c.max_subscriptions_per_tenant = 100000;
+    c.replication_role = ReplicationRole::kStandby;
+    c.replication_primary_port = port;
+    return c;
+}
+
+}  // namespace
+
+TEST(SubscriptionReplication, StandbyFollowsPrimaryAndResyncs) {
+    Logger::instance().set_level(LogLevel::kError);
+    Config pcfg;
+    pcfg.replication_bind_address = "127.0.0.1";
+    pcfg.replication_listen_port = 0;
+    ReplicationSender primary(pcfg);
+    ASSERT_EQ(primary.start(), Result::kOk);
+
+    // Known before the standby attaches: arrives in the first full sync
+    primary.on_upsert(blf("repl-1", "sip:101@repl.com", 5));
+    primary.on_upsert(blf("repl-2", "sip:102@repl.com", 1));
+    primary.on_upsert(blf("repl-3", "sip:103@repl.com", 1));
+    EXPECT_EQ(primary.stats().records_tracked.load(), 3u);
+
+    Config scfg = standby_config(primary.port());
+    DialogDispatcher dispatcher(scfg, std::make_shared<SlowEventLogger>(scfg), nullptr);
+    ASSERT_EQ(dispatcher.start(), Result::kOk);
+    auto standby = std::make_unique<ReplicationReceiver>(scfg, dispatcher);
+    ASSERT_EQ(standby->start(), Result::kOk);
+
+    ASSERT_TRUE(wait_for([&] { return dispatcher.aggregate_stats().total_dialogs_active == 3; }));
+    EXPECT_TRUE(standby->is_connected());
+    EXPECT_EQ(standby->stats().full_syncs.load(), 1u);
+    EXPECT_TRUE(watched_by("sip:101@repl.com", "repl-1"));
+    SubscriptionRegistry::SubscriptionInfo info;
+    ASSERT_TRUE(SubscriptionRegistry::instance().lookup("repl-2", info));
+    EXPECT_EQ(info.worker_index, dispatcher.routing().find("repl-2"));
+
+    // Deltas: a re-pointed watcher, a delete, a terminated dialog
+    primary.on_upsert(blf("repl-1", "sip:201@repl.com", 6));
+    primary.on_delete("repl-2");
+    auto terminated = blf("repl-3", "sip:103@repl.com", 2);
+    terminated.lifecycle = SubLifecycle::kTerminated;
+    primary.on_upsert(terminated);
+    ASSERT_TRUE(wait_for([&] { return dispatcher.aggregate_stats().total_dialogs_active == 1; }));
+    ASSERT_TRUE(wait_for([&] { return watched_by("sip:201@repl.com", "repl-1"); }));
+    EXPECT_FALSE(watched_by("sip:101@repl.com", "repl-1"));
+    EXPECT_FALSE(watched_by("sip:102@repl.com", "repl-2"));
+    EXPECT_EQ(dispatcher.routing().find("repl-2"), DialogRoutingTable::kNoWorker);
+    EXPECT_EQ(primary.stats().records_tracked.load(), 1u);
+
+    // Changes while the standby is away reach it through the resync, and
+    // replicas the primary no longer has are dropped
+    standby->stop();
+    standby.reset();
+    ASSERT_TRUE(wait_for([&] { return primary.stats().standby_connected.load() == 0; }));
+    primary.on_delete("repl-1");
+    primary.on_upsert(blf("repl-4", "sip:104@repl.com", 1));
+    standby = std::make_unique<ReplicationReceiver>(scfg, dispatcher);
+    ASSERT_EQ(standby->start(), Result::kOk);
+    ASSERT_TRUE(wait_for([&] { return watched_by("sip:104@repl.com", "repl-4"); }));
+    ASSERT_TRUE(wait_for([&] { return dispatcher.aggregate_stats().total_dialogs_active == 1; }));
+    EXPECT_FALSE(watched_by("sip:201@repl.com", "repl-1"));
+    EXPECT_EQ(primary.stats().full_syncs.load(), 2u);
+
+    standby->stop();
+    dispatcher.stop();
+    primary.stop();
+}
+
+TEST(SubscriptionReplication, StandbyKeepsShortExpiresDialogRefreshedOnPrimary) {
+    Logger::instance().set_level(LogLevel::kError);
+    Config pcfg;
+    pcfg.num_workers = 1;
+    pcfg.mongo_enable_persistence = false;
+    pcfg.replication_bind_address = "127.0.0.1";
+    pcfg.replication_listen_port = 0;
+    pcfg.expires_blf_min_sec = 1;
+    pcfg.expires_checkpoint = Seconds(300);   // Far above the granted Expires
+    auto sender = std::make_shared<ReplicationSender>(pcfg);
+    ASSERT_EQ(sender->start(), Result::kOk);
+    auto store = std::make_shared<SubscriptionStore>(pcfg, nullptr);
+    store->add_change_listener(sender);
+    DialogDispatcher primary(pcfg, std::make_shared<SlowEventLogger>(pcfg), store);
+    ASSERT_EQ(primary.start(), Result::kOk);
+
+    auto subscribe = [] { return test::subscribe("repl-short", "repl.com", 2); };
+    const auto& ws = primary.worker(0).stats();
+    ASSERT_EQ(primary.dispatch(subscribe()), Result::kOk);
+    ASSERT_TRUE(wait_for([&] { return ws.dialogs_active.load() == 1; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+    ASSERT_EQ(primary.dispatch(subscribe()), Result::kOk);
+    ASSERT_TRUE(wait_for([&] { return ws.refresh_fast_path.load() == 1; }));
+
+    // The standby syncs after the admitted expiry has passed: it must get
+    // the refreshed one, or it drops a dialog the primary still serves
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    Config scfg = standby_config(sender->port());
+    DialogDispatcher standby_dispatcher(scfg, std::make_shared<SlowEventLogger>(scfg), nullptr);
+    ASSERT_EQ(standby_dispatcher.start(), Result::kOk);
+    ReplicationReceiver standby(scfg, standby_dispatcher);
+    ASSERT_EQ(standby.start(), Result::kOk);
+    ASSERT_TRUE(wait_for([&] { return standby.stats().full_syncs.load() == 1; }));
+    EXPECT_TRUE(wait_for([&] { return standby_dispatcher.aggregate_stats().total_dialogs_active == 1; }));
+
+    standby.stop();
+    standby_dispatcher.stop();
+    primary.stop();
+    sender->stop();
+}
+
+TEST(SubscriptionReplication, StreamIsFramedAndChecksummed) {
+    Logger::instance().set_level(LogLevel::kError);
+    Config cfg;
+    cfg.replication_bind_address = "127.0.0.1";
+    cfg.replication_listen_port = 0;
+    ReplicationSender primary(cfg);
+    ASSERT_EQ(primary.start(), Result::kOk);
+    primary.on_upsert(blf("frame-1", "sip:1@repl.com", 7));
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(primary.port());
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_TRUE(wait_for([&] { return primary.stats().standby_connected.load() == 1; }));
+    primary.on_delete("frame-1");
+
+    // Sync bracket around the one record, then the delete, then heartbeats
+    std::string in;
+    char buf[4096];
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(1500);
+    while (std::chrono::steady_clock::now() < deadline) {
+        struct pollfd pfd{fd, POLLIN, 0};
+        if (poll(&pfd, 1, 20) <= 0) continue;
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        in.append(buf, static_cast<size_t>(n));
+    }
+    close(fd);
+
+    std::vector<uint8_t> ops;
+    size_t off = 0;
+    while (in.size() - off >= replication::kFrameHeaderSize) {
+        uint32_t len = 0, sum = 0;
+        for (int i = 0; i < 4; ++i) {
+            len |= static_cast<uint32_t>(static_cast<uint8_t>(in[off + i])) << (8 * i);
+            sum |= static_cast<uint32_t>(static_cast<uint8_t>(in[off + 4 + i])) << (8 * i);
+        }
+        ASSERT_LE(off + replication::kFrameHeaderSize + len, in.size());
+        const char* payload = in.data() + off + replication::kFrameHeaderSize;
+        ASSERT_EQ(SubscriptionCodec::checksum(payload, len), sum);
+        ops.push_back(static_cast<uint8_t>(payload[0]));
+        if (payload[0] == replication::kOpUpsert) {
+            SubscriptionRecord rec;
+            ASSERT_TRUE(SubscriptionCodec::decode(payload + 1, len - 1, rec));
+            EXPECT_EQ(rec.dialog_id, "frame-1");
+            EXPECT_EQ(rec.notify_cseq, 7u);
+        } else if (payload[0] == replication::kOpDelete) {
+            EXPECT_EQ(std::string(payload + 1, len - 1), "frame-1");
+        }
+        off += replication::kFrameHeaderSize + len;
+    }
+    EXPECT_EQ(off, in.size());
+    ASSERT_GE(ops.size(), 5u);
+    EXPECT_EQ(ops[0], replication::kOpSyncBegin);
+    EXPECT_EQ(ops[1], replication::kOpUpsert);
+    EXPECT_EQ(ops[2], replication::kOpSyncEnd);
+    EXPECT_EQ(ops[3], replication::kOpDelete);
+    EXPECT_EQ(ops[4], replication::kOpHeartbeat);
+    primary.stop();
+}
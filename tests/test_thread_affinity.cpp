@@ -0,0 +1,61 @@
+
+// =============================================================================
+// FILE: tests/test_thread_affinity.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "common/thread_affinity.h"
+#include <pthread.h>
+#include <sched.h>
+#include <cstring>
+#include <thread>
+
+using namespace sip_processor;
+
+TEST(ThreadAffinity, ParsesCpuLists) {
+    std::vector<int> cpus;
+    ASSERT_TRUE(parse_cpu_list("0-3, 8,10-11", cpus));
+    EXPECT_EQ(cpus, (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    ASSERT_TRUE(parse_cpu_list("", cpus));
+    EXPECT_TRUE(cpus.empty());
+
+    EXPECT_FALSE(parse_cpu_list("3-1", cpus));
+    EXPECT_FALSE(parse_cpu_list("a,b", cpus));
+    EXPECT_FALSE(parse_cpu_list("1,,2", cpus));
+    EXPECT_FALSE(parse_cpu_list("node999", cpus));
+}
+
+TEST(ThreadAffinity, DisabledOnlyNamesTheThread) {
+    Config cfg;
+    cfg.affinity_workers = "0";
+    ASSERT_TRUE(ThreadPlacement::instance().configure(cfg));
+    EXPECT_EQ(ThreadPlacement::instance().worker_cpu(0), -1);
+
+    std::thread t([] {
+        EXPECT_FALSE(ThreadPlacement::instance().place(ThreadRole::kWorker, 0, "sip-worker-0-long-name"));
+        char name[16] = {};
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+        EXPECT_STREQ(name, "sip-worker-0-lo");
+    });
+    t.join();
+}
+
+TEST(ThreadAffinity, PinsWorkersRoundRobin) {
+    Config cfg;
+    cfg.affinity_enabled = true;
+    cfg.affinity_workers = "0";
+    cfg.affinity_http = "bogus";
+    EXPECT_FALSE(ThreadPlacement::instance().configure(cfg));   // http left unpinned
+    EXPECT_EQ(ThreadPlacement::instance().worker_cpu(3), 0);
+
+    std::thread t([] {
+        EXPECT_FALSE(ThreadPlacement::instance().place(ThreadRole::kHttp, 0, "http-loop"));
+        ASSERT_TRUE(ThreadPlacement::instance().place(ThreadRole::kWorker, 3, "sip-worker-3"));
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+        EXPECT_EQ(CPU_COUNT(&set), 1);
+        EXPECT_TRUE(CPU_ISSET(0, &set));
+    });
+    t.join();
+    ThreadPlacement::instance().configure(Config{});
+}
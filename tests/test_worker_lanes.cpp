@@ -0,0 +1,82 @@
+
+// =============================================================================
+// FILE: tests/test_worker_lanes.cpp
+// =============================================================================
+#include <gtest/gtest.h>
+#include "dispatch/dialog_worker.h"
+#include "common/latency_histogram.h"
+#include "common/slow_event_logger.h"
+#include "common/logger.h"
+#include "test_helpers.h"
+#include <chrono>
+#include <thread>
+
+using namespace sip_processor;
+
+namespace {
+
+Config lane_config() {
+    Config c = test::worker_config();
+    c.dispatcher_feed_batch = 100;
+    c.dispatcher_feed_guard_batch = 10;
+    return c;
+}
+
+std::unique_ptr<SipEvent> subscribe(const std::string& did) {
+    return test::subscribe(did, "lanes.com");
+}
+
+std::unique_ptr<SipEvent> trigger(const std::string& did) {
+    auto ev = SipEvent::create_presence_trigger(did, TenantId("lanes.com"), "c1", "sip:a@lanes.com",
+                                                "sip:b@lanes.com", "confirmed", "inbound", "");
+    ev->enqueued_at = Clock::now();
+    return ev;
+}
+
+}  // namespace
+
+TEST(WorkerLanes, TransactionOvertakesPresenceBurst) {
+    Logger::instance().set_level(LogLevel::kError);
+    Config cfg = lane_config();
+    DialogWorker worker(0, cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    for (int i = 0; i < 2000; ++i) {
+        SubscriptionRecord rec;
+        rec.dialog_id = "burst-" + std::to_string(i);
+        rec.tenant_id = TenantId("lanes.com");
+        rec.type = SubscriptionType::kBLF;
+        rec.lifecycle = SubLifecycle::kActive;
+        worker.load_recovered_subscription(std::move(rec));
+    }
+
+    // The burst is queued ahead of the SUBSCRIBE
+    for (int i = 0; i < 2000; ++i) ASSERT_EQ(worker.enqueue(trigger("burst-" + std::to_string(i))), Result::kOk);
+    ASSERT_EQ(worker.enqueue(subscribe("fresh")), Result::kOk);
+    EXPECT_EQ(worker.stats().transaction_queue_depth.load(), 1u);
+    EXPECT_EQ(worker.stats().feed_queue_depth.load(), 2000u);
+
+    LatencyRecorder::instance().reset();
+    ASSERT_EQ(worker.start(), Result::kOk);
+    for (int i = 0; i < 300 && worker.stats().events_processed.load() < 2001; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(worker.stats().events_processed.load(), 2001u);
+    worker.stop();
+
+    // First cycle: the SUBSCRIBE plus only the guard batch of triggers
+    EXPECT_EQ(worker.stats().feed_throttled_cycles.load(), 1u);
+    auto sip = LatencyRecorder::instance().snapshot(LatencyStage::kQueueWaitSip);
+    auto feed = LatencyRecorder::instance().snapshot(LatencyStage::kQueueWaitFeed);
+    EXPECT_EQ(sip.count, 1u);
+    EXPECT_EQ(feed.count, 2000u);
+    EXPECT_LT(sip.max, feed.max);
+}
+
+TEST(WorkerLanes, FullFeedLaneStillAcceptsTransactions) {
+    Config cfg = lane_config();
+    cfg.max_incoming_queue_per_worker = 50;
+    DialogWorker worker(0, cfg, std::make_shared<SlowEventLogger>(cfg), nullptr);
+    for (int i = 0; i < 50; ++i) ASSERT_EQ(worker.enqueue(trigger("d" + std::to_string(i))), Result::kOk);
+    EXPECT_EQ(worker.enqueue(trigger("over")), Result::kCapacityExceeded);
+    EXPECT_EQ(worker.enqueue(subscribe("new")), Result::kOk);
+    EXPECT_EQ(worker.stats().queue_depth.load(), 51u);
+}